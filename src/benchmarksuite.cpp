@@ -0,0 +1,445 @@
+module;
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QQuickWindow>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QUuid>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#if defined(Q_OS_WIN)
+extern "C" {
+#include <windows.h>
+#include <psapi.h>
+}
+#if defined(_MSC_VER)
+#pragma comment(lib, "psapi.lib")
+#endif
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#endif
+
+module genyconnect.backend.benchmarksuite;
+import genyconnect.backend.linkparser;
+import genyconnect.backend.serverprofile;
+
+namespace {
+constexpr int kGroupCount = 20;
+constexpr int kSourceCount = 8;
+constexpr int kFloodTickMs = 10;
+constexpr int kFloodWarmupMs = 500;
+
+// Resident set size; coarse (the allocator keeps freed pages), so only
+// differences across one large allocation are meaningful.
+qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS memInfo;
+    std::memset(&memInfo, 0, sizeof(memInfo));
+    memInfo.cb = sizeof(memInfo);
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memInfo, static_cast<DWORD>(sizeof(memInfo)))) {
+        return static_cast<qint64>(memInfo.WorkingSetSize);
+    }
+    return -1;
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info taskInfo;
+    mach_msg_type_number_t taskInfoCount = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  reinterpret_cast<task_info_t>(&taskInfo), &taskInfoCount) == KERN_SUCCESS) {
+        return static_cast<qint64>(taskInfo.resident_size);
+    }
+    return -1;
+#elif defined(Q_OS_LINUX)
+    QFile statusFile(QStringLiteral("/proc/self/status"));
+    if (!statusFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    while (!statusFile.atEnd()) {
+        const QByteArray line = statusFile.readLine();
+        if (line.startsWith("VmRSS:")) {
+            const QList<QByteArray> parts = line.simplified().split(' ');
+            return parts.size() >= 2 ? parts.at(1).toLongLong() * 1024 : -1;
+        }
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+// Frame interval percentiles in milliseconds.
+QJsonObject frameStats(QList<qint64> intervalsNs)
+{
+    std::sort(intervalsNs.begin(), intervalsNs.end());
+    const auto percentileMs = [&intervalsNs](double q) {
+        if (intervalsNs.isEmpty()) {
+            return 0.0;
+        }
+        const qsizetype index = qMin(intervalsNs.size() - 1, static_cast<qsizetype>(q * intervalsNs.size()));
+        return intervalsNs.at(index) / 1.0e6;
+    };
+    return QJsonObject {
+        {QStringLiteral("frames"), static_cast<int>(intervalsNs.size())},
+        {QStringLiteral("p50Ms"), percentileMs(0.50)},
+        {QStringLiteral("p95Ms"), percentileMs(0.95)},
+        {QStringLiteral("p99Ms"), percentileMs(0.99)},
+        {QStringLiteral("maxMs"), intervalsNs.isEmpty() ? 0.0 : intervalsNs.last() / 1.0e6}
+    };
+}
+
+// The profile layout before interning: every text field an owned QString
+// and both JSON objects inline.
+struct LegacyServerProfile {
+    QString id;
+    QString name;
+    QString protocol;
+    QString address;
+    quint16 port = 0;
+    QString userId;
+    QString encryption;
+    QString flow;
+    QString network;
+    QString security;
+    QString sni;
+    QString alpn;
+    QString fingerprint;
+    QString publicKey;
+    QString shortId;
+    QString spiderX;
+    QString path;
+    QString hostHeader;
+    QString serviceName;
+    QString headerType;
+    QString xhttpMode;
+    QJsonObject xhttpExtra;
+    bool allowInsecure = false;
+    QString originalLink;
+    QString groupName;
+    QString sourceName;
+    QString sourceId;
+    QJsonObject extra;
+    int lastPingMs = -1;
+    bool pingInProgress = false;
+};
+
+QString detached(const QString& value)
+{
+    return value.isEmpty() ? QString() : QString(value.constData(), value.size());
+}
+
+QJsonObject detached(const QJsonObject& value)
+{
+    return value.isEmpty()
+        ? QJsonObject()
+        : QJsonDocument::fromJson(QJsonDocument(value).toJson(QJsonDocument::Compact)).object();
+}
+
+// What the old parser kept for a link: values read from the link in their
+// own allocations, the protocol as a literal and the link itself shared.
+LegacyServerProfile legacyProfile(const ServerProfile& profile)
+{
+    LegacyServerProfile legacy;
+    legacy.id = detached(profile.id);
+    legacy.name = detached(profile.name);
+    legacy.protocol = profile.protocol.toString();
+    legacy.address = detached(profile.address);
+    legacy.port = profile.port;
+    legacy.userId = detached(profile.userId);
+    legacy.encryption = detached(profile.encryption.toString());
+    legacy.flow = detached(profile.flow.toString());
+    legacy.network = detached(profile.network.toString());
+    legacy.security = detached(profile.security.toString());
+    legacy.sni = detached(profile.sni);
+    legacy.alpn = detached(profile.alpn);
+    legacy.fingerprint = detached(profile.fingerprint.toString());
+    legacy.publicKey = detached(profile.publicKey());
+    legacy.shortId = detached(profile.shortId());
+    legacy.spiderX = detached(profile.spiderX());
+    legacy.path = detached(profile.path);
+    legacy.hostHeader = detached(profile.hostHeader);
+    legacy.serviceName = detached(profile.serviceName());
+    legacy.headerType = detached(profile.headerType.toString());
+    legacy.xhttpMode = detached(profile.xhttpMode);
+    legacy.xhttpExtra = detached(profile.xhttpExtra());
+    legacy.allowInsecure = profile.allowInsecure;
+    legacy.originalLink = profile.originalLink;
+    legacy.extra = detached(profile.extra());
+    return legacy;
+}
+
+// A mix of the share links real subscriptions carry: VLESS over
+// REALITY/TCP, TLS/WS and gRPC, and VMess over WS.
+QString syntheticLink(int index)
+{
+    const QString uuid = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    const QString host = QStringLiteral("node%1.example.net").arg(index);
+    const QString name = QStringLiteral("Node %1").arg(index);
+    switch (index % 4) {
+    case 0:
+        return QStringLiteral("vless://%1@%2:443?encryption=none&flow=xtls-rprx-vision&security=reality"
+                              "&sni=www.example.com&fp=chrome&pbk=Z84J2IelR9ch3k8VtlVhhs5ycBUlXA7wHBWcBrjqnAw"
+                              "&sid=6ba85179e30d4fc2&type=tcp&headerType=none#%3")
+            .arg(uuid, host, name);
+    case 1:
+        return QStringLiteral("vless://%1@%2:443?encryption=none&security=tls&sni=%2&fp=firefox"
+                              "&alpn=h2,http/1.1&type=ws&host=%2&path=/ws#%3")
+            .arg(uuid, host, name);
+    case 2:
+        return QStringLiteral("vless://%1@%2:443?encryption=none&security=tls&sni=%2&fp=chrome"
+                              "&type=grpc&serviceName=grpc-%4#%3")
+            .arg(uuid, host, name)
+            .arg(index % 16);
+    default: {
+        const QJsonObject vmess {
+            {QStringLiteral("v"), QStringLiteral("2")},
+            {QStringLiteral("ps"), name},
+            {QStringLiteral("add"), host},
+            {QStringLiteral("port"), QStringLiteral("443")},
+            {QStringLiteral("id"), uuid},
+            {QStringLiteral("aid"), QStringLiteral("0")},
+            {QStringLiteral("scy"), QStringLiteral("auto")},
+            {QStringLiteral("net"), QStringLiteral("ws")},
+            {QStringLiteral("type"), QStringLiteral("none")},
+            {QStringLiteral("host"), host},
+            {QStringLiteral("path"), QStringLiteral("/vmess")},
+            {QStringLiteral("tls"), QStringLiteral("tls")},
+            {QStringLiteral("sni"), host},
+            {QStringLiteral("fp"), QStringLiteral("safari")}
+        };
+        return QStringLiteral("vmess://")
+            + QString::fromLatin1(QJsonDocument(vmess).toJson(QJsonDocument::Compact).toBase64());
+    }
+    }
+}
+}
+
+QJsonObject BenchmarkSuite::profileMemory(const ProfileMemoryOptions& options, bool *passed)
+{
+    const int count = qMax(1, options.profiles);
+    const int rounds = qMax(0, options.rounds);
+
+    QStringList links;
+    links.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        links.append(syntheticLink(i));
+    }
+    // An import assigns one group and source string to all of its profiles.
+    QStringList groups;
+    for (int i = 0; i < kGroupCount; ++i) {
+        groups.append(QStringLiteral("Group %1").arg(i));
+    }
+    QStringList sourceNames;
+    QStringList sourceIds;
+    for (int i = 0; i < kSourceCount; ++i) {
+        sourceNames.append(QStringLiteral("Subscription %1").arg(i));
+        sourceIds.append(QStringLiteral("sub-%1").arg(i));
+    }
+
+    // The current layout is measured first and kept alive: RSS only grows,
+    // so the legacy list on top of it is a second clean delta.
+    const qsizetype tableBefore = InternedString::tableSize();
+    const qint64 rssBefore = residentBytes();
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<ServerProfile> profiles;
+    profiles.reserve(count);
+    int parseFailures = 0;
+    for (int i = 0; i < count; ++i) {
+        auto parsed = LinkParser::parse(links.at(i));
+        if (!parsed.has_value()) {
+            ++parseFailures;
+            continue;
+        }
+        parsed->groupName = groups.at(i % kGroupCount);
+        parsed->sourceName = sourceNames.at(i % kSourceCount);
+        parsed->sourceId = sourceIds.at(i % kSourceCount);
+        profiles.append(*parsed);
+    }
+    const double parseMs = timer.nsecsElapsed() / 1.0e6;
+    const qint64 rssAfter = residentBytes();
+    const qsizetype tableAfterImport = InternedString::tableSize();
+
+    QList<LegacyServerProfile> legacyProfiles;
+    legacyProfiles.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const auto parsed = LinkParser::parse(links.at(i));
+        if (!parsed.has_value()) {
+            continue;
+        }
+        LegacyServerProfile legacy = legacyProfile(*parsed);
+        legacy.groupName = groups.at(i % kGroupCount);
+        legacy.sourceName = sourceNames.at(i % kSourceCount);
+        legacy.sourceId = sourceIds.at(i % kSourceCount);
+        legacyProfiles.append(std::move(legacy));
+    }
+    const qint64 rssAfterLegacy = residentBytes();
+    legacyProfiles.clear();
+    legacyProfiles.squeeze();
+
+    // A detached copy touches every element, including the interned handles.
+    timer.restart();
+    QList<ServerProfile> copy = profiles;
+    copy.detach();
+    const double copyMs = timer.nsecsElapsed() / 1.0e6;
+    copy.clear();
+
+    // Each round replaces the list with one whose subscription-controlled
+    // values are all new, as a refresh of a churning subscription would.
+    qsizetype tablePeak = tableAfterImport;
+    for (int round = 0; round < rounds; ++round) {
+        QList<ServerProfile> refreshed = profiles;
+        for (qsizetype i = 0; i < refreshed.size(); ++i) {
+            refreshed[i].fingerprint = QStringLiteral("fp-%1-%2").arg(round).arg(i);
+            refreshed[i].groupName = QStringLiteral("Group %1-%2").arg(round).arg(i % kGroupCount);
+        }
+        profiles = std::move(refreshed);
+        tablePeak = qMax(tablePeak, InternedString::tableSize());
+    }
+    const qsizetype tableAfterChurn = InternedString::tableSize();
+    profiles.clear();
+    profiles.squeeze();
+    const qsizetype tableAfterRelease = InternedString::tableSize();
+
+    const qint64 rssDelta = (rssBefore >= 0 && rssAfter >= 0) ? rssAfter - rssBefore : -1;
+    const qint64 legacyRssDelta = (rssAfter >= 0 && rssAfterLegacy >= 0) ? rssAfterLegacy - rssAfter : -1;
+    const double reduction = rssDelta > 0 && legacyRssDelta >= 0
+        ? static_cast<double>(legacyRssDelta) / static_cast<double>(rssDelta)
+        : -1.0;
+    const bool ok = parseFailures == 0
+                    && tableAfterRelease <= tableBefore
+                    && reduction >= options.minReduction;
+    if (passed) {
+        *passed = ok;
+    }
+
+    return QJsonObject {
+        {QStringLiteral("profiles"), count},
+        {QStringLiteral("parseFailures"), parseFailures},
+        {QStringLiteral("rounds"), rounds},
+        {QStringLiteral("internedHandleBytes"), static_cast<int>(sizeof(InternedString))},
+        {QStringLiteral("parseMs"), parseMs},
+        {QStringLiteral("copyMs"), copyMs},
+        {QStringLiteral("current"), QJsonObject {
+            {QStringLiteral("profileInlineBytes"), static_cast<int>(sizeof(ServerProfile))},
+            {QStringLiteral("rssDeltaBytes"), rssDelta},
+            {QStringLiteral("rssBytesPerProfile"), rssDelta >= 0 ? static_cast<double>(rssDelta) / count : -1.0}
+        }},
+        {QStringLiteral("legacy"), QJsonObject {
+            {QStringLiteral("profileInlineBytes"), static_cast<int>(sizeof(LegacyServerProfile))},
+            {QStringLiteral("rssDeltaBytes"), legacyRssDelta},
+            {QStringLiteral("rssBytesPerProfile"), legacyRssDelta >= 0 ? static_cast<double>(legacyRssDelta) / count : -1.0}
+        }},
+        {QStringLiteral("reduction"), reduction},
+        {QStringLiteral("minReduction"), options.minReduction},
+        {QStringLiteral("internTable"), QJsonObject {
+            {QStringLiteral("beforeImport"), tableBefore},
+            {QStringLiteral("afterImport"), tableAfterImport},
+            {QStringLiteral("peakDuringChurn"), tablePeak},
+            {QStringLiteral("afterChurn"), tableAfterChurn},
+            {QStringLiteral("afterRelease"), tableAfterRelease}
+        }},
+        {QStringLiteral("passed"), ok}
+    };
+}
+
+QJsonObject BenchmarkSuite::logFloodFrameTime(QQuickWindow *window,
+                                              const std::function<void(const QString&)>& postLine,
+                                              const LogFloodOptions& options,
+                                              bool *passed)
+{
+    if (passed) {
+        *passed = false;
+    }
+    if (window == nullptr || !postLine) {
+        return QJsonObject {
+            {QStringLiteral("error"), QStringLiteral("Main window is not loaded.")},
+            {QStringLiteral("passed"), false}
+        };
+    }
+    const int durationMs = qMax(500, options.durationMs);
+    const int linesPerTick = qMax(1, options.linesPerSecond * kFloodTickMs / 1000);
+
+    // An idle window renders nothing, so keep requesting frames the way a
+    // running animation would; a stalled GUI thread then shows up as longer
+    // intervals instead of as missing frames.
+    const QMetaObject::Connection keepRendering = QObject::connect(
+        window, &QQuickWindow::frameSwapped, window, &QQuickWindow::requestUpdate, Qt::QueuedConnection);
+    window->show();
+    window->requestUpdate();
+
+    QElapsedTimer frameClock;
+    frameClock.start();
+    qint64 lastFrameNs = -1;
+    QList<qint64> intervalsNs;
+    const QMetaObject::Connection frameProbe = QObject::connect(window, &QQuickWindow::afterAnimating, window, [&]() {
+        const qint64 nowNs = frameClock.nsecsElapsed();
+        if (lastFrameNs >= 0) {
+            intervalsNs.append(nowNs - lastFrameNs);
+        }
+        lastFrameNs = nowNs;
+    });
+
+    // Lines are posted one at a time from the GUI thread, as the process
+    // manager's logLine signal delivers them.
+    qint64 linesPosted = 0;
+    QTimer producer;
+    producer.setInterval(kFloodTickMs);
+    QObject::connect(&producer, &QTimer::timeout, &producer, [&postLine, linesPerTick, &linesPosted]() {
+        for (int i = 0; i < linesPerTick; ++i, ++linesPosted) {
+            postLine(QStringLiteral("from 10.0.0.2:%1 accepted tcp:host%2.example.net:443 [tun-in -> proxy]")
+                         .arg(40000 + linesPosted % 20000)
+                         .arg(linesPosted % 997));
+        }
+    });
+
+    const auto runPhase = [&](int ms, bool flood) {
+        intervalsNs.clear();
+        lastFrameNs = -1;
+        QEventLoop loop;
+        QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+        if (flood) {
+            producer.start();
+        }
+        loop.exec();
+        producer.stop();
+        return intervalsNs;
+    };
+
+    runPhase(kFloodWarmupMs, false);
+    const QJsonObject idle = frameStats(runPhase(durationMs, false));
+    const QJsonObject flood = frameStats(runPhase(durationMs, true));
+
+    QObject::disconnect(frameProbe);
+    QObject::disconnect(keepRendering);
+
+    const bool ok = idle.value(QStringLiteral("frames")).toInt() > 0
+                    && flood.value(QStringLiteral("frames")).toInt() > 0
+                    && flood.value(QStringLiteral("p95Ms")).toDouble()
+                           <= idle.value(QStringLiteral("p95Ms")).toDouble() + options.maxExtraP95Ms;
+    if (passed) {
+        *passed = ok;
+    }
+    return QJsonObject {
+        {QStringLiteral("durationMs"), durationMs},
+        {QStringLiteral("linesPerSecond"), linesPerTick * 1000 / kFloodTickMs},
+        {QStringLiteral("linesPosted"), linesPosted},
+        {QStringLiteral("maxExtraP95Ms"), options.maxExtraP95Ms},
+        {QStringLiteral("idle"), idle},
+        {QStringLiteral("flood"), flood},
+        {QStringLiteral("passed"), ok}
+    };
+}
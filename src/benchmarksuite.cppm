@@ -0,0 +1,82 @@
+/*!
+ * @file        benchmarksuite.cppm
+ * @brief       Headless checks and measurements of backend building blocks.
+ *
+ * @details
+ * Complements TunnelBenchmark with checks that do not need a network: each
+ * entry point runs synthetic but representative input through one backend
+ * component, measures it and returns a JSON report with a pass/fail verdict,
+ * so CI can run it from the command line next to `--tunnel-benchmark`.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QJsonObject>
+#include <QString>
+
+#include <functional>
+
+class QQuickWindow;
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.benchmarksuite;
+#endif
+
+/**
+ * @class BenchmarkSuite
+ * @brief Runs one backend check and reports it as JSON.
+ */
+export class BenchmarkSuite
+{
+public:
+    /**
+     * @struct ProfileMemoryOptions
+     * @brief Shape of the profile memory check.
+     */
+    struct ProfileMemoryOptions {
+        int profiles = 100000;                  //!< Profiles parsed from generated share links.
+        int rounds = 5;                         //!< Re-imports with fresh subscription-controlled values.
+        double minReduction = 3.0;              //!< Required legacy-to-current resident memory ratio.
+    };
+
+    /**
+     * @brief Measure the in-memory cost of a large profile list against the
+     *        pre-interning layout and check that re-imports do not grow the
+     *        interned string table.
+     * @param options Check shape.
+     * @param passed Output verdict: the memory reduction met the target and the
+     *        table returned to its size before the import.
+     * @return Report with timings, resident memory per profile of both layouts,
+     *         their ratio and table sizes.
+     */
+    static QJsonObject profileMemory(const ProfileMemoryOptions& options, bool *passed);
+
+    /**
+     * @struct LogFloodOptions
+     * @brief Shape of the frame-time check under a log flood.
+     */
+    struct LogFloodOptions {
+        int durationMs = 5000;                  //!< Length of the idle and the flood phase each.
+        int linesPerSecond = 20000;             //!< Runtime lines posted during the flood.
+        int maxExtraP95Ms = 8;                  //!< Allowed growth of the 95th percentile frame interval.
+    };
+
+    /**
+     * @brief Measure frame intervals of the application window while runtime
+     *        log lines are flooded into it, against an idle baseline.
+     * @param window Loaded main window; kept rendering continuously during the check.
+     * @param postLine Delivers one runtime line the way xray-core output arrives.
+     * @param options Check shape.
+     * @param passed Output verdict: the flood kept the p95 frame interval within the allowance.
+     * @return Report with frame interval percentiles of both phases.
+     * @note Runs its own event loop on the GUI thread.
+     */
+    static QJsonObject logFloodFrameTime(QQuickWindow *window,
+                                         const std::function<void(const QString&)>& postLine,
+                                         const LogFloodOptions& options,
+                                         bool *passed);
+};
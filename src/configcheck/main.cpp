@@ -0,0 +1,290 @@
+// Runtime config golden check.
+//
+// The golden documents under golden/ were written once by the JSON-tree
+// builder of the last release before the typed config model (commit 12fcc60),
+// including the TUN DNS and noise-block passes that writeRuntimeConfig ran on
+// its output, for Linux, macOS and Windows. Each file holds the profile, the
+// build options and the expected config per platform; this tool rebuilds the
+// config with XrayConfigBuilder and reports the first difference.
+//
+// Matcher arrays of routing rules are compared as sets: xray matches a rule if
+// any of its matchers does, and RoutingRuleCompiler may reorder them.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVariant>
+
+#include <algorithm>
+#include <optional>
+
+import genyconnect.backend.serverprofile;
+import genyconnect.backend.xraycapabilities;
+import genyconnect.backend.xrayconfigbuilder;
+
+namespace {
+#if defined(Q_OS_WIN)
+constexpr char kPlatformKey[] = "windows";
+#elif defined(Q_OS_MACOS)
+constexpr char kPlatformKey[] = "macos";
+#else
+constexpr char kPlatformKey[] = "linux";
+#endif
+
+// A core that accepts everything the baseline builder wrote unconditionally.
+XrayCapabilities fullyCapableCore()
+{
+    XrayCapabilities core;
+    core.executablePath = QStringLiteral("golden");
+    core.fingerprint = QStringLiteral("golden");
+    core.version = QStringLiteral("26.2.6");
+    core.versionMajor = 26;
+    core.versionMinor = 2;
+    core.versionPatch = 6;
+    core.processRouting = true;
+    core.transports = {
+        QStringLiteral("tcp"), QStringLiteral("raw"), QStringLiteral("ws"), QStringLiteral("grpc"),
+        QStringLiteral("httpupgrade"), QStringLiteral("xhttp"), QStringLiteral("splithttp"),
+        QStringLiteral("kcp"), QStringLiteral("quic"), QStringLiteral("h2")
+    };
+    core.tunStacks = {QStringLiteral("system"), QStringLiteral("gvisor"), QStringLiteral("mixed")};
+    return core;
+}
+
+QStringList stringList(const QJsonValue& value)
+{
+    return value.toVariant().toStringList();
+}
+
+XrayConfigBuilder::BuildOptions buildOptions(const QJsonObject& json)
+{
+    XrayConfigBuilder::BuildOptions options;
+    options.socksPort = static_cast<quint16>(json.value(QStringLiteral("socksPort")).toInt(options.socksPort));
+    options.apiPort = static_cast<quint16>(json.value(QStringLiteral("apiPort")).toInt(options.apiPort));
+    options.logLevel = json.value(QStringLiteral("logLevel")).toString(options.logLevel);
+    options.enableMux = json.value(QStringLiteral("enableMux")).toBool(options.enableMux);
+    options.enableStatsApi = json.value(QStringLiteral("enableStatsApi")).toBool(options.enableStatsApi);
+    options.enableTun = json.value(QStringLiteral("enableTun")).toBool(options.enableTun);
+    options.tunAutoRoute = json.value(QStringLiteral("tunAutoRoute")).toBool(options.tunAutoRoute);
+    options.tunStrictRoute = json.value(QStringLiteral("tunStrictRoute")).toBool(options.tunStrictRoute);
+    options.tunInterfaceName = json.value(QStringLiteral("tunInterfaceName")).toString();
+    options.dnsServers = stringList(json.value(QStringLiteral("dnsServers")));
+    options.whitelistMode = json.value(QStringLiteral("whitelistMode")).toBool(options.whitelistMode);
+    options.enableProcessRouting = json.value(QStringLiteral("enableProcessRouting")).toBool(options.enableProcessRouting);
+    options.proxyDomains = stringList(json.value(QStringLiteral("proxyDomains")));
+    options.directDomains = stringList(json.value(QStringLiteral("directDomains")));
+    options.blockDomains = stringList(json.value(QStringLiteral("blockDomains")));
+    options.proxyProcesses = stringList(json.value(QStringLiteral("proxyProcesses")));
+    options.directProcesses = stringList(json.value(QStringLiteral("directProcesses")));
+    options.blockProcesses = stringList(json.value(QStringLiteral("blockProcesses")));
+    options.core = fullyCapableCore();
+    return options;
+}
+
+// Sorts matcher arrays so rules compare as xray evaluates them.
+QJsonObject normalizedConfig(QJsonObject config)
+{
+    QJsonObject routing = config.value(QStringLiteral("routing")).toObject();
+    QJsonArray rules = routing.value(QStringLiteral("rules")).toArray();
+    for (qsizetype i = 0; i < rules.size(); ++i) {
+        QJsonObject rule = rules.at(i).toObject();
+        for (const QString& key : {QStringLiteral("domain"), QStringLiteral("ip")}) {
+            if (!rule.contains(key)) {
+                continue;
+            }
+            QStringList matchers = stringList(rule.value(key));
+            matchers.sort();
+            rule.insert(key, QJsonArray::fromStringList(matchers));
+        }
+        rules[i] = rule;
+    }
+    routing.insert(QStringLiteral("rules"), rules);
+    config.insert(QStringLiteral("routing"), routing);
+    return config;
+}
+
+// Path of the first difference between two documents, empty when equal.
+QString firstDifference(const QJsonValue& expected, const QJsonValue& actual, const QString& path)
+{
+    if (expected.type() != actual.type()) {
+        return path;
+    }
+    if (expected.isObject()) {
+        const QJsonObject expectedObject = expected.toObject();
+        const QJsonObject actualObject = actual.toObject();
+        QStringList keys = expectedObject.keys() + actualObject.keys();
+        keys.removeDuplicates();
+        for (const QString& key : keys) {
+            const QString difference = firstDifference(
+                expectedObject.value(key), actualObject.value(key), path + QLatin1Char('.') + key);
+            if (!difference.isEmpty()) {
+                return difference;
+            }
+        }
+        return {};
+    }
+    if (expected.isArray()) {
+        const QJsonArray expectedArray = expected.toArray();
+        const QJsonArray actualArray = actual.toArray();
+        if (expectedArray.size() != actualArray.size()) {
+            return path + QStringLiteral(".length");
+        }
+        for (qsizetype i = 0; i < expectedArray.size(); ++i) {
+            const QString difference = firstDifference(
+                expectedArray.at(i), actualArray.at(i), QStringLiteral("%1[%2]").arg(path).arg(i));
+            if (!difference.isEmpty()) {
+                return difference;
+            }
+        }
+        return {};
+    }
+    return expected == actual ? QString() : path;
+}
+
+// Median and 95th percentile in microseconds.
+QJsonObject timingStats(QList<qint64> samplesNs)
+{
+    std::sort(samplesNs.begin(), samplesNs.end());
+    const auto percentileUs = [&samplesNs](double q) {
+        if (samplesNs.isEmpty()) {
+            return 0.0;
+        }
+        const qsizetype index = qMin(samplesNs.size() - 1, static_cast<qsizetype>(q * samplesNs.size()));
+        return samplesNs.at(index) / 1.0e3;
+    };
+    return QJsonObject {
+        {QStringLiteral("medianUs"), percentileUs(0.50)},
+        {QStringLiteral("p95Us"), percentileUs(0.95)}
+    };
+}
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Check typed runtime configs against the baseline golden documents."));
+    parser.addHelpOption();
+    const QCommandLineOption goldenOption(QStringLiteral("golden"), QStringLiteral("Directory of golden documents."), QStringLiteral("dir"), QStringLiteral(GENYCONNECT_CONFIG_GOLDEN_DIR));
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Timed builds of the largest case."), QStringLiteral("count"), QStringLiteral("200"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to a file instead of stdout."), QStringLiteral("file"));
+    parser.addOptions({goldenOption, iterationsOption, outputOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QDir goldenDir(parser.value(goldenOption));
+    const QStringList files = goldenDir.entryList({QStringLiteral("*.json")}, QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        err << "No golden documents in " << goldenDir.absolutePath() << "\n";
+        return 1;
+    }
+
+    bool ok = true;
+    QJsonArray caseReports;
+    QString timedCase;
+    std::optional<ServerProfile> timedProfile;
+    XrayConfigBuilder::BuildOptions timedOptions;
+    qsizetype timedBytes = -1;
+    for (const QString& fileName : files) {
+        QFile file(goldenDir.filePath(fileName));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "Cannot read " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+        const QJsonObject golden = QJsonDocument::fromJson(file.readAll()).object();
+        QJsonObject caseReport {{QStringLiteral("name"), QFileInfo(fileName).completeBaseName()}};
+
+        const std::optional<ServerProfile> profile = ServerProfile::fromJson(golden.value(QStringLiteral("profile")).toObject());
+        const QJsonObject expected = golden.value(QStringLiteral("config")).toObject()
+                                         .value(QLatin1StringView(kPlatformKey)).toObject();
+        if (!profile.has_value() || expected.isEmpty()) {
+            caseReport.insert(QStringLiteral("error"), QStringLiteral("Golden document has no profile or no config for this platform."));
+            caseReports.append(caseReport);
+            ok = false;
+            continue;
+        }
+
+        const XrayConfigBuilder::BuildOptions options = buildOptions(golden.value(QStringLiteral("options")).toObject());
+        const QByteArray typedBytes = XrayConfigBuilder::serialize(XrayConfigBuilder::buildConfig(*profile, options));
+        QJsonParseError parseError;
+        const QJsonDocument typedDocument = QJsonDocument::fromJson(typedBytes, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !typedDocument.isObject()) {
+            caseReport.insert(QStringLiteral("error"), QStringLiteral("Typed output is not valid JSON: %1").arg(parseError.errorString()));
+            caseReports.append(caseReport);
+            ok = false;
+            continue;
+        }
+
+        const QString difference = firstDifference(
+            normalizedConfig(expected), normalizedConfig(typedDocument.object()), QStringLiteral("$"));
+        caseReport.insert(QStringLiteral("equivalent"), difference.isEmpty());
+        if (!difference.isEmpty()) {
+            caseReport.insert(QStringLiteral("firstDifference"), difference);
+            ok = false;
+        }
+        caseReport.insert(QStringLiteral("typedBytes"), static_cast<qint64>(typedBytes.size()));
+        caseReports.append(caseReport);
+
+        if (typedBytes.size() > timedBytes) {
+            timedBytes = typedBytes.size();
+            timedCase = caseReport.value(QStringLiteral("name")).toString();
+            timedProfile = profile;
+            timedOptions = options;
+        }
+    }
+
+    // Build and serialize, as writeRuntimeConfig does before writing the file.
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    QList<qint64> buildNs;
+    if (timedProfile.has_value()) {
+        buildNs.reserve(iterations);
+        QElapsedTimer timer;
+        for (int i = 0; i < iterations; ++i) {
+            timer.start();
+            const QByteArray bytes = XrayConfigBuilder::serialize(XrayConfigBuilder::buildConfig(*timedProfile, timedOptions));
+            buildNs.append(timer.nsecsElapsed());
+            Q_UNUSED(bytes);
+        }
+    }
+
+    const QJsonObject report {
+        {QStringLiteral("platform"), QLatin1StringView(kPlatformKey)},
+        {QStringLiteral("cases"), caseReports},
+        {QStringLiteral("timing"), QJsonObject {
+            {QStringLiteral("case"), timedCase},
+            {QStringLiteral("iterations"), iterations},
+            {QStringLiteral("build"), timingStats(buildNs)},
+            {QStringLiteral("bytes"), static_cast<qint64>(qMax<qsizetype>(0, timedBytes))}
+        }},
+        {QStringLiteral("passed"), ok}
+    };
+
+    const QByteArray data = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    const QString outputPath = parser.value(outputOption);
+    if (outputPath.isEmpty()) {
+        QTextStream(stdout) << data;
+    } else {
+        QFile file(outputPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+            err << "Cannot write " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+    }
+    if (!ok) {
+        err << "[ConfigCheck] Typed runtime config differs from the baseline golden documents.\n";
+        return 2;
+    }
+    return 0;
+}
@@ -168,21 +168,21 @@ std::optional<ServerProfile> LinkParser::parseVmess(const QString& rawLink, QStr
     profile.flow = obj.value(QStringLiteral("flow")).toString().trimmed();
 
     profile.fingerprint = obj.value(QStringLiteral("fp")).toString().trimmed();
-    profile.publicKey = obj.value(QStringLiteral("pbk")).toString().trimmed();
-    profile.shortId = obj.value(QStringLiteral("sid")).toString().trimmed();
-    profile.spiderX = obj.value(QStringLiteral("spx")).toString().trimmed();
+    profile.setPublicKey(obj.value(QStringLiteral("pbk")).toString().trimmed());
+    profile.setShortId(obj.value(QStringLiteral("sid")).toString().trimmed());
+    profile.setSpiderX(obj.value(QStringLiteral("spx")).toString().trimmed());
 
-    profile.serviceName = obj.value(QStringLiteral("serviceName")).toString().trimmed();
+    profile.setServiceName(obj.value(QStringLiteral("serviceName")).toString().trimmed());
     profile.xhttpMode = obj.value(QStringLiteral("mode")).toString().trimmed().toLower();
     if (profile.network == QStringLiteral("xhttp") && profile.xhttpMode.isEmpty()) {
         profile.xhttpMode = QStringLiteral("auto");
     }
-    profile.xhttpExtra = obj.value(QStringLiteral("extra")).toObject();
+    profile.setXhttpExtra(obj.value(QStringLiteral("extra")).toObject());
     const QString allowInsecure = obj.value(QStringLiteral("allowInsecure")).toString().trimmed().toLower();
     profile.allowInsecure = (allowInsecure == QStringLiteral("1") || allowInsecure == QStringLiteral("true"));
 
     profile.originalLink = rawLink;
-    profile.extra = obj;
+    profile.setExtra(obj);
 
     if (!profile.isValid()) {
         setError(errorMessage, QStringLiteral("VMESS link is missing required fields."));
@@ -244,7 +244,7 @@ std::optional<ServerProfile> LinkParser::parseVless(const QString& rawLink, QStr
     profile.headerType = query.queryItemValue(QStringLiteral("headerType")).trimmed().toLower();
 
     profile.hostHeader = query.queryItemValue(QStringLiteral("host")).trimmed();
-    profile.serviceName = query.queryItemValue(QStringLiteral("serviceName")).trimmed();
+    profile.setServiceName(query.queryItemValue(QStringLiteral("serviceName")).trimmed());
     profile.xhttpMode = query.queryItemValue(QStringLiteral("mode")).trimmed().toLower();
     if (profile.network == QStringLiteral("xhttp") && profile.xhttpMode.isEmpty()) {
         profile.xhttpMode = QStringLiteral("auto");
@@ -257,7 +257,7 @@ std::optional<ServerProfile> LinkParser::parseVless(const QString& rawLink, QStr
             setError(errorMessage, QStringLiteral("VLESS link has invalid XHTTP extra JSON."));
             return std::nullopt;
         }
-        profile.xhttpExtra = *xhttpExtra;
+        profile.setXhttpExtra(*xhttpExtra);
     }
 
     profile.sni = query.queryItemValue(QStringLiteral("sni")).trimmed();
@@ -267,9 +267,9 @@ std::optional<ServerProfile> LinkParser::parseVless(const QString& rawLink, QStr
 
     profile.alpn = query.queryItemValue(QStringLiteral("alpn")).trimmed();
     profile.fingerprint = query.queryItemValue(QStringLiteral("fp")).trimmed();
-    profile.publicKey = query.queryItemValue(QStringLiteral("pbk")).trimmed();
-    profile.shortId = query.queryItemValue(QStringLiteral("sid")).trimmed();
-    profile.spiderX = query.queryItemValue(QStringLiteral("spx")).trimmed();
+    profile.setPublicKey(query.queryItemValue(QStringLiteral("pbk")).trimmed());
+    profile.setShortId(query.queryItemValue(QStringLiteral("sid")).trimmed());
+    profile.setSpiderX(query.queryItemValue(QStringLiteral("spx")).trimmed());
 
     QString allowInsecure = query.queryItemValue(QStringLiteral("allowInsecure")).trimmed().toLower();
     if (allowInsecure.isEmpty()) {
@@ -0,0 +1,200 @@
+module;
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+module genyconnect.backend.logpipeline;
+
+namespace {
+constexpr int kFlushIntervalMs = 120;
+constexpr int kTailIntervalMs = 200;
+constexpr int kMaxTailBufferBytes = 512 * 1024;
+constexpr int kTailBufferKeepBytes = 256 * 1024;
+}
+
+LogPipeline::LogPipeline(QObject *parent)
+    : QObject(parent)
+    , m_flushTimer(new QTimer(this))
+    , m_tailTimer(new QTimer(this))
+{
+    // Timers are children so they follow the pipeline into its worker thread.
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kFlushIntervalMs);
+    connect(m_flushTimer, &QTimer::timeout, this, [this]() {
+        if (!m_dirty) {
+            return;
+        }
+        m_dirty = false;
+        emit snapshotReady(m_lines, m_latestRuntimeLine);
+    });
+    m_tailTimer->setInterval(kTailIntervalMs);
+    connect(m_tailTimer, &QTimer::timeout, this, &LogPipeline::pollTail);
+}
+
+bool LogPipeline::isNoisyLine(const QString& line)
+{
+    // Hide internal Stats API polling noise from UI logs.
+    if (line.contains(QStringLiteral("[api-in -> api]"))) {
+        return true;
+    }
+    if (!line.contains(QStringLiteral(" accepted "))) {
+        return false;
+    }
+    // Drop high-frequency link-local broadcast noise in TUN mode
+    // (for example: udp:* -> 169.254.255.255:137 [tun-in -> direct]),
+    // which can flood logs and stall UI updates.
+    if (line.contains(QStringLiteral("[tun-in -> direct]"))
+        && (line.contains(QStringLiteral("udp:169.254.255.255:137"))
+            || line.contains(QStringLiteral("udp:255.255.255.255:137"))
+            || line.contains(QStringLiteral("udp:169.254.255.255:138"))
+            || line.contains(QStringLiteral("udp:255.255.255.255:138"))
+            || line.contains(QStringLiteral("from tcp:169.254."))
+            || line.contains(QStringLiteral("from udp:169.254."))
+            || line.contains(QStringLiteral("udp:224.")))) {
+        return true;
+    }
+    // Keep tun-in traffic visible for diagnostics; suppress only noisy local-proxy chatter.
+    if (line.contains(QStringLiteral("[tun-in ->"))) {
+        return false;
+    }
+    return line.contains(QStringLiteral(">> proxy"))
+           || line.contains(QStringLiteral("socks ->"))
+           || line.contains(QStringLiteral("mixed-in ->"));
+}
+
+void LogPipeline::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (!m_enabled) {
+        clear();
+    }
+}
+
+void LogPipeline::setCapacity(int lines)
+{
+    m_capacity = qMax(1, lines);
+    if (m_lines.size() > m_capacity) {
+        m_lines.remove(0, m_lines.size() - m_capacity);
+        scheduleFlush();
+    }
+}
+
+void LogPipeline::appendRuntimeLine(const QString& line)
+{
+    if (!m_enabled || isNoisyLine(line)) {
+        return;
+    }
+    m_latestRuntimeLine = line;
+    pushLine(line);
+}
+
+void LogPipeline::appendSystemLine(const QString& message)
+{
+    if (!m_enabled) {
+        return;
+    }
+    if (!m_lines.isEmpty() && m_lines.last() == message) {
+        return;
+    }
+    pushLine(message);
+}
+
+void LogPipeline::clear()
+{
+    m_flushTimer->stop();
+    m_dirty = false;
+    if (m_lines.isEmpty() && m_latestRuntimeLine.isEmpty()) {
+        return;
+    }
+    m_lines.clear();
+    m_latestRuntimeLine.clear();
+    emit snapshotReady(m_lines, m_latestRuntimeLine);
+}
+
+void LogPipeline::startTail(const QString& path)
+{
+    m_tailPath = path;
+    m_tailOffset = 0;
+    m_tailBuffer.clear();
+    if (m_tailPath.isEmpty()) {
+        m_tailTimer->stop();
+        return;
+    }
+    m_tailTimer->start();
+}
+
+void LogPipeline::stopTail()
+{
+    m_tailTimer->stop();
+    m_tailPath.clear();
+    m_tailOffset = 0;
+    m_tailBuffer.clear();
+}
+
+void LogPipeline::pollTail()
+{
+    if (!m_enabled || m_tailPath.isEmpty()) {
+        return;
+    }
+
+    QFile file(m_tailPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    if (m_tailOffset > file.size()) {
+        m_tailOffset = 0;
+        m_tailBuffer.clear();
+    }
+    if (!file.seek(m_tailOffset)) {
+        return;
+    }
+    const QByteArray chunk = file.readAll();
+    m_tailOffset = file.pos();
+    file.close();
+    if (chunk.isEmpty()) {
+        return;
+    }
+
+    m_tailBuffer.append(chunk);
+    if (m_tailBuffer.size() > kMaxTailBufferBytes) {
+        m_tailBuffer = m_tailBuffer.right(kTailBufferKeepBytes);
+        appendSystemLine(QStringLiteral("[System] Log stream is very busy. Older lines were trimmed to keep UI responsive."));
+    }
+
+    // Off the GUI thread there is no reason to cap lines per tick; only the
+    // newest m_capacity lines survive anyway.
+    qsizetype start = 0;
+    qsizetype newLineIndex = m_tailBuffer.indexOf('\n', start);
+    while (newLineIndex >= 0) {
+        const QByteArray lineBytes = m_tailBuffer.mid(start, newLineIndex - start).trimmed();
+        if (!lineBytes.isEmpty()) {
+            appendRuntimeLine(QString::fromUtf8(lineBytes));
+        }
+        start = newLineIndex + 1;
+        newLineIndex = m_tailBuffer.indexOf('\n', start);
+    }
+    m_tailBuffer.remove(0, start);
+}
+
+void LogPipeline::pushLine(const QString& line)
+{
+    m_lines.append(line);
+    if (m_lines.size() > m_capacity) {
+        m_lines.remove(0, m_lines.size() - m_capacity);
+    }
+    scheduleFlush();
+}
+
+void LogPipeline::scheduleFlush()
+{
+    m_dirty = true;
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
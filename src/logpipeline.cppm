@@ -0,0 +1,123 @@
+/*!
+ * @file        logpipeline.cppm
+ * @brief       Off-GUI-thread log filtering, tailing and coalescing.
+ *
+ * @details
+ * Runtime log floods (TUN mode can emit thousands of lines per second) used
+ * to be split, filtered and trimmed on the GUI thread. The pipeline is meant
+ * to live on a backend worker thread: it receives raw lines through queued
+ * calls, tails the privileged runtime log file on its own timer, keeps the
+ * bounded history and publishes at most one immutable snapshot per flush
+ * interval. The QML-facing controller only swaps the snapshot in.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.logpipeline;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @class LogPipeline
+ * @brief Bounded log history fed from runtime output and published in batches.
+ *
+ * All slots must be invoked on the thread the pipeline lives on (use queued
+ * connections or `QMetaObject::invokeMethod` from other threads).
+ */
+GENYCONNECT_MODULE_EXPORT class LogPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct pipeline.
+     * @param parent Optional QObject parent (leave empty when moving to a thread).
+     */
+    explicit LogPipeline(QObject *parent = nullptr);
+
+    /**
+     * @brief Whether a runtime line is high-frequency noise hidden from the UI.
+     * @param line Raw runtime log line.
+     * @return True when the line should be dropped.
+     */
+    static bool isNoisyLine(const QString& line);
+
+public slots:
+    /**
+     * @brief Enable or disable collection; disabling also clears history.
+     * @param enabled Collection flag.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Set maximum number of retained lines.
+     * @param lines History capacity.
+     */
+    void setCapacity(int lines);
+
+    /**
+     * @brief Append one runtime line (noise-filtered, updates latest line).
+     * @param line Raw runtime log line.
+     */
+    void appendRuntimeLine(const QString& line);
+
+    /**
+     * @brief Append an application/system message (consecutive duplicates dropped).
+     * @param message Message text.
+     */
+    void appendSystemLine(const QString& message);
+
+    /**
+     * @brief Drop history and publish an empty snapshot.
+     */
+    void clear();
+
+    /**
+     * @brief Start tailing a log file written by an external runtime.
+     * @param path Log file path; reading starts at its beginning.
+     */
+    void startTail(const QString& path);
+
+    /**
+     * @brief Stop tailing and drop any partial line.
+     */
+    void stopTail();
+
+signals:
+    //! Coalesced history snapshot; emitted at most once per flush interval.
+    void snapshotReady(const QStringList& lines, const QString& latestRuntimeLine);
+
+private:
+    void pollTail();
+    void pushLine(const QString& line);
+    void scheduleFlush();
+
+    bool m_enabled = true;                       //!< Collection enabled.
+    int m_capacity = 200;                        //!< Retained line count.
+    QStringList m_lines;                         //!< Bounded history, oldest first.
+    QString m_latestRuntimeLine;                 //!< Last accepted runtime line.
+    bool m_dirty = false;                        //!< History changed since last flush.
+    QString m_tailPath;                          //!< Tailed file (empty when idle).
+    qint64 m_tailOffset = 0;                     //!< Bytes consumed from m_tailPath.
+    QByteArray m_tailBuffer;                     //!< Partial trailing line.
+    QTimer *m_flushTimer = nullptr;              //!< Snapshot coalescing timer.
+    QTimer *m_tailTimer = nullptr;               //!< Tail poll timer.
+};
+
+#include "logpipeline.moc"
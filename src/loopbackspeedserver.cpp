@@ -0,0 +1,321 @@
+module;
+#include <QHostAddress>
+#include <QList>
+#include <QMetaObject>
+#include <QRandomGenerator>
+#include <QUrlQuery>
+#include <QtGlobal>
+
+#include <array>
+
+module genyconnect.backend.loopbackspeedserver;
+
+namespace {
+constexpr qint64 kBlockBytes = 64 * 1024;
+constexpr qsizetype kMaxHeaderBytes = 16 * 1024;
+// Enough queued data to keep the loopback socket saturated between
+// bytesWritten() notifications without buffering whole responses.
+constexpr qint64 kWriteHighWaterBytes = 512 * 1024;
+
+const std::array<quint32, kBlockBytes / 4>& bodyBlock()
+{
+    static const std::array<quint32, kBlockBytes / 4> block = [] {
+        std::array<quint32, kBlockBytes / 4> words {};
+        QRandomGenerator generator(0x47454E59u);
+        generator.fillRange(words.data(), words.size());
+        return words;
+    }();
+    return block;
+}
+}
+
+LoopbackSpeedServer::LoopbackSpeedServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &LoopbackSpeedServer::onNewConnection);
+}
+
+LoopbackSpeedServer::~LoopbackSpeedServer()
+{
+    stop();
+}
+
+void LoopbackSpeedServer::setMaxDownloadBytes(qint64 bytes)
+{
+    m_maxDownloadBytes = qMax<qint64>(0, bytes);
+}
+
+void LoopbackSpeedServer::setMaxUploadBytes(qint64 bytes)
+{
+    m_maxUploadBytes = qMax<qint64>(0, bytes);
+}
+
+bool LoopbackSpeedServer::start(QString *errorMessage)
+{
+    if (m_server->isListening()) {
+        return true;
+    }
+    if (!m_server->listen(QHostAddress::LocalHost, 0)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Cannot listen on the loopback interface: %1").arg(m_server->errorString());
+        }
+        return false;
+    }
+    m_port = m_server->serverPort();
+    m_servedBytes = 0;
+    m_sunkBytes = 0;
+    return true;
+}
+
+void LoopbackSpeedServer::stop()
+{
+    m_server->close();
+    m_port = 0;
+    const QList<QTcpSocket *> sockets = m_connections.keys();
+    m_connections.clear();
+    for (QTcpSocket *socket : sockets) {
+        QObject::disconnect(socket, nullptr, this, nullptr);
+        socket->abort();
+        socket->deleteLater();
+    }
+}
+
+quint16 LoopbackSpeedServer::port() const
+{
+    return m_port;
+}
+
+QUrl LoopbackSpeedServer::downloadUrl(qint64 bytes) const
+{
+    return QUrl(QStringLiteral("http://127.0.0.1:%1/down?bytes=%2").arg(port()).arg(qMax<qint64>(0, bytes)));
+}
+
+QUrl LoopbackSpeedServer::uploadUrl() const
+{
+    return QUrl(QStringLiteral("http://127.0.0.1:%1/up").arg(port()));
+}
+
+qint64 LoopbackSpeedServer::servedBytes() const
+{
+    return m_servedBytes;
+}
+
+qint64 LoopbackSpeedServer::sunkBytes() const
+{
+    return m_sunkBytes;
+}
+
+void LoopbackSpeedServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_connections.insert(socket, Connection());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() {
+            fill(socket);
+        });
+        // Queued so a disconnect raised while a request is being handled
+        // never removes the connection under the caller.
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_connections.remove(socket);
+            socket->deleteLater();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void LoopbackSpeedServer::onReadyRead(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end()) {
+        return;
+    }
+    Connection& connection = it.value();
+
+    for (;;) {
+        if (connection.uploadRemaining > 0) {
+            const qint64 skipped = socket->skip(qMin(connection.uploadRemaining, socket->bytesAvailable()));
+            if (skipped <= 0) {
+                break;
+            }
+            connection.uploadRemaining -= skipped;
+            m_sunkBytes += skipped;
+            if (connection.uploadRemaining == 0) {
+                finishUpload(socket, connection);
+            }
+            continue;
+        }
+        // One request at a time; anything after it waits in the socket buffer.
+        if (connection.sendRemaining > 0 || connection.closeAfter) {
+            break;
+        }
+
+        if (socket->bytesAvailable() > 0) {
+            connection.header += socket->read(qMax<qsizetype>(0, kMaxHeaderBytes - connection.header.size()));
+        }
+        const qsizetype end = connection.header.indexOf("\r\n\r\n");
+        if (end < 0) {
+            if (connection.header.size() >= kMaxHeaderBytes) {
+                connection.closeAfter = true;
+                respond(socket, connection, 431, "Request Header Fields Too Large", 0);
+            }
+            break;
+        }
+        const QByteArray head = connection.header.left(end);
+        const QByteArray rest = connection.header.mid(end + 4);
+        connection.header.clear();
+        if (!handleRequest(socket, connection, head, rest)) {
+            break;
+        }
+    }
+}
+
+bool LoopbackSpeedServer::handleRequest(
+    QTcpSocket *socket,
+    Connection& connection,
+    const QByteArray& head,
+    QByteArray rest)
+{
+    const QList<QByteArray> lines = head.split('\n');
+    const QList<QByteArray> requestLine = lines.constFirst().trimmed().split(' ');
+    if (requestLine.size() != 3 || !requestLine.at(2).startsWith("HTTP/1.")) {
+        connection.closeAfter = true;
+        respond(socket, connection, 400, "Bad Request", 0);
+        return false;
+    }
+    const QByteArray& method = requestLine.at(0);
+    const QUrl url(QString::fromLatin1(requestLine.at(1)));
+    connection.closeAfter = requestLine.at(2) == "HTTP/1.0";
+
+    qint64 contentLength = 0;
+    bool chunked = false;
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const QByteArray& line = lines.at(i);
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed().toLower();
+        if (name == "content-length") {
+            bool ok = false;
+            contentLength = value.toLongLong(&ok);
+            if (!ok || contentLength < 0) {
+                connection.closeAfter = true;
+                respond(socket, connection, 400, "Bad Request", 0);
+                return false;
+            }
+        } else if (name == "transfer-encoding") {
+            chunked = value.contains("chunked");
+        } else if (name == "connection") {
+            if (value.contains("close")) {
+                connection.closeAfter = true;
+            } else if (value.contains("keep-alive")) {
+                connection.closeAfter = false;
+            }
+        }
+    }
+
+    const QString path = url.path();
+    if (path == QStringLiteral("/down") && method == "GET") {
+        const qint64 bytes = qBound<qint64>(
+            0,
+            QUrlQuery(url).queryItemValue(QStringLiteral("bytes")).toLongLong(),
+            m_maxDownloadBytes);
+        connection.header = rest;
+        respond(socket, connection, 200, "OK", bytes);
+        return !connection.closeAfter;
+    }
+
+    if (path == QStringLiteral("/up") && method == "POST") {
+        if (chunked) {
+            connection.closeAfter = true;
+            respond(socket, connection, 411, "Length Required", 0);
+            return false;
+        }
+        if (contentLength > m_maxUploadBytes) {
+            connection.closeAfter = true;
+            respond(socket, connection, 413, "Content Too Large", 0);
+            return false;
+        }
+        const qint64 buffered = qMin<qint64>(rest.size(), contentLength);
+        m_sunkBytes += buffered;
+        rest.remove(0, buffered);
+        connection.header = rest;
+        connection.uploadRemaining = contentLength - buffered;
+        if (connection.uploadRemaining == 0) {
+            finishUpload(socket, connection);
+        }
+        return !connection.closeAfter;
+    }
+
+    // The body of an unknown request is not read, so the connection cannot be reused.
+    if (contentLength > 0 || chunked) {
+        connection.closeAfter = true;
+    }
+    connection.header = rest;
+    respond(socket, connection, 404, "Not Found", 0);
+    return !connection.closeAfter;
+}
+
+void LoopbackSpeedServer::finishUpload(QTcpSocket *socket, Connection& connection)
+{
+    respond(socket, connection, 200, "OK", 0);
+}
+
+void LoopbackSpeedServer::respond(
+    QTcpSocket *socket,
+    Connection& connection,
+    int status,
+    const QByteArray& reason,
+    qint64 bodyBytes)
+{
+    QByteArray head;
+    head.reserve(192);
+    head += "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n";
+    head += "Content-Type: application/octet-stream\r\n";
+    head += "Content-Length: " + QByteArray::number(bodyBytes) + "\r\n";
+    head += "Cache-Control: no-store\r\n";
+    head += connection.closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    socket->write(head);
+
+    connection.sendRemaining = bodyBytes;
+    connection.sendOffset = 0;
+    fill(socket);
+}
+
+void LoopbackSpeedServer::fill(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end()) {
+        return;
+    }
+    Connection& connection = it.value();
+
+    const char *block = reinterpret_cast<const char *>(bodyBlock().data());
+    while (connection.sendRemaining > 0 && socket->bytesToWrite() < kWriteHighWaterBytes) {
+        const qint64 chunk = qMin(connection.sendRemaining, kBlockBytes - connection.sendOffset);
+        const qint64 written = socket->write(block + connection.sendOffset, chunk);
+        if (written <= 0) {
+            socket->abort();
+            return;
+        }
+        connection.sendRemaining -= written;
+        connection.sendOffset = (connection.sendOffset + written) % kBlockBytes;
+        m_servedBytes += written;
+    }
+    if (connection.sendRemaining > 0) {
+        return;
+    }
+    if (connection.closeAfter) {
+        socket->disconnectFromHost();
+        return;
+    }
+    if (socket->bytesAvailable() > 0 || !connection.header.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, socket]() {
+            onReadyRead(socket);
+        }, Qt::QueuedConnection);
+    }
+}
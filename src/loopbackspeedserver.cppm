@@ -0,0 +1,139 @@
+/*!
+ * @file        loopbackspeedserver.cppm
+ * @brief       Minimal HTTP/1.1 speed-test server bound to the loopback interface.
+ *
+ * @details
+ * Serves the two endpoints the speed test needs without leaving the host:
+ * `GET /down?bytes=N` streams N bytes of incompressible data and
+ * `POST /up` reads and discards the request body. Connections are kept
+ * alive so parallel streams can reuse them, bodies are produced from one
+ * shared block as the socket drains, and nothing is buffered per request.
+ * The server is a plain QObject and is meant to be moved to its own thread
+ * so it does not share an event loop with the client it serves.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <atomic>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.loopbackspeedserver;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @class LoopbackSpeedServer
+ * @brief Download source and upload sink on `127.0.0.1`.
+ */
+GENYCONNECT_MODULE_EXPORT class LoopbackSpeedServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 kDefaultMaxBodyBytes = 1024LL * 1024 * 1024; //!< Per-request cap of both directions.
+
+    /**
+     * @brief Construct a stopped server.
+     * @param parent Optional QObject parent.
+     */
+    explicit LoopbackSpeedServer(QObject *parent = nullptr);
+    ~LoopbackSpeedServer() override;
+
+    /**
+     * @brief Limit the size of one download response.
+     * @param bytes Maximum `bytes` accepted by `/down`; larger requests are clamped.
+     */
+    void setMaxDownloadBytes(qint64 bytes);
+
+    /**
+     * @brief Limit the size of one upload body.
+     * @param bytes Maximum `Content-Length` accepted by `/up`; larger bodies get 413.
+     */
+    void setMaxUploadBytes(qint64 bytes);
+
+    /**
+     * @brief Listen on an ephemeral loopback port.
+     * @param errorMessage Optional output message on failure.
+     * @return True when listening.
+     */
+    bool start(QString *errorMessage = nullptr);
+
+    /**
+     * @brief Close the listener and every open connection.
+     */
+    void stop();
+
+    /**
+     * @brief Listening port.
+     * @return Port, 0 when stopped.
+     */
+    quint16 port() const;
+
+    /**
+     * @brief URL of a download of the given size.
+     * @param bytes Response body size.
+     * @return `http://127.0.0.1:<port>/down?bytes=<bytes>`.
+     */
+    QUrl downloadUrl(qint64 bytes) const;
+
+    /**
+     * @brief URL of the upload sink.
+     * @return `http://127.0.0.1:<port>/up`.
+     */
+    QUrl uploadUrl() const;
+
+    /**
+     * @brief Body bytes sent by `/down` since start().
+     * @return Byte count; safe to read from any thread.
+     */
+    qint64 servedBytes() const;
+
+    /**
+     * @brief Body bytes discarded by `/up` since start().
+     * @return Byte count; safe to read from any thread.
+     */
+    qint64 sunkBytes() const;
+
+private:
+    struct Connection {
+        QByteArray header;           //!< Request head read so far.
+        qint64 uploadRemaining = 0;  //!< Body bytes of `/up` still to discard.
+        qint64 sendRemaining = 0;    //!< Body bytes of `/down` still to send.
+        qint64 sendOffset = 0;       //!< Position in the shared block.
+        bool closeAfter = false;     //!< Close once the response is out.
+    };
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+    void fill(QTcpSocket *socket);
+    bool handleRequest(QTcpSocket *socket, Connection& connection, const QByteArray& head, QByteArray rest);
+    void finishUpload(QTcpSocket *socket, Connection& connection);
+    void respond(QTcpSocket *socket, Connection& connection, int status, const QByteArray& reason, qint64 bodyBytes);
+
+    QTcpServer *m_server = nullptr;                  //!< Loopback listener.
+    QHash<QTcpSocket *, Connection> m_connections;   //!< Open connections.
+    qint64 m_maxDownloadBytes = kDefaultMaxBodyBytes; //!< `/down` cap.
+    qint64 m_maxUploadBytes = kDefaultMaxBodyBytes;  //!< `/up` cap.
+    std::atomic<quint16> m_port {0};                 //!< Listening port.
+    std::atomic<qint64> m_servedBytes {0};           //!< Body bytes sent.
+    std::atomic<qint64> m_sunkBytes {0};             //!< Body bytes discarded.
+};
+
+#include "loopbackspeedserver.moc"
@@ -1,7 +1,12 @@
 #include <QAction>
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QIcon>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QLockFile>
@@ -11,16 +16,295 @@
 #include <QQuickWindow>
 #include <QStandardPaths>
 #include <QSystemTrayIcon>
+#include <QTemporaryDir>
+#include <QTextStream>
 #include <QTimer>
 #include <QtCore/qglobal.h>
 
 #include "platform/macosappbridge.hpp"
 
+import genyconnect.backend.benchmarksuite;
 import genyconnect.backend.connectionstate;
+import genyconnect.backend.speedtestsnapshot;
+import genyconnect.backend.tunnelbenchmark;
 import genyconnect.backend.vpncontroller;
+import genyconnect.backend.xraycapabilities;
+
+// Writes a benchmark report to a file, or to stdout when no file is given.
+static auto writeReport(const QJsonObject& report, const QString& outputPath, QTextStream& err) -> bool
+{
+    const QByteArray data = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (outputPath.isEmpty()) {
+        QTextStream(stdout) << data;
+        return true;
+    }
+    QFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+        err << "Cannot write " << file.fileName() << ": " << file.errorString() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Headless loopback benchmark for CI: prints the direct and tunneled passes
+// as JSON and fails when the tunnel costs more than the allowed overhead.
+// With --rule-entries it runs twice, with compiled and with raw routing
+// lists, so the report shows the per-connection matching cost of both.
+static auto runTunnelBenchmark(int argc, char *argv[]) -> int
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("GenyConnect"));
+    QCoreApplication::setApplicationName(QStringLiteral("GenyConnect"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measure the tunnel overhead against a loopback speed-test server."));
+    parser.addHelpOption();
+    const QCommandLineOption benchmarkOption(QStringLiteral("tunnel-benchmark"), QStringLiteral("Run the tunnel benchmark."));
+    const QCommandLineOption xrayOption(QStringLiteral("xray"), QStringLiteral("xray-core executable."), QStringLiteral("path"));
+    const QCommandLineOption protocolOption(QStringLiteral("protocol"), QStringLiteral("Loopback protocol: vless or vmess."), QStringLiteral("name"), QStringLiteral("vless"));
+    const QCommandLineOption muxOption(QStringLiteral("mux"), QStringLiteral("Enable mux on the proxy outbound."));
+    const QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("Seconds per transfer phase."), QStringLiteral("seconds"), QStringLiteral("5"));
+    const QCommandLineOption streamsOption(QStringLiteral("streams"), QStringLiteral("Parallel streams per transfer phase."), QStringLiteral("count"), QStringLiteral("4"));
+    const QCommandLineOption maxOverheadOption(QStringLiteral("max-overhead"), QStringLiteral("Fail when throughput overhead exceeds this percentage."), QStringLiteral("percent"));
+    const QCommandLineOption latencyProbesOption(QStringLiteral("latency-probes"), QStringLiteral("Sequential requests per latency measurement."), QStringLiteral("count"), QStringLiteral("20"));
+    const QCommandLineOption ruleEntriesOption(QStringLiteral("rule-entries"), QStringLiteral("Synthetic routing entries; compares compiled and raw lists."), QStringLiteral("count"), QStringLiteral("0"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to a file instead of stdout."), QStringLiteral("file"));
+    parser.addOptions({benchmarkOption, xrayOption, protocolOption, muxOption, durationOption, streamsOption, maxOverheadOption, latencyProbesOption, ruleEntriesOption, outputOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QString xrayPath = parser.isSet(xrayOption)
+        ? parser.value(xrayOption)
+        : QStandardPaths::findExecutable(QStringLiteral("xray"));
+    if (xrayPath.trimmed().isEmpty()) {
+        err << "xray-core executable not found; pass --xray.\n";
+        return 1;
+    }
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        err << "Cannot create a temporary directory.\n";
+        return 1;
+    }
+
+    TunnelBenchmark::Options options;
+    options.protocol = parser.value(protocolOption).trimmed().toLower();
+    options.mux = parser.isSet(muxOption);
+    options.durationMs = parser.value(durationOption).toInt() * 1000;
+    options.streams = parser.value(streamsOption).toInt();
+    options.latencyProbes = parser.value(latencyProbesOption).toInt();
+    options.core = XrayCapabilities::probe(xrayPath);
+    const int ruleEntries = qMax(0, parser.value(ruleEntriesOption).toInt());
+    TunnelBenchmark::addSyntheticRules(&options, ruleEntries);
+    QJsonObject compiledReport;
+    double compiledLatencyMs = -1.0;
+    bool compiledExceeded = false;
+
+    TunnelBenchmark benchmark;
+    benchmark.setExecutablePath(xrayPath);
+    benchmark.setWorkingDirectory(workDir.path());
+    QObject::connect(&benchmark, &TunnelBenchmark::progressChanged, &app, [&err](const QString& step) {
+        err << "[Benchmark] " << step << "\n";
+        err.flush();
+    });
+    QObject::connect(&benchmark, &TunnelBenchmark::finished, &app, [&](bool ok, const QString& error) {
+        int code = ok ? 0 : 1;
+        if (!ok) {
+            err << "[Benchmark] Failed: " << error << "\n";
+        } else if (parser.isSet(maxOverheadOption)) {
+            const double limit = parser.value(maxOverheadOption).toDouble();
+            if (benchmark.downloadOverheadPct() > limit || benchmark.uploadOverheadPct() > limit) {
+                err << "[Benchmark] Overhead exceeds " << limit << "%.\n";
+                code = 2;
+            }
+        }
+
+        QJsonObject report = benchmark.toJson();
+        if (ruleEntries > 0 && options.compileRules) {
+            if (!ok) {
+                writeReport(report, parser.value(outputOption), err);
+                QCoreApplication::exit(1);
+                return;
+            }
+            // Second run with the same lists as the builder emitted them before compilation.
+            compiledReport = report;
+            compiledLatencyMs = benchmark.addedLatencyMs();
+            compiledExceeded = code == 2;
+            options.compileRules = false;
+            QTimer::singleShot(0, &app, [&]() {
+                QString error;
+                if (!benchmark.start(options, &error)) {
+                    err << error << "\n";
+                    QCoreApplication::exit(1);
+                }
+            });
+            return;
+        }
+        if (ruleEntries > 0) {
+            if (compiledExceeded && code == 0) {
+                code = 2;
+            }
+            report = QJsonObject {
+                {QStringLiteral("compiled"), compiledReport},
+                {QStringLiteral("raw"), report},
+                {QStringLiteral("ruleMatchingSavedMs"), ok ? benchmark.addedLatencyMs() - compiledLatencyMs : 0.0}
+            };
+        }
+
+        if (!writeReport(report, parser.value(outputOption), err)) {
+            code = 1;
+        }
+        QCoreApplication::exit(code);
+    });
+
+    QString error;
+    if (!benchmark.start(options, &error)) {
+        err << error << "\n";
+        return 1;
+    }
+    return app.exec();
+}
+
+// Headless profile memory check for CI: measures a large synthetic profile
+// list in the current and the pre-interning layout, and fails when the
+// reduction misses the target or re-imports leave entries in the intern table.
+static auto runProfileBenchmark(int argc, char *argv[]) -> int
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measure the memory cost of a large profile list."));
+    parser.addHelpOption();
+    const QCommandLineOption benchmarkOption(QStringLiteral("profile-benchmark"), QStringLiteral("Run the profile memory check."));
+    const QCommandLineOption profilesOption(QStringLiteral("profiles"), QStringLiteral("Profiles to generate."), QStringLiteral("count"), QStringLiteral("100000"));
+    const QCommandLineOption roundsOption(QStringLiteral("rounds"), QStringLiteral("Re-imports with fresh values."), QStringLiteral("count"), QStringLiteral("5"));
+    const QCommandLineOption reductionOption(QStringLiteral("min-reduction"), QStringLiteral("Required memory reduction over the legacy layout."), QStringLiteral("factor"), QStringLiteral("3.0"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to a file instead of stdout."), QStringLiteral("file"));
+    parser.addOptions({benchmarkOption, profilesOption, roundsOption, reductionOption, outputOption});
+    parser.process(app);
+
+    BenchmarkSuite::ProfileMemoryOptions options;
+    options.profiles = parser.value(profilesOption).toInt();
+    options.rounds = parser.value(roundsOption).toInt();
+    options.minReduction = parser.value(reductionOption).toDouble();
+
+    QTextStream err(stderr);
+    bool passed = false;
+    const QJsonObject report = BenchmarkSuite::profileMemory(options, &passed);
+    if (!writeReport(report, parser.value(outputOption), err)) {
+        return 1;
+    }
+    if (!passed) {
+        err << "[Benchmark] Profile memory check failed.\n";
+        return 2;
+    }
+    return 0;
+}
+
+static void registerQmlTypes()
+{
+    qmlRegisterUncreatableMetaObject(
+        connectionStateMetaObject(),
+        "GenyConnect",
+        1,
+        0,
+        "ConnectionState",
+        QStringLiteral("ConnectionState is read-only")
+        );
+
+    qmlRegisterUncreatableMetaObject(
+        SpeedTestSnapshot::staticMetaObject,
+        "GenyConnect",
+        1,
+        0,
+        "SpeedTestPhase",
+        QStringLiteral("SpeedTestPhase is read-only")
+        );
+}
+
+static auto loadMainWindow(QQmlApplicationEngine& engine, VpnController& vpnController) -> QQuickWindow *
+{
+    engine.rootContext()->setContextProperty(QStringLiteral("vpnController"), &vpnController);
+    engine.rootContext()->setContextProperty(QStringLiteral("updater"), vpnController.updater());
+    engine.loadFromModule(QStringLiteral("GenyConnect"), QStringLiteral("Main"));
+
+    if (engine.rootObjects().isEmpty()) {
+        return nullptr;
+    }
+    return qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst());
+}
+
+// Headless-capable frame-time check for CI (run with QT_QPA_PLATFORM=offscreen
+// when no display is available): fails when a log flood stretches GUI frames
+// of the real main window.
+static auto runFrameBenchmark(int argc, char *argv[]) -> int
+{
+    QApplication app(argc, argv);
+    // Test-mode paths and a separate name keep the check away from the user's
+    // profiles, settings and single-instance lock.
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName(QStringLiteral("GenyConnect"));
+    QCoreApplication::setApplicationName(QStringLiteral("GenyConnect-FrameBenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measure GUI frame time under a runtime log flood."));
+    parser.addHelpOption();
+    const QCommandLineOption benchmarkOption(QStringLiteral("frame-benchmark"), QStringLiteral("Run the frame-time check."));
+    const QCommandLineOption durationOption(QStringLiteral("duration-ms"), QStringLiteral("Length of each phase."), QStringLiteral("ms"), QStringLiteral("5000"));
+    const QCommandLineOption rateOption(QStringLiteral("lines-per-second"), QStringLiteral("Log lines posted during the flood."), QStringLiteral("count"), QStringLiteral("20000"));
+    const QCommandLineOption extraOption(QStringLiteral("max-extra-p95-ms"), QStringLiteral("Allowed p95 frame interval growth."), QStringLiteral("ms"), QStringLiteral("8"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the JSON report to a file instead of stdout."), QStringLiteral("file"));
+    parser.addOptions({benchmarkOption, durationOption, rateOption, extraOption, outputOption});
+    parser.process(app);
+
+    BenchmarkSuite::LogFloodOptions options;
+    options.durationMs = parser.value(durationOption).toInt();
+    options.linesPerSecond = parser.value(rateOption).toInt();
+    options.maxExtraP95Ms = parser.value(extraOption).toInt();
+
+    QTextStream err(stderr);
+    registerQmlTypes();
+    VpnController vpnController;
+    QQmlApplicationEngine engine;
+    QQuickWindow *mainWindow = loadMainWindow(engine, vpnController);
+    if (mainWindow == nullptr) {
+        err << "[Benchmark] Main window failed to load.\n";
+        return 1;
+    }
+    mainWindow->setProperty("allowCloseExit", false);
+
+    bool passed = false;
+    const QJsonObject report = BenchmarkSuite::logFloodFrameTime(
+        mainWindow,
+        [&vpnController](const QString& line) { vpnController.postRuntimeLogLine(line); },
+        options,
+        &passed);
+    if (!writeReport(report, parser.value(outputOption), err)) {
+        return 1;
+    }
+    if (!passed) {
+        err << "[Benchmark] Frame time under log flood exceeded the allowance.\n";
+        return 2;
+    }
+    return 0;
+}
 
 auto main(int argc, char *argv[]) -> int
 {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--tunnel-benchmark") == 0) {
+            return runTunnelBenchmark(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--profile-benchmark") == 0) {
+            return runProfileBenchmark(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--frame-benchmark") == 0) {
+            return runFrameBenchmark(argc, argv);
+        }
+    }
+
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
     QApplication app(argc, argv);
     app.setQuitOnLastWindowClosed(false);
 
@@ -69,20 +353,11 @@ auto main(int argc, char *argv[]) -> int
         return 0;
     }
 
-    qmlRegisterUncreatableMetaObject(
-        connectionStateMetaObject(),
-        "GenyConnect",
-        1,
-        0,
-        "ConnectionState",
-        QStringLiteral("ConnectionState is read-only")
-        );
+    registerQmlTypes();
 
     VpnController vpnController;
 
     QQmlApplicationEngine engine;
-    engine.rootContext()->setContextProperty(QStringLiteral("vpnController"), &vpnController);
-    engine.rootContext()->setContextProperty(QStringLiteral("updater"), vpnController.updater());
 
     QObject::connect(
         &engine,
@@ -92,13 +367,7 @@ auto main(int argc, char *argv[]) -> int
         Qt::QueuedConnection
         );
 
-    engine.loadFromModule(QStringLiteral("GenyConnect"), QStringLiteral("Main"));
-
-    if (engine.rootObjects().isEmpty()) {
-        return -1;
-    }
-
-    auto *mainWindow = qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst());
+    auto *mainWindow = loadMainWindow(engine, vpnController);
     if (mainWindow == nullptr) {
         return -1;
     }
@@ -109,6 +378,37 @@ auto main(int argc, char *argv[]) -> int
 
     mainWindow->setProperty("allowCloseExit", false);
 
+    // Time-to-first-frame; frameSwapped fires on the render thread.
+    QObject::connect(
+        mainWindow,
+        &QQuickWindow::frameSwapped,
+        &vpnController,
+        [&vpnController, startupTimer]() {
+            const qint64 elapsedMs = startupTimer.elapsed();
+            QMetaObject::invokeMethod(
+                &vpnController,
+                [&vpnController, elapsedMs]() { vpnController.recordFirstFrame(elapsedMs); },
+                Qt::QueuedConnection
+                );
+        },
+        static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::SingleShotConnection)
+        );
+
+    // Live speed-test figures are published once per frame, right before the
+    // scene graph syncs, instead of on every sampling tick.
+    QObject::connect(
+        &vpnController,
+        &VpnController::speedTestFrameRequested,
+        mainWindow,
+        &QQuickWindow::requestUpdate
+        );
+    QObject::connect(
+        mainWindow,
+        &QQuickWindow::afterAnimating,
+        &vpnController,
+        &VpnController::publishSpeedTestSnapshot
+        );
+
     const auto setTaskbarPresence = [mainWindow](bool showInTaskbar) {
         if (mainWindow == nullptr) {
             return;
@@ -0,0 +1,318 @@
+module;
+#include <QNetworkInformation>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#if defined(Q_OS_LINUX) && defined(GENYCONNECT_HAS_QTDBUS)
+#include <QDBusConnection>
+#endif
+
+module genyconnect.backend.networkmonitor;
+
+namespace {
+constexpr int kDefaultDebounceMs = 1500;
+constexpr int kNetlinkReceiveBufferBytes = 64 * 1024;
+
+#if defined(Q_OS_LINUX) && defined(GENYCONNECT_HAS_QTDBUS)
+constexpr const char kLogindService[] = "org.freedesktop.login1";
+constexpr const char kLogindPath[] = "/org/freedesktop/login1";
+constexpr const char kLogindManagerInterface[] = "org.freedesktop.login1.Manager";
+#endif
+}
+
+NetworkMonitor::NetworkMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(kDefaultDebounceMs);
+    connect(&m_debounceTimer, &QTimer::timeout, this, [this]() {
+        if (m_pendingReasons.isEmpty()) {
+            return;
+        }
+        const QString reason = m_pendingReasons.join(QStringLiteral(","));
+        m_pendingReasons.clear();
+        emit networkChanged(reason);
+    });
+}
+
+NetworkMonitor::~NetworkMonitor()
+{
+    stop();
+}
+
+bool NetworkMonitor::start()
+{
+    if (isActive()) {
+        return true;
+    }
+
+#if defined(Q_OS_LINUX)
+    openNetlinkSocket();
+    m_sleepWatchActive = openSleepWatch();
+#endif
+    if (m_netlinkFd < 0) {
+        openNetworkInformation();
+    }
+    return isActive();
+}
+
+void NetworkMonitor::stop()
+{
+    m_debounceTimer.stop();
+    m_pendingReasons.clear();
+
+    if (m_netlinkNotifier) {
+        m_netlinkNotifier->setEnabled(false);
+        delete m_netlinkNotifier;
+        m_netlinkNotifier = nullptr;
+    }
+#if defined(Q_OS_LINUX)
+    if (m_netlinkFd >= 0) {
+        ::close(m_netlinkFd);
+    }
+#endif
+    m_netlinkFd = -1;
+
+#if defined(Q_OS_LINUX) && defined(GENYCONNECT_HAS_QTDBUS)
+    if (m_sleepWatchActive) {
+        QDBusConnection::systemBus().disconnect(
+            QString::fromLatin1(kLogindService),
+            QString::fromLatin1(kLogindPath),
+            QString::fromLatin1(kLogindManagerInterface),
+            QStringLiteral("PrepareForSleep"),
+            this,
+            SLOT(onPrepareForSleep(bool)));
+    }
+#endif
+    m_sleepWatchActive = false;
+
+    if (m_networkInformationActive) {
+        if (QNetworkInformation *info = QNetworkInformation::instance()) {
+            QObject::disconnect(info, nullptr, this, nullptr);
+        }
+        m_networkInformationActive = false;
+    }
+}
+
+bool NetworkMonitor::isActive() const
+{
+    return m_netlinkFd >= 0 || m_sleepWatchActive || m_networkInformationActive;
+}
+
+void NetworkMonitor::setIgnoredInterfaces(const QStringList& names)
+{
+    m_ignoredInterfaces.clear();
+    for (const QString& name : names) {
+        const QString trimmed = name.trimmed();
+        if (!trimmed.isEmpty() && !m_ignoredInterfaces.contains(trimmed)) {
+            m_ignoredInterfaces.append(trimmed);
+        }
+    }
+}
+
+void NetworkMonitor::setDebounceInterval(int ms)
+{
+    m_debounceTimer.setInterval(qMax(100, ms));
+}
+
+void NetworkMonitor::onPrepareForSleep(bool sleeping)
+{
+    if (sleeping) {
+        // Nothing sent before suspend is worth acting on after resume.
+        m_debounceTimer.stop();
+        m_pendingReasons.clear();
+        emit aboutToSleep();
+        return;
+    }
+    emit resumed();
+    scheduleChange(QStringLiteral("resume"));
+}
+
+bool NetworkMonitor::openNetlinkSocket()
+{
+#if defined(Q_OS_LINUX)
+    const int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_netlinkFd = fd;
+    m_netlinkNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_netlinkNotifier, &QSocketNotifier::activated, this, [this]() {
+        readNetlinkMessages();
+    });
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NetworkMonitor::readNetlinkMessages()
+{
+#if defined(Q_OS_LINUX)
+    alignas(nlmsghdr) char buffer[kNetlinkReceiveBufferBytes];
+    for (;;) {
+        const ssize_t received = ::recv(m_netlinkFd, buffer, sizeof(buffer), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // Kernel dropped notifications; the state is unknown, so re-validate.
+                scheduleChange(QStringLiteral("overrun"));
+                continue;
+            }
+            return;
+        }
+        if (received == 0) {
+            return;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(buffer);
+             NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            switch (header->nlmsg_type) {
+            case RTM_NEWLINK:
+            case RTM_DELLINK: {
+                const auto *info = static_cast<const ifinfomsg *>(NLMSG_DATA(header));
+                if ((info->ifi_flags & IFF_LOOPBACK) != 0) {
+                    break;
+                }
+                // Wireless scan/stat updates arrive as RTM_NEWLINK with no flag
+                // change; only administrative and carrier transitions matter.
+                if (header->nlmsg_type == RTM_NEWLINK && (info->ifi_change & (IFF_UP | IFF_RUNNING)) == 0) {
+                    break;
+                }
+                QString name;
+                int attrLength = static_cast<int>(IFLA_PAYLOAD(header));
+                for (auto *attr = IFLA_RTA(info); RTA_OK(attr, attrLength); attr = RTA_NEXT(attr, attrLength)) {
+                    if (attr->rta_type == IFLA_IFNAME) {
+                        name = QString::fromLocal8Bit(static_cast<const char *>(RTA_DATA(attr)));
+                        break;
+                    }
+                }
+                if (!isIgnoredInterface(name)) {
+                    scheduleChange(QStringLiteral("link"));
+                }
+                break;
+            }
+            case RTM_NEWROUTE:
+            case RTM_DELROUTE: {
+                const auto *route = static_cast<const rtmsg *>(NLMSG_DATA(header));
+                // Only default unicast routes in the main table decide where
+                // the outer transport goes; policy tables belong to TUN setups.
+                if (route->rtm_dst_len != 0 || route->rtm_type != RTN_UNICAST) {
+                    break;
+                }
+                quint32 table = route->rtm_table;
+                int outputIndex = 0;
+                int attrLength = static_cast<int>(RTM_PAYLOAD(header));
+                for (auto *attr = RTM_RTA(route); RTA_OK(attr, attrLength); attr = RTA_NEXT(attr, attrLength)) {
+                    if (attr->rta_type == RTA_TABLE) {
+                        table = *static_cast<const quint32 *>(RTA_DATA(attr));
+                    } else if (attr->rta_type == RTA_OIF) {
+                        outputIndex = *static_cast<const int *>(RTA_DATA(attr));
+                    }
+                }
+                if (table != RT_TABLE_MAIN) {
+                    break;
+                }
+                char nameBuffer[IF_NAMESIZE] = {};
+                const QString name = (outputIndex > 0 && ::if_indextoname(static_cast<unsigned>(outputIndex), nameBuffer))
+                    ? QString::fromLocal8Bit(nameBuffer)
+                    : QString();
+                if (!isIgnoredInterface(name)) {
+                    scheduleChange(route->rtm_family == AF_INET6 ? QStringLiteral("route6")
+                                                                 : QStringLiteral("route4"));
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+#endif
+}
+
+bool NetworkMonitor::openSleepWatch()
+{
+#if defined(Q_OS_LINUX) && defined(GENYCONNECT_HAS_QTDBUS)
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.isConnected()) {
+        return false;
+    }
+    return bus.connect(
+        QString::fromLatin1(kLogindService),
+        QString::fromLatin1(kLogindPath),
+        QString::fromLatin1(kLogindManagerInterface),
+        QStringLiteral("PrepareForSleep"),
+        this,
+        SLOT(onPrepareForSleep(bool)));
+#else
+    return false;
+#endif
+}
+
+void NetworkMonitor::openNetworkInformation()
+{
+    if (!QNetworkInformation::loadDefaultBackend()) {
+        return;
+    }
+    QNetworkInformation *info = QNetworkInformation::instance();
+    if (!info) {
+        return;
+    }
+
+    connect(info, &QNetworkInformation::reachabilityChanged, this, [this]() {
+        scheduleChange(QStringLiteral("reachability"));
+    });
+    connect(info, &QNetworkInformation::transportMediumChanged, this, [this]() {
+        scheduleChange(QStringLiteral("medium"));
+    });
+    m_networkInformationActive = true;
+}
+
+bool NetworkMonitor::isIgnoredInterface(const QString& name) const
+{
+    if (name.isEmpty()) {
+        return false;
+    }
+    for (const QString& pattern : m_ignoredInterfaces) {
+        if (pattern.endsWith(QLatin1Char('*'))) {
+            if (name.startsWith(pattern.chopped(1), Qt::CaseInsensitive)) {
+                return true;
+            }
+        } else if (name.compare(pattern, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NetworkMonitor::scheduleChange(const QString& reason)
+{
+    if (!m_pendingReasons.contains(reason)) {
+        m_pendingReasons.append(reason);
+    }
+    m_debounceTimer.start();
+}
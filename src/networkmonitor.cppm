@@ -0,0 +1,109 @@
+/*!
+ * @file        networkmonitor.cppm
+ * @brief       Event-driven host network change detection.
+ *
+ * @details
+ * Watches the host for changes that can silently break an established
+ * tunnel: link carrier changes, default-route replacement (Wi-Fi roaming,
+ * cable/VPN switches) and suspend/resume. On Linux this listens to rtnetlink
+ * multicast groups and the logind `PrepareForSleep` signal; other platforms
+ * fall back to `QNetworkInformation`. Bursts of events are debounced into a
+ * single notification so callers can run one targeted re-validation.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QObject>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.networkmonitor;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @class NetworkMonitor
+ * @brief Debounced notifier for host network and power state changes.
+ */
+GENYCONNECT_MODULE_EXPORT class NetworkMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct monitor (inactive until start()).
+     * @param parent Optional QObject parent.
+     */
+    explicit NetworkMonitor(QObject *parent = nullptr);
+    ~NetworkMonitor() override;
+
+    /**
+     * @brief Open platform event sources.
+     * @return True when at least one event source is active.
+     */
+    bool start();
+
+    /**
+     * @brief Close all event sources and drop pending notifications.
+     */
+    void stop();
+
+    /**
+     * @brief Whether an event source is active.
+     * @return True after a successful start().
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Set interfaces whose events are ignored (for example the tunnel's own TUN device).
+     * @param names Exact names or prefixes ending with `*`.
+     */
+    void setIgnoredInterfaces(const QStringList& names);
+
+    /**
+     * @brief Set debounce window for coalescing event bursts.
+     * @param ms Quiet period in milliseconds.
+     */
+    void setDebounceInterval(int ms);
+
+signals:
+    //! Emitted once per debounced burst; `reason` lists the event kinds seen.
+    void networkChanged(const QString& reason);
+    //! Emitted when the system is about to suspend.
+    void aboutToSleep();
+    //! Emitted right after resume (a `networkChanged("resume")` follows after debounce).
+    void resumed();
+
+private slots:
+    //! Handle logind PrepareForSleep(bool) signal.
+    void onPrepareForSleep(bool sleeping);
+
+private:
+    bool openNetlinkSocket();
+    void readNetlinkMessages();
+    bool openSleepWatch();
+    void openNetworkInformation();
+    bool isIgnoredInterface(const QString& name) const;
+    void scheduleChange(const QString& reason);
+
+    int m_netlinkFd = -1;                          //!< rtnetlink socket (Linux).
+    QSocketNotifier *m_netlinkNotifier = nullptr;  //!< Read notifier for m_netlinkFd.
+    bool m_sleepWatchActive = false;               //!< logind subscription active.
+    bool m_networkInformationActive = false;       //!< QNetworkInformation fallback active.
+    QStringList m_ignoredInterfaces;               //!< Interface names/prefixes to skip.
+    QStringList m_pendingReasons;                  //!< Reasons collected in current burst.
+    QTimer m_debounceTimer;                        //!< Coalesces bursts of events.
+};
+
+#include "networkmonitor.moc"
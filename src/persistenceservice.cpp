@@ -0,0 +1,178 @@
+module;
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+#include <functional>
+#include <utility>
+
+module genyconnect.backend.persistenceservice;
+
+namespace {
+constexpr int kDefaultCoalesceMs = 400;
+}
+
+PersistenceService::PersistenceService(QObject *parent)
+    : QObject(parent)
+{
+    // The window starts at the first dirty mark and is not extended by later
+    // marks, so a steady stream of changes still reaches disk regularly.
+    m_coalesceTimer.setSingleShot(true);
+    m_coalesceTimer.setInterval(kDefaultCoalesceMs);
+    connect(&m_coalesceTimer, &QTimer::timeout, this, [this]() {
+        dispatch(takeDirtyJobs());
+    });
+}
+
+PersistenceService::~PersistenceService()
+{
+    m_coalesceTimer.stop();
+    if (m_writerContext) {
+        m_writerContext->deleteLater();
+    }
+}
+
+void PersistenceService::setWorkerThread(QThread *thread)
+{
+    if (m_writerContext) {
+        m_writerContext->deleteLater();
+        m_writerContext = nullptr;
+    }
+    if (!thread) {
+        return;
+    }
+    auto *context = new QObject();
+    context->moveToThread(thread);
+    connect(thread, &QThread::finished, context, &QObject::deleteLater);
+    m_writerContext = context;
+}
+
+void PersistenceService::setCoalesceInterval(int ms)
+{
+    m_coalesceTimer.setInterval(qMax(0, ms));
+}
+
+void PersistenceService::registerStore(const QString& store, SnapshotProvider provider)
+{
+    m_providers.insert(store, std::move(provider));
+}
+
+void PersistenceService::markDirty(const QString& store)
+{
+    if (!m_providers.contains(store)) {
+        return;
+    }
+    m_dirty.insert(store);
+    if (!m_coalesceTimer.isActive()) {
+        m_coalesceTimer.start();
+    }
+}
+
+bool PersistenceService::isDirty(const QString& store) const
+{
+    return m_dirty.contains(store);
+}
+
+void PersistenceService::flush()
+{
+    m_coalesceTimer.stop();
+    const QList<Job> jobs = takeDirtyJobs();
+
+    QObject *context = m_writerContext.data();
+    if (!context || !context->thread()->isRunning() || context->thread() == QThread::currentThread()) {
+        runJobs(jobs);
+        return;
+    }
+    // Blocking on the worker queue also waits for writes dispatched earlier.
+    QMetaObject::invokeMethod(context, [this, jobs]() {
+        runJobs(jobs);
+    }, Qt::BlockingQueuedConnection);
+}
+
+bool PersistenceService::writeFileAtomically(const QString& path, const QByteArray& data, QString *errorMessage)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+QList<PersistenceService::Job> PersistenceService::takeDirtyJobs()
+{
+    QList<Job> jobs;
+    jobs.reserve(m_dirty.size());
+    for (const QString& store : std::as_const(m_dirty)) {
+        const auto it = m_providers.constFind(store);
+        if (it == m_providers.constEnd() || !it.value()) {
+            continue;
+        }
+        Writer writer = it.value()();
+        if (writer) {
+            jobs.append(Job {store, std::move(writer)});
+        }
+    }
+    // A provider that declined keeps its store dirty; the owner marks it
+    // again once it can take a snapshot, which restarts the window.
+    for (const Job& job : std::as_const(jobs)) {
+        m_dirty.remove(job.store);
+    }
+    return jobs;
+}
+
+void PersistenceService::dispatch(const QList<Job>& jobs)
+{
+    if (jobs.isEmpty()) {
+        return;
+    }
+    QObject *context = m_writerContext.data();
+    if (!context || !context->thread()->isRunning()) {
+        runJobs(jobs);
+        return;
+    }
+    QMetaObject::invokeMethod(context, [this, jobs]() {
+        runJobs(jobs);
+    }, Qt::QueuedConnection);
+}
+
+void PersistenceService::runJobs(const QList<Job>& jobs)
+{
+    const QPointer<PersistenceService> guard(this);
+    for (const Job& job : jobs) {
+        QString error;
+        if (job.writer(&error)) {
+            continue;
+        }
+        const QString store = job.store;
+        QMetaObject::invokeMethod(guard.data(), [guard, store, error]() {
+            if (!guard) {
+                return;
+            }
+            emit guard->writeFailed(store, error);
+        }, Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,131 @@
+/*!
+ * @file        persistenceservice.cppm
+ * @brief       Coalescing write-behind persistence for controller state.
+ *
+ * @details
+ * Stores (profiles, subscriptions, settings, usage counters, ...) are
+ * registered once with a snapshot provider. Callers only mark a store dirty;
+ * after a short window the provider runs once on the owner thread to capture
+ * an immutable, implicitly shared snapshot, and the returned writer
+ * serializes and commits it on the worker thread. Writes are executed in
+ * order, so an older snapshot can never overwrite a newer one. flush() forces
+ * everything to disk and is meant for shutdown.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+
+#include <functional>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.persistenceservice;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @class PersistenceService
+ * @brief Marks stores dirty, coalesces bursts and writes snapshots off the owner thread.
+ */
+GENYCONNECT_MODULE_EXPORT class PersistenceService : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Serializes and stores one snapshot; runs on the worker thread.
+    using Writer = std::function<bool(QString *errorMessage)>;
+    //! Captures a snapshot and returns its writer; runs on the owner thread.
+    //! An empty writer declines the write and leaves the store dirty.
+    using SnapshotProvider = std::function<Writer()>;
+
+    /**
+     * @brief Construct service (writes run synchronously until a worker thread is set).
+     * @param parent Optional QObject parent.
+     */
+    explicit PersistenceService(QObject *parent = nullptr);
+    ~PersistenceService() override;
+
+    /**
+     * @brief Run writers on the given thread.
+     * @param thread Running (or soon running) worker thread; must outlive pending writes.
+     */
+    void setWorkerThread(QThread *thread);
+
+    /**
+     * @brief Set coalescing window.
+     * @param ms Delay between the first dirty mark and the write.
+     */
+    void setCoalesceInterval(int ms);
+
+    /**
+     * @brief Register a store.
+     * @param store Store name used by markDirty().
+     * @param provider Snapshot provider.
+     */
+    void registerStore(const QString& store, SnapshotProvider provider);
+
+    /**
+     * @brief Schedule a write of a store within the coalescing window.
+     * @param store Registered store name.
+     */
+    void markDirty(const QString& store);
+
+    /**
+     * @brief Whether a store has changes that were not handed to a writer yet.
+     * @param store Registered store name.
+     * @return True while marked dirty, including after its provider declined.
+     */
+    bool isDirty(const QString& store) const;
+
+    /**
+     * @brief Write all dirty stores and wait until every queued write is committed.
+     */
+    void flush();
+
+    /**
+     * @brief Atomically replace a file's contents.
+     * @param path Target file.
+     * @param data New contents.
+     * @param errorMessage Optional output error text.
+     * @return True when the new contents were committed.
+     */
+    static bool writeFileAtomically(const QString& path, const QByteArray& data, QString *errorMessage = nullptr);
+
+signals:
+    //! Emitted on the owner thread when a store could not be written.
+    void writeFailed(const QString& store, const QString& error);
+
+private:
+    struct Job {
+        QString store;
+        Writer writer;
+    };
+
+    QList<Job> takeDirtyJobs();
+    void dispatch(const QList<Job>& jobs);
+    void runJobs(const QList<Job>& jobs);
+
+    QHash<QString, SnapshotProvider> m_providers;  //!< Registered stores.
+    QSet<QString> m_dirty;                         //!< Stores waiting for the window to close.
+    QPointer<QObject> m_writerContext;             //!< Context object living on the worker thread.
+    QTimer m_coalesceTimer;                        //!< Write-behind window.
+};
+
+#include "persistenceservice.moc"
@@ -0,0 +1,452 @@
+module;
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QList>
+#include <QString>
+#include <QtEndian>
+#include <QtTypes>
+
+#include <cstring>
+#include <optional>
+
+module genyconnect.backend.profilestore;
+
+namespace {
+constexpr quint32 kMagic = 0x53504347; // "GCPS"
+constexpr quint16 kHeaderSize = 32;
+constexpr quint32 kNoString = 0xFFFFFFFFu;
+constexpr quint16 kFlagAllowInsecure = 0x0001;
+
+enum StringField : int {
+    FieldId = 0,
+    FieldName,
+    FieldProtocol,
+    FieldAddress,
+    FieldUserId,
+    FieldEncryption,
+    FieldFlow,
+    FieldNetwork,
+    FieldSecurity,
+    FieldSni,
+    FieldAlpn,
+    FieldFingerprint,
+    FieldPublicKey,
+    FieldShortId,
+    FieldSpiderX,
+    FieldPath,
+    FieldHostHeader,
+    FieldServiceName,
+    FieldHeaderType,
+    FieldXhttpMode,
+    FieldOriginalLink,
+    FieldGroupName,
+    FieldSourceName,
+    FieldSourceId,
+    FieldXhttpExtra,   // compact JSON text
+    FieldExtra,        // compact JSON text
+    FieldTransportTuning, // compact JSON text
+    FieldCount
+};
+
+// Values in StringField order; JSON fields are encoded as compact JSON text.
+QString fieldValue(const ServerProfile& profile, int field)
+{
+    switch (field) {
+    case FieldId: return profile.id;
+    case FieldName: return profile.name;
+    case FieldProtocol: return profile.protocol;
+    case FieldAddress: return profile.address;
+    case FieldUserId: return profile.userId;
+    case FieldEncryption: return profile.encryption;
+    case FieldFlow: return profile.flow;
+    case FieldNetwork: return profile.network;
+    case FieldSecurity: return profile.security;
+    case FieldSni: return profile.sni;
+    case FieldAlpn: return profile.alpn;
+    case FieldFingerprint: return profile.fingerprint;
+    case FieldPublicKey: return profile.publicKey();
+    case FieldShortId: return profile.shortId();
+    case FieldSpiderX: return profile.spiderX();
+    case FieldPath: return profile.path;
+    case FieldHostHeader: return profile.hostHeader;
+    case FieldServiceName: return profile.serviceName();
+    case FieldHeaderType: return profile.headerType;
+    case FieldXhttpMode: return profile.xhttpMode;
+    case FieldOriginalLink: return profile.originalLink;
+    case FieldGroupName: return profile.groupName;
+    case FieldSourceName: return profile.sourceName;
+    case FieldSourceId: return profile.sourceId;
+    case FieldXhttpExtra:
+        return profile.xhttpExtra().isEmpty()
+            ? QString()
+            : QString::fromUtf8(QJsonDocument(profile.xhttpExtra()).toJson(QJsonDocument::Compact));
+    case FieldExtra:
+        return profile.extra().isEmpty()
+            ? QString()
+            : QString::fromUtf8(QJsonDocument(profile.extra()).toJson(QJsonDocument::Compact));
+    case FieldTransportTuning:
+        return profile.transportTuning().isEmpty()
+            ? QString()
+            : QString::fromUtf8(QJsonDocument(profile.transportTuning().toJson()).toJson(QJsonDocument::Compact));
+    default:
+        return {};
+    }
+}
+
+InternedString *internedField(ServerProfile& profile, int field)
+{
+    switch (field) {
+    case FieldProtocol: return &profile.protocol;
+    case FieldEncryption: return &profile.encryption;
+    case FieldFlow: return &profile.flow;
+    case FieldNetwork: return &profile.network;
+    case FieldSecurity: return &profile.security;
+    case FieldFingerprint: return &profile.fingerprint;
+    case FieldHeaderType: return &profile.headerType;
+    default: return nullptr;
+    }
+}
+
+void setFieldValue(ServerProfile& profile, int field, const QString& value)
+{
+    switch (field) {
+    case FieldId: profile.id = value; break;
+    case FieldName: profile.name = value; break;
+    case FieldAddress: profile.address = value; break;
+    case FieldUserId: profile.userId = value; break;
+    case FieldSni: profile.sni = value; break;
+    case FieldAlpn: profile.alpn = value; break;
+    case FieldPublicKey: profile.setPublicKey(value); break;
+    case FieldShortId: profile.setShortId(value); break;
+    case FieldSpiderX: profile.setSpiderX(value); break;
+    case FieldPath: profile.path = value; break;
+    case FieldHostHeader: profile.hostHeader = value; break;
+    case FieldServiceName: profile.setServiceName(value); break;
+    case FieldXhttpMode: profile.xhttpMode = value; break;
+    case FieldOriginalLink: profile.originalLink = value; break;
+    case FieldGroupName: profile.groupName = value; break;
+    case FieldSourceName: profile.sourceName = value; break;
+    case FieldSourceId: profile.sourceId = value; break;
+    default: break;
+    }
+}
+
+constexpr quint16 recordSizeFor(int fieldCount)
+{
+    return static_cast<quint16>(fieldCount * 4 + 4);
+}
+
+void setError(QString *errorMessage, const QString& error)
+{
+    if (errorMessage) {
+        *errorMessage = error;
+    }
+}
+
+template <typename T>
+void appendLittleEndian(QByteArray& out, T value)
+{
+    const T encoded = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&encoded), sizeof(T));
+}
+
+template <typename T>
+T readLittleEndian(const uchar *at)
+{
+    return qFromLittleEndian<T>(at);
+}
+
+class StringPoolWriter
+{
+public:
+    quint32 add(const QString& value)
+    {
+        if (value.isEmpty()) {
+            return kNoString;
+        }
+        const auto it = m_offsets.constFind(value);
+        if (it != m_offsets.constEnd()) {
+            return it.value();
+        }
+        const quint32 offset = static_cast<quint32>(m_pool.size());
+        appendLittleEndian<quint32>(m_pool, static_cast<quint32>(value.size()));
+        for (const QChar ch : value) {
+            appendLittleEndian<quint16>(m_pool, ch.unicode());
+        }
+        while (m_pool.size() % 4 != 0) {
+            m_pool.append('\0');
+        }
+        m_offsets.insert(value, offset);
+        return offset;
+    }
+
+    const QByteArray& bytes() const { return m_pool; }
+    quint32 entryCount() const { return static_cast<quint32>(m_offsets.size()); }
+
+private:
+    QByteArray m_pool;
+    QHash<QString, quint32> m_offsets;
+};
+
+class StringPoolReader
+{
+public:
+    StringPoolReader(const uchar *pool, quint32 size, quint32 entryCount)
+        : m_pool(pool)
+        , m_size(size)
+    {
+        m_strings.reserve(static_cast<qsizetype>(qMin<quint32>(entryCount, 1u << 20)));
+    }
+
+    // Each pool entry is decoded once; later references share the QString.
+    bool string(quint32 offset, QString *out)
+    {
+        if (offset == kNoString) {
+            out->clear();
+            return true;
+        }
+        const auto it = m_strings.constFind(offset);
+        if (it != m_strings.constEnd()) {
+            *out = it.value();
+            return true;
+        }
+        if (offset % 4 != 0 || quint64(offset) + 4 > m_size) {
+            return false;
+        }
+        const quint32 length = readLittleEndian<quint32>(m_pool + offset);
+        if (quint64(offset) + 4 + quint64(length) * 2 > m_size) {
+            return false;
+        }
+        QString decoded(static_cast<qsizetype>(length), Qt::Uninitialized);
+        const uchar *units = m_pool + offset + 4;
+        if constexpr (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) {
+            std::memcpy(decoded.data(), units, size_t(length) * 2);
+        } else {
+            for (quint32 i = 0; i < length; ++i) {
+                decoded[i] = QChar(readLittleEndian<quint16>(units + i * 2));
+            }
+        }
+        m_strings.insert(offset, decoded);
+        *out = decoded;
+        return true;
+    }
+
+    // Interned handles are resolved once per pool entry as well.
+    bool interned(quint32 offset, InternedString *out)
+    {
+        const auto it = m_interned.constFind(offset);
+        if (it != m_interned.constEnd()) {
+            *out = it.value();
+            return true;
+        }
+        QString text;
+        if (!string(offset, &text)) {
+            return false;
+        }
+        *out = text;
+        m_interned.insert(offset, *out);
+        return true;
+    }
+
+    // JSON fields are parsed only when present, and identical objects only once.
+    bool object(quint32 offset, QJsonObject *out)
+    {
+        if (offset == kNoString) {
+            *out = QJsonObject {};
+            return true;
+        }
+        const auto it = m_objects.constFind(offset);
+        if (it != m_objects.constEnd()) {
+            *out = it.value();
+            return true;
+        }
+        QString text;
+        if (!string(offset, &text)) {
+            return false;
+        }
+        const QJsonObject parsed = QJsonDocument::fromJson(text.toUtf8()).object();
+        m_objects.insert(offset, parsed);
+        *out = parsed;
+        return true;
+    }
+
+private:
+    const uchar *m_pool = nullptr;
+    quint32 m_size = 0;
+    QHash<quint32, QString> m_strings;
+    QHash<quint32, QJsonObject> m_objects;
+    QHash<quint32, InternedString> m_interned;
+};
+}
+
+QByteArray ProfileStore::serialize(const QList<ServerProfile>& profiles)
+{
+    const quint16 recordSize = recordSizeFor(FieldCount);
+    StringPoolWriter pool;
+    QByteArray records;
+    records.reserve(profiles.size() * recordSize);
+
+    for (const ServerProfile& profile : profiles) {
+        for (int field = 0; field < FieldCount; ++field) {
+            appendLittleEndian<quint32>(records, pool.add(fieldValue(profile, field)));
+        }
+        appendLittleEndian<quint16>(records, profile.port);
+        appendLittleEndian<quint16>(records, profile.allowInsecure ? kFlagAllowInsecure : quint16(0));
+    }
+
+    const quint32 recordTableOffset = kHeaderSize;
+    const quint32 poolOffset = recordTableOffset + static_cast<quint32>(records.size());
+
+    QByteArray out;
+    out.reserve(poolOffset + pool.bytes().size());
+    appendLittleEndian<quint32>(out, kMagic);
+    appendLittleEndian<quint16>(out, kFormatVersion);
+    appendLittleEndian<quint16>(out, kHeaderSize);
+    appendLittleEndian<quint32>(out, static_cast<quint32>(profiles.size()));
+    appendLittleEndian<quint16>(out, static_cast<quint16>(FieldCount));
+    appendLittleEndian<quint16>(out, recordSize);
+    appendLittleEndian<quint32>(out, recordTableOffset);
+    appendLittleEndian<quint32>(out, poolOffset);
+    appendLittleEndian<quint32>(out, static_cast<quint32>(pool.bytes().size()));
+    appendLittleEndian<quint32>(out, pool.entryCount());
+    out.append(records);
+    out.append(pool.bytes());
+    return out;
+}
+
+std::optional<QList<ServerProfile>> ProfileStore::deserialize(const uchar *data, qint64 size, QString *errorMessage)
+{
+    if (!data || size < kHeaderSize || readLittleEndian<quint32>(data) != kMagic) {
+        setError(errorMessage, QStringLiteral("Not a profile store file."));
+        return std::nullopt;
+    }
+    const quint16 version = readLittleEndian<quint16>(data + 4);
+    const quint16 headerSize = readLittleEndian<quint16>(data + 6);
+    if (version > kFormatVersion || headerSize < kHeaderSize) {
+        setError(errorMessage, QStringLiteral("Unsupported profile store version %1.").arg(version));
+        return std::nullopt;
+    }
+    const quint32 count = readLittleEndian<quint32>(data + 8);
+    const quint16 fieldCount = readLittleEndian<quint16>(data + 12);
+    const quint16 recordSize = readLittleEndian<quint16>(data + 14);
+    const quint32 recordTableOffset = readLittleEndian<quint32>(data + 16);
+    const quint32 poolOffset = readLittleEndian<quint32>(data + 20);
+    const quint32 poolSize = readLittleEndian<quint32>(data + 24);
+    const quint32 poolEntries = readLittleEndian<quint32>(data + 28);
+
+    if (recordSize < recordSizeFor(fieldCount)
+        || quint64(recordTableOffset) + quint64(count) * recordSize > quint64(size)
+        || quint64(poolOffset) + poolSize > quint64(size)) {
+        setError(errorMessage, QStringLiteral("Profile store is truncated or corrupted."));
+        return std::nullopt;
+    }
+
+    StringPoolReader pool(data + poolOffset, poolSize, poolEntries);
+    const int knownFields = qMin<int>(fieldCount, FieldCount);
+    QList<ServerProfile> profiles;
+    profiles.reserve(static_cast<qsizetype>(count));
+
+    for (quint32 row = 0; row < count; ++row) {
+        const uchar *record = data + recordTableOffset + quint64(row) * recordSize;
+        ServerProfile profile;
+        bool ok = true;
+        for (int field = 0; field < knownFields && ok; ++field) {
+            const quint32 offset = readLittleEndian<quint32>(record + field * 4);
+            if (offset == kNoString) {
+                continue;
+            }
+            if (InternedString *handle = internedField(profile, field)) {
+                ok = pool.interned(offset, handle);
+            } else if (field == FieldXhttpExtra || field == FieldExtra || field == FieldTransportTuning) {
+                QJsonObject object;
+                ok = pool.object(offset, &object);
+                if (field == FieldXhttpExtra) {
+                    profile.setXhttpExtra(object);
+                } else if (field == FieldExtra) {
+                    profile.setExtra(object);
+                } else {
+                    profile.setTransportTuning(TransportTuning::fromJson(object));
+                }
+            } else {
+                QString value;
+                ok = pool.string(offset, &value);
+                setFieldValue(profile, field, value);
+            }
+        }
+        if (!ok) {
+            setError(errorMessage, QStringLiteral("Profile store has an invalid string reference."));
+            return std::nullopt;
+        }
+        const uchar *tail = record + fieldCount * 4;
+        profile.port = readLittleEndian<quint16>(tail);
+        profile.allowInsecure = (readLittleEndian<quint16>(tail + 2) & kFlagAllowInsecure) != 0;
+        if (profile.isValid()) {
+            profiles.append(profile);
+        }
+    }
+    return profiles;
+}
+
+std::optional<QList<ServerProfile>> ProfileStore::readFile(const QString& path, QString *errorMessage)
+{
+    QFile file(path);
+    if (!file.exists()) {
+        setError(errorMessage, QStringLiteral("Profile store does not exist."));
+        return std::nullopt;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, file.errorString());
+        return std::nullopt;
+    }
+
+    // The mapping is only held while decoding, so the file can be replaced
+    // atomically afterwards on every platform.
+    const qint64 size = file.size();
+    if (uchar *mapped = file.map(0, size)) {
+        auto profiles = deserialize(mapped, size, errorMessage);
+        file.unmap(mapped);
+        return profiles;
+    }
+    const QByteArray bytes = file.readAll();
+    return deserialize(reinterpret_cast<const uchar *>(bytes.constData()), bytes.size(), errorMessage);
+}
+
+QByteArray ProfileStore::toJson(const QList<ServerProfile>& profiles)
+{
+    QJsonArray arr;
+    for (const ServerProfile& profile : profiles) {
+        arr.append(profile.toJson());
+    }
+    return QJsonDocument(arr).toJson(QJsonDocument::Indented);
+}
+
+std::optional<QList<ServerProfile>> ProfileStore::fromJson(const QByteArray& json, QString *errorMessage)
+{
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
+        setError(errorMessage, parseError.error != QJsonParseError::NoError
+                                   ? parseError.errorString()
+                                   : QStringLiteral("Expected a JSON array of profiles."));
+        return std::nullopt;
+    }
+
+    QList<ServerProfile> profiles;
+    const QJsonArray arr = doc.array();
+    profiles.reserve(arr.size());
+    for (const QJsonValue& value : arr) {
+        if (!value.isObject()) {
+            continue;
+        }
+        auto profile = ServerProfile::fromJson(value.toObject());
+        if (profile.has_value()) {
+            profiles.append(profile.value());
+        }
+    }
+    return profiles;
+}
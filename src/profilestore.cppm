@@ -0,0 +1,95 @@
+/*!
+ * @file        profilestore.cppm
+ * @brief       Versioned binary storage for server profiles.
+ *
+ * @details
+ * Large subscriptions make `profiles.json` the dominant startup cost: every
+ * profile is parsed into a JSON tree before its ~30 strings are copied out.
+ * The binary store avoids that. A fixed header is followed by a table of
+ * fixed-size records (one per profile, one string-pool offset per field) and
+ * a de-duplicated UTF-16 string pool. Files are memory-mapped read-only while
+ * loading; each pool entry is decoded (or interned) at most once, so
+ * repeated values such as group, source, protocol or transport names are
+ * resolved a single time, and JSON object fields are only parsed when
+ * present. JSON import/export is kept for portability and to migrate
+ * existing installations.
+ *
+ * Layout (little-endian):
+ * - header (32 bytes): magic `GCPS`, version, header size, profile count,
+ *   field count, record size, record table offset, pool offset, pool size,
+ *   pool entry count
+ * - record table: `profileCount * recordSize` bytes; each record holds
+ *   `fieldCount` pool offsets (`0xFFFFFFFF` = empty), the port and flags
+ * - string pool: entries of `u32 length` + UTF-16 code units, 4-byte aligned
+ *
+ * Readers honour the record size and field count stored in the header, so
+ * fields appended in later versions are skipped by older builds and missing
+ * trailing fields read as empty.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtTypes>
+
+#include <optional>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.profilestore;
+import genyconnect.backend.serverprofile;
+#endif
+
+/**
+ * @class ProfileStore
+ * @brief Reads and writes profile collections in binary and JSON form.
+ */
+export class ProfileStore
+{
+public:
+    static constexpr quint16 kFormatVersion = 1; //!< Current binary format version.
+
+    /**
+     * @brief Encode profiles into the binary store format.
+     * @param profiles Profiles to encode.
+     * @return Encoded bytes.
+     */
+    static QByteArray serialize(const QList<ServerProfile>& profiles);
+
+    /**
+     * @brief Decode a binary store image.
+     * @param data Start of the image (for example a mapped file).
+     * @param size Image size in bytes.
+     * @param errorMessage Optional output message on failure.
+     * @return Decoded profiles or empty optional for malformed input.
+     */
+    static std::optional<QList<ServerProfile>> deserialize(const uchar *data, qint64 size, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Memory-map and decode a binary store file.
+     * @param path File path.
+     * @param errorMessage Optional output message on failure.
+     * @return Decoded profiles or empty optional when missing or malformed.
+     */
+    static std::optional<QList<ServerProfile>> readFile(const QString& path, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Encode profiles as a JSON array (portable export format).
+     * @param profiles Profiles to encode.
+     * @return Indented JSON bytes.
+     */
+    static QByteArray toJson(const QList<ServerProfile>& profiles);
+
+    /**
+     * @brief Decode a JSON array of profiles (import and legacy migration).
+     * @param json JSON bytes.
+     * @param errorMessage Optional output message on failure.
+     * @return Valid profiles, or empty optional when the input is not a JSON array.
+     */
+    static std::optional<QList<ServerProfile>> fromJson(const QByteArray& json, QString *errorMessage = nullptr);
+};
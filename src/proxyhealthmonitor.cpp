@@ -0,0 +1,397 @@
+module;
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QNetworkProxy>
+#include <QPointer>
+#include <QSslSocket>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <algorithm>
+#include <memory>
+
+module genyconnect.backend.proxyhealthmonitor;
+
+namespace {
+constexpr int kDefaultIntervalMs = 15000;
+constexpr int kMaxHeaderBytes = 8192;
+constexpr int kSummaryWindow = 30;
+
+int medianOf(QList<int> values)
+{
+    if (values.isEmpty()) {
+        return -1;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(values.size() / 2);
+}
+}
+
+struct ProxyHealthMonitor::Probe {
+    enum class Stage {
+        Connecting,
+        AwaitingConnectReply,
+        TlsHandshake,
+        AwaitingFirstByte
+    };
+
+    quint64 roundId = 0;
+    ProxyHealthTarget target;
+    QPointer<QSslSocket> socket;
+    QPointer<QTimer> timeout;
+    QElapsedTimer stageTimer;
+    QByteArray buffer;
+    Stage stage = Stage::Connecting;
+    ProxyHealthSample sample;
+    bool finished = false;
+};
+
+// Only the answer to this request proves the outbound reached the server.
+void ProxyHealthMonitor::sendRequest(Probe *probe)
+{
+    probe->stage = Probe::Stage::AwaitingFirstByte;
+    const QString path = probe->target.path.isEmpty() ? QStringLiteral("/") : probe->target.path;
+    probe->socket->write(QStringLiteral("HEAD %1 HTTP/1.1\r\nHost: %2\r\nConnection: close\r\n\r\n")
+                             .arg(path, probe->target.host)
+                             .toUtf8());
+}
+
+QVariantMap ProxyHealthSample::toVariantMap() const
+{
+    return QVariantMap {
+        {QStringLiteral("timestampMs"), timestampMs},
+        {QStringLiteral("target"), target},
+        {QStringLiteral("ok"), ok},
+        {QStringLiteral("connectMs"), connectMs},
+        {QStringLiteral("connectReplyMs"), connectReplyMs},
+        {QStringLiteral("tlsMs"), tlsMs},
+        {QStringLiteral("ttfbMs"), ttfbMs},
+        {QStringLiteral("error"), error}
+    };
+}
+
+ProxyHealthMonitor::ProxyHealthMonitor(QObject *parent)
+    : QObject(parent)
+{
+    // Mix an anycast IP (plain HTTP, needs no DNS) with two TLS endpoints on
+    // different networks so one flaky target does not read as a dead tunnel.
+    // Every target must answer a request: the CONNECT reply alone comes from
+    // the local xray inbound and says nothing about the server.
+    m_targets = {
+        ProxyHealthTarget {QStringLiteral("1.1.1.1"), 80, false, QStringLiteral("/")},
+        ProxyHealthTarget {QStringLiteral("www.gstatic.com"), 443, true, QStringLiteral("/generate_204")},
+        ProxyHealthTarget {QStringLiteral("cp.cloudflare.com"), 443, true, QStringLiteral("/generate_204")}
+    };
+
+    m_intervalTimer.setInterval(kDefaultIntervalMs);
+    connect(&m_intervalTimer, &QTimer::timeout, this, [this]() {
+        // Skip a tick rather than stacking rounds on a slow tunnel.
+        if (m_rounds.isEmpty()) {
+            probeNow();
+        }
+    });
+}
+
+ProxyHealthMonitor::~ProxyHealthMonitor()
+{
+    stop();
+}
+
+void ProxyHealthMonitor::setProxyPort(quint16 port)
+{
+    m_proxyPort = port;
+}
+
+void ProxyHealthMonitor::setTargets(const QList<ProxyHealthTarget>& targets)
+{
+    m_targets = targets;
+}
+
+void ProxyHealthMonitor::setInterval(int ms)
+{
+    m_intervalTimer.setInterval(qMax(1000, ms));
+}
+
+void ProxyHealthMonitor::setTimeout(int ms)
+{
+    m_timeoutMs = qMax(500, ms);
+}
+
+void ProxyHealthMonitor::start()
+{
+    m_intervalTimer.start();
+}
+
+void ProxyHealthMonitor::stop()
+{
+    m_intervalTimer.stop();
+    const QList<std::shared_ptr<Probe>> probes = m_probes;
+    for (const std::shared_ptr<Probe>& probe : probes) {
+        probe->finished = true;
+        if (probe->timeout) {
+            probe->timeout->stop();
+        }
+        if (probe->socket) {
+            QObject::disconnect(probe->socket, nullptr, this, nullptr);
+            probe->socket->abort();
+            probe->socket->deleteLater();
+        }
+    }
+    m_probes.clear();
+    m_rounds.clear();
+}
+
+bool ProxyHealthMonitor::isRunning() const
+{
+    return m_intervalTimer.isActive();
+}
+
+quint64 ProxyHealthMonitor::probeNow()
+{
+    const quint64 roundId = m_nextRoundId++;
+    if (m_targets.isEmpty()) {
+        QTimer::singleShot(0, this, [this, roundId]() {
+            emit roundFinished(roundId, false, QStringLiteral("No health-check targets configured."));
+        });
+        return roundId;
+    }
+
+    Round round;
+    round.pending = static_cast<int>(m_targets.size());
+    m_rounds.insert(roundId, round);
+    for (const ProxyHealthTarget& target : std::as_const(m_targets)) {
+        startProbe(roundId, target);
+    }
+    return roundId;
+}
+
+void ProxyHealthMonitor::clear()
+{
+    m_samples.clear();
+    m_failedRoundStreak = 0;
+    if (!m_healthy) {
+        m_healthy = true;
+        emit healthChanged();
+    }
+}
+
+QVariantList ProxyHealthMonitor::recentSamples(int limit) const
+{
+    QVariantList out;
+    const int count = static_cast<int>(m_samples.size());
+    const int first = qMax(0, count - qMax(0, limit));
+    out.reserve(count - first);
+    for (int i = first; i < count; ++i) {
+        out.append(m_samples.at(i).toVariantMap());
+    }
+    return out;
+}
+
+QVariantMap ProxyHealthMonitor::summary() const
+{
+    const int count = static_cast<int>(m_samples.size());
+    const int first = qMax(0, count - kSummaryWindow);
+    int okCount = 0;
+    QList<int> connectReply;
+    QList<int> tls;
+    QList<int> ttfb;
+    for (int i = first; i < count; ++i) {
+        const ProxyHealthSample& sample = m_samples.at(i);
+        if (!sample.ok) {
+            continue;
+        }
+        ++okCount;
+        if (sample.connectReplyMs >= 0) {
+            connectReply.append(sample.connectReplyMs);
+        }
+        if (sample.tlsMs >= 0) {
+            tls.append(sample.tlsMs);
+        }
+        if (sample.ttfbMs >= 0) {
+            ttfb.append(sample.ttfbMs);
+        }
+    }
+
+    const int windowSize = count - first;
+    return QVariantMap {
+        {QStringLiteral("healthy"), m_healthy},
+        {QStringLiteral("sampleCount"), windowSize},
+        {QStringLiteral("successRate"), windowSize > 0 ? static_cast<double>(okCount) / windowSize : 0.0},
+        {QStringLiteral("connectReplyMsP50"), medianOf(connectReply)},
+        {QStringLiteral("tlsMsP50"), medianOf(tls)},
+        {QStringLiteral("ttfbMsP50"), medianOf(ttfb)},
+        {QStringLiteral("failedRoundStreak"), m_failedRoundStreak}
+    };
+}
+
+bool ProxyHealthMonitor::isHealthy() const
+{
+    return m_healthy;
+}
+
+void ProxyHealthMonitor::startProbe(quint64 roundId, const ProxyHealthTarget& target)
+{
+    auto probe = std::make_shared<Probe>();
+    probe->roundId = roundId;
+    probe->target = target;
+    probe->sample.target = QStringLiteral("%1:%2").arg(target.host).arg(target.port);
+    m_probes.append(probe);
+
+    auto *socket = new QSslSocket(this);
+    socket->setProxy(QNetworkProxy::NoProxy);
+    probe->socket = socket;
+
+    // Probes hold only weak references back to themselves through the
+    // socket connections; finishProbe() drops the strong one. The timeout
+    // timer is parented to the socket so both go away with deleteLater().
+    const std::weak_ptr<Probe> weak = probe;
+
+    probe->timeout = new QTimer(socket);
+    probe->timeout->setSingleShot(true);
+    probe->timeout->setInterval(m_timeoutMs);
+    connect(probe->timeout, &QTimer::timeout, this, [this, weak]() {
+        if (const auto p = weak.lock()) {
+            static const char *const stageNames[] = {"connect", "CONNECT reply", "TLS handshake", "first byte"};
+            finishProbe(p, false, QStringLiteral("Timed out waiting for %1.")
+                                      .arg(QLatin1StringView(stageNames[static_cast<int>(p->stage)])));
+        }
+    });
+
+    connect(socket, &QAbstractSocket::connected, this, [weak]() {
+        const auto p = weak.lock();
+        if (!p || p->finished) {
+            return;
+        }
+        p->sample.connectMs = static_cast<int>(p->stageTimer.restart());
+        p->stage = Probe::Stage::AwaitingConnectReply;
+        const QByteArray authority = QStringLiteral("%1:%2").arg(p->target.host).arg(p->target.port).toUtf8();
+        p->socket->write("CONNECT " + authority + " HTTP/1.1\r\nHost: " + authority + "\r\n\r\n");
+    });
+
+    connect(socket, &QSslSocket::encrypted, this, [weak]() {
+        const auto p = weak.lock();
+        if (!p || p->finished) {
+            return;
+        }
+        p->sample.tlsMs = static_cast<int>(p->stageTimer.restart());
+        sendRequest(p.get());
+    });
+
+    connect(socket, &QIODevice::readyRead, this, [this, weak]() {
+        const auto p = weak.lock();
+        if (!p || p->finished) {
+            return;
+        }
+
+        if (p->stage == Probe::Stage::AwaitingFirstByte) {
+            p->sample.ttfbMs = static_cast<int>(p->stageTimer.elapsed());
+            finishProbe(p, true, QString());
+            return;
+        }
+        if (p->stage != Probe::Stage::AwaitingConnectReply) {
+            return;
+        }
+
+        p->buffer.append(p->socket->readAll());
+        const qsizetype headerEnd = p->buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (p->buffer.size() > kMaxHeaderBytes) {
+                finishProbe(p, false, QStringLiteral("Oversized CONNECT response."));
+            }
+            return;
+        }
+
+        const qsizetype lineEnd = p->buffer.indexOf("\r\n");
+        const QString statusLine = QString::fromUtf8(p->buffer.left(lineEnd)).trimmed();
+        if (!statusLine.startsWith(QStringLiteral("HTTP/1.1 200"))
+            && !statusLine.startsWith(QStringLiteral("HTTP/1.0 200"))) {
+            finishProbe(p, false, statusLine.isEmpty()
+                                      ? QStringLiteral("No proxy response for CONNECT test.")
+                                      : QStringLiteral("CONNECT response: %1").arg(statusLine));
+            return;
+        }
+
+        p->sample.connectReplyMs = static_cast<int>(p->stageTimer.restart());
+        if (!p->target.tls) {
+            p->buffer.clear();
+            sendRequest(p.get());
+            return;
+        }
+        p->buffer.clear();
+        p->stage = Probe::Stage::TlsHandshake;
+        p->socket->setPeerVerifyName(p->target.host);
+        p->socket->startClientEncryption();
+    });
+
+    connect(socket, &QAbstractSocket::errorOccurred, this, [this, weak](QAbstractSocket::SocketError) {
+        const auto p = weak.lock();
+        if (!p || p->finished) {
+            return;
+        }
+        // A server closing right after the first response byte is success.
+        if (p->sample.ttfbMs >= 0) {
+            return;
+        }
+        finishProbe(p, false, p->socket->errorString());
+    });
+
+    probe->stageTimer.start();
+    probe->timeout->start();
+    socket->connectToHost(QHostAddress(QHostAddress::LocalHost), m_proxyPort);
+}
+
+void ProxyHealthMonitor::finishProbe(const std::shared_ptr<Probe>& probe, bool ok, const QString& error)
+{
+    if (probe->finished) {
+        return;
+    }
+    probe->finished = true;
+    if (probe->timeout) {
+        probe->timeout->stop();
+    }
+    if (probe->socket) {
+        QObject::disconnect(probe->socket, nullptr, this, nullptr);
+        probe->socket->abort();
+        probe->socket->deleteLater();
+    }
+    m_probes.removeOne(probe);
+
+    probe->sample.ok = ok;
+    probe->sample.error = error;
+    probe->sample.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    recordSample(probe->sample);
+
+    auto it = m_rounds.find(probe->roundId);
+    if (it == m_rounds.end()) {
+        return;
+    }
+    it->anyOk = it->anyOk || ok;
+    if (!ok && it->firstError.isEmpty()) {
+        it->firstError = QStringLiteral("%1: %2").arg(probe->sample.target, error);
+    }
+    if (--it->pending > 0) {
+        return;
+    }
+
+    const quint64 roundId = it.key();
+    const Round round = it.value();
+    m_rounds.erase(it);
+
+    m_failedRoundStreak = round.anyOk ? 0 : m_failedRoundStreak + 1;
+    if (m_healthy != round.anyOk) {
+        m_healthy = round.anyOk;
+        emit healthChanged();
+    }
+    emit roundFinished(roundId, round.anyOk, round.anyOk ? QString() : round.firstError);
+}
+
+void ProxyHealthMonitor::recordSample(const ProxyHealthSample& sample)
+{
+    m_samples.append(sample);
+    while (m_samples.size() > m_historyCapacity) {
+        m_samples.removeFirst();
+    }
+    emit sampleAdded();
+}
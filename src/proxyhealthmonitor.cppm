@@ -0,0 +1,194 @@
+/*!
+ * @file        proxyhealthmonitor.cppm
+ * @brief       Event-driven health probing through the local mixed inbound.
+ *
+ * @details
+ * Periodically (or on demand) opens connections through the local proxy to
+ * a few well-known targets and measures each stage separately: TCP connect
+ * to the inbound, the HTTP CONNECT reply, the TLS handshake and
+ * time-to-first-byte of a tiny request. xray answers CONNECT itself before it
+ * dials the outbound, so only the TLS handshake and the response prove the
+ * server end works; a probe counts as ok once one of them completed. Everything runs
+ * on the owning thread's event loop; no call blocks. Samples are kept in a
+ * bounded ring so callers can observe degradation as it builds up.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <memory>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.proxyhealthmonitor;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct ProxyHealthTarget
+ * @brief Destination probed through the proxy.
+ */
+GENYCONNECT_MODULE_EXPORT struct ProxyHealthTarget {
+    QString host;                //!< Host name or IP sent in CONNECT.
+    quint16 port = 443;          //!< Destination port.
+    bool tls = true;             //!< Perform TLS handshake before the request; false sends plain HTTP.
+    QString path = QStringLiteral("/generate_204"); //!< Request path used for TTFB.
+};
+
+/**
+ * @struct ProxyHealthSample
+ * @brief Stage timings of one probe; `-1` marks a stage that was not reached.
+ */
+GENYCONNECT_MODULE_EXPORT struct ProxyHealthSample {
+    qint64 timestampMs = 0;      //!< Wall-clock completion time (ms since epoch).
+    QString target;              //!< `host:port` of the probed target.
+    bool ok = false;             //!< The target answered end to end (first response byte).
+    int connectMs = -1;          //!< TCP connect to the local inbound.
+    int connectReplyMs = -1;     //!< CONNECT request to `200` reply; local hop only, xray replies before dialing.
+    int tlsMs = -1;              //!< TLS handshake through the tunnel.
+    int ttfbMs = -1;             //!< Request write to first response byte.
+    QString error;               //!< Failure description when `ok` is false.
+
+    /**
+     * @brief Convert sample to a QML-friendly map.
+     * @return Variant map with all fields.
+     */
+    QVariantMap toVariantMap() const;
+};
+
+/**
+ * @class ProxyHealthMonitor
+ * @brief Non-blocking multi-target health monitor for the local proxy.
+ */
+GENYCONNECT_MODULE_EXPORT class ProxyHealthMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct monitor with default targets.
+     * @param parent Optional QObject parent.
+     */
+    explicit ProxyHealthMonitor(QObject *parent = nullptr);
+    ~ProxyHealthMonitor() override;
+
+    /**
+     * @brief Set local mixed/HTTP inbound port.
+     * @param port Listening port on 127.0.0.1.
+     */
+    void setProxyPort(quint16 port);
+
+    /**
+     * @brief Replace probe targets.
+     * @param targets Targets probed in parallel each round.
+     */
+    void setTargets(const QList<ProxyHealthTarget>& targets);
+
+    /**
+     * @brief Set periodic probe interval.
+     * @param ms Interval between rounds in milliseconds.
+     */
+    void setInterval(int ms);
+
+    /**
+     * @brief Set per-probe timeout.
+     * @param ms Timeout covering all stages of one probe.
+     */
+    void setTimeout(int ms);
+
+    /**
+     * @brief Start periodic rounds (first round after one interval).
+     */
+    void start();
+
+    /**
+     * @brief Stop periodic rounds and abort probes in flight.
+     */
+    void stop();
+
+    /**
+     * @brief Whether periodic probing is active.
+     * @return True after start().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Probe all targets now.
+     * @return Round id reported back through roundFinished().
+     */
+    quint64 probeNow();
+
+    /**
+     * @brief Drop recorded samples.
+     */
+    void clear();
+
+    /**
+     * @brief Most recent samples, newest last.
+     * @param limit Maximum number of samples.
+     * @return Sample maps.
+     */
+    QVariantList recentSamples(int limit) const;
+
+    /**
+     * @brief Aggregate health over recent samples.
+     * @return Map with healthy, successRate, median stage timings and failure streak.
+     */
+    QVariantMap summary() const;
+
+    /**
+     * @brief Whether the last finished round had at least one end-to-end probe.
+     * @return Health flag (true before the first round).
+     */
+    bool isHealthy() const;
+
+signals:
+    //! Emitted after each probe sample is recorded.
+    void sampleAdded();
+    //! Emitted when all probes of a round finished.
+    void roundFinished(quint64 roundId, bool ok, const QString& error);
+    //! Emitted when the healthy flag flips.
+    void healthChanged();
+
+private:
+    struct Probe;
+    struct Round {
+        int pending = 0;
+        bool anyOk = false;
+        QString firstError;
+    };
+
+    void startProbe(quint64 roundId, const ProxyHealthTarget& target);
+    static void sendRequest(Probe *probe);
+    void finishProbe(const std::shared_ptr<Probe>& probe, bool ok, const QString& error);
+    void recordSample(const ProxyHealthSample& sample);
+
+    quint16 m_proxyPort = 10808;                     //!< Local inbound port.
+    QList<ProxyHealthTarget> m_targets;              //!< Probe targets.
+    int m_timeoutMs = 6000;                          //!< Per-probe timeout.
+    int m_historyCapacity = 180;                     //!< Ring-buffer capacity.
+    QList<ProxyHealthSample> m_samples;              //!< Ring of recent samples.
+    QHash<quint64, Round> m_rounds;                  //!< Rounds in flight.
+    QList<std::shared_ptr<Probe>> m_probes;          //!< Probes in flight.
+    quint64 m_nextRoundId = 1;                       //!< Round id generator.
+    int m_failedRoundStreak = 0;                     //!< Consecutive rounds without success.
+    bool m_healthy = true;                           //!< Last round outcome.
+    QTimer m_intervalTimer;                          //!< Periodic round trigger.
+};
+
+#include "proxyhealthmonitor.moc"
@@ -0,0 +1,447 @@
+module;
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QtTypes>
+
+#include <algorithm>
+
+module genyconnect.backend.routingrulecompiler;
+
+namespace {
+constexpr int kListCount = 3;
+
+QString listName(int rank)
+{
+    switch (rank) {
+    case 0: return QStringLiteral("block");
+    case 1: return QStringLiteral("direct");
+    default: return QStringLiteral("proxy");
+    }
+}
+
+// 128-bit unsigned value so IPv4 and IPv6 ranges share one code path.
+struct Address128 {
+    quint64 hi = 0;
+    quint64 lo = 0;
+
+    friend bool operator==(const Address128&, const Address128&) = default;
+    friend bool operator<(const Address128& a, const Address128& b)
+    {
+        return a.hi != b.hi ? a.hi < b.hi : a.lo < b.lo;
+    }
+    friend bool operator<=(const Address128& a, const Address128& b) { return !(b < a); }
+    friend Address128 operator&(const Address128& a, const Address128& b) { return {a.hi & b.hi, a.lo & b.lo}; }
+    friend Address128 operator|(const Address128& a, const Address128& b) { return {a.hi | b.hi, a.lo | b.lo}; }
+    Address128 operator~() const { return {~hi, ~lo}; }
+
+    bool isZero() const { return hi == 0 && lo == 0; }
+
+    Address128 next() const
+    {
+        Address128 out = *this;
+        if (++out.lo == 0) {
+            ++out.hi;
+        }
+        return out;
+    }
+};
+
+// Value with the low `count` bits set.
+Address128 lowBits(int count)
+{
+    if (count <= 0) {
+        return {};
+    }
+    if (count < 64) {
+        return {0, (quint64(1) << count) - 1};
+    }
+    if (count < 128) {
+        return {(quint64(1) << (count - 64)) - 1, ~quint64(0)};
+    }
+    return {~quint64(0), ~quint64(0)};
+}
+
+struct IpRange {
+    bool v6 = false;
+    Address128 start;
+    Address128 end;
+    QString source;                             // Original entry, for conflict reports.
+    int rank = -1;                              // List that holds the range.
+};
+
+int familyBits(bool v6)
+{
+    return v6 ? 128 : 32;
+}
+
+bool parseIpRange(const QString& text, IpRange *range)
+{
+    QHostAddress address;
+    int prefix = -1;
+    if (text.contains('/')) {
+        const QPair<QHostAddress, int> subnet = QHostAddress::parseSubnet(text);
+        address = subnet.first;
+        prefix = subnet.second;
+    } else if (!address.setAddress(text)) {
+        return false;
+    }
+    if (address.isNull()) {
+        return false;
+    }
+
+    range->v6 = address.protocol() == QAbstractSocket::IPv6Protocol;
+    const int bits = familyBits(range->v6);
+    if (prefix < 0) {
+        prefix = bits;
+    }
+
+    Address128 value;
+    if (range->v6) {
+        const Q_IPV6ADDR bytes = address.toIPv6Address();
+        for (int i = 0; i < 8; ++i) {
+            value.hi = (value.hi << 8) | bytes[i];
+            value.lo = (value.lo << 8) | bytes[i + 8];
+        }
+    } else {
+        value.lo = address.toIPv4Address();
+    }
+
+    const Address128 hostMask = lowBits(bits - prefix);
+    range->start = value & ~hostMask;
+    range->end = range->start | hostMask;
+    range->source = text;
+    return true;
+}
+
+QString formatAddress(bool v6, const Address128& value)
+{
+    QHostAddress address;
+    if (v6) {
+        Q_IPV6ADDR bytes;
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<quint8>(value.hi >> (56 - 8 * i));
+            bytes[i + 8] = static_cast<quint8>(value.lo >> (56 - 8 * i));
+        }
+        address.setAddress(bytes);
+    } else {
+        address.setAddress(static_cast<quint32>(value.lo));
+    }
+    return address.toString();
+}
+
+QString formatPrefix(bool v6, const Address128& start, int prefix)
+{
+    return QStringLiteral("%1/%2").arg(formatAddress(v6, start)).arg(prefix);
+}
+
+QString formatRange(const IpRange& range)
+{
+    return QStringLiteral("%1-%2").arg(formatAddress(range.v6, range.start), formatAddress(range.v6, range.end));
+}
+
+// Sort and merge overlapping or adjacent ranges of one family.
+QList<IpRange> mergeRanges(QList<IpRange> ranges)
+{
+    std::sort(ranges.begin(), ranges.end(), [](const IpRange& a, const IpRange& b) {
+        return a.v6 != b.v6 ? !a.v6 : a.start < b.start;
+    });
+
+    QList<IpRange> merged;
+    for (const IpRange& range : ranges) {
+        if (!merged.isEmpty()) {
+            IpRange& last = merged.last();
+            const bool lastIsTop = last.end == lowBits(familyBits(last.v6));
+            if (last.v6 == range.v6 && (lastIsTop || range.start <= last.end.next())) {
+                if (last.end < range.end) {
+                    last.end = range.end;
+                }
+                continue;
+            }
+        }
+        merged.append(range);
+    }
+    return merged;
+}
+
+// Split a contiguous range into the fewest aligned prefixes.
+void appendPrefixes(const IpRange& range, QStringList *out)
+{
+    const int bits = familyBits(range.v6);
+    Address128 start = range.start;
+    while (true) {
+        int hostBits = 0;
+        while (hostBits < bits) {
+            const Address128 mask = lowBits(hostBits + 1);
+            if (!(start & mask).isZero() || range.end < (start | mask)) {
+                break;
+            }
+            ++hostBits;
+        }
+        out->append(formatPrefix(range.v6, start, bits - hostBits));
+
+        const Address128 last = start | lowBits(hostBits);
+        if (last == range.end) {
+            break;
+        }
+        start = last.next();
+    }
+}
+
+enum class EntryKind {
+    Domain,                                     // `domain:`, matches the name and its subdomains.
+    Full,                                       // `full:`, matches the exact name.
+    OpaqueDomain,                               // keyword/regexp/geosite/...: de-duplicated only.
+    OpaqueIp,                                   // `geoip:` matchers.
+    Address                                     // Literal IP or CIDR.
+};
+
+struct Entry {
+    EntryKind kind = EntryKind::OpaqueDomain;
+    QString matcher;                            // Normalized matcher as emitted.
+    QStringList labels;                         // Reversed domain labels (Domain/Full only).
+    IpRange range;                              // Address only.
+};
+
+Entry classifyEntry(const QString& raw)
+{
+    Entry entry;
+    const QString text = raw.trimmed();
+    if (parseIpRange(text, &entry.range)) {
+        entry.kind = EntryKind::Address;
+        return entry;
+    }
+
+    const qsizetype colon = text.indexOf(':');
+    const QString type = colon < 0 ? QStringLiteral("domain") : text.left(colon).toLower();
+    QString value = colon < 0 ? text : text.mid(colon + 1).trimmed();
+
+    if (type == QStringLiteral("geoip")) {
+        entry.kind = EntryKind::OpaqueIp;
+        entry.matcher = QStringLiteral("geoip:%1").arg(value.toLower());
+        return entry;
+    }
+    if (type != QStringLiteral("domain") && type != QStringLiteral("full")) {
+        entry.kind = EntryKind::OpaqueDomain;
+        entry.matcher = text;
+        return entry;
+    }
+
+    value = value.toLower();
+    if (type == QStringLiteral("domain") && value.startsWith(QStringLiteral("*."))) {
+        value.remove(0, 2);
+    }
+    while (value.startsWith('.')) {
+        value.remove(0, 1);
+    }
+    while (value.endsWith('.')) {
+        value.chop(1);
+    }
+
+    entry.kind = type == QStringLiteral("full") ? EntryKind::Full : EntryKind::Domain;
+    entry.matcher = QStringLiteral("%1:%2").arg(type, value);
+    const QStringList labels = value.split('.', Qt::SkipEmptyParts);
+    entry.labels.reserve(labels.size());
+    for (auto it = labels.crbegin(); it != labels.crend(); ++it) {
+        entry.labels.append(*it);
+    }
+    return entry;
+}
+
+// Suffix trie over reversed labels ("com" -> "example" -> "a"). Each node
+// keeps the earliest list rank that holds a `domain:` or `full:` rule there.
+class DomainTrie
+{
+public:
+    DomainTrie()
+    {
+        m_nodes.append(Node {});
+    }
+
+    void insert(const Entry& entry, int rank)
+    {
+        int node = 0;
+        for (const QString& label : entry.labels) {
+            const int child = m_nodes[node].children.value(label, -1);
+            if (child >= 0) {
+                node = child;
+                continue;
+            }
+            m_nodes.append(Node {});
+            m_nodes[node].children.insert(label, m_nodes.size() - 1);
+            node = m_nodes.size() - 1;
+        }
+        int& slot = entry.kind == EntryKind::Domain ? m_nodes[node].domainRank : m_nodes[node].fullRank;
+        if (slot < 0 || rank < slot) {
+            slot = rank;
+        }
+    }
+
+    /**
+     * Find a rule that matches everything `entry` matches and is evaluated
+     * before it. Returns the shadowing rank, or -1 when the entry is live;
+     * `shadowedBy` receives the shadowing matcher.
+     */
+    int shadowingRank(const Entry& entry, int rank, QString *shadowedBy) const
+    {
+        int node = 0;
+        for (qsizetype depth = 0; depth < entry.labels.size(); ++depth) {
+            node = m_nodes[node].children.value(entry.labels.at(depth), -1);
+            if (node < 0) {
+                return -1;
+            }
+            const Node& current = m_nodes[node];
+            const bool terminal = depth + 1 == entry.labels.size();
+
+            // An ancestor `domain:` rule covers every descendant; at the
+            // entry's own node it only covers a `full:` rule or an earlier list.
+            const bool domainCovers = current.domainRank >= 0
+                                      && (terminal
+                                              ? (entry.kind == EntryKind::Full ? current.domainRank <= rank
+                                                                                : current.domainRank < rank)
+                                              : current.domainRank <= rank);
+            if (domainCovers) {
+                *shadowedBy = QStringLiteral("domain:%1").arg(joinLabels(entry.labels, depth + 1));
+                return current.domainRank;
+            }
+            if (terminal && entry.kind == EntryKind::Full
+                && current.fullRank >= 0 && current.fullRank < rank) {
+                *shadowedBy = entry.matcher;
+                return current.fullRank;
+            }
+        }
+        return -1;
+    }
+
+private:
+    struct Node {
+        QHash<QString, int> children;
+        int domainRank = -1;
+        int fullRank = -1;
+    };
+
+    static QString joinLabels(const QStringList& reversed, qsizetype count)
+    {
+        QStringList labels;
+        labels.reserve(count);
+        for (qsizetype i = count - 1; i >= 0; --i) {
+            labels.append(reversed.at(i));
+        }
+        return labels.join('.');
+    }
+
+    QList<Node> m_nodes;
+};
+
+QString conflictMessage(int rank, const QString& entry, int shadowRank, const QString& shadowedBy)
+{
+    return QStringLiteral("%1 rule '%2' never applies: %3 rule '%4' matches first.")
+        .arg(listName(rank), entry, listName(shadowRank), shadowedBy);
+}
+}
+
+RoutingRuleCompiler::Result RoutingRuleCompiler::compile(
+    const QStringList& blockEntries,
+    const QStringList& directEntries,
+    const QStringList& proxyEntries)
+{
+    Result result;
+    const QStringList *inputs[kListCount] = {&blockEntries, &directEntries, &proxyEntries};
+    Target *targets[kListCount] = {&result.block, &result.direct, &result.proxy};
+
+    QList<Entry> entries[kListCount];
+    DomainTrie trie;
+    for (int rank = 0; rank < kListCount; ++rank) {
+        for (const QString& raw : *inputs[rank]) {
+            if (raw.trimmed().isEmpty()) {
+                continue;
+            }
+            ++result.inputEntries;
+            Entry entry = classifyEntry(raw);
+            if ((entry.kind == EntryKind::Domain || entry.kind == EntryKind::Full) && entry.labels.isEmpty()) {
+                continue;
+            }
+            if (entry.kind == EntryKind::Domain || entry.kind == EntryKind::Full) {
+                trie.insert(entry, rank);
+            }
+            entries[rank].append(entry);
+        }
+    }
+
+    QHash<QString, int> opaqueRanks;
+    QList<IpRange> earlierRanges;               // Merged ranges of all earlier lists.
+    for (int rank = 0; rank < kListCount; ++rank) {
+        Target& target = *targets[rank];
+        QSet<QString> emitted;
+        QList<IpRange> ranges;
+
+        for (const Entry& entry : std::as_const(entries[rank])) {
+            switch (entry.kind) {
+            case EntryKind::Domain:
+            case EntryKind::Full: {
+                QString shadowedBy;
+                const int shadowRank = trie.shadowingRank(entry, rank, &shadowedBy);
+                if (shadowRank >= 0) {
+                    if (shadowRank < rank) {
+                        result.conflicts.append(conflictMessage(rank, entry.matcher, shadowRank, shadowedBy));
+                    }
+                    break;
+                }
+                if (!emitted.contains(entry.matcher)) {
+                    emitted.insert(entry.matcher);
+                    target.domains.append(entry.matcher);
+                }
+                break;
+            }
+            case EntryKind::OpaqueDomain:
+            case EntryKind::OpaqueIp: {
+                const int firstRank = opaqueRanks.value(entry.matcher, rank);
+                if (firstRank < rank) {
+                    result.conflicts.append(conflictMessage(rank, entry.matcher, firstRank, entry.matcher));
+                    break;
+                }
+                opaqueRanks.insert(entry.matcher, rank);
+                if (!emitted.contains(entry.matcher)) {
+                    emitted.insert(entry.matcher);
+                    (entry.kind == EntryKind::OpaqueIp ? target.ips : target.domains).append(entry.matcher);
+                }
+                break;
+            }
+            case EntryKind::Address: {
+                bool shadowed = false;
+                for (const IpRange& earlier : std::as_const(earlierRanges)) {
+                    if (earlier.v6 != entry.range.v6
+                        || earlier.end < entry.range.start || entry.range.end < earlier.start) {
+                        continue;
+                    }
+                    if (earlier.start <= entry.range.start && entry.range.end <= earlier.end) {
+                        shadowed = true;
+                        result.conflicts.append(conflictMessage(rank, entry.range.source, earlier.rank, formatRange(earlier)));
+                        break;
+                    }
+                }
+                if (!shadowed) {
+                    ranges.append(entry.range);
+                }
+                break;
+            }
+            }
+        }
+
+        const QList<IpRange> merged = mergeRanges(ranges);
+        for (const IpRange& range : merged) {
+            appendPrefixes(range, &target.ips);
+        }
+        for (IpRange range : merged) {
+            range.rank = rank;
+            earlierRanges.append(range);
+        }
+
+        result.outputEntries += target.domains.size() + target.ips.size();
+    }
+
+    return result;
+}
@@ -0,0 +1,75 @@
+/*!
+ * @file        routingrulecompiler.cppm
+ * @brief       Reduces user routing lists to a minimal equivalent rule set.
+ *
+ * @details
+ * Block, direct and proxy lists are matched by xray in that order and the
+ * first match wins, so an entry that is already covered by an earlier entry
+ * (in the same list or an earlier one) can never change the outcome. The
+ * compiler removes such entries before they reach xray's matchers:
+ * - domain rules are placed in a reversed-label suffix trie, so
+ *   `domain:example.com` subsumes `full:a.example.com` and
+ *   `domain:b.example.com`;
+ * - IP and CIDR entries are merged into the fewest covering prefixes;
+ * - other matchers (`keyword:`, `regexp:`, `geosite:`, ...) are only
+ *   de-duplicated, since their overlap cannot be decided statically.
+ *
+ * An entry shadowed by an earlier list is a conflict: the user asked for one
+ * outcome but another list always wins. Conflicts are dropped like any other
+ * dead entry and reported so the user can fix their lists.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QString>
+#include <QStringList>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.routingrulecompiler;
+#endif
+
+/**
+ * @class RoutingRuleCompiler
+ * @brief Compiles block/direct/proxy entry lists into minimal matcher lists.
+ */
+export class RoutingRuleCompiler
+{
+public:
+    /**
+     * @struct Target
+     * @brief Compiled matchers for one outbound.
+     */
+    struct Target {
+        QStringList domains;                    //!< Prefixed domain matchers (`domain:`, `full:`, ...).
+        QStringList ips;                        //!< CIDRs and `geoip:` matchers.
+    };
+
+    /**
+     * @struct Result
+     * @brief Compiled lists plus a report of what was removed.
+     */
+    struct Result {
+        Target block;                           //!< Matchers routed to `block`.
+        Target direct;                          //!< Matchers routed to `direct`.
+        Target proxy;                           //!< Matchers routed to `proxy`.
+        QStringList conflicts;                  //!< Entries shadowed by an earlier list, human readable.
+        int inputEntries = 0;                   //!< Non-empty entries received.
+        int outputEntries = 0;                  //!< Matchers emitted.
+    };
+
+    /**
+     * @brief Compile user entry lists.
+     * @param blockEntries Entries routed to `block` (matched first).
+     * @param directEntries Entries routed to `direct`.
+     * @param proxyEntries Entries routed to `proxy` (matched last).
+     * @return Minimal matcher lists in input order, with conflicts reported.
+     */
+    static Result compile(
+        const QStringList& blockEntries,
+        const QStringList& directEntries,
+        const QStringList& proxyEntries);
+};
@@ -0,0 +1,301 @@
+module;
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+#include <QStringList>
+#include <QtTypes>
+
+module genyconnect.backend.ruleassets;
+
+namespace {
+// Domain.Type in xray's routing protobuf.
+enum class SiteType : quint32 {
+    Plain = 0,                                  // keyword:
+    Regex = 1,                                  // regexp:
+    Domain = 2,                                 // domain:
+    Full = 3                                    // full:
+};
+
+void appendVarint(QByteArray *out, quint64 value)
+{
+    while (value >= 0x80) {
+        out->append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->append(static_cast<char>(value));
+}
+
+void appendTag(QByteArray *out, int field, int wireType)
+{
+    appendVarint(out, (static_cast<quint64>(field) << 3) | static_cast<quint64>(wireType));
+}
+
+void appendBytesField(QByteArray *out, int field, const QByteArray& bytes)
+{
+    appendTag(out, field, 2);
+    appendVarint(out, static_cast<quint64>(bytes.size()));
+    out->append(bytes);
+}
+
+void appendVarintField(QByteArray *out, int field, quint64 value)
+{
+    if (value == 0) {
+        return;                                 // proto3 default, omitted on the wire.
+    }
+    appendTag(out, field, 0);
+    appendVarint(out, value);
+}
+
+bool splitSiteMatcher(const QString& matcher, SiteType *type, QString *value)
+{
+    const qsizetype colon = matcher.indexOf(':');
+    if (colon <= 0) {
+        return false;
+    }
+    const QString prefix = matcher.left(colon);
+    if (prefix == QStringLiteral("domain")) {
+        *type = SiteType::Domain;
+    } else if (prefix == QStringLiteral("full")) {
+        *type = SiteType::Full;
+    } else if (prefix == QStringLiteral("keyword")) {
+        *type = SiteType::Plain;
+    } else if (prefix == QStringLiteral("regexp")) {
+        *type = SiteType::Regex;
+    } else {
+        return false;
+    }
+    *value = matcher.mid(colon + 1);
+    return !value->isEmpty();
+}
+
+QByteArray encodeCidr(const QString& text)
+{
+    const QPair<QHostAddress, int> subnet = text.contains('/')
+        ? QHostAddress::parseSubnet(text)
+        : QPair<QHostAddress, int>(QHostAddress(text), -1);
+    if (subnet.first.isNull()) {
+        return {};
+    }
+
+    QByteArray ip;
+    int prefix = subnet.second;
+    if (subnet.first.protocol() == QAbstractSocket::IPv4Protocol) {
+        const quint32 value = subnet.first.toIPv4Address();
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            ip.append(static_cast<char>((value >> shift) & 0xFF));
+        }
+        prefix = prefix < 0 ? 32 : prefix;
+    } else {
+        const Q_IPV6ADDR value = subnet.first.toIPv6Address();
+        ip = QByteArray(reinterpret_cast<const char *>(value.c), 16);
+        prefix = prefix < 0 ? 128 : prefix;
+    }
+
+    QByteArray cidr;
+    appendBytesField(&cidr, 1, ip);
+    appendVarintField(&cidr, 2, static_cast<quint64>(prefix));
+    return cidr;
+}
+
+QByteArray contentHash(const QString& fileName, const QList<RuleAssets::Set>& sets, const QByteArray& sourceKey)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(fileName.toUtf8());
+    if (!sourceKey.isEmpty()) {
+        hash.addData(QByteArrayView("\n@"));
+        hash.addData(sourceKey);
+    }
+    for (const RuleAssets::Set& set : sets) {
+        hash.addData(QByteArrayView("\n#"));
+        hash.addData(set.code.toUtf8());
+        if (!sourceKey.isEmpty()) {
+            hash.addData(QByteArray::number(set.matchers.size()));
+            continue;
+        }
+        for (const QString& matcher : set.matchers) {
+            hash.addData(QByteArrayView("\n"));
+            hash.addData(matcher.toUtf8());
+        }
+    }
+    return hash.result().toHex();
+}
+
+bool writeAtomically(const QString& path, const QByteArray& data, QString *errorMessage)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(data) != data.size()
+        || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+}
+
+bool RuleAssets::isSiteMatcher(const QString& matcher)
+{
+    SiteType type = SiteType::Domain;
+    QString value;
+    return splitSiteMatcher(matcher, &type, &value);
+}
+
+QByteArray RuleAssets::encodeGeoSite(const QList<Set>& sets)
+{
+    QByteArray out;
+    for (const Set& set : sets) {
+        QByteArray site;
+        appendBytesField(&site, 1, set.code.toUpper().toUtf8());
+        for (const QString& matcher : set.matchers) {
+            SiteType type = SiteType::Domain;
+            QString value;
+            if (!splitSiteMatcher(matcher, &type, &value)) {
+                continue;
+            }
+            QByteArray domain;
+            appendVarintField(&domain, 1, static_cast<quint64>(type));
+            appendBytesField(&domain, 2, value.toUtf8());
+            appendBytesField(&site, 2, domain);
+        }
+        appendBytesField(&out, 1, site);
+    }
+    return out;
+}
+
+QByteArray RuleAssets::encodeGeoIp(const QList<Set>& sets)
+{
+    QByteArray out;
+    for (const Set& set : sets) {
+        QByteArray geoIp;
+        appendBytesField(&geoIp, 1, set.code.toUpper().toUtf8());
+        for (const QString& matcher : set.matchers) {
+            const QByteArray cidr = encodeCidr(matcher);
+            if (!cidr.isEmpty()) {
+                appendBytesField(&geoIp, 2, cidr);
+            }
+        }
+        appendBytesField(&out, 1, geoIp);
+    }
+    return out;
+}
+
+bool RuleAssets::store(
+    const QString& directory,
+    const QString& fileName,
+    const QList<Set>& sets,
+    const QByteArray& sourceKey,
+    bool *rewritten,
+    QString *errorMessage)
+{
+    if (rewritten) {
+        *rewritten = false;
+    }
+    if (!QDir().mkpath(directory)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Cannot create asset directory: %1").arg(directory);
+        }
+        return false;
+    }
+
+    const QDir dir(directory);
+    const QString path = dir.filePath(fileName);
+    const QString hashPath = path + QStringLiteral(".sha256");
+    const QByteArray hash = contentHash(fileName, sets, sourceKey);
+
+    QFile hashFile(hashPath);
+    if (QFileInfo::exists(path) && hashFile.open(QIODevice::ReadOnly)
+        && hashFile.readAll().trimmed() == hash) {
+        return true;
+    }
+    hashFile.close();
+
+    const QByteArray data = fileName == QString::fromLatin1(kIpFileName) ? encodeGeoIp(sets) : encodeGeoSite(sets);
+    if (!writeAtomically(path, data, errorMessage)) {
+        return false;
+    }
+    // The sidecar is written last, so an interrupted write is simply redone.
+    if (!writeAtomically(hashPath, hash, errorMessage)) {
+        return false;
+    }
+    if (rewritten) {
+        *rewritten = true;
+    }
+    return true;
+}
+
+int RuleAssets::mirrorCoreAssets(const QString& coreDirectory, const QString& directory)
+{
+    const QDir source(coreDirectory);
+    if (coreDirectory.trimmed().isEmpty() || !source.exists() || !QDir().mkpath(directory)) {
+        return 0;
+    }
+
+    const QDir target(directory);
+    int copied = 0;
+    const QFileInfoList assets = source.entryInfoList({QStringLiteral("*.dat")}, QDir::Files);
+    for (const QFileInfo& asset : assets) {
+        const QString name = asset.fileName();
+        if (name == QString::fromLatin1(kSiteFileName) || name == QString::fromLatin1(kIpFileName)) {
+            continue;
+        }
+        const QString destination = target.filePath(name);
+        const QFileInfo existing(destination);
+        if (existing.exists()
+            && existing.size() == asset.size()
+            && existing.lastModified() == asset.lastModified()) {
+            continue;
+        }
+
+        QFile::remove(destination);
+        if (!QFile::copy(asset.absoluteFilePath(), destination)) {
+            continue;
+        }
+        // Keep the source timestamp so the next check can skip the copy.
+        QFile copy(destination);
+        if (copy.open(QIODevice::ReadWrite)) {
+            copy.setFileTime(asset.lastModified(), QFileDevice::FileModificationTime);
+        }
+        ++copied;
+    }
+    return copied;
+}
+
+QStringList RuleAssets::parseRuleList(const QByteArray& text)
+{
+    QStringList out;
+    const QList<QByteArray> lines = text.split('\n');
+    out.reserve(lines.size());
+    for (const QByteArray& rawLine : lines) {
+        QByteArray line = rawLine.trimmed();
+        if (line.isEmpty() || line.startsWith('#') || line.startsWith('!') || line.startsWith("//")) {
+            continue;
+        }
+        const qsizetype comment = line.indexOf(" #");
+        if (comment >= 0) {
+            line = line.left(comment).trimmed();
+        }
+
+        // Hosts-file lines ("0.0.0.0 example.com") contribute their host name.
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        QString entry = QString::fromUtf8(fields.constFirst());
+        if (fields.size() > 1 && !QHostAddress(entry).isNull()) {
+            entry = QString::fromUtf8(fields.at(1));
+            if (entry == QStringLiteral("localhost")) {
+                continue;
+            }
+        }
+        if (!entry.isEmpty()) {
+            out.append(entry);
+        }
+    }
+    return out;
+}
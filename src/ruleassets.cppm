@@ -0,0 +1,108 @@
+/*!
+ * @file        ruleassets.cppm
+ * @brief       Generated geosite/geoip assets for large routing lists.
+ *
+ * @details
+ * Inlining tens of thousands of matchers makes the runtime config several
+ * megabytes large and slows down xray startup. Large lists are therefore
+ * written to xray-compatible protobuf assets (`GeoSiteList` / `GeoIPList`)
+ * and referenced from routing as `ext:genyconnect.dat:<list>` and
+ * `ext:genyconnect-ip.dat:<list>`. Each asset carries a content hash sidecar
+ * so an unchanged rule set is never re-encoded or rewritten; callers that
+ * know what the sets were compiled from pass that key instead, so the check
+ * does not walk every matcher.
+ *
+ * xray resolves `ext:` files relative to its asset directory; the asset
+ * directory also mirrors the `.dat` files shipped next to the core, so
+ * `geosite:`/`geoip:` matchers keep working when it is selected.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.ruleassets;
+#endif
+
+/**
+ * @class RuleAssets
+ * @brief Encodes, stores and sources rule lists kept outside the runtime config.
+ */
+export class RuleAssets
+{
+public:
+    static constexpr const char *kSiteFileName = "genyconnect.dat";   //!< Generated geosite asset.
+    static constexpr const char *kIpFileName = "genyconnect-ip.dat";  //!< Generated geoip asset.
+
+    /**
+     * @struct Set
+     * @brief One tagged list inside an asset.
+     */
+    struct Set {
+        QString code;                           //!< List tag (`proxy`, `direct`, `block`).
+        QStringList matchers;                   //!< `domain:`/`full:`/`keyword:`/`regexp:` entries or CIDRs.
+    };
+
+    /**
+     * @brief Whether a domain matcher can be stored in a geosite asset.
+     * @param matcher Prefixed domain matcher.
+     * @return True for `domain:`, `full:`, `keyword:` and `regexp:` matchers.
+     */
+    static bool isSiteMatcher(const QString& matcher);
+
+    /**
+     * @brief Encode domain sets as a `GeoSiteList` message.
+     * @param sets Tagged domain matcher lists.
+     * @return Protobuf bytes.
+     */
+    static QByteArray encodeGeoSite(const QList<Set>& sets);
+
+    /**
+     * @brief Encode CIDR sets as a `GeoIPList` message.
+     * @param sets Tagged CIDR lists; unparsable entries are skipped.
+     * @return Protobuf bytes.
+     */
+    static QByteArray encodeGeoIp(const QList<Set>& sets);
+
+    /**
+     * @brief Write an asset unless the stored content hash already matches.
+     * @param directory Asset directory.
+     * @param fileName Asset file name (kSiteFileName or kIpFileName).
+     * @param sets Tagged lists to store.
+     * @param sourceKey Hash of the inputs @p sets were compiled from; when
+     *        empty the matchers themselves are hashed.
+     * @param rewritten Optional output, true when the file was (re)written.
+     * @param errorMessage Optional output message on failure.
+     * @return True when the asset on disk matches @p sets.
+     */
+    static bool store(
+        const QString& directory,
+        const QString& fileName,
+        const QList<Set>& sets,
+        const QByteArray& sourceKey,
+        bool *rewritten = nullptr,
+        QString *errorMessage = nullptr);
+
+    /**
+     * @brief Copy the `.dat` files shipped next to the core into the asset directory.
+     * @param coreDirectory Directory holding the xray executable.
+     * @param directory Asset directory.
+     * @return Number of files copied (unchanged files are skipped).
+     */
+    static int mirrorCoreAssets(const QString& coreDirectory, const QString& directory);
+
+    /**
+     * @brief Parse a rule list file (plain list, hosts file or matcher list).
+     * @param text File contents.
+     * @return Entries in file order; comments and blank lines skipped.
+     */
+    static QStringList parseRuleList(const QByteArray& text);
+};
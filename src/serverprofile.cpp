@@ -1,14 +1,143 @@
 module;
+#include <QHash>
+#include <QList>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QString>
+#include <QtGlobal>
 #include <QUuid>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <optional>
+#include <utility>
 
 module genyconnect.backend.serverprofile;
 
 namespace {
+// Interned values live in fixed-size chunks that are never moved, so live
+// handles resolve without locking while other threads intern new values.
+// Entries are reference counted: a value no handle refers to any more is
+// dropped and its slot reused, so the table only holds values in use.
+constexpr quint32 kInternChunkBits = 10;
+constexpr quint32 kInternChunkSize = 1u << kInternChunkBits;
+constexpr quint32 kInternMaxChunks = 65536;
+
+struct InternSlot {
+    QString value;
+    std::atomic<quint32> refs {0};
+};
+
+struct InternTable {
+    QMutex mutex;
+    QHash<QString, quint32> ids;
+    QList<quint32> freeIds;
+    quint32 nextId = 1; // id 0 is the empty string
+    std::atomic<qsizetype> live {0};
+    std::unique_ptr<std::atomic<InternSlot *>[]> chunks {new std::atomic<InternSlot *>[kInternMaxChunks]()};
+    bool exhaustedReported = false;
+
+    InternTable()
+    {
+        chunks[0].store(new InternSlot[kInternChunkSize], std::memory_order_release);
+    }
+
+    InternSlot& slot(quint32 id) const
+    {
+        InternSlot *chunk = chunks[id >> kInternChunkBits].load(std::memory_order_acquire);
+        return chunk[id & (kInternChunkSize - 1)];
+    }
+
+    quint32 intern(const QString& value)
+    {
+        if (value.isEmpty()) {
+            return 0;
+        }
+        QMutexLocker locker(&mutex);
+        const auto it = ids.constFind(value);
+        if (it != ids.constEnd()) {
+            slot(it.value()).refs.fetch_add(1, std::memory_order_relaxed);
+            return it.value();
+        }
+        quint32 id = 0;
+        if (!freeIds.isEmpty()) {
+            id = freeIds.takeLast();
+        } else {
+            const quint32 chunkIndex = nextId >> kInternChunkBits;
+            if (chunkIndex >= kInternMaxChunks) {
+                // Needs tens of millions of distinct live values; memory runs
+                // out long before that, but never abort on imported data.
+                if (!exhaustedReported) {
+                    exhaustedReported = true;
+                    qWarning("InternedString table is full; further new values read as empty.");
+                }
+                return 0;
+            }
+            if (!chunks[chunkIndex].load(std::memory_order_relaxed)) {
+                chunks[chunkIndex].store(new InternSlot[kInternChunkSize], std::memory_order_release);
+            }
+            id = nextId++;
+        }
+        InternSlot& entry = slot(id);
+        entry.value = value;
+        entry.refs.store(1, std::memory_order_relaxed);
+        ids.insert(value, id);
+        live.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    void retain(quint32 id)
+    {
+        if (id != 0) {
+            slot(id).refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release(quint32 id)
+    {
+        if (id == 0 || slot(id).refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        QMutexLocker locker(&mutex);
+        InternSlot& entry = slot(id);
+        // Re-interned or already dropped by a racing release in the meantime.
+        if (entry.refs.load(std::memory_order_relaxed) != 0 || entry.value.isEmpty()) {
+            return;
+        }
+        ids.remove(entry.value);
+        entry.value = QString();
+        freeIds.append(id);
+        live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    const QString& resolve(quint32 id) const
+    {
+        return slot(id).value;
+    }
+};
+
+InternTable& internTable()
+{
+    // Intentionally leaked: handles may be released during static destruction.
+    static InternTable *table = new InternTable();
+    return *table;
+}
+
+const QString& emptyString()
+{
+    static const QString value;
+    return value;
+}
+
+const QJsonObject& emptyObject()
+{
+    static const QJsonObject value;
+    return value;
+}
+
 QString createProfileId()
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
@@ -34,6 +163,251 @@ std::optional<quint16> parseJsonPort(const QJsonValue& value)
 
     return static_cast<quint16>(parsed);
 }
+
+std::optional<int> parseJsonBoundedInt(const QJsonValue& value, int minimum, int maximum)
+{
+    if (value.isUndefined() || value.isNull()) {
+        return std::nullopt;
+    }
+
+    bool ok = false;
+    const int parsed = value.isString() ? value.toString().trimmed().toInt(&ok) : value.toVariant().toInt(&ok);
+    if (!ok) {
+        return std::nullopt;
+    }
+    return std::clamp(parsed, minimum, maximum);
+}
+
+std::optional<bool> parseJsonBool(const QJsonValue& value)
+{
+    if (!value.isBool()) {
+        return std::nullopt;
+    }
+    return value.toBool();
+}
+
+template <typename T>
+void insertOptional(QJsonObject *json, const QString& key, const std::optional<T>& value)
+{
+    if (value.has_value()) {
+        json->insert(key, *value);
+    }
+}
+}
+
+bool TransportTuning::isEmpty() const
+{
+    return !mux && !muxConcurrency && !xudpConcurrency && !tcpFastOpen && !tcpKeepAliveIdle
+           && tcpCongestion.isEmpty() && !tcpNoDelay && !tcpMptcp && !bufferSizeKb && !connIdle
+           && !handshake && !fragment;
+}
+
+TransportTuning TransportTuning::overriding(const TransportTuning& fallback) const
+{
+    TransportTuning out;
+    out.mux = mux ? mux : fallback.mux;
+    out.muxConcurrency = muxConcurrency ? muxConcurrency : fallback.muxConcurrency;
+    out.xudpConcurrency = xudpConcurrency ? xudpConcurrency : fallback.xudpConcurrency;
+    out.tcpFastOpen = tcpFastOpen ? tcpFastOpen : fallback.tcpFastOpen;
+    out.tcpKeepAliveIdle = tcpKeepAliveIdle ? tcpKeepAliveIdle : fallback.tcpKeepAliveIdle;
+    out.tcpCongestion = tcpCongestion.isEmpty() ? fallback.tcpCongestion : tcpCongestion;
+    out.tcpNoDelay = tcpNoDelay ? tcpNoDelay : fallback.tcpNoDelay;
+    out.tcpMptcp = tcpMptcp ? tcpMptcp : fallback.tcpMptcp;
+    out.bufferSizeKb = bufferSizeKb ? bufferSizeKb : fallback.bufferSizeKb;
+    out.connIdle = connIdle ? connIdle : fallback.connIdle;
+    out.handshake = handshake ? handshake : fallback.handshake;
+    out.fragment = fragment ? fragment : fallback.fragment;
+    return out;
+}
+
+QJsonObject TransportTuning::toJson() const
+{
+    QJsonObject json;
+    insertOptional(&json, QStringLiteral("mux"), mux);
+    insertOptional(&json, QStringLiteral("muxConcurrency"), muxConcurrency);
+    insertOptional(&json, QStringLiteral("xudpConcurrency"), xudpConcurrency);
+    insertOptional(&json, QStringLiteral("tcpFastOpen"), tcpFastOpen);
+    insertOptional(&json, QStringLiteral("tcpKeepAliveIdle"), tcpKeepAliveIdle);
+    if (!tcpCongestion.isEmpty()) {
+        json.insert(QStringLiteral("tcpCongestion"), tcpCongestion);
+    }
+    insertOptional(&json, QStringLiteral("tcpNoDelay"), tcpNoDelay);
+    insertOptional(&json, QStringLiteral("tcpMptcp"), tcpMptcp);
+    insertOptional(&json, QStringLiteral("bufferSizeKb"), bufferSizeKb);
+    insertOptional(&json, QStringLiteral("connIdle"), connIdle);
+    insertOptional(&json, QStringLiteral("handshake"), handshake);
+    insertOptional(&json, QStringLiteral("fragment"), fragment);
+    return json;
+}
+
+TransportTuning TransportTuning::fromJson(const QJsonObject& json)
+{
+    TransportTuning tuning;
+    tuning.mux = parseJsonBool(json.value(QStringLiteral("mux")));
+    tuning.muxConcurrency = parseJsonBoundedInt(json.value(QStringLiteral("muxConcurrency")), 1, 128);
+    tuning.xudpConcurrency = parseJsonBoundedInt(json.value(QStringLiteral("xudpConcurrency")), 1, 1024);
+    tuning.tcpFastOpen = parseJsonBool(json.value(QStringLiteral("tcpFastOpen")));
+    tuning.tcpKeepAliveIdle = parseJsonBoundedInt(json.value(QStringLiteral("tcpKeepAliveIdle")), 1, 7200);
+    const QString congestion = json.value(QStringLiteral("tcpCongestion")).toString().trimmed().toLower();
+    if (congestion == QStringLiteral("bbr") || congestion == QStringLiteral("cubic")
+        || congestion == QStringLiteral("reno")) {
+        tuning.tcpCongestion = congestion;
+    }
+    tuning.tcpNoDelay = parseJsonBool(json.value(QStringLiteral("tcpNoDelay")));
+    tuning.tcpMptcp = parseJsonBool(json.value(QStringLiteral("tcpMptcp")));
+    tuning.bufferSizeKb = parseJsonBoundedInt(json.value(QStringLiteral("bufferSizeKb")), 0, 65536);
+    tuning.connIdle = parseJsonBoundedInt(json.value(QStringLiteral("connIdle")), 1, 86400);
+    tuning.handshake = parseJsonBoundedInt(json.value(QStringLiteral("handshake")), 1, 120);
+    tuning.fragment = parseJsonBool(json.value(QStringLiteral("fragment")));
+    return tuning;
+}
+
+InternedString::InternedString(const QString& value)
+    : m_id(internTable().intern(value))
+{
+}
+
+InternedString::InternedString(const InternedString& other)
+    : m_id(other.m_id)
+{
+    internTable().retain(m_id);
+}
+
+InternedString::InternedString(InternedString&& other) noexcept
+    : m_id(std::exchange(other.m_id, 0))
+{
+}
+
+InternedString::~InternedString()
+{
+    internTable().release(m_id);
+}
+
+InternedString& InternedString::operator=(const InternedString& other)
+{
+    if (m_id != other.m_id) {
+        internTable().retain(other.m_id);
+        internTable().release(std::exchange(m_id, other.m_id));
+    }
+    return *this;
+}
+
+InternedString& InternedString::operator=(InternedString&& other) noexcept
+{
+    if (this != &other) {
+        internTable().release(std::exchange(m_id, std::exchange(other.m_id, 0)));
+    }
+    return *this;
+}
+
+InternedString& InternedString::operator=(const QString& value)
+{
+    const quint32 id = internTable().intern(value);
+    internTable().release(std::exchange(m_id, id));
+    return *this;
+}
+
+const QString& InternedString::toString() const
+{
+    return internTable().resolve(m_id);
+}
+
+qsizetype InternedString::tableSize()
+{
+    return internTable().live.load(std::memory_order_relaxed) + 1;
+}
+
+const QString& ServerProfile::publicKey() const
+{
+    return m_extension ? m_extension->publicKey : emptyString();
+}
+
+const QString& ServerProfile::shortId() const
+{
+    return m_extension ? m_extension->shortId : emptyString();
+}
+
+const QString& ServerProfile::spiderX() const
+{
+    return m_extension ? m_extension->spiderX : emptyString();
+}
+
+const QString& ServerProfile::serviceName() const
+{
+    return m_extension ? m_extension->serviceName : emptyString();
+}
+
+const QJsonObject& ServerProfile::xhttpExtra() const
+{
+    return m_extension ? m_extension->xhttpExtra : emptyObject();
+}
+
+const QJsonObject& ServerProfile::extra() const
+{
+    return m_extension ? m_extension->extra : emptyObject();
+}
+
+const TransportTuning& ServerProfile::transportTuning() const
+{
+    static const TransportTuning empty;
+    return m_extension ? m_extension->transportTuning : empty;
+}
+
+void ServerProfile::setPublicKey(const QString& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().publicKey = value;
+    }
+}
+
+void ServerProfile::setShortId(const QString& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().shortId = value;
+    }
+}
+
+void ServerProfile::setSpiderX(const QString& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().spiderX = value;
+    }
+}
+
+void ServerProfile::setServiceName(const QString& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().serviceName = value;
+    }
+}
+
+void ServerProfile::setXhttpExtra(const QJsonObject& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().xhttpExtra = value;
+    }
+}
+
+void ServerProfile::setExtra(const QJsonObject& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().extra = value;
+    }
+}
+
+void ServerProfile::setTransportTuning(const TransportTuning& value)
+{
+    if (m_extension || !value.isEmpty()) {
+        ensureExtension().transportTuning = value;
+    }
+}
+
+ServerProfileExtension& ServerProfile::ensureExtension()
+{
+    if (!m_extension) {
+        m_extension = new ServerProfileExtension();
+    }
+    return *m_extension;
 }
 
 bool ServerProfile::isValid() const
@@ -59,36 +433,39 @@ QJsonObject ServerProfile::toJson() const
     QJsonObject json;
     json[QStringLiteral("id")] = id;
     json[QStringLiteral("name")] = name;
-    json[QStringLiteral("protocol")] = protocol;
+    json[QStringLiteral("protocol")] = protocol.toString();
     json[QStringLiteral("address")] = address;
     json[QStringLiteral("port")] = static_cast<int>(port);
 
     json[QStringLiteral("userId")] = userId;
-    json[QStringLiteral("encryption")] = encryption;
-    json[QStringLiteral("flow")] = flow;
-    json[QStringLiteral("network")] = network;
-    json[QStringLiteral("security")] = security;
+    json[QStringLiteral("encryption")] = encryption.toString();
+    json[QStringLiteral("flow")] = flow.toString();
+    json[QStringLiteral("network")] = network.toString();
+    json[QStringLiteral("security")] = security.toString();
 
     json[QStringLiteral("sni")] = sni;
     json[QStringLiteral("alpn")] = alpn;
-    json[QStringLiteral("fingerprint")] = fingerprint;
-    json[QStringLiteral("publicKey")] = publicKey;
-    json[QStringLiteral("shortId")] = shortId;
-    json[QStringLiteral("spiderX")] = spiderX;
+    json[QStringLiteral("fingerprint")] = fingerprint.toString();
+    json[QStringLiteral("publicKey")] = publicKey();
+    json[QStringLiteral("shortId")] = shortId();
+    json[QStringLiteral("spiderX")] = spiderX();
 
     json[QStringLiteral("path")] = path;
     json[QStringLiteral("hostHeader")] = hostHeader;
-    json[QStringLiteral("serviceName")] = serviceName;
-    json[QStringLiteral("headerType")] = headerType;
+    json[QStringLiteral("serviceName")] = serviceName();
+    json[QStringLiteral("headerType")] = headerType.toString();
     json[QStringLiteral("xhttpMode")] = xhttpMode;
-    json[QStringLiteral("xhttpExtra")] = xhttpExtra;
+    json[QStringLiteral("xhttpExtra")] = xhttpExtra();
 
     json[QStringLiteral("allowInsecure")] = allowInsecure;
     json[QStringLiteral("originalLink")] = originalLink;
     json[QStringLiteral("groupName")] = groupName;
     json[QStringLiteral("sourceName")] = sourceName;
     json[QStringLiteral("sourceId")] = sourceId;
-    json[QStringLiteral("extra")] = extra;
+    json[QStringLiteral("extra")] = extra();
+    if (!transportTuning().isEmpty()) {
+        json[QStringLiteral("transportTuning")] = transportTuning().toJson();
+    }
 
     return json;
 }
@@ -115,23 +492,24 @@ std::optional<ServerProfile> ServerProfile::fromJson(const QJsonObject& json)
     profile.sni = json.value(QStringLiteral("sni")).toString().trimmed();
     profile.alpn = json.value(QStringLiteral("alpn")).toString().trimmed();
     profile.fingerprint = json.value(QStringLiteral("fingerprint")).toString().trimmed();
-    profile.publicKey = json.value(QStringLiteral("publicKey")).toString().trimmed();
-    profile.shortId = json.value(QStringLiteral("shortId")).toString().trimmed();
-    profile.spiderX = json.value(QStringLiteral("spiderX")).toString().trimmed();
+    profile.setPublicKey(json.value(QStringLiteral("publicKey")).toString().trimmed());
+    profile.setShortId(json.value(QStringLiteral("shortId")).toString().trimmed());
+    profile.setSpiderX(json.value(QStringLiteral("spiderX")).toString().trimmed());
 
     profile.path = json.value(QStringLiteral("path")).toString().trimmed();
     profile.hostHeader = json.value(QStringLiteral("hostHeader")).toString().trimmed();
-    profile.serviceName = json.value(QStringLiteral("serviceName")).toString().trimmed();
+    profile.setServiceName(json.value(QStringLiteral("serviceName")).toString().trimmed());
     profile.headerType = json.value(QStringLiteral("headerType")).toString().trimmed().toLower();
     profile.xhttpMode = json.value(QStringLiteral("xhttpMode")).toString().trimmed().toLower();
-    profile.xhttpExtra = json.value(QStringLiteral("xhttpExtra")).toObject();
+    profile.setXhttpExtra(json.value(QStringLiteral("xhttpExtra")).toObject());
 
     profile.allowInsecure = json.value(QStringLiteral("allowInsecure")).toBool(false);
     profile.originalLink = json.value(QStringLiteral("originalLink")).toString().trimmed();
     profile.groupName = json.value(QStringLiteral("groupName")).toString().trimmed();
     profile.sourceName = json.value(QStringLiteral("sourceName")).toString().trimmed();
     profile.sourceId = json.value(QStringLiteral("sourceId")).toString().trimmed();
-    profile.extra = json.value(QStringLiteral("extra")).toObject();
+    profile.setExtra(json.value(QStringLiteral("extra")).toObject());
+    profile.setTransportTuning(TransportTuning::fromJson(json.value(QStringLiteral("transportTuning")).toObject()));
 
     if (profile.id.isEmpty()) {
         profile.id = createProfileId();
@@ -15,57 +15,210 @@
 
 module;
 #include <QJsonObject>
+#include <QSharedData>
+#include <QSharedDataPointer>
 #include <QString>
+#include <QStringList>
 #include <QtTypes>
 
 #include <optional>
 
 export module genyconnect.backend.serverprofile;
 
+/**
+ * @class InternedString
+ * @brief Four-byte handle to a process-wide, reference-counted string table.
+ *
+ * @details
+ * Used for the enum-like profile fields (protocol, encryption, flow,
+ * network, security, fingerprint, header type) whose handful of values
+ * repeats across thousands of subscription profiles. Equal values share one
+ * table entry, so comparing two handles is an integer compare. Converts
+ * implicitly to `const QString&`; the reference stays valid while the handle
+ * lives. An entry is dropped with its last handle, so the table never holds
+ * more than the values in use. Interning is thread-safe.
+ */
+export class InternedString
+{
+public:
+    InternedString() = default;
+
+    /**
+     * @brief Intern a value.
+     * @param value String value (empty maps to the null handle).
+     */
+    InternedString(const QString& value);
+    InternedString(const InternedString& other);
+    InternedString(InternedString&& other) noexcept;
+    ~InternedString();
+
+    InternedString& operator=(const InternedString& other);
+    InternedString& operator=(InternedString&& other) noexcept;
+
+    /**
+     * @brief Re-point handle to an interned copy of value.
+     * @param value String value.
+     * @return This handle.
+     */
+    InternedString& operator=(const QString& value);
+
+    /**
+     * @brief Interned value.
+     * @return Stable reference into the shared table.
+     */
+    const QString& toString() const;
+    operator const QString&() const { return toString(); }
+
+    /**
+     * @brief Table id (0 for the empty string).
+     * @return Interned id.
+     */
+    quint32 id() const { return m_id; }
+
+    bool isEmpty() const { return m_id == 0; }
+    QString trimmed() const { return toString().trimmed(); }
+    QString toLower() const { return toString().toLower(); }
+    QString toUpper() const { return toString().toUpper(); }
+    QStringList split(QChar sep, Qt::SplitBehavior behavior = Qt::KeepEmptyParts) const
+    {
+        return toString().split(sep, behavior);
+    }
+    int compare(const QString& other, Qt::CaseSensitivity cs = Qt::CaseSensitive) const
+    {
+        return toString().compare(other, cs);
+    }
+
+    friend bool operator==(const InternedString& lhs, const InternedString& rhs) { return lhs.m_id == rhs.m_id; }
+    friend bool operator==(const InternedString& lhs, const QString& rhs) { return lhs.toString() == rhs; }
+
+    /**
+     * @brief Number of distinct values currently interned (diagnostics).
+     * @return Live entries including the empty entry.
+     */
+    static qsizetype tableSize();
+
+private:
+    quint32 m_id = 0; //!< Index into the shared table; 0 is the empty string.
+};
+
+/**
+ * @struct TransportTuning
+ * @brief Performance-related outbound and policy settings.
+ *
+ * @details
+ * Every field is optional: unset values fall back to the next layer (global
+ * defaults, then xray's own defaults) and are not emitted into the config.
+ */
+export struct TransportTuning {
+    std::optional<bool> mux;                 //!< Enable outbound mux.
+    std::optional<int> muxConcurrency;       //!< Mux sub-connections per TCP connection (1-128).
+    std::optional<int> xudpConcurrency;      //!< Mux XUDP sub-connections (1-1024).
+    std::optional<bool> tcpFastOpen;         //!< sockopt `tcpFastOpen`.
+    std::optional<int> tcpKeepAliveIdle;     //!< sockopt `tcpKeepAliveIdle` in seconds.
+    QString tcpCongestion;                   //!< sockopt `tcpCongestion` (bbr, cubic, reno); empty keeps the system default.
+    std::optional<bool> tcpNoDelay;          //!< sockopt `tcpNoDelay`.
+    std::optional<bool> tcpMptcp;            //!< sockopt `tcpMptcp`.
+    std::optional<int> bufferSizeKb;         //!< Policy per-connection buffer in KB.
+    std::optional<int> connIdle;             //!< Policy idle timeout in seconds.
+    std::optional<int> handshake;            //!< Policy handshake timeout in seconds.
+    std::optional<bool> fragment;            //!< Dial Reality through the fragmenting `frag-proxy` outbound.
+
+    /**
+     * @brief Whether no field is set.
+     * @return True when every field falls back.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Layer these settings over fallback values.
+     * @param fallback Values used where this tuning is unset.
+     * @return Merged tuning.
+     */
+    TransportTuning overriding(const TransportTuning& fallback) const;
+
+    /**
+     * @brief Serialize set fields.
+     * @return JSON object without unset fields.
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Parse and clamp tuning values.
+     * @param json Object produced by toJson() or edited by the user.
+     * @return Tuning; invalid fields are left unset.
+     */
+    static TransportTuning fromJson(const QJsonObject& json);
+};
+
+/**
+ * @struct ServerProfileExtension
+ * @brief Rarely populated transport/metadata fields, allocated only when set.
+ */
+export struct ServerProfileExtension : public QSharedData {
+    QString publicKey;        //!< REALITY public key.
+    QString shortId;          //!< REALITY short-id.
+    QString spiderX;          //!< REALITY spiderX value.
+    QString serviceName;      //!< gRPC service name.
+    QJsonObject xhttpExtra;   //!< XHTTP advanced transport settings.
+    QJsonObject extra;        //!< Extensible free-form metadata.
+    TransportTuning transportTuning; //!< Per-profile performance overrides.
+};
+
 /**
  * @struct ServerProfile
  * @brief Canonical connection profile used by GenyConnect.
  *
  * @details
  * Contains endpoint, protocol, transport and security data parsed from
- * supported share links or loaded from persistent storage.
+ * supported share links or loaded from persistent storage. Enum-like fields
+ * are interned and rarely used fields live in a shared extension block,
+ * which keeps large subscription lists compact in memory.
  */
 export struct ServerProfile {
     QString id;               //!< Stable profile identifier.
     QString name;             //!< Human-readable profile name.
-    QString protocol;         //!< Outbound protocol (for example, vless/vmess).
+    InternedString protocol;  //!< Outbound protocol (for example, vless/vmess).
     QString address;          //!< Remote host or IP address.
     quint16 port = 0;         //!< Remote port.
 
     QString userId;           //!< User UUID or account token.
-    QString encryption;       //!< Encryption mode or cipher.
-    QString flow;             //!< XTLS/flow setting when applicable.
-    QString network;          //!< Transport network (tcp/ws/grpc/...).
-    QString security;         //!< Stream security layer (tls/reality/...).
+    InternedString encryption; //!< Encryption mode or cipher.
+    InternedString flow;      //!< XTLS/flow setting when applicable.
+    InternedString network;   //!< Transport network (tcp/ws/grpc/...).
+    InternedString security;  //!< Stream security layer (tls/reality/...).
 
     QString sni;              //!< TLS/REALITY server name.
-    QString alpn;             //!< ALPN list in plain string form.
-    QString fingerprint;      //!< Client fingerprint hint.
-    QString publicKey;        //!< REALITY public key.
-    QString shortId;          //!< REALITY short-id.
-    QString spiderX;          //!< REALITY spiderX value.
+    QString alpn;      //!< ALPN list in plain string form.
+    InternedString fingerprint; //!< Client fingerprint hint.
 
     QString path;             //!< HTTP/WS/GRPC path.
     QString hostHeader;       //!< Host override header.
-    QString serviceName;      //!< gRPC service name.
-    QString headerType;       //!< Header type override.
-    QString xhttpMode;        //!< XHTTP upload/download mode hint.
-    QJsonObject xhttpExtra;   //!< XHTTP advanced transport settings.
+    InternedString headerType; //!< Header type override.
+    QString xhttpMode; //!< XHTTP upload/download mode hint.
 
     bool allowInsecure = false; //!< Allow insecure certificate mode.
+    bool pingInProgress = false; //!< True while profile endpoint ping is in progress.
+    int lastPingMs = -1;      //!< Latest measured endpoint TCP latency in milliseconds.
 
     QString originalLink;     //!< Original imported share link.
-    QString groupName;        //!< Logical group/category name (for filtering).
-    QString sourceName;       //!< Human-readable source/subscription name.
-    QString sourceId;         //!< Stable source identifier.
-    QJsonObject extra;        //!< Extensible free-form metadata.
-    int lastPingMs = -1;      //!< Latest measured endpoint TCP latency in milliseconds.
-    bool pingInProgress = false; //!< True while profile endpoint ping is in progress.
+    QString groupName; //!< Logical group/category name (for filtering).
+    QString sourceName; //!< Human-readable source/subscription name.
+    QString sourceId;  //!< Stable source identifier.
+
+    const QString& publicKey() const;            //!< REALITY public key.
+    const QString& shortId() const;              //!< REALITY short-id.
+    const QString& spiderX() const;              //!< REALITY spiderX value.
+    const QString& serviceName() const;          //!< gRPC service name.
+    const QJsonObject& xhttpExtra() const;       //!< XHTTP advanced transport settings.
+    const QJsonObject& extra() const;            //!< Extensible free-form metadata.
+    const TransportTuning& transportTuning() const; //!< Per-profile performance overrides.
+    void setPublicKey(const QString& value);
+    void setShortId(const QString& value);
+    void setSpiderX(const QString& value);
+    void setServiceName(const QString& value);
+    void setXhttpExtra(const QJsonObject& value);
+    void setExtra(const QJsonObject& value);
+    void setTransportTuning(const TransportTuning& value);
 
     /**
      * @brief Validate essential endpoint/profile fields.
@@ -91,4 +244,9 @@ export struct ServerProfile {
      * @return Parsed profile or empty optional on invalid input.
      */
     static std::optional<ServerProfile> fromJson(const QJsonObject& json);
+
+private:
+    ServerProfileExtension& ensureExtension();
+
+    QSharedDataPointer<ServerProfileExtension> m_extension; //!< Null until a rare field is set.
 };
@@ -38,13 +38,13 @@ QVariant ServerProfileModel::data(const QModelIndex& index, int role) const
     case NameRole:
         return profile.name;
     case ProtocolRole:
-        return profile.protocol;
+        return profile.protocol.toString();
     case AddressRole:
         return profile.address;
     case PortRole:
         return profile.port;
     case SecurityRole:
-        return profile.security;
+        return profile.security.toString();
     case DisplayLabelRole:
         return profile.displayLabel();
     case GroupRole:
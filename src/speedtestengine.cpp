@@ -0,0 +1,438 @@
+module;
+#include <QElapsedTimer>
+#include <QHttp1Configuration>
+#include <QRandomGenerator>
+#include <QSslError>
+#include <QtGlobal>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+module genyconnect.backend.speedtestengine;
+
+namespace {
+// Sampling windows averaged before deciding on the next step, so the slow
+// start of freshly opened streams does not read as a plateau.
+constexpr int kSettleWindows = 4;
+// A step must raise the aggregate rate by this factor to keep growing.
+constexpr double kGrowthThreshold = 1.10;
+constexpr qint64 kPayloadBlockBytes = 64 * 1024;
+constexpr qint64 kMaxLatencySampleMs = 60000;
+
+quint64 splitMix64(quint64 value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Built once and shared by every payload; a 64 KiB period is already past
+// the window of deflate, and the per-block key removes the repetition.
+const std::array<char, kPayloadBlockBytes>& payloadBlock()
+{
+    static const std::array<char, kPayloadBlockBytes> block = [] {
+        std::array<char, kPayloadBlockBytes> bytes {};
+        quint64 state = 0x6A09E667F3BCC909ULL;
+        for (qint64 offset = 0; offset < kPayloadBlockBytes; offset += 8) {
+            state = splitMix64(state);
+            std::memcpy(bytes.data() + offset, &state, sizeof(state));
+        }
+        return bytes;
+    }();
+    return block;
+}
+}
+
+SpeedTestPayload::SpeedTestPayload(qint64 size, quint64 seed, QObject *parent)
+    : QIODevice(parent)
+    , m_size(qMax<qint64>(0, size))
+    , m_seed(seed != 0 ? seed : QRandomGenerator::global()->generate64())
+{
+    open(QIODevice::ReadOnly);
+}
+
+qint64 SpeedTestPayload::size() const
+{
+    return m_size;
+}
+
+qint64 SpeedTestPayload::readData(char *data, qint64 maxSize)
+{
+    const std::array<char, kPayloadBlockBytes>& block = payloadBlock();
+    const qint64 start = pos();
+    const qint64 count = qBound<qint64>(0, m_size - start, maxSize);
+    qint64 written = 0;
+    while (written < count) {
+        const qint64 position = start + written;
+        const qint64 offset = position % kPayloadBlockBytes;
+        const qint64 chunk = qMin(count - written, kPayloadBlockBytes - offset);
+        const quint64 key = splitMix64(m_seed ^ static_cast<quint64>(position / kPayloadBlockBytes));
+        for (qint64 i = 0; i < chunk; ++i) {
+            const int shift = static_cast<int>((offset + i) & 7) * 8;
+            data[written + i] = static_cast<char>(block[offset + i] ^ static_cast<char>(key >> shift));
+        }
+        written += chunk;
+    }
+    return count;
+}
+
+qint64 SpeedTestPayload::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+SpeedTestEngine::SpeedTestEngine(QNetworkAccessManager *network, QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+{
+    m_deadline.setSingleShot(true);
+    connect(&m_deadline, &QTimer::timeout, this, [this]() {
+        finish(QNetworkReply::NoError, QString());
+    });
+}
+
+SpeedTestEngine::~SpeedTestEngine()
+{
+    abortStreams();
+}
+
+void SpeedTestEngine::start(
+    const QNetworkRequest& request,
+    bool upload,
+    qint64 uploadBytes,
+    qint64 targetBytes,
+    int durationMs,
+    int initialStreams,
+    int maxStreams)
+{
+    stop();
+
+    m_maxStreams = qBound(1, maxStreams, kMaxStreams);
+    m_request = request;
+    // Independent TCP connections are the point; HTTP/2 would multiplex every
+    // stream onto one connection, and HTTP/1.1 caps connections per host at 6.
+    m_request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+    QHttp1Configuration http1;
+    http1.setNumberOfConnectionsPerHost(static_cast<qsizetype>(m_maxStreams));
+    m_request.setHttp1Configuration(http1);
+
+    m_upload = upload;
+    m_uploadBytes = qMax<qint64>(0, uploadBytes);
+    m_targetBytes = qMax<qint64>(0, targetBytes);
+    m_streams.clear();
+    m_totalBytes = 0;
+    m_anyCompleted = false;
+    m_lastError = QNetworkReply::NoError;
+    m_lastErrorText.clear();
+    m_windowSumMbps = 0.0;
+    m_windowCount = 0;
+    m_baselineMbps = 0.0;
+    m_plateaued = false;
+    m_running = true;
+    if (durationMs > 0) {
+        m_deadline.start(durationMs);
+    }
+
+    const int streams = qBound(1, initialStreams, m_maxStreams);
+    for (int i = 0; i < streams && m_running; ++i) {
+        openStream();
+    }
+}
+
+void SpeedTestEngine::stop()
+{
+    m_running = false;
+    m_deadline.stop();
+    abortStreams();
+}
+
+bool SpeedTestEngine::isRunning() const
+{
+    return m_running;
+}
+
+qint64 SpeedTestEngine::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+int SpeedTestEngine::streamCount() const
+{
+    return static_cast<int>(m_streams.size());
+}
+
+int SpeedTestEngine::usedStreamCount() const
+{
+    return static_cast<int>(std::count_if(m_streams.cbegin(), m_streams.cend(), [](const Stream& stream) {
+        return stream.stats.bytes > 0;
+    }));
+}
+
+bool SpeedTestEngine::plateaued() const
+{
+    return m_plateaued;
+}
+
+QList<SpeedTestStream> SpeedTestEngine::streams() const
+{
+    QList<SpeedTestStream> out;
+    out.reserve(m_streams.size());
+    for (const Stream& stream : m_streams) {
+        SpeedTestStream stats = stream.stats;
+        if (stats.active && stream.requestTimer.isValid()) {
+            stats.activeMs += stream.requestTimer.elapsed();
+        }
+        out.append(stats);
+    }
+    return out;
+}
+
+void SpeedTestEngine::adapt(double windowMbps)
+{
+    if (!m_running || m_plateaued || m_streams.size() >= m_maxStreams) {
+        return;
+    }
+    m_windowSumMbps += qMax(0.0, windowMbps);
+    if (++m_windowCount < kSettleWindows) {
+        return;
+    }
+
+    const double averageMbps = m_windowSumMbps / static_cast<double>(m_windowCount);
+    m_windowSumMbps = 0.0;
+    m_windowCount = 0;
+    if (m_baselineMbps > 0.0 && averageMbps < m_baselineMbps * kGrowthThreshold) {
+        m_plateaued = true;
+        return;
+    }
+
+    m_baselineMbps = averageMbps;
+    const int target = qMin(m_maxStreams, static_cast<int>(m_streams.size()) * 2);
+    while (m_running && m_streams.size() < target) {
+        openStream();
+    }
+}
+
+void SpeedTestEngine::openStream()
+{
+    Stream stream;
+    stream.stats.id = static_cast<int>(m_streams.size()) + 1;
+    m_streams.append(stream);
+    issueRequest(static_cast<int>(m_streams.size()) - 1);
+    emit streamsChanged();
+}
+
+void SpeedTestEngine::issueRequest(int index)
+{
+    if (m_network == nullptr) {
+        finish(QNetworkReply::UnknownNetworkError, QStringLiteral("No network manager."));
+        return;
+    }
+
+    Stream& stream = m_streams[index];
+    QNetworkReply *reply = nullptr;
+    if (m_upload) {
+        auto *payload = new SpeedTestPayload(m_uploadBytes);
+        reply = m_network->post(m_request, payload);
+        payload->setParent(reply);
+    } else {
+        reply = m_network->get(m_request);
+    }
+    stream.reply = reply;
+    stream.requestBytes = 0;
+    stream.stats.active = true;
+    ++stream.stats.requests;
+    stream.requestTimer.start();
+
+    if (m_upload) {
+        connect(reply, &QNetworkReply::uploadProgress, this, [this, index, reply](qint64 sent, qint64) {
+            onReplyProgress(index, reply, sent);
+        });
+    } else {
+        connect(reply, &QNetworkReply::downloadProgress, this, [this, index, reply](qint64 received, qint64) {
+            onReplyProgress(index, reply, received);
+        });
+    }
+    connect(reply, &QNetworkReply::readyRead, this, [reply]() {
+        reply->readAll();
+    });
+    connect(reply, &QNetworkReply::sslErrors, this, [reply](const QList<QSslError>& errors) {
+        Q_UNUSED(errors)
+        reply->abort();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, index, reply]() {
+        onReplyFinished(index, reply);
+    });
+}
+
+void SpeedTestEngine::onReplyProgress(int index, QNetworkReply *reply, qint64 bytes)
+{
+    if (!m_running || index >= m_streams.size()) {
+        return;
+    }
+    Stream& stream = m_streams[index];
+    if (stream.reply != reply || bytes <= stream.requestBytes) {
+        return;
+    }
+
+    const qint64 delta = bytes - stream.requestBytes;
+    stream.requestBytes = bytes;
+    stream.stats.bytes += delta;
+    m_totalBytes += delta;
+    emit progressChanged();
+
+    if (m_targetBytes > 0 && m_totalBytes >= m_targetBytes) {
+        finish(QNetworkReply::NoError, QString());
+    }
+}
+
+void SpeedTestEngine::onReplyFinished(int index, QNetworkReply *reply)
+{
+    reply->deleteLater();
+    if (index >= m_streams.size() || m_streams.at(index).reply != reply) {
+        return;
+    }
+
+    Stream& stream = m_streams[index];
+    stream.reply = nullptr;
+    stream.stats.active = false;
+    stream.stats.activeMs += stream.requestTimer.elapsed();
+    if (!m_running) {
+        return;
+    }
+
+    const QNetworkReply::NetworkError error = reply->error();
+    if (error == QNetworkReply::NoError) {
+        m_anyCompleted = true;
+        if (m_targetBytes > 0 || m_deadline.isActive()) {
+            // Keep the stream busy until the target is reached or time is up.
+            issueRequest(index);
+            return;
+        }
+    } else {
+        stream.stats.error = reply->errorString();
+        m_lastError = error;
+        m_lastErrorText = stream.stats.error;
+        emit streamsChanged();
+    }
+
+    if (activeStreamCount() == 0) {
+        finish(m_anyCompleted ? QNetworkReply::NoError : m_lastError,
+               m_anyCompleted ? QString() : m_lastErrorText);
+    }
+}
+
+void SpeedTestEngine::abortStreams()
+{
+    for (Stream& stream : m_streams) {
+        if (!stream.reply) {
+            continue;
+        }
+        QNetworkReply *reply = stream.reply;
+        stream.reply = nullptr;
+        stream.stats.active = false;
+        stream.stats.activeMs += stream.requestTimer.elapsed();
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void SpeedTestEngine::finish(QNetworkReply::NetworkError error, const QString& errorText)
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_deadline.stop();
+    abortStreams();
+    emit finished(error, errorText);
+}
+
+int SpeedTestEngine::activeStreamCount() const
+{
+    int count = 0;
+    for (const Stream& stream : m_streams) {
+        if (stream.stats.active) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+SpeedTestLatencyProbe::SpeedTestLatencyProbe(QNetworkAccessManager *network, QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+{
+}
+
+SpeedTestLatencyProbe::~SpeedTestLatencyProbe()
+{
+    abort();
+}
+
+bool SpeedTestLatencyProbe::probe(const QUrl& url, int timeoutMs, int maxInFlight)
+{
+    if (m_network == nullptr || !url.isValid() || m_replies.size() >= qMax(1, maxInFlight)) {
+        return false;
+    }
+
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setRawHeader("Cache-Control", "no-cache");
+    request.setRawHeader("User-Agent", "GenyConnect-SpeedTest/1.0");
+    QElapsedTimer timer;
+    timer.start();
+    QNetworkReply *reply = m_network->head(request);
+    m_replies.append(reply);
+
+    connect(reply, &QNetworkReply::sslErrors, this, [reply](const QList<QSslError>& errors) {
+        Q_UNUSED(errors)
+        reply->abort();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, timer]() {
+        // Any HTTP status means the request made the round trip.
+        const bool responded = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid();
+        finishProbe(reply, responded ? static_cast<int>(qBound<qint64>(1, timer.elapsed(), kMaxLatencySampleMs)) : -1);
+    });
+    auto *deadline = new QTimer(reply);
+    deadline->setSingleShot(true);
+    connect(deadline, &QTimer::timeout, this, [this, reply, timeoutMs]() {
+        finishProbe(reply, timeoutMs);
+    });
+    deadline->start(timeoutMs);
+    return true;
+}
+
+void SpeedTestLatencyProbe::abort()
+{
+    const QList<QNetworkReply *> replies = m_replies;
+    m_replies.clear();
+    for (QNetworkReply *reply : replies) {
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+int SpeedTestLatencyProbe::inFlight() const
+{
+    return static_cast<int>(m_replies.size());
+}
+
+void SpeedTestLatencyProbe::finishProbe(QNetworkReply *reply, int latencyMs)
+{
+    if (!m_replies.removeOne(reply)) {
+        return;
+    }
+    QObject::disconnect(reply, nullptr, this, nullptr);
+    reply->abort();
+    reply->deleteLater();
+    if (latencyMs > 0) {
+        emit sampled(latencyMs);
+    } else {
+        emit failed();
+    }
+}
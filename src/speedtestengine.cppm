@@ -0,0 +1,287 @@
+/*!
+ * @file        speedtestengine.cppm
+ * @brief       Multi-stream transfer engine for the speed test.
+ *
+ * @details
+ * A single TCP stream through a tunnel rarely fills a path with a large
+ * bandwidth-delay product, so one request per phase undercounts capacity.
+ * The engine runs the transfer of one phase over several concurrent HTTP/1.1
+ * connections (HTTP/2 would multiplex them onto one TCP stream), keeps every
+ * stream busy by re-issuing its request when it completes, and stops all
+ * streams when the phase ends.
+ *
+ * The number of streams is adaptive: the caller reports the aggregate rate
+ * of each sampling window through adapt(); the engine doubles the streams
+ * (1, 2, 4, 8, 16) while each step still raises throughput noticeably and
+ * stops growing once it plateaus.
+ *
+ * Upload bodies come from SpeedTestPayload, a read-only QIODevice that
+ * produces incompressible bytes on demand from one shared 64 KiB block, so
+ * a stream never materializes its body in memory. A phase can end on an
+ * aggregate byte target, on a duration, or on whichever comes first.
+ *
+ * SpeedTestLatencyProbe samples latency under that load: timed HEAD requests
+ * on the same network manager cross the same proxy or TUN path as the
+ * transfer, so the increase over idle latency is the tunnel's bufferbloat.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.speedtestengine;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct SpeedTestStream
+ * @brief Per-stream transfer figures.
+ */
+GENYCONNECT_MODULE_EXPORT struct SpeedTestStream {
+    int id = 0;                  //!< 1-based stream number in opening order.
+    qint64 bytes = 0;            //!< Bytes transferred across all requests of the stream.
+    qint64 activeMs = 0;         //!< Time the stream had a request in flight.
+    int requests = 0;            //!< Requests issued on the stream.
+    bool active = false;         //!< A request is in flight.
+    QString error;               //!< Last request error, empty when none failed.
+};
+
+/**
+ * @class SpeedTestPayload
+ * @brief Random-access upload body of arbitrary size generated on read.
+ *
+ * Bytes are a shared pseudo-random block XOR-ed with a per-block key derived
+ * from the device seed, so the stream never repeats and does not compress.
+ */
+GENYCONNECT_MODULE_EXPORT class SpeedTestPayload : public QIODevice
+{
+public:
+    /**
+     * @brief Construct an open, read-only payload.
+     * @param size Body size in bytes.
+     * @param seed Per-device seed; 0 picks a random one.
+     * @param parent Optional QObject parent.
+     */
+    explicit SpeedTestPayload(qint64 size, quint64 seed = 0, QObject *parent = nullptr);
+
+    qint64 size() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    qint64 m_size = 0;                           //!< Body size.
+    quint64 m_seed = 0;                          //!< Key seed.
+};
+
+/**
+ * @class SpeedTestEngine
+ * @brief Runs one speed-test transfer phase over N adaptive concurrent streams.
+ */
+GENYCONNECT_MODULE_EXPORT class SpeedTestEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kMaxStreams = 16;       //!< Upper bound for adaptive growth.
+
+    /**
+     * @brief Construct engine.
+     * @param network Network manager used for requests (proxy already set).
+     * @param parent Optional QObject parent.
+     */
+    explicit SpeedTestEngine(QNetworkAccessManager *network, QObject *parent = nullptr);
+    ~SpeedTestEngine() override;
+
+    /**
+     * @brief Start a transfer phase; a running phase is stopped first.
+     * @param request Request issued on every stream (HTTP/2 is disabled here).
+     * @param upload POST a generated body instead of GET.
+     * @param uploadBytes Body size of each upload request.
+     * @param targetBytes Aggregate bytes that complete the phase; 0 for no byte target.
+     * @param durationMs Phase duration after which the phase completes; 0 for no deadline.
+     * @param initialStreams Streams opened immediately.
+     * @param maxStreams Upper bound for adapt().
+     *
+     * With neither a byte target nor a duration, each stream runs one request.
+     */
+    void start(
+        const QNetworkRequest& request,
+        bool upload,
+        qint64 uploadBytes,
+        qint64 targetBytes,
+        int durationMs = 0,
+        int initialStreams = 1,
+        int maxStreams = kMaxStreams);
+
+    /**
+     * @brief Abort all streams without emitting finished().
+     */
+    void stop();
+
+    /**
+     * @brief Whether a phase is running.
+     * @return True between start() and finished()/stop().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Bytes transferred by all streams in this phase.
+     * @return Aggregate byte count.
+     */
+    qint64 totalBytes() const;
+
+    /**
+     * @brief Streams opened in this phase.
+     * @return Stream count.
+     */
+    int streamCount() const;
+
+    /**
+     * @brief Streams that moved at least one byte in this phase.
+     * @return Stream count; streams opened too late to transfer are left out.
+     */
+    int usedStreamCount() const;
+
+    /**
+     * @brief Whether adaptive growth stopped because throughput plateaued.
+     * @return True after a step that did not raise throughput enough.
+     */
+    bool plateaued() const;
+
+    /**
+     * @brief Per-stream figures with in-flight time counted up to now.
+     * @return Streams in opening order.
+     */
+    QList<SpeedTestStream> streams() const;
+
+    /**
+     * @brief Feed the aggregate rate of one sampling window (after warm-up).
+     * @param windowMbps Aggregate throughput of the window.
+     */
+    void adapt(double windowMbps);
+
+signals:
+    //! Emitted whenever transferred bytes change.
+    void progressChanged();
+    //! Emitted when streams are opened or fail.
+    void streamsChanged();
+    /**
+     * @brief Emitted once per phase when the target is reached or every stream ended.
+     * @param error NoError when the target was reached or a request completed; the last error otherwise.
+     * @param errorText Description of @p error.
+     */
+    void finished(QNetworkReply::NetworkError error, const QString& errorText);
+
+private:
+    struct Stream {
+        SpeedTestStream stats;
+        QPointer<QNetworkReply> reply;
+        qint64 requestBytes = 0;
+        QElapsedTimer requestTimer;
+    };
+
+    void openStream();
+    void issueRequest(int index);
+    void onReplyProgress(int index, QNetworkReply *reply, qint64 bytes);
+    void onReplyFinished(int index, QNetworkReply *reply);
+    void abortStreams();
+    void finish(QNetworkReply::NetworkError error, const QString& errorText);
+    int activeStreamCount() const;
+
+    QNetworkAccessManager *m_network = nullptr;      //!< Shared network manager.
+    QNetworkRequest m_request;                       //!< Request issued on every stream.
+    bool m_upload = false;                           //!< Phase direction.
+    qint64 m_uploadBytes = 0;                        //!< Body size of each upload request.
+    qint64 m_targetBytes = 0;                        //!< Aggregate bytes completing the phase.
+    QTimer m_deadline;                               //!< Ends a time-based phase.
+    int m_maxStreams = kMaxStreams;                  //!< Adaptive growth bound.
+    QList<Stream> m_streams;                         //!< Streams in opening order.
+    qint64 m_totalBytes = 0;                         //!< Aggregate bytes.
+    bool m_running = false;                          //!< Phase in progress.
+    bool m_anyCompleted = false;                     //!< At least one request completed cleanly.
+    QNetworkReply::NetworkError m_lastError = QNetworkReply::NoError; //!< Last request error.
+    QString m_lastErrorText;                         //!< Description of m_lastError.
+    double m_windowSumMbps = 0.0;                    //!< Window rates since the last step.
+    int m_windowCount = 0;                           //!< Windows since the last step.
+    double m_baselineMbps = 0.0;                     //!< Average rate before the last step.
+    bool m_plateaued = false;                        //!< Growth stopped.
+};
+
+/**
+ * @class SpeedTestLatencyProbe
+ * @brief Timed HEAD requests through the network manager of a transfer.
+ *
+ * A probe measures the time to the response headers. Probe a host other than
+ * the transfer's, so probes do not queue behind busy transfer connections;
+ * once a keep-alive connection is open, each sample is one round trip.
+ */
+GENYCONNECT_MODULE_EXPORT class SpeedTestLatencyProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct probe.
+     * @param network Network manager of the transfer (proxy already set).
+     * @param parent Optional QObject parent.
+     */
+    explicit SpeedTestLatencyProbe(QNetworkAccessManager *network, QObject *parent = nullptr);
+    ~SpeedTestLatencyProbe() override;
+
+    /**
+     * @brief Issue one probe unless the in-flight limit is reached.
+     * @param url Probe target.
+     * @param timeoutMs Probe timeout; under load a timeout is the latency itself
+     *        and is reported at this value.
+     * @param maxInFlight Probes allowed in flight at once.
+     * @return True when a probe was issued.
+     */
+    bool probe(const QUrl& url, int timeoutMs, int maxInFlight = 1);
+
+    /**
+     * @brief Abort probes in flight without reporting them.
+     */
+    void abort();
+
+    /**
+     * @brief Probes in flight.
+     * @return Probe count.
+     */
+    int inFlight() const;
+
+signals:
+    //! Emitted when a probe got a response or timed out.
+    void sampled(int latencyMs);
+    //! Emitted when a probe failed before any response.
+    void failed();
+
+private:
+    void finishProbe(QNetworkReply *reply, int latencyMs);
+
+    QNetworkAccessManager *m_network = nullptr;      //!< Shared network manager.
+    QList<QNetworkReply *> m_replies;                //!< Probes in flight.
+};
+
+#include "speedtestengine.moc"
@@ -0,0 +1,358 @@
+module;
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QModelIndex>
+#include <QtGlobal>
+
+module genyconnect.backend.speedtesthistory;
+
+namespace {
+constexpr qint64 kDayMs = 24LL * 60 * 60 * 1000;
+
+struct Averages {
+    int count = 0;
+    double downloadMbps = 0.0;
+    double uploadMbps = 0.0;
+    int uploadCount = 0;
+    double pingMs = 0.0;
+    int pingCount = 0;
+    double profilePingMs = 0.0;
+    int profilePingCount = 0;
+
+    void add(const SpeedTestResult& result)
+    {
+        ++count;
+        downloadMbps += result.downloadMbps;
+        // Batch runs measure download only.
+        if (result.batchRunMs == 0) {
+            uploadMbps += result.uploadMbps;
+            ++uploadCount;
+        }
+        if (result.pingMs >= 0) {
+            pingMs += result.pingMs;
+            ++pingCount;
+        }
+        if (result.profilePingMs >= 0) {
+            profilePingMs += result.profilePingMs;
+            ++profilePingCount;
+        }
+    }
+
+    double downloadAverage() const
+    {
+        return count > 0 ? downloadMbps / count : 0.0;
+    }
+
+    QVariantMap toVariantMap() const
+    {
+        return QVariantMap {
+            {QStringLiteral("count"), count},
+            {QStringLiteral("downloadMbps"), downloadAverage()},
+            {QStringLiteral("uploadMbps"), uploadCount > 0 ? uploadMbps / uploadCount : 0.0},
+            {QStringLiteral("pingMs"), pingCount > 0 ? qRound(pingMs / pingCount) : -1},
+            {QStringLiteral("profilePingMs"), profilePingCount > 0 ? qRound(profilePingMs / profilePingCount) : -1}
+        };
+    }
+};
+}
+
+QString SpeedTestResult::summary() const
+{
+    QString line = batchRunMs > 0
+        ? QStringLiteral("Batch %1: DL %2 Mbps").arg(profileName, QString::number(downloadMbps, 'f', 2))
+        : QStringLiteral("Size %1 MB: DL %2 Mbps | UL %3 Mbps | AVG %4 Mbps")
+              .arg(sizeMb)
+              .arg(QString::number(downloadMbps, 'f', 2))
+              .arg(QString::number(uploadMbps, 'f', 2))
+              .arg(QString::number(averageMbps, 'f', 2));
+    if (pingMs >= 0) {
+        line += QStringLiteral(" | Ping %1 ms").arg(pingMs);
+    }
+    if (jitterMs >= 0) {
+        line += QStringLiteral(" | Jitter %1 ms").arg(jitterMs);
+    }
+    line += QStringLiteral(" | Loss %1%").arg(QString::number(lossPct, 'f', 1));
+    if (qualityScore >= 0) {
+        line += QStringLiteral(" | Quality %1/100").arg(qualityScore);
+    }
+    if (!bufferbloatGrade.isEmpty()) {
+        line += QStringLiteral(" | Bufferbloat %1 (+%2 ms)").arg(bufferbloatGrade).arg(bufferbloatMs);
+    }
+    if (batchRunMs > 0) {
+        if (downloadStreams > 0) {
+            line += QStringLiteral(" | Streams %1").arg(downloadStreams);
+        }
+    } else if (downloadStreams > 0) {
+        line += QStringLiteral(" | Streams %1/%2").arg(downloadStreams).arg(uploadStreams);
+    }
+    return line;
+}
+
+QJsonObject SpeedTestResult::toJson() const
+{
+    QJsonObject obj;
+    obj[QStringLiteral("timestampMs")] = timestampMs;
+    obj[QStringLiteral("profileId")] = profileId;
+    obj[QStringLiteral("profileName")] = profileName;
+    obj[QStringLiteral("transport")] = transport;
+    obj[QStringLiteral("profilePingMs")] = profilePingMs;
+    obj[QStringLiteral("sizeMb")] = sizeMb;
+    obj[QStringLiteral("downloadMbps")] = downloadMbps;
+    obj[QStringLiteral("uploadMbps")] = uploadMbps;
+    obj[QStringLiteral("averageMbps")] = averageMbps;
+    obj[QStringLiteral("pingMs")] = pingMs;
+    obj[QStringLiteral("jitterMs")] = jitterMs;
+    obj[QStringLiteral("lossPct")] = lossPct;
+    obj[QStringLiteral("qualityScore")] = qualityScore;
+    obj[QStringLiteral("bufferbloatMs")] = bufferbloatMs;
+    obj[QStringLiteral("bufferbloatGrade")] = bufferbloatGrade;
+    obj[QStringLiteral("downloadStreams")] = downloadStreams;
+    obj[QStringLiteral("uploadStreams")] = uploadStreams;
+    obj[QStringLiteral("downloadEndpoint")] = downloadEndpoint;
+    obj[QStringLiteral("uploadEndpoint")] = uploadEndpoint;
+    obj[QStringLiteral("batchRunMs")] = batchRunMs;
+    return obj;
+}
+
+SpeedTestResult SpeedTestResult::fromJson(const QJsonObject& obj)
+{
+    SpeedTestResult result;
+    result.timestampMs = obj.value(QStringLiteral("timestampMs")).toInteger();
+    result.profileId = obj.value(QStringLiteral("profileId")).toString();
+    result.profileName = obj.value(QStringLiteral("profileName")).toString();
+    result.transport = obj.value(QStringLiteral("transport")).toString();
+    result.profilePingMs = obj.value(QStringLiteral("profilePingMs")).toInt(-1);
+    result.sizeMb = obj.value(QStringLiteral("sizeMb")).toInt();
+    result.downloadMbps = qMax(0.0, obj.value(QStringLiteral("downloadMbps")).toDouble());
+    result.uploadMbps = qMax(0.0, obj.value(QStringLiteral("uploadMbps")).toDouble());
+    result.averageMbps = qMax(0.0, obj.value(QStringLiteral("averageMbps")).toDouble());
+    result.pingMs = obj.value(QStringLiteral("pingMs")).toInt(-1);
+    result.jitterMs = obj.value(QStringLiteral("jitterMs")).toInt(-1);
+    result.lossPct = qBound(0.0, obj.value(QStringLiteral("lossPct")).toDouble(), 100.0);
+    result.qualityScore = obj.value(QStringLiteral("qualityScore")).toInt(-1);
+    result.bufferbloatMs = obj.value(QStringLiteral("bufferbloatMs")).toInt(-1);
+    result.bufferbloatGrade = obj.value(QStringLiteral("bufferbloatGrade")).toString();
+    result.downloadStreams = obj.value(QStringLiteral("downloadStreams")).toInt();
+    result.uploadStreams = obj.value(QStringLiteral("uploadStreams")).toInt();
+    result.downloadEndpoint = obj.value(QStringLiteral("downloadEndpoint")).toString();
+    result.uploadEndpoint = obj.value(QStringLiteral("uploadEndpoint")).toString();
+    result.batchRunMs = qMax<qint64>(0, obj.value(QStringLiteral("batchRunMs")).toInteger());
+    return result;
+}
+
+QVariantMap SpeedTestResult::toVariantMap() const
+{
+    QVariantMap map = toJson().toVariantMap();
+    map.insert(QStringLiteral("timestamp"), QDateTime::fromMSecsSinceEpoch(timestampMs));
+    map.insert(QStringLiteral("summary"), summary());
+    return map;
+}
+
+SpeedTestHistoryModel::SpeedTestHistoryModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int SpeedTestHistoryModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return m_results.size();
+}
+
+QVariant SpeedTestHistoryModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_results.size()) {
+        return {};
+    }
+
+    const SpeedTestResult& result = m_results.at(m_results.size() - 1 - index.row());
+
+    switch (role) {
+    case TimestampRole:
+        return QDateTime::fromMSecsSinceEpoch(result.timestampMs);
+    case ProfileIdRole:
+        return result.profileId;
+    case ProfileNameRole:
+        return result.profileName;
+    case TransportRole:
+        return result.transport;
+    case DownloadMbpsRole:
+        return result.downloadMbps;
+    case UploadMbpsRole:
+        return result.uploadMbps;
+    case PingMsRole:
+        return result.pingMs;
+    case JitterMsRole:
+        return result.jitterMs;
+    case QualityScoreRole:
+        return result.qualityScore;
+    case BufferbloatGradeRole:
+        return result.bufferbloatGrade;
+    case Qt::DisplayRole:
+    case SummaryRole:
+        return result.summary();
+    case ResultRole:
+        return result.toVariantMap();
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> SpeedTestHistoryModel::roleNames() const
+{
+    return {
+        {TimestampRole, "timestamp"},
+        {ProfileIdRole, "profileId"},
+        {ProfileNameRole, "profileName"},
+        {TransportRole, "transport"},
+        {DownloadMbpsRole, "downloadMbps"},
+        {UploadMbpsRole, "uploadMbps"},
+        {PingMsRole, "pingMs"},
+        {JitterMsRole, "jitterMs"},
+        {QualityScoreRole, "qualityScore"},
+        {BufferbloatGradeRole, "bufferbloatGrade"},
+        {SummaryRole, "summary"},
+        {ResultRole, "result"},
+    };
+}
+
+void SpeedTestHistoryModel::setResults(const QList<SpeedTestResult>& results)
+{
+    beginResetModel();
+    m_results = results;
+    if (m_results.size() > kMaxResults) {
+        m_results.remove(0, m_results.size() - kMaxResults);
+    }
+    rebuildIndex();
+    endResetModel();
+}
+
+void SpeedTestHistoryModel::append(const SpeedTestResult& result)
+{
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_results.append(result);
+    m_profileIndex[result.profileId].append(m_results.size() - 1);
+    endInsertRows();
+
+    if (m_results.size() > kMaxResults) {
+        const int excess = m_results.size() - kMaxResults;
+        beginRemoveRows(QModelIndex(), m_results.size() - excess, m_results.size() - 1);
+        m_results.remove(0, excess);
+        rebuildIndex();
+        endRemoveRows();
+    }
+}
+
+const QList<SpeedTestResult>& SpeedTestHistoryModel::results() const
+{
+    return m_results;
+}
+
+QStringList SpeedTestHistoryModel::summaries(int limit) const
+{
+    QStringList out;
+    for (qsizetype i = m_results.size() - 1; i >= 0 && out.size() < limit; --i) {
+        out.append(m_results.at(i).summary());
+    }
+    return out;
+}
+
+QVariantList SpeedTestHistoryModel::profileResults(const QString& profileId, int limit) const
+{
+    QVariantList out;
+    const QList<int> positions = m_profileIndex.value(profileId);
+    for (qsizetype i = positions.size() - 1; i >= 0; --i) {
+        if (limit > 0 && out.size() >= limit) {
+            break;
+        }
+        out.append(m_results.at(positions.at(i)).toVariantMap());
+    }
+    return out;
+}
+
+QList<SpeedTestResult> SpeedTestHistoryModel::batchResults(qint64 batchRunMs) const
+{
+    QList<SpeedTestResult> out;
+    if (batchRunMs <= 0) {
+        return out;
+    }
+    for (qsizetype i = m_results.size() - 1; i >= 0; --i) {
+        const SpeedTestResult& result = m_results.at(i);
+        if (result.timestampMs < batchRunMs) {
+            break;                              // Results of a run are newer than its start.
+        }
+        if (result.batchRunMs == batchRunMs) {
+            out.prepend(result);
+        }
+    }
+    return out;
+}
+
+QVariantMap SpeedTestHistoryModel::profileTrend(const QString& profileId, int days) const
+{
+    const qint64 windowMs = qMax(1, days) * kDayMs;
+    const qint64 recentStart = QDateTime::currentMSecsSinceEpoch() - windowMs;
+    const qint64 previousStart = recentStart - windowMs;
+
+    Averages recent;
+    Averages previous;
+    const QList<int> positions = m_profileIndex.value(profileId);
+    for (qsizetype i = positions.size() - 1; i >= 0; --i) {
+        const SpeedTestResult& result = m_results.at(positions.at(i));
+        if (result.timestampMs >= recentStart) {
+            recent.add(result);
+        } else if (result.timestampMs >= previousStart) {
+            previous.add(result);
+        } else {
+            break;                              // Positions are chronological.
+        }
+    }
+
+    QVariantMap trend;
+    trend.insert(QStringLiteral("recent"), recent.toVariantMap());
+    trend.insert(QStringLiteral("previous"), previous.toVariantMap());
+    const double before = previous.downloadAverage();
+    trend.insert(QStringLiteral("downloadChangePct"),
+                 recent.count > 0 && before > 0.0 ? (recent.downloadAverage() - before) * 100.0 / before : 0.0);
+    return trend;
+}
+
+QByteArray SpeedTestHistoryModel::serialize(const QList<SpeedTestResult>& results)
+{
+    QJsonArray arr;
+    for (const SpeedTestResult& result : results) {
+        arr.append(result.toJson());
+    }
+    return QJsonDocument(arr).toJson(QJsonDocument::Compact);
+}
+
+QList<SpeedTestResult> SpeedTestHistoryModel::deserialize(const QByteArray& data)
+{
+    QList<SpeedTestResult> out;
+    const QJsonDocument doc = QJsonDocument::fromJson(data);
+    if (!doc.isArray()) {
+        return out;
+    }
+    const QJsonArray arr = doc.array();
+    out.reserve(arr.size());
+    for (const QJsonValue& value : arr) {
+        const SpeedTestResult result = SpeedTestResult::fromJson(value.toObject());
+        if (result.timestampMs > 0) {
+            out.append(result);
+        }
+    }
+    return out;
+}
+
+void SpeedTestHistoryModel::rebuildIndex()
+{
+    m_profileIndex.clear();
+    for (int i = 0; i < m_results.size(); ++i) {
+        m_profileIndex[m_results.at(i).profileId].append(i);
+    }
+}
@@ -0,0 +1,205 @@
+/*!
+ * @file        speedtesthistory.cppm
+ * @brief       Structured speed-test results and their list model.
+ *
+ * @details
+ * Every completed speed test is kept as a SpeedTestResult carrying the time,
+ * the profile and its transport, the endpoints and every metric, so results
+ * can be compared across weeks and against profile ping measurements. The
+ * history is persisted as a compact JSON array in the data directory.
+ * SpeedTestHistoryModel exposes results newest first to QML and keeps a
+ * per-profile index, so profile queries and trends do not scan the history.
+ * A batch speed test adds one result per measured profile, tagged with the
+ * start time of its run, so a batch ranking reads straight from the history.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.speedtesthistory;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct SpeedTestResult
+ * @brief One completed speed test.
+ */
+GENYCONNECT_MODULE_EXPORT struct SpeedTestResult {
+    qint64 timestampMs = 0;          //!< Completion time, ms since epoch (UTC).
+    QString profileId;               //!< Profile connected during the test.
+    QString profileName;             //!< Profile label at test time.
+    QString transport;               //!< `protocol/network/security` of the profile.
+    int profilePingMs = -1;          //!< Profile TCP ping at test time.
+    int sizeMb = 0;                  //!< Selected test size.
+    double downloadMbps = 0.0;       //!< Download throughput.
+    double uploadMbps = 0.0;         //!< Upload throughput.
+    double averageMbps = 0.0;        //!< Combined average.
+    int pingMs = -1;                 //!< Idle latency (p50).
+    int jitterMs = -1;               //!< Idle jitter (p95 - p50).
+    double lossPct = 0.0;            //!< Probe loss.
+    int qualityScore = -1;           //!< Quality score 0-100.
+    int bufferbloatMs = -1;          //!< Latency increase under load.
+    QString bufferbloatGrade;        //!< Bufferbloat grade.
+    int downloadStreams = 0;         //!< Parallel download streams.
+    int uploadStreams = 0;           //!< Parallel upload streams.
+    QString downloadEndpoint;        //!< Download endpoint host.
+    QString uploadEndpoint;          //!< Upload endpoint host.
+    qint64 batchRunMs = 0;           //!< Start time of the batch run that produced the result; 0 for a regular test.
+
+    /**
+     * @brief One-line summary as shown in the history list.
+     * @return Summary text.
+     */
+    QString summary() const;
+
+    /**
+     * @brief Serialize result to JSON.
+     * @return JSON object.
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Build result from JSON.
+     * @param obj JSON object written by toJson().
+     * @return Parsed result; `timestampMs` is 0 when invalid.
+     */
+    static SpeedTestResult fromJson(const QJsonObject& obj);
+
+    /**
+     * @brief Convert result to a QML-friendly map.
+     * @return Variant map with all fields.
+     */
+    QVariantMap toVariantMap() const;
+};
+
+/**
+ * @class SpeedTestHistoryModel
+ * @brief Persisted speed-test results, newest first, with per-profile queries.
+ */
+GENYCONNECT_MODULE_EXPORT class SpeedTestHistoryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kMaxResults = 2000;     //!< Oldest results are dropped beyond this.
+
+    /**
+     * @enum Roles
+     * @brief Custom model roles exposed to QML.
+     */
+    enum Roles {
+        TimestampRole = Qt::UserRole + 1, //!< Completion time (QDateTime).
+        ProfileIdRole,                    //!< Profile id.
+        ProfileNameRole,                  //!< Profile label.
+        TransportRole,                    //!< Transport summary.
+        DownloadMbpsRole,                 //!< Download throughput.
+        UploadMbpsRole,                   //!< Upload throughput.
+        PingMsRole,                       //!< Idle latency.
+        JitterMsRole,                     //!< Idle jitter.
+        QualityScoreRole,                 //!< Quality score.
+        BufferbloatGradeRole,             //!< Bufferbloat grade.
+        SummaryRole,                      //!< Pre-formatted summary line.
+        ResultRole                        //!< All fields as a map.
+    };
+
+    /**
+     * @brief Construct an empty history.
+     * @param parent Optional QObject parent.
+     */
+    explicit SpeedTestHistoryModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    /**
+     * @brief Replace all results.
+     * @param results Results in chronological order (oldest first).
+     */
+    void setResults(const QList<SpeedTestResult>& results);
+
+    /**
+     * @brief Add a new result as the first row.
+     * @param result Completed result.
+     */
+    void append(const SpeedTestResult& result);
+
+    /**
+     * @brief All results in chronological order (oldest first).
+     * @return Result list.
+     */
+    const QList<SpeedTestResult>& results() const;
+
+    /**
+     * @brief Summary lines of the newest results.
+     * @param limit Maximum number of lines.
+     * @return Lines, newest first.
+     */
+    QStringList summaries(int limit) const;
+
+    /**
+     * @brief Results of one profile, newest first.
+     * @param profileId Profile id.
+     * @param limit Maximum number of results; non-positive for all.
+     * @return Result maps.
+     */
+    Q_INVOKABLE QVariantList profileResults(const QString& profileId, int limit = 50) const;
+
+    /**
+     * @brief Results of one batch run.
+     * @param batchRunMs Start time of the run, as stored in SpeedTestResult::batchRunMs.
+     * @return Results in chronological order.
+     */
+    QList<SpeedTestResult> batchResults(qint64 batchRunMs) const;
+
+    /**
+     * @brief Compare a profile's recent results with the window before it.
+     * @param profileId Profile id.
+     * @param days Window length in days.
+     * @return Map with `recent` and `previous` averages (`count`, `downloadMbps`,
+     *         `uploadMbps`, `pingMs`, `profilePingMs`) and `downloadChangePct`.
+     */
+    Q_INVOKABLE QVariantMap profileTrend(const QString& profileId, int days = 7) const;
+
+    /**
+     * @brief Serialize results to compact JSON.
+     * @param results Results in chronological order.
+     * @return JSON array bytes.
+     */
+    static QByteArray serialize(const QList<SpeedTestResult>& results);
+
+    /**
+     * @brief Parse results written by serialize().
+     * @param data JSON array bytes.
+     * @return Results in chronological order; invalid entries are skipped.
+     */
+    static QList<SpeedTestResult> deserialize(const QByteArray& data);
+
+private:
+    void rebuildIndex();
+
+    QList<SpeedTestResult> m_results;                //!< Chronological, oldest first.
+    QHash<QString, QList<int>> m_profileIndex;       //!< Positions in m_results per profile, ascending.
+};
+
+#include "speedtesthistory.moc"
@@ -0,0 +1,168 @@
+/*!
+ * @file        speedtestsnapshot.cppm
+ * @brief       Speed test phase enum and the immutable snapshot published to QML.
+ *
+ * @details
+ * The speed test runs as a state machine over SpeedTestSnapshot::Phase.
+ * Its live figures change every sampling tick, so they are not published as
+ * individual properties: the controller copies them into one
+ * SpeedTestSnapshot, a value-type gadget, and publishes it at most once per
+ * displayed frame. A QML binding that reads several fields re-evaluates once
+ * per publication instead of once per field.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QObject>
+#include <QString>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.speedtestsnapshot;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct SpeedTestSnapshot
+ * @brief Speed test figures at one point in time.
+ */
+GENYCONNECT_MODULE_EXPORT struct SpeedTestSnapshot {
+    Q_GADGET
+    Q_PROPERTY(bool running MEMBER running CONSTANT)
+    Q_PROPERTY(Phase phase MEMBER phase CONSTANT)
+    Q_PROPERTY(QString phaseName READ phaseName CONSTANT)
+    Q_PROPERTY(QString state READ state CONSTANT)
+    Q_PROPERTY(int elapsedSec MEMBER elapsedSec CONSTANT)
+    Q_PROPERTY(int durationSec MEMBER durationSec CONSTANT)
+    Q_PROPERTY(double progress MEMBER progress CONSTANT)
+    Q_PROPERTY(double currentMbps MEMBER currentMbps CONSTANT)
+    Q_PROPERTY(double peakMbps MEMBER peakMbps CONSTANT)
+    Q_PROPERTY(double averageMbps MEMBER averageMbps CONSTANT)
+    Q_PROPERTY(double downloadMbps MEMBER downloadMbps CONSTANT)
+    Q_PROPERTY(double uploadMbps MEMBER uploadMbps CONSTANT)
+    Q_PROPERTY(int pingMs MEMBER pingMs CONSTANT)
+    Q_PROPERTY(int jitterMs MEMBER jitterMs CONSTANT)
+    Q_PROPERTY(int streamCount MEMBER streamCount CONSTANT)
+
+public:
+    /**
+     * @enum Phase
+     * @brief Step of the speed test state machine.
+     */
+    enum Phase {
+        Idle,       //!< No test has run since the last reset.
+        Preparing,  //!< Test accepted, network path being set up.
+        Latency,    //!< Idle latency and jitter probes.
+        Download,   //!< Download transfer.
+        Upload,     //!< Upload transfer.
+        Analyzing,  //!< Transfers done, metrics being finalized.
+        Completed,  //!< Finished with results.
+        Failed,     //!< Stopped on an error.
+        Cancelled   //!< Stopped by the user.
+    };
+    Q_ENUM(Phase)
+
+    bool running = false;        //!< A test is in progress.
+    Phase phase = Idle;          //!< Current phase.
+    int elapsedSec = 0;          //!< Seconds spent in the current phase.
+    int durationSec = 0;         //!< Expected length of the current phase.
+    double progress = 0.0;       //!< Progress of the current phase, 0..1.
+    double currentMbps = 0.0;    //!< Rate of the last sampling window.
+    double peakMbps = 0.0;       //!< Highest window rate of the current phase.
+    double averageMbps = 0.0;    //!< Average rate of the current phase, or the final average.
+    double downloadMbps = 0.0;   //!< Final download rate, 0 until measured.
+    double uploadMbps = 0.0;     //!< Final upload rate, 0 until measured.
+    int pingMs = -1;             //!< Median idle latency, -1 until measured.
+    int jitterMs = -1;           //!< Idle jitter, -1 until measured.
+    int streamCount = 0;         //!< Streams of the current transfer that carried data.
+
+    /**
+     * @brief Name of a phase.
+     * @param value Phase.
+     * @return Enum key, e.g. `Download`.
+     */
+    static QString nameOf(Phase value)
+    {
+        switch (value) {
+        case Idle:
+            return QStringLiteral("Idle");
+        case Preparing:
+            return QStringLiteral("Preparing");
+        case Latency:
+            return QStringLiteral("Latency");
+        case Download:
+            return QStringLiteral("Download");
+        case Upload:
+            return QStringLiteral("Upload");
+        case Analyzing:
+            return QStringLiteral("Analyzing");
+        case Completed:
+            return QStringLiteral("Completed");
+        case Failed:
+            return QStringLiteral("Failed");
+        case Cancelled:
+            return QStringLiteral("Cancelled");
+        }
+        return QStringLiteral("Idle");
+    }
+
+    /**
+     * @brief Coarse state of a phase.
+     * @param value Phase.
+     * @return `Testing` for the measuring phases, otherwise the phase name.
+     */
+    static QString stateOf(Phase value)
+    {
+        return isMeasuring(value) ? QStringLiteral("Testing") : nameOf(value);
+    }
+
+    /**
+     * @brief Whether a phase moves data or probes latency.
+     * @param value Phase.
+     * @return True for Latency, Download and Upload.
+     */
+    static bool isMeasuring(Phase value)
+    {
+        return value == Latency || value == Download || value == Upload;
+    }
+
+    /**
+     * @brief Whether a phase is a transfer.
+     * @param value Phase.
+     * @return True for Download and Upload.
+     */
+    static bool isTransfer(Phase value)
+    {
+        return value == Download || value == Upload;
+    }
+
+    /**
+     * @brief Name of the current phase.
+     * @return Enum key of `phase`.
+     */
+    QString phaseName() const
+    {
+        return nameOf(phase);
+    }
+
+    /**
+     * @brief Coarse state of the current phase.
+     * @return `Testing` while measuring, otherwise the phase name.
+     */
+    QString state() const
+    {
+        return stateOf(phase);
+    }
+
+    bool operator==(const SpeedTestSnapshot& other) const = default;
+};
+
+#include "speedtestsnapshot.moc"
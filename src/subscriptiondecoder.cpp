@@ -0,0 +1,96 @@
+module;
+#include <QCryptographicHash>
+#include <QRegularExpression>
+
+#include <utility>
+
+module genyconnect.backend.subscriptiondecoder;
+import genyconnect.backend.linkparser;
+
+namespace {
+QByteArray decodeFlexibleBase64(const QByteArray& rawInput)
+{
+    QByteArray raw = rawInput.trimmed();
+    raw.replace('-', '+');
+    raw.replace('_', '/');
+    const int padding = raw.size() % 4;
+    if (padding > 0) {
+        raw.append(QByteArray(4 - padding, '='));
+    }
+
+    QByteArray decoded = QByteArray::fromBase64(raw, QByteArray::AbortOnBase64DecodingErrors);
+    if (!decoded.isEmpty()) {
+        return decoded;
+    }
+
+    return QByteArray::fromBase64(rawInput.trimmed(), QByteArray::AbortOnBase64DecodingErrors);
+}
+
+QStringList extractShareLinks(const QString& text)
+{
+    QStringList links;
+    const QString normalized = text;
+    const QStringList lines = normalized.split(QRegularExpression(QStringLiteral("[\\r\\n]+")), Qt::SkipEmptyParts);
+    for (QString line : lines) {
+        line = line.trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        const QStringList tokens = line.split(QRegularExpression(QStringLiteral("[\\s,]+")), Qt::SkipEmptyParts);
+        for (const QString& token : tokens) {
+            const QString candidate = token.trimmed();
+            if (candidate.startsWith(QStringLiteral("vmess://"), Qt::CaseInsensitive)
+                || candidate.startsWith(QStringLiteral("vless://"), Qt::CaseInsensitive)) {
+                links.append(candidate);
+            }
+        }
+    }
+    links.removeDuplicates();
+    return links;
+}
+}
+
+SubscriptionDecoder::SubscriptionDecoder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QStringList SubscriptionDecoder::extractLinks(const QByteArray& payload)
+{
+    const QString plain = QString::fromUtf8(payload).trimmed();
+    QStringList links = extractShareLinks(plain);
+    if (!links.isEmpty()) {
+        return links;
+    }
+
+    const QByteArray decoded = decodeFlexibleBase64(payload);
+    if (decoded.isEmpty()) {
+        return {};
+    }
+    return extractShareLinks(QString::fromUtf8(decoded));
+}
+
+void SubscriptionDecoder::decode(quint64 generation,
+                                 const QString& key,
+                                 const QByteArray& payload,
+                                 const QString& previousHash)
+{
+    SubscriptionDecodeResult result;
+    result.generation = generation;
+    result.key = key;
+    result.contentHash = QString::fromLatin1(QCryptographicHash::hash(payload, QCryptographicHash::Sha256).toHex());
+    result.unchanged = !previousHash.isEmpty() && previousHash == result.contentHash;
+    if (!result.unchanged) {
+        const QStringList links = extractLinks(payload);
+        result.linkCount = static_cast<int>(links.size());
+        result.profiles.reserve(links.size());
+        for (const QString& link : links) {
+            auto parsed = LinkParser::parse(link);
+            if (parsed.has_value()) {
+                result.profiles.append(std::move(parsed.value()));
+            }
+        }
+    }
+    emit decoded(result);
+}
@@ -0,0 +1,90 @@
+/*!
+ * @file        subscriptiondecoder.cppm
+ * @brief       Off-GUI-thread decoding of subscription payloads.
+ *
+ * @details
+ * A subscription payload can carry thousands of share links, and hashing,
+ * base64 decoding and parsing them used to run on the GUI thread while the
+ * refresh was in flight. The decoder is meant to live on the backend worker
+ * thread next to the log pipeline: it receives raw payloads through queued
+ * calls and returns parsed profiles, so the controller only merges finished
+ * results into the profile model.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.subscriptiondecoder;
+import genyconnect.backend.serverprofile;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct SubscriptionDecodeResult
+ * @brief Parsed contents of one subscription payload.
+ */
+GENYCONNECT_MODULE_EXPORT struct SubscriptionDecodeResult {
+    quint64 generation = 0;            //!< Generation passed to decode().
+    QString key;                       //!< Key passed to decode().
+    QString contentHash;               //!< Hex SHA-256 of the payload.
+    bool unchanged = false;            //!< The hash equals the previous one; nothing was parsed.
+    int linkCount = 0;                 //!< Share links found in the payload.
+    QList<ServerProfile> profiles;     //!< Profiles parsed from the links, in payload order.
+};
+
+/**
+ * @class SubscriptionDecoder
+ * @brief Hashes subscription payloads and parses their share links.
+ *
+ * decode() must be invoked on the thread the decoder lives on (use queued
+ * connections or `QMetaObject::invokeMethod` from other threads).
+ */
+GENYCONNECT_MODULE_EXPORT class SubscriptionDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct decoder.
+     * @param parent Optional QObject parent (leave empty when moving to a thread).
+     */
+    explicit SubscriptionDecoder(QObject *parent = nullptr);
+
+    /**
+     * @brief Extract VMess/VLESS share links from plain or base64 text.
+     * @param payload Subscription body or pasted text.
+     * @return Unique links in input order.
+     */
+    static QStringList extractLinks(const QByteArray& payload);
+
+public slots:
+    /**
+     * @brief Hash a payload and, unless it is unchanged, parse its links.
+     * @param generation Caller's fetch generation, echoed back to drop stale results.
+     * @param key Caller's identifier, e.g. the subscription id.
+     * @param payload Response body.
+     * @param previousHash Hash of the last imported payload (may be empty).
+     */
+    void decode(quint64 generation, const QString& key, const QByteArray& payload, const QString& previousHash);
+
+signals:
+    //! Emitted once per decode() call.
+    void decoded(const SubscriptionDecodeResult& result);
+};
+
+#include "subscriptiondecoder.moc"
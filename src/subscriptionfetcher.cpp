@@ -0,0 +1,226 @@
+module;
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QtGlobal>
+
+module genyconnect.backend.subscriptionfetcher;
+
+namespace {
+// Aborts a reply whose transfer timeout did not fire, e.g. a stalled TLS handshake.
+constexpr int kWatchdogGraceMs = 2000;
+constexpr int kMaxBackoffMs = 30000;
+}
+
+SubscriptionFetcher::SubscriptionFetcher(QNetworkAccessManager *network, QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &SubscriptionFetcher::pump);
+    m_clock.start();
+}
+
+SubscriptionFetcher::~SubscriptionFetcher()
+{
+    stop();
+}
+
+void SubscriptionFetcher::setOptions(const Options& options)
+{
+    m_options = options;
+    m_options.maxConcurrent = qMax(1, options.maxConcurrent);
+    m_options.maxPerHost = qMax(1, options.maxPerHost);
+    m_options.maxAttempts = qMax(1, options.maxAttempts);
+    m_options.retryBackoffMs = qMax(0, options.retryBackoffMs);
+    m_options.timeoutMs = qMax(1000, options.timeoutMs);
+}
+
+void SubscriptionFetcher::enqueue(const QList<SubscriptionFetchRequest>& requests)
+{
+    if (requests.isEmpty()) {
+        return;
+    }
+    for (const SubscriptionFetchRequest& request : requests) {
+        Job job;
+        job.request = request;
+        job.host = request.url.host().toLower();
+        m_pending.append(job);
+    }
+    m_running = true;
+    pump();
+}
+
+void SubscriptionFetcher::stop()
+{
+    m_running = false;
+    m_retryTimer.stop();
+    m_pending.clear();
+    const QList<QNetworkReply *> replies = m_active.keys();
+    m_active.clear();
+    m_activePerHost.clear();
+    for (QNetworkReply *reply : replies) {
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+bool SubscriptionFetcher::isRunning() const
+{
+    return m_running;
+}
+
+void SubscriptionFetcher::pump()
+{
+    if (!m_running) {
+        return;
+    }
+    const qint64 nowMs = m_clock.elapsed();
+    qint64 nextReadyMs = -1;
+    for (qsizetype i = 0; i < m_pending.size() && m_active.size() < m_options.maxConcurrent;) {
+        const Job& job = m_pending.at(i);
+        if (job.notBeforeMs > nowMs) {
+            nextReadyMs = nextReadyMs < 0 ? job.notBeforeMs : qMin(nextReadyMs, job.notBeforeMs);
+            ++i;
+            continue;
+        }
+        if (m_activePerHost.value(job.host) >= m_options.maxPerHost) {
+            ++i;
+            continue;
+        }
+        startJob(m_pending.takeAt(i));
+    }
+    // A free slot also wakes the pool, so only backoffs need the timer.
+    if (nextReadyMs >= 0) {
+        m_retryTimer.start(static_cast<int>(qMax<qint64>(0, nextReadyMs - nowMs)));
+    }
+}
+
+void SubscriptionFetcher::startJob(const Job& job)
+{
+    Job started = job;
+    ++started.attempts;
+    if (started.startedMs < 0) {
+        started.startedMs = m_clock.elapsed();
+    }
+
+    QNetworkRequest request(started.request.url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setTransferTimeout(m_options.timeoutMs);
+    request.setRawHeader("User-Agent", "GenyConnect-Subscription/1.0");
+    if (!started.request.etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", started.request.etag);
+    }
+    if (!started.request.lastModified.isEmpty()) {
+        request.setRawHeader("If-Modified-Since", started.request.lastModified);
+    }
+
+    QNetworkReply *reply = m_network->get(request);
+    auto *watchdog = new QTimer(reply);
+    watchdog->setSingleShot(true);
+    watchdog->setInterval(m_options.timeoutMs + kWatchdogGraceMs);
+    connect(watchdog, &QTimer::timeout, reply, [reply]() {
+        if (reply->isFinished()) {
+            return;
+        }
+        reply->setProperty("_geny_timeout", true);
+        reply->abort();
+    });
+    watchdog->start();
+
+    m_active.insert(reply, started);
+    ++m_activePerHost[started.host];
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onReplyFinished(reply);
+    });
+}
+
+void SubscriptionFetcher::onReplyFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+    const auto it = m_active.find(reply);
+    if (it == m_active.end()) {
+        return;
+    }
+    Job job = it.value();
+    m_active.erase(it);
+    if (--m_activePerHost[job.host] <= 0) {
+        m_activePerHost.remove(job.host);
+    }
+
+    const QNetworkReply::NetworkError error = reply->error();
+    const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // Both the transfer timeout and the watchdog surface as a cancelled operation.
+    const bool timedOut = reply->property("_geny_timeout").toBool()
+                          || error == QNetworkReply::OperationCanceledError;
+
+    if (error != QNetworkReply::NoError
+        && !timedOut
+        && job.attempts < m_options.maxAttempts
+        && isRetryable(error, httpStatus)) {
+        job.notBeforeMs = m_clock.elapsed() + backoffMs(job.attempts);
+        m_pending.append(job);
+        pump();
+        return;
+    }
+
+    SubscriptionFetchResult result;
+    result.key = job.request.key;
+    result.url = job.request.url;
+    result.ok = error == QNetworkReply::NoError;
+    result.httpStatus = httpStatus;
+    result.attempts = job.attempts;
+    result.timedOut = timedOut;
+    result.elapsedMs = m_clock.elapsed() - job.startedMs;
+    if (result.ok) {
+        result.notModified = httpStatus == 304;
+        if (!result.notModified) {
+            result.payload = reply->readAll();
+        }
+        result.etag = reply->rawHeader("ETag");
+        result.lastModified = reply->rawHeader("Last-Modified");
+    } else {
+        result.error = reply->errorString().trimmed();
+    }
+
+    // Start the next fetch before the caller spends time parsing this one.
+    pump();
+    emit fetched(result);
+    if (!m_running) {
+        return;
+    }
+    if (m_pending.isEmpty() && m_active.isEmpty()) {
+        m_running = false;
+        m_retryTimer.stop();
+        emit finished();
+    }
+}
+
+qint64 SubscriptionFetcher::backoffMs(int attempts) const
+{
+    const qint64 base = qMin<qint64>(
+        kMaxBackoffMs,
+        static_cast<qint64>(m_options.retryBackoffMs) << qBound(0, attempts - 1, 10));
+    // Up to a quarter either way, so retries of one host do not line up.
+    const qint64 spread = base / 4;
+    return spread > 0 ? base - spread + QRandomGenerator::global()->bounded(2 * spread + 1) : base;
+}
+
+bool SubscriptionFetcher::isRetryable(QNetworkReply::NetworkError error, int httpStatus)
+{
+    if (httpStatus == 408 || httpStatus == 429 || (httpStatus >= 500 && httpStatus <= 599)) {
+        return true;
+    }
+    switch (error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyConnectionRefusedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
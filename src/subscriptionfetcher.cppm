@@ -0,0 +1,162 @@
+/*!
+ * @file        subscriptionfetcher.cppm
+ * @brief       Bounded-concurrency fetch pool for subscription refresh.
+ *
+ * @details
+ * Fetching subscriptions one after another makes a refresh as slow as the
+ * sum of its fetches, and a dead host costs a full timeout before the next
+ * one starts. SubscriptionFetcher runs up to a fixed number of fetches at
+ * once, never more than a few against the same host, and retries transient
+ * failures after an exponential backoff while the other fetches proceed.
+ * Results are reported as they arrive, so the caller parses and merges them
+ * in arrival order. A refresh takes about as long as its slowest fetch.
+ *
+ * Timeouts are not retried: a host that did not answer within the timeout
+ * would hold the refresh for several more timeouts.
+ *
+ * Requests may carry the validators of the previous response; a server that
+ * honours them answers `304 Not Modified` without a body, reported as
+ * `notModified`.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.subscriptionfetcher;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct SubscriptionFetchRequest
+ * @brief One subscription URL to fetch.
+ */
+GENYCONNECT_MODULE_EXPORT struct SubscriptionFetchRequest {
+    QString key;                 //!< Caller's identifier, e.g. the subscription id.
+    QUrl url;                    //!< Subscription endpoint.
+    QByteArray etag;             //!< Sent as `If-None-Match` when not empty.
+    QByteArray lastModified;     //!< Sent as `If-Modified-Since` when not empty.
+};
+
+/**
+ * @struct SubscriptionFetchResult
+ * @brief Outcome of one request after its last attempt.
+ */
+GENYCONNECT_MODULE_EXPORT struct SubscriptionFetchResult {
+    QString key;                 //!< Key of the request.
+    QUrl url;                    //!< Requested URL.
+    bool ok = false;             //!< The server answered without error.
+    bool notModified = false;    //!< The server answered 304; `payload` is empty.
+    QByteArray payload;          //!< Response body when `ok` and not `notModified`.
+    QByteArray etag;             //!< `ETag` response header.
+    QByteArray lastModified;     //!< `Last-Modified` response header.
+    int httpStatus = 0;          //!< HTTP status of the last attempt, 0 without a response.
+    int attempts = 0;            //!< Attempts made.
+    bool timedOut = false;       //!< The last attempt hit the timeout.
+    qint64 elapsedMs = 0;        //!< Time from the first attempt to the result, backoff included.
+    QString error;               //!< Network error of the last attempt when not `ok`.
+};
+
+/**
+ * @class SubscriptionFetcher
+ * @brief Fetches subscription URLs concurrently with per-host limits and retries.
+ */
+GENYCONNECT_MODULE_EXPORT class SubscriptionFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Options
+     * @brief Pool limits and retry policy.
+     */
+    struct Options {
+        int maxConcurrent = 6;            //!< Fetches in flight at once.
+        int maxPerHost = 2;               //!< Fetches in flight against one host.
+        int maxAttempts = 3;              //!< Attempts per request, the first included.
+        int retryBackoffMs = 1000;        //!< Delay before the first retry; doubles per retry.
+        int timeoutMs = 15000;            //!< Transfer timeout of one attempt.
+    };
+
+    /**
+     * @brief Construct fetcher.
+     * @param network Network manager used for requests.
+     * @param parent Optional QObject parent.
+     */
+    explicit SubscriptionFetcher(QNetworkAccessManager *network, QObject *parent = nullptr);
+    ~SubscriptionFetcher() override;
+
+    /**
+     * @brief Set pool limits and retry policy; applies to fetches started afterwards.
+     * @param options Limits and policy.
+     */
+    void setOptions(const Options& options);
+
+    /**
+     * @brief Queue requests and start as many as the limits allow.
+     * @param requests Requests, started in list order as slots free up.
+     */
+    void enqueue(const QList<SubscriptionFetchRequest>& requests);
+
+    /**
+     * @brief Abort every fetch without emitting fetched() or finished().
+     */
+    void stop();
+
+    /**
+     * @brief Whether requests are queued or in flight.
+     * @return True between enqueue() and finished()/stop().
+     */
+    bool isRunning() const;
+
+signals:
+    //! Emitted once per request, in arrival order.
+    void fetched(const SubscriptionFetchResult& result);
+    //! Emitted after the last queued request has been reported.
+    void finished();
+
+private:
+    struct Job {
+        SubscriptionFetchRequest request;
+        QString host;
+        int attempts = 0;
+        qint64 notBeforeMs = 0;
+        qint64 startedMs = -1;
+    };
+
+    void pump();
+    void startJob(const Job& job);
+    void onReplyFinished(QNetworkReply *reply);
+    qint64 backoffMs(int attempts) const;
+    static bool isRetryable(QNetworkReply::NetworkError error, int httpStatus);
+
+    QNetworkAccessManager *m_network = nullptr;      //!< Not owned.
+    Options m_options;                               //!< Pool limits and retry policy.
+    QList<Job> m_pending;                            //!< Waiting for a slot or a backoff.
+    QHash<QNetworkReply *, Job> m_active;            //!< In flight.
+    QHash<QString, int> m_activePerHost;             //!< In-flight count per host.
+    QTimer m_retryTimer;                             //!< Wakes the pool when a backoff ends.
+    QElapsedTimer m_clock;                           //!< Time base of backoffs.
+    bool m_running = false;                          //!< Requests queued or in flight.
+};
+
+#include "subscriptionfetcher.moc"
@@ -0,0 +1,622 @@
+module;
+#include <QDir>
+#include <QFile>
+#include <QHostAddress>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTimer>
+#include <QtGlobal>
+
+#include <algorithm>
+
+module genyconnect.backend.transporttuner;
+
+namespace {
+constexpr int kLaunchTimeoutMs = 6000;
+constexpr int kInboundPollMs = 100;
+constexpr int kLatencyProbeCount = 5;
+constexpr int kLatencyTimeoutMs = 4000;
+// Same pacing as the speed test's loaded-latency sampling.
+constexpr int kLoadedProbeIntervalMs = 250;
+constexpr int kLoadedProbeMaxInFlight = 2;
+constexpr int kThroughputWindowMs = 8000;
+// Fixed rather than adaptive so every candidate runs under the same load.
+constexpr int kThroughputStreams = 4;
+constexpr int kThroughputWarmupMs = 1000;
+constexpr int kThroughputMinimumMeasureMs = 500;
+constexpr int kThroughputTimeoutMs = 15000;
+// Batches trade precision for coverage so large groups finish in minutes.
+constexpr int kBatchLatencyProbeCount = 3;
+constexpr int kBatchThroughputWindowMs = 4000;
+constexpr int kProcessStopTimeoutMs = 1000;
+// A winner must beat the current settings by this factor; smaller
+// differences are within run-to-run noise and not worth a change.
+constexpr double kMinimumImprovement = 1.05;
+constexpr const char *kConfigFileName = "transport-tuner.json";
+
+int medianOf(QList<int> values)
+{
+    if (values.isEmpty()) {
+        return -1;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(values.size() / 2);
+}
+
+QNetworkRequest measurementRequest(const QUrl& url, int timeoutMs)
+{
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setRawHeader("Cache-Control", "no-cache");
+    request.setRawHeader("User-Agent", "GenyConnect-SpeedTest/1.0");
+    request.setTransferTimeout(timeoutMs);
+    return request;
+}
+
+QString onOff(bool value)
+{
+    return value ? QStringLiteral("on") : QStringLiteral("off");
+}
+}
+
+QVariantMap TransportTunerCandidate::toVariantMap() const
+{
+    return QVariantMap {
+        {QStringLiteral("label"), label},
+        {QStringLiteral("profileId"), profileId},
+        {QStringLiteral("current"), current},
+        {QStringLiteral("measured"), measured},
+        {QStringLiteral("ok"), ok},
+        {QStringLiteral("latencyMs"), latencyMs},
+        {QStringLiteral("loadedLatencyMs"), loadedLatencyMs},
+        {QStringLiteral("throughputMbps"), throughputMbps},
+        {QStringLiteral("streams"), streams},
+        {QStringLiteral("score"), score},
+        {QStringLiteral("error"), error}
+    };
+}
+
+TransportTuner::TransportTuner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_engine, &SpeedTestEngine::progressChanged, this, &TransportTuner::onThroughputProgress);
+    connect(&m_engine, &SpeedTestEngine::finished, this, &TransportTuner::onThroughputFinished);
+    connect(&m_latencyProbe, &SpeedTestLatencyProbe::sampled, this, &TransportTuner::onLatencySampled);
+    connect(&m_latencyProbe, &SpeedTestLatencyProbe::failed, this, &TransportTuner::runLatencyProbe);
+    m_loadedProbeTimer.setInterval(kLoadedProbeIntervalMs);
+    connect(&m_loadedProbeTimer, &QTimer::timeout, this, &TransportTuner::runLoadedLatencyProbe);
+
+    connect(&m_process, &XrayProcessManager::stopped, this, [this]() {
+        if (m_stage == Stage::Stopping) {
+            m_stage = Stage::Idle;
+            advance();
+        } else if (m_stage != Stage::Idle) {
+            finishCandidate(false, QStringLiteral("xray-core exited during the measurement."));
+        }
+    });
+    connect(&m_process, &XrayProcessManager::errorOccurred, this, [this](const QString& error) {
+        if (m_stage == Stage::Launching && !m_process.isRunning()) {
+            finishCandidate(false, error);
+        }
+    });
+}
+
+TransportTuner::~TransportTuner()
+{
+    abortNetwork();
+    m_process.stop(kProcessStopTimeoutMs);
+    if (!m_configPath.isEmpty()) {
+        QFile::remove(m_configPath);
+    }
+}
+
+void TransportTuner::setExecutablePath(const QString& path)
+{
+    m_process.setExecutablePath(path);
+}
+
+void TransportTuner::setWorkingDirectory(const QString& path)
+{
+    m_workingDirectory = path;
+    m_process.setWorkingDirectory(path);
+}
+
+void TransportTuner::setEndpoints(const QUrl& latencyUrl, const QUrl& throughputUrl)
+{
+    m_latencyUrl = latencyUrl;
+    m_throughputUrl = throughputUrl;
+}
+
+QList<TransportTunerCandidate> TransportTuner::candidatesFor(
+    const ServerProfile& profile,
+    const XrayConfigBuilder::BuildOptions& options)
+{
+    const TransportTuning base = profile.transportTuning();
+    const TransportTuning effective = base.overriding(options.transport);
+    const bool reality = profile.security == QStringLiteral("reality");
+    const bool currentMux = effective.mux.value_or(options.enableMux);
+    const bool currentFragment = effective.fragment.value_or(true);
+
+    QStringList congestions {QString()};
+#if defined(Q_OS_LINUX)
+    if (options.core.supportsOption(QStringLiteral("tcpCongestion"))) {
+        congestions = {QStringLiteral("cubic"), QStringLiteral("bbr")};
+    }
+#endif
+    // An unset congestion control is the kernel default, which is cubic on
+    // stock Linux kernels.
+    const QString currentCongestion = effective.tcpCongestion.isEmpty() && congestions.size() > 1
+        ? QStringLiteral("cubic")
+        : effective.tcpCongestion;
+    const QList<bool> fragments = reality ? QList<bool> {true, false} : QList<bool> {currentFragment};
+
+    QList<TransportTunerCandidate> out;
+    for (const bool mux : {false, true}) {
+        for (const QString& congestion : congestions) {
+            for (const bool fragment : fragments) {
+                TransportTunerCandidate candidate;
+                candidate.profileId = profile.id;
+                candidate.tuning = base;
+                candidate.tuning.mux = mux;
+                QStringList parts {QStringLiteral("mux %1").arg(onOff(mux))};
+                if (!congestion.isEmpty()) {
+                    candidate.tuning.tcpCongestion = congestion;
+                    parts.append(congestion);
+                }
+                if (reality) {
+                    candidate.tuning.fragment = fragment;
+                    parts.append(QStringLiteral("fragment %1").arg(onOff(fragment)));
+                }
+                candidate.label = parts.join(QStringLiteral(", "));
+                candidate.current = mux == currentMux
+                                    && congestion == currentCongestion
+                                    && (!reality || fragment == currentFragment);
+                if (candidate.current) {
+                    out.prepend(candidate);
+                } else {
+                    out.append(candidate);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+bool TransportTuner::start(
+    const ServerProfile& profile,
+    const XrayConfigBuilder::BuildOptions& options,
+    QString *errorMessage)
+{
+    if (!prepare(options, errorMessage)) {
+        return false;
+    }
+
+    m_profile = profile;
+    m_candidates = candidatesFor(profile, options);
+    m_profiles = QList<ServerProfile>(m_candidates.size(), profile);
+    m_batch = false;
+    m_latencyProbeCount = kLatencyProbeCount;
+    m_throughputWindowMs = kThroughputWindowMs;
+    QTimer::singleShot(0, this, &TransportTuner::advance);
+    return true;
+}
+
+bool TransportTuner::startBatch(
+    const QList<ServerProfile>& profiles,
+    const XrayConfigBuilder::BuildOptions& options,
+    QString *errorMessage)
+{
+    if (profiles.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("No profiles to benchmark.");
+        }
+        return false;
+    }
+    if (!prepare(options, errorMessage)) {
+        return false;
+    }
+
+    m_profile = ServerProfile();
+    m_candidates.clear();
+    m_candidates.reserve(profiles.size());
+    for (const ServerProfile& profile : profiles) {
+        TransportTunerCandidate candidate;
+        candidate.label = profile.displayLabel();
+        candidate.profileId = profile.id;
+        candidate.tuning = profile.transportTuning();
+        m_candidates.append(candidate);
+    }
+    m_profiles = profiles;
+    m_batch = true;
+    m_latencyProbeCount = kBatchLatencyProbeCount;
+    m_throughputWindowMs = kBatchThroughputWindowMs;
+    QTimer::singleShot(0, this, &TransportTuner::advance);
+    return true;
+}
+
+bool TransportTuner::prepare(const XrayConfigBuilder::BuildOptions& options, QString *errorMessage)
+{
+    QString error;
+    if (m_running) {
+        error = QStringLiteral("Transport tuning is already running.");
+    } else if (m_process.executablePath().trimmed().isEmpty()) {
+        error = QStringLiteral("xray-core executable path is not set.");
+    } else if (!m_latencyUrl.isValid() || !m_throughputUrl.isValid()) {
+        error = QStringLiteral("No speed test endpoint configured.");
+    } else if (m_workingDirectory.isEmpty() || !QDir().mkpath(m_workingDirectory)) {
+        error = QStringLiteral("Cannot create the tuning directory.");
+    }
+    if (!error.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+
+    // Candidates only differ in transport settings; routing, TUN and the
+    // stats API would only add noise and need resources the tuner must not take.
+    m_options = options;
+    m_options.enableTun = false;
+    m_options.enableStatsApi = false;
+    m_options.whitelistMode = false;
+    m_options.enableProcessRouting = false;
+    m_options.proxyDomains.clear();
+    m_options.directDomains.clear();
+    m_options.blockDomains.clear();
+    m_options.proxyProcesses.clear();
+    m_options.directProcesses.clear();
+    m_options.blockProcesses.clear();
+    m_options.logLevel = QStringLiteral("warning");
+
+    m_configPath = QDir(m_workingDirectory).filePath(QString::fromLatin1(kConfigFileName));
+    m_index = -1;
+    m_stage = Stage::Idle;
+    m_running = true;
+    m_cancelled = false;
+    return true;
+}
+
+void TransportTuner::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    m_cancelled = true;
+    if (m_stage != Stage::Idle && m_stage != Stage::Stopping) {
+        finishCandidate(false, QStringLiteral("Cancelled."));
+    }
+}
+
+bool TransportTuner::isRunning() const
+{
+    return m_running;
+}
+
+bool TransportTuner::isBatch() const
+{
+    return m_batch;
+}
+
+QString TransportTuner::profileId() const
+{
+    return m_profile.id;
+}
+
+const QList<TransportTunerCandidate>& TransportTuner::candidates() const
+{
+    return m_candidates;
+}
+
+int TransportTuner::recommendedIndex() const
+{
+    int best = -1;
+    int current = -1;
+    for (int i = 0; i < m_candidates.size(); ++i) {
+        const TransportTunerCandidate& candidate = m_candidates.at(i);
+        if (candidate.current) {
+            current = i;
+        }
+        if (candidate.ok && (best < 0 || candidate.score > m_candidates.at(best).score)) {
+            best = i;
+        }
+    }
+    if (best < 0 || best == current) {
+        return -1;
+    }
+    if (current >= 0 && m_candidates.at(current).ok
+        && m_candidates.at(best).score < m_candidates.at(current).score * kMinimumImprovement) {
+        return -1;
+    }
+    return best;
+}
+
+double TransportTuner::score(double throughputMbps, int latencyMs)
+{
+    // Throughput decides; latency breaks ties and penalizes chatty setups.
+    return throughputMbps * 100.0 / (100.0 + static_cast<double>(qMax(0, latencyMs)));
+}
+
+QList<int> TransportTuner::ranking() const
+{
+    QList<int> order;
+    order.reserve(m_candidates.size());
+    for (int i = 0; i < m_candidates.size(); ++i) {
+        order.append(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int left, int right) {
+        const TransportTunerCandidate& a = m_candidates.at(left);
+        const TransportTunerCandidate& b = m_candidates.at(right);
+        if (a.ok != b.ok) {
+            return a.ok;
+        }
+        if (a.measured != b.measured) {
+            return a.measured;
+        }
+        return a.ok && a.score > b.score;
+    });
+    return order;
+}
+
+void TransportTuner::advance()
+{
+    if (!m_running) {
+        return;
+    }
+    if (m_cancelled) {
+        finishRun(false, QStringLiteral("Cancelled."));
+        return;
+    }
+    ++m_index;
+    if (m_index >= m_candidates.size()) {
+        const bool anyOk = std::any_of(m_candidates.cbegin(), m_candidates.cend(),
+                                       [](const TransportTunerCandidate& candidate) { return candidate.ok; });
+        finishRun(anyOk, anyOk ? QString() : QStringLiteral("No candidate could be measured."));
+        return;
+    }
+    startCandidate();
+}
+
+void TransportTuner::startCandidate()
+{
+    m_stage = Stage::Launching;
+    m_stageTimer.start();
+    m_latencySamples.clear();
+    m_latencyAttempts = 0;
+    emit progressChanged(m_index, m_candidates.size());
+
+    // Reserve an ephemeral port; the short window until xray binds it is
+    // acceptable for a loopback-only listener.
+    QTcpServer reservation;
+    if (!reservation.listen(QHostAddress::LocalHost, 0)) {
+        finishCandidate(false, QStringLiteral("No free local port."));
+        return;
+    }
+    m_port = reservation.serverPort();
+    reservation.close();
+
+    XrayConfigBuilder::BuildOptions options = m_options;
+    options.socksPort = m_port;
+    options.httpPort = m_port;
+    ServerProfile profile = m_profiles.at(m_index);
+    profile.setTransportTuning(m_candidates.at(m_index).tuning);
+    const QByteArray config = XrayConfigBuilder::serialize(XrayConfigBuilder::buildConfig(profile, options));
+
+    QSaveFile file(m_configPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(config) != config.size()
+        || !file.commit()) {
+        finishCandidate(false, QStringLiteral("Failed to write candidate config: %1").arg(file.errorString()));
+        return;
+    }
+
+    QString error;
+    if (!m_process.start(m_configPath, &error)) {
+        finishCandidate(false, error);
+        return;
+    }
+    m_network.setProxy(QNetworkProxy(QNetworkProxy::Socks5Proxy, QStringLiteral("127.0.0.1"), m_port));
+    m_network.clearConnectionCache();
+    pollInbound();
+}
+
+void TransportTuner::pollInbound()
+{
+    if (m_stage != Stage::Launching) {
+        return;
+    }
+    if (m_stageTimer.elapsed() > kLaunchTimeoutMs) {
+        finishCandidate(false, QStringLiteral("xray-core did not open its inbound in time."));
+        return;
+    }
+
+    auto *socket = new QTcpSocket(this);
+    m_inboundProbe = socket;
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        socket->abort();
+        socket->deleteLater();
+        if (m_inboundProbe != socket || m_stage != Stage::Launching) {
+            return;
+        }
+        m_inboundProbe = nullptr;
+        m_stage = Stage::Latency;
+        runLatencyProbe();
+    });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket](QAbstractSocket::SocketError) {
+        socket->deleteLater();
+        if (m_inboundProbe != socket) {
+            return;
+        }
+        m_inboundProbe = nullptr;
+        QTimer::singleShot(kInboundPollMs, this, &TransportTuner::pollInbound);
+    });
+    socket->connectToHost(QHostAddress::LocalHost, m_port);
+}
+
+void TransportTuner::runLatencyProbe()
+{
+    if (m_stage != Stage::Latency) {
+        return;
+    }
+    if (m_latencyAttempts >= m_latencyProbeCount) {
+        if (m_latencySamples.isEmpty()) {
+            finishCandidate(false, QStringLiteral("Latency probes failed."));
+        } else {
+            startThroughput();
+        }
+        return;
+    }
+
+    ++m_latencyAttempts;
+    if (!m_latencyProbe.probe(m_latencyUrl, kLatencyTimeoutMs)) {
+        finishCandidate(false, QStringLiteral("Latency probes failed."));
+    }
+}
+
+void TransportTuner::onLatencySampled(int latencyMs)
+{
+    if (m_stage == Stage::Latency) {
+        m_latencySamples.append(latencyMs);
+        runLatencyProbe();
+    } else if (m_stage == Stage::Throughput) {
+        m_loadedLatencySamples.append(latencyMs);
+    }
+}
+
+void TransportTuner::runLoadedLatencyProbe()
+{
+    if (m_stage != Stage::Throughput) {
+        m_loadedProbeTimer.stop();
+        return;
+    }
+    // Only sample once the streams move data.
+    if (m_engine.totalBytes() > 0) {
+        m_latencyProbe.probe(m_latencyUrl, kLatencyTimeoutMs, kLoadedProbeMaxInFlight);
+    }
+}
+
+void TransportTuner::startThroughput()
+{
+    m_stage = Stage::Throughput;
+    m_firstByteMs = -1;
+    m_throughputStartMs = -1;
+    m_warmupBytes = 0;
+    m_loadedLatencySamples.clear();
+    m_requestTimer.start();
+    m_loadedProbeTimer.start();
+    m_engine.start(measurementRequest(m_throughputUrl, kThroughputTimeoutMs),
+                   false,
+                   0,
+                   0,
+                   m_throughputWindowMs,
+                   kThroughputStreams,
+                   kThroughputStreams);
+}
+
+void TransportTuner::onThroughputProgress()
+{
+    if (m_stage != Stage::Throughput) {
+        return;
+    }
+    const qint64 elapsedMs = m_requestTimer.elapsed();
+    if (m_firstByteMs < 0) {
+        m_firstByteMs = elapsedMs;
+        return;
+    }
+    // Skip slow start so the figure reflects the steady state.
+    if (m_throughputStartMs < 0 && elapsedMs - m_firstByteMs >= kThroughputWarmupMs) {
+        m_throughputStartMs = elapsedMs;
+        m_warmupBytes = m_engine.totalBytes();
+    }
+}
+
+void TransportTuner::onThroughputFinished(QNetworkReply::NetworkError error, const QString& errorText)
+{
+    if (m_stage != Stage::Throughput) {
+        return;
+    }
+    if (error != QNetworkReply::NoError && m_engine.totalBytes() == 0) {
+        finishCandidate(false, errorText);
+        return;
+    }
+    finishThroughput();
+}
+
+void TransportTuner::finishThroughput()
+{
+    const qint64 nowMs = m_requestTimer.elapsed();
+    const qint64 totalBytes = m_engine.totalBytes();
+    const int streams = m_engine.usedStreamCount();
+    abortNetwork();
+
+    double mbps = 0.0;
+    if (m_throughputStartMs >= 0 && nowMs - m_throughputStartMs >= kThroughputMinimumMeasureMs) {
+        mbps = (static_cast<double>(totalBytes - m_warmupBytes) * 8.0)
+               / (static_cast<double>(nowMs - m_throughputStartMs) * 1000.0);
+    } else if (m_firstByteMs >= 0 && nowMs > m_firstByteMs) {
+        // Short downloads finish before warm-up ends; use everything received.
+        mbps = (static_cast<double>(totalBytes) * 8.0) / (static_cast<double>(nowMs - m_firstByteMs) * 1000.0);
+    }
+    if (mbps <= 0.0) {
+        finishCandidate(false, QStringLiteral("No data received."));
+        return;
+    }
+
+    TransportTunerCandidate& candidate = m_candidates[m_index];
+    candidate.latencyMs = medianOf(m_latencySamples);
+    candidate.loadedLatencyMs = medianOf(m_loadedLatencySamples);
+    candidate.throughputMbps = mbps;
+    candidate.streams = streams;
+    candidate.score = score(mbps, candidate.loadedLatencyMs >= 0 ? candidate.loadedLatencyMs : candidate.latencyMs);
+    finishCandidate(true);
+}
+
+void TransportTuner::finishCandidate(bool ok, const QString& error)
+{
+    if (m_index < 0 || m_index >= m_candidates.size() || m_candidates.at(m_index).measured) {
+        return;
+    }
+    TransportTunerCandidate& candidate = m_candidates[m_index];
+    candidate.measured = true;
+    candidate.ok = ok;
+    if (!ok) {
+        candidate.error = error;
+        candidate.score = -1.0;
+    }
+
+    abortNetwork();
+    if (m_inboundProbe) {
+        m_inboundProbe->abort();
+        m_inboundProbe->deleteLater();
+        m_inboundProbe = nullptr;
+    }
+    emit progressChanged(m_index, m_candidates.size());
+
+    if (m_process.isRunning()) {
+        m_stage = Stage::Stopping;
+        m_process.stop(0);
+        return;
+    }
+    m_stage = Stage::Idle;
+    QTimer::singleShot(0, this, &TransportTuner::advance);
+}
+
+void TransportTuner::abortNetwork()
+{
+    m_loadedProbeTimer.stop();
+    m_engine.stop();
+    m_latencyProbe.abort();
+}
+
+void TransportTuner::finishRun(bool ok, const QString& error)
+{
+    m_running = false;
+    m_stage = Stage::Idle;
+    if (!m_configPath.isEmpty()) {
+        QFile::remove(m_configPath);
+    }
+    emit finished(ok, error);
+}
@@ -0,0 +1,260 @@
+/*!
+ * @file        transporttuner.cppm
+ * @brief       Benchmarks transport tuning candidates for one profile.
+ *
+ * @details
+ * For a chosen profile the tuner builds a small matrix of candidate settings
+ * (mux on/off, BBR vs cubic where the platform and core allow it, and the
+ * Reality fragment dialer on/off). Each candidate config is produced by
+ * XrayConfigBuilder, started in a temporary xray-core bound to an ephemeral
+ * local port and measured the same way the speed test does: idle latency
+ * and latency under load through SpeedTestLatencyProbe, and download
+ * throughput through SpeedTestEngine with a fixed window and stream count, so
+ * candidates and profiles are measured under identical load. Candidates run one at a time so they do not
+ * compete for bandwidth; the run is fully event driven and never blocks the
+ * caller.
+ *
+ * The same runner benchmarks a batch of profiles: each profile becomes one
+ * candidate with its own settings, measured with fewer latency probes and a
+ * shorter throughput window, and ranking() orders the results.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QElapsedTimer>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantMap>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.transporttuner;
+import genyconnect.backend.serverprofile;
+import genyconnect.backend.speedtestengine;
+import genyconnect.backend.xrayconfigbuilder;
+import genyconnect.backend.xrayprocessmanager;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct TransportTunerCandidate
+ * @brief One candidate setting and its measurement.
+ */
+GENYCONNECT_MODULE_EXPORT struct TransportTunerCandidate {
+    QString label;               //!< Human readable summary (`mux on, bbr, fragment off`).
+    QString profileId;           //!< Profile measured by this candidate.
+    TransportTuning tuning;      //!< Profile tuning used for this candidate.
+    bool current = false;        //!< Matches the settings the profile uses today.
+    bool measured = false;       //!< Measurement finished (successfully or not).
+    bool ok = false;             //!< Latency and throughput were measured.
+    int latencyMs = -1;          //!< Median idle latency through the candidate.
+    int loadedLatencyMs = -1;    //!< Median latency during the throughput window.
+    double throughputMbps = 0.0; //!< Download throughput after warm-up.
+    int streams = 0;             //!< Streams that carried data in the throughput window.
+    double score = -1.0;         //!< Ranking score, higher is better; `-1` when failed.
+    QString error;               //!< Failure description when `ok` is false.
+
+    /**
+     * @brief Convert candidate to a QML-friendly map.
+     * @return Variant map with all fields except the raw tuning.
+     */
+    QVariantMap toVariantMap() const;
+};
+
+/**
+ * @class TransportTuner
+ * @brief Runs the candidate matrix through temporary xray-core instances.
+ */
+GENYCONNECT_MODULE_EXPORT class TransportTuner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct tuner.
+     * @param parent Optional QObject parent.
+     */
+    explicit TransportTuner(QObject *parent = nullptr);
+    ~TransportTuner() override;
+
+    /**
+     * @brief Set the xray-core executable used for candidates.
+     * @param path Executable path.
+     */
+    void setExecutablePath(const QString& path);
+
+    /**
+     * @brief Set the directory for temporary candidate configs.
+     * @param path Writable directory.
+     */
+    void setWorkingDirectory(const QString& path);
+
+    /**
+     * @brief Set measurement endpoints.
+     * @param latencyUrl Tiny response used for request latency.
+     * @param throughputUrl Large download used for throughput.
+     */
+    void setEndpoints(const QUrl& latencyUrl, const QUrl& throughputUrl);
+
+    /**
+     * @brief Build the candidate matrix for a profile.
+     * @param profile Profile to tune.
+     * @param options Build options of a normal connect (global defaults, core features).
+     * @return Candidates; the one matching today's settings is first and marked current.
+     */
+    static QList<TransportTunerCandidate> candidatesFor(
+        const ServerProfile& profile,
+        const XrayConfigBuilder::BuildOptions& options);
+
+    /**
+     * @brief Start benchmarking a profile.
+     * @param profile Profile to tune.
+     * @param options Build options of a normal connect; ports, TUN and routing are replaced.
+     * @param errorMessage Optional output message on failure.
+     * @return True when the run started.
+     */
+    bool start(
+        const ServerProfile& profile,
+        const XrayConfigBuilder::BuildOptions& options,
+        QString *errorMessage = nullptr);
+
+    /**
+     * @brief Start benchmarking several profiles with their own settings.
+     * @param profiles Profiles to measure, one candidate each.
+     * @param options Build options of a normal connect; ports, TUN and routing are replaced.
+     * @param errorMessage Optional output message on failure.
+     * @return True when the run started.
+     */
+    bool startBatch(
+        const QList<ServerProfile>& profiles,
+        const XrayConfigBuilder::BuildOptions& options,
+        QString *errorMessage = nullptr);
+
+    /**
+     * @brief Abort the run; finished() reports a cancellation.
+     */
+    void cancel();
+
+    /**
+     * @brief Whether a run is in progress.
+     * @return True between start() and finished().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Whether the current or last run is a profile batch.
+     * @return True after startBatch().
+     */
+    bool isBatch() const;
+
+    /**
+     * @brief Profile id of the current or last single-profile run.
+     * @return Profile id, empty for a batch.
+     */
+    QString profileId() const;
+
+    /**
+     * @brief Candidates of the current or last run, in run order.
+     * @return Candidates with measurements filled in as they finish.
+     */
+    const QList<TransportTunerCandidate>& candidates() const;
+
+    /**
+     * @brief Candidate that should replace the current settings.
+     * @return Index into candidates(), or `-1` when the current settings are best
+     *         or the margin is within measurement noise.
+     */
+    int recommendedIndex() const;
+
+    /**
+     * @brief Ranking score of a measurement.
+     * @param throughputMbps Download throughput.
+     * @param latencyMs Median latency, under load when measured; negative when unknown.
+     * @return Score, higher is better.
+     */
+    static double score(double throughputMbps, int latencyMs);
+
+    /**
+     * @brief Candidates ordered best first.
+     * @return Indices into candidates(); measured candidates by score, then failed and pending ones.
+     */
+    QList<int> ranking() const;
+
+signals:
+    //! Emitted when a candidate starts or finishes measuring.
+    void progressChanged(int index, int count);
+    //! Emitted once per run.
+    void finished(bool ok, const QString& error);
+
+private:
+    enum class Stage {
+        Idle,
+        Launching,
+        Latency,
+        Throughput,
+        Stopping
+    };
+
+    bool prepare(const XrayConfigBuilder::BuildOptions& options, QString *errorMessage);
+    void startCandidate();
+    void pollInbound();
+    void runLatencyProbe();
+    void onLatencySampled(int latencyMs);
+    void runLoadedLatencyProbe();
+    void startThroughput();
+    void onThroughputProgress();
+    void onThroughputFinished(QNetworkReply::NetworkError error, const QString& errorText);
+    void finishThroughput();
+    void finishCandidate(bool ok, const QString& error = QString());
+    void advance();
+    void abortNetwork();
+    void finishRun(bool ok, const QString& error);
+
+    QString m_workingDirectory;                      //!< Directory for candidate configs.
+    QUrl m_latencyUrl;                               //!< Latency endpoint.
+    QUrl m_throughputUrl;                            //!< Throughput endpoint.
+    ServerProfile m_profile;                         //!< Profile of a single-profile run.
+    XrayConfigBuilder::BuildOptions m_options;       //!< Candidate build options.
+    QList<TransportTunerCandidate> m_candidates;     //!< Matrix of the current run.
+    QList<ServerProfile> m_profiles;                 //!< Profile of each candidate.
+    bool m_batch = false;                            //!< Run measures a profile batch.
+    int m_latencyProbeCount = 0;                     //!< Latency probes per candidate.
+    int m_throughputWindowMs = 0;                    //!< Throughput window per candidate.
+    int m_index = -1;                                //!< Candidate being measured.
+    Stage m_stage = Stage::Idle;                     //!< Stage of the current candidate.
+    QString m_configPath;                            //!< Temporary config of the current candidate.
+    XrayProcessManager m_process;                    //!< Temporary xray-core.
+    QNetworkAccessManager m_network;                 //!< Requests through the candidate inbound.
+    SpeedTestEngine m_engine {&m_network};           //!< Throughput streams through the candidate inbound.
+    SpeedTestLatencyProbe m_latencyProbe {&m_network}; //!< Idle and loaded latency through the candidate inbound.
+    QTimer m_loadedProbeTimer;                       //!< Paces latency probes during the throughput window.
+    QPointer<QTcpSocket> m_inboundProbe;             //!< Readiness probe of the inbound.
+    QElapsedTimer m_stageTimer;                      //!< Time since the stage started.
+    QElapsedTimer m_requestTimer;                    //!< Time since the throughput window started.
+    QList<int> m_latencySamples;                     //!< Idle latency samples of the current candidate.
+    QList<int> m_loadedLatencySamples;               //!< Latency samples under load.
+    int m_latencyAttempts = 0;                       //!< Latency probes started.
+    quint16 m_port = 0;                              //!< Ephemeral inbound port of the candidate.
+    qint64 m_firstByteMs = -1;                       //!< Window elapsed time at the first byte.
+    qint64 m_throughputStartMs = -1;                 //!< Window elapsed time at warm-up end.
+    qint64 m_warmupBytes = 0;                        //!< Bytes received before warm-up ended.
+    bool m_running = false;                          //!< Run in progress.
+    bool m_cancelled = false;                        //!< Run cancelled by the caller.
+};
+
+#include "transporttuner.moc"
@@ -1,6 +1,7 @@
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QHash>
@@ -12,8 +13,11 @@
 #include <QJsonObject>
 #include <QNetworkInterface>
 #include <QProcess>
+#include <QProcessEnvironment>
 #include <QRegularExpression>
 #include <QSet>
+#include <QSaveFile>
+#include <QSocketNotifier>
 #include <QStandardPaths>
 #include <QTcpServer>
 #include <QTcpSocket>
@@ -21,11 +25,23 @@
 #include <QTimer>
 #include <QVector>
 #include <climits>
+#include <vector>
 #if !defined(Q_OS_WIN)
 #include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#endif
+#if defined(Q_OS_MACOS)
+#include <libproc.h>
+#include <sys/event.h>
+#endif
 #if defined(Q_OS_WIN)
 #include <windows.h>
 #endif
@@ -34,13 +50,6 @@ using namespace Qt::StringLiterals;
 
 namespace {
 
-QString quoteForSh(const QString& value)
-{
-    QString escaped = value;
-    escaped.replace('\'', "'\"'\"'");
-    return u"'"_s + escaped + u"'"_s;
-}
-
 QString quoteForPowerShell(const QString& value)
 {
     QString escaped = value;
@@ -1100,6 +1109,69 @@ bool validateLinuxTunRouting(const QString& requestedTunIf, const QString& serve
     }
     return false;
 }
+
+// Best-effort MTU/queue/offload tuning for the TUN device created by xray.
+// Returns the values that were actually applied so the app can record them.
+QJsonObject tuneLinuxTunInterface(const QString& requestedTunIf, int mtu, int txQueueLen)
+{
+    QJsonObject applied;
+    QString tunIf = requestedTunIf.trimmed();
+    if (tunIf.isEmpty()) {
+        QString ignored;
+        tunIf = linuxRouteDeviceFor(u"1.1.1.1"_s, false, &ignored);
+    }
+    if (tunIf.isEmpty()) {
+        return applied;
+    }
+    applied.insert(u"tun_if"_s, tunIf);
+
+    const QString ipTool = linuxIpTool();
+    // xray sets the configured MTU itself; re-apply it in case the core
+    // ignored the setting or the device was reused from a previous run.
+    if (!ipTool.isEmpty() && mtu > 0) {
+        QString stdoutText;
+        QString stderrText;
+        if (runProcess(
+                ipTool,
+                {u"link"_s, u"set"_s, u"dev"_s, tunIf, u"mtu"_s, QString::number(mtu)},
+                3000,
+                &stdoutText,
+                &stderrText)) {
+            applied.insert(u"mtu"_s, mtu);
+        }
+    }
+    if (!ipTool.isEmpty() && txQueueLen > 0) {
+        QString stdoutText;
+        QString stderrText;
+        if (runProcess(
+                ipTool,
+                {u"link"_s, u"set"_s, u"dev"_s, tunIf, u"txqueuelen"_s, QString::number(txQueueLen)},
+                3000,
+                &stdoutText,
+                &stderrText)) {
+            applied.insert(u"txqueuelen"_s, txQueueLen);
+        }
+    }
+
+    // GSO/GRO only take effect when the TUN fd was opened with offload support;
+    // ethtool rejects the request otherwise, which is fine.
+    QString ethtool = QStandardPaths::findExecutable(u"ethtool"_s);
+    if (ethtool.isEmpty()) {
+        ethtool = QStandardPaths::findExecutable(u"ethtool"_s, {u"/usr/sbin"_s, u"/sbin"_s});
+    }
+    if (!ethtool.isEmpty()) {
+        QString stdoutText;
+        QString stderrText;
+        const bool offloadsOk = runProcess(
+            ethtool,
+            {u"-K"_s, tunIf, u"gso"_s, u"on"_s, u"gro"_s, u"on"_s},
+            3000,
+            &stdoutText,
+            &stderrText);
+        applied.insert(u"offloads"_s, offloadsOk ? u"gso,gro"_s : u"unsupported"_s);
+    }
+    return applied;
+}
 #endif
 
 #if defined(Q_OS_MACOS)
@@ -1343,6 +1415,286 @@ bool isProcessAlive(qint64 pid)
 #endif
 }
 
+#if !defined(Q_OS_WIN)
+qint64 readPidFile(const QString& pidPath)
+{
+    QFile pidFile(pidPath);
+    if (!pidFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    bool ok = false;
+    const qint64 pid = QString::fromUtf8(pidFile.readAll()).trimmed().toLongLong(&ok);
+    return (ok && pid > 0) ? pid : -1;
+}
+
+// Executable image of a running process, empty when it cannot be determined.
+QString processExecutablePath(pid_t pid)
+{
+#if defined(Q_OS_LINUX)
+    QString target = QFile::symLinkTarget(u"/proc/%1/exe"_s.arg(pid));
+    // The kernel marks an image replaced on disk, e.g. by an xray upgrade.
+    const QString deletedSuffix = u" (deleted)"_s;
+    if (target.endsWith(deletedSuffix)) {
+        target.chop(deletedSuffix.size());
+    }
+    return target;
+#elif defined(Q_OS_MACOS)
+    char buffer[PROC_PIDPATHINFO_MAXSIZE] = {};
+    if (::proc_pidpath(pid, buffer, sizeof(buffer)) <= 0) {
+        return QString();
+    }
+    return QString::fromLocal8Bit(buffer);
+#else
+    Q_UNUSED(pid)
+    return QString();
+#endif
+}
+
+// Whether a pid taken from a pid file still names the runtime it was written
+// for. Pids are reused after a reboot or a long uptime, and the helper runs as
+// root, so anything it cannot positively identify is left alone.
+bool isManagedRuntimeProcess(pid_t pid, const QString& expectedExecutable)
+{
+    const QString actual = processExecutablePath(pid);
+    if (actual.isEmpty()) {
+        return false;
+    }
+    if (!expectedExecutable.isEmpty()) {
+        const QFileInfo expectedInfo(expectedExecutable);
+        const QFileInfo actualInfo(actual);
+        const QString expectedPath = expectedInfo.canonicalFilePath().isEmpty()
+            ? QDir::cleanPath(expectedInfo.absoluteFilePath())
+            : expectedInfo.canonicalFilePath();
+        const QString actualPath = actualInfo.canonicalFilePath().isEmpty()
+            ? QDir::cleanPath(actualInfo.absoluteFilePath())
+            : actualInfo.canonicalFilePath();
+        return actualPath == expectedPath;
+    }
+    // Older apps do not send the executable path with stop requests.
+    return QFileInfo(actual).fileName().startsWith(u"xray"_s, Qt::CaseInsensitive);
+}
+
+bool writePidFile(const QString& pidPath, qint64 pid)
+{
+    QSaveFile pidFile(pidPath);
+    if (!pidFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        return false;
+    }
+    pidFile.write(QByteArray::number(pid));
+    return pidFile.commit();
+}
+
+void setCloseOnExec(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFD);
+    if (flags >= 0) {
+        ::fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+}
+
+// Fork/exec xray directly with stdout/stderr appended to the runtime log.
+// Exec failures are reported back through a close-on-exec pipe so a missing
+// or non-executable binary fails the request instead of looking like a crash.
+pid_t spawnRuntimeProcess(
+    const QString& program,
+    const QStringList& arguments,
+    const QString& workingDir,
+    const QString& logPath,
+    QString* errorOut)
+{
+    const QByteArray programBytes = QFile::encodeName(program);
+    const QByteArray workingDirBytes = QFile::encodeName(workingDir);
+    const QByteArray logPathBytes = QFile::encodeName(logPath);
+    QList<QByteArray> argumentBytes;
+    argumentBytes.append(programBytes);
+    for (const QString& argument : arguments) {
+        argumentBytes.append(QFile::encodeName(argument));
+    }
+    std::vector<char*> argv;
+    argv.reserve(static_cast<size_t>(argumentBytes.size()) + 1);
+    for (QByteArray& argument : argumentBytes) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    const int logFd = ::open(logPathBytes.constData(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logFd < 0) {
+        if (errorOut != nullptr) {
+            *errorOut = u"Failed to open runtime log: %1"_s.arg(QString::fromLocal8Bit(std::strerror(errno)));
+        }
+        return -1;
+    }
+    setCloseOnExec(logFd);
+    const int nullFd = ::open("/dev/null", O_RDONLY);
+    if (nullFd >= 0) {
+        setCloseOnExec(nullFd);
+    }
+
+    int execErrorPipe[2] = {-1, -1};
+    if (::pipe(execErrorPipe) != 0) {
+        ::close(logFd);
+        if (nullFd >= 0) {
+            ::close(nullFd);
+        }
+        if (errorOut != nullptr) {
+            *errorOut = u"Failed to create runtime spawn pipe."_s;
+        }
+        return -1;
+    }
+    setCloseOnExec(execErrorPipe[0]);
+    setCloseOnExec(execErrorPipe[1]);
+
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        // Child: only async-signal-safe calls until exec.
+        ::setsid();
+        if (nullFd >= 0) {
+            ::dup2(nullFd, STDIN_FILENO);
+        }
+        ::dup2(logFd, STDOUT_FILENO);
+        ::dup2(logFd, STDERR_FILENO);
+        if (!workingDirBytes.isEmpty()) {
+            Q_UNUSED(::chdir(workingDirBytes.constData()));
+        }
+        ::execv(programBytes.constData(), argv.data());
+        const int execErrno = errno;
+        Q_UNUSED(::write(execErrorPipe[1], &execErrno, sizeof(execErrno)));
+        ::_exit(127);
+    }
+
+    ::close(execErrorPipe[1]);
+    ::close(logFd);
+    if (nullFd >= 0) {
+        ::close(nullFd);
+    }
+
+    if (pid < 0) {
+        ::close(execErrorPipe[0]);
+        if (errorOut != nullptr) {
+            *errorOut = u"Failed to fork Xray runtime: %1"_s.arg(QString::fromLocal8Bit(std::strerror(errno)));
+        }
+        return -1;
+    }
+
+    int execErrno = 0;
+    ssize_t readBytes = -1;
+    do {
+        readBytes = ::read(execErrorPipe[0], &execErrno, sizeof(execErrno));
+    } while (readBytes < 0 && errno == EINTR);
+    ::close(execErrorPipe[0]);
+    if (readBytes == static_cast<ssize_t>(sizeof(execErrno))) {
+        ::waitpid(pid, nullptr, 0);
+        if (errorOut != nullptr) {
+            *errorOut = u"Failed to execute Xray in privileged helper: %1"_s
+                            .arg(QString::fromLocal8Bit(std::strerror(execErrno)));
+        }
+        return -1;
+    }
+
+    return pid;
+}
+
+// Open a pollable handle that becomes readable when `pid` exits: a pidfd on
+// Linux 5.3+, a kqueue with EVFILT_PROC/NOTE_EXIT on macOS. Returns -1 when
+// the platform cannot provide one so callers fall back to polling.
+int openProcessExitWatchFd(pid_t pid)
+{
+    if (pid <= 0) {
+        return -1;
+    }
+#if defined(Q_OS_LINUX) && defined(SYS_pidfd_open)
+    const int fd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+    if (fd >= 0) {
+        setCloseOnExec(fd);
+    }
+    return fd;
+#elif defined(Q_OS_MACOS)
+    const int kq = ::kqueue();
+    if (kq < 0) {
+        return -1;
+    }
+    struct kevent change;
+    EV_SET(&change, pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, nullptr);
+    if (::kevent(kq, &change, 1, nullptr, 0, nullptr) < 0) {
+        ::close(kq);
+        return -1;
+    }
+    setCloseOnExec(kq);
+    return kq;
+#else
+    Q_UNUSED(pid)
+    return -1;
+#endif
+}
+
+void drainProcessExitWatchFd(int fd)
+{
+#if defined(Q_OS_MACOS)
+    struct kevent event;
+    const struct timespec noWait {0, 0};
+    Q_UNUSED(::kevent(fd, nullptr, 0, &event, 1, &noWait));
+#else
+    Q_UNUSED(fd)
+#endif
+}
+
+QString describeWaitStatus(int status)
+{
+    if (WIFEXITED(status)) {
+        return u"exit code %1"_s.arg(WEXITSTATUS(status));
+    }
+    if (WIFSIGNALED(status)) {
+        return u"signal %1"_s.arg(WTERMSIG(status));
+    }
+    return u"unknown status"_s;
+}
+
+// Returns true once `pid` is gone. Children of the helper are reaped here so
+// they never linger as zombies that still answer kill(pid, 0).
+bool waitForProcessExit(pid_t pid, bool ownChild, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        if (ownChild) {
+            const pid_t waited = ::waitpid(pid, nullptr, WNOHANG);
+            if (waited == pid || (waited < 0 && errno == ECHILD)) {
+                return true;
+            }
+        } else if (!isProcessAlive(pid)) {
+            return true;
+        }
+        if (timer.elapsed() >= timeoutMs) {
+            return false;
+        }
+        QThread::msleep(50);
+    }
+}
+
+void terminateRuntimeProcess(pid_t pid, bool ownChild)
+{
+    if (pid <= 0) {
+        return;
+    }
+    if (::kill(pid, SIGTERM) != 0 && errno == ESRCH) {
+        if (ownChild) {
+            ::waitpid(pid, nullptr, WNOHANG);
+        }
+        return;
+    }
+    // Give xray a moment to tear down its TUN device before forcing it.
+    if (waitForProcessExit(pid, ownChild, 1000)) {
+        return;
+    }
+    ::kill(pid, SIGKILL);
+    if (ownChild) {
+        ::waitpid(pid, nullptr, 0);
+    } else {
+        Q_UNUSED(waitForProcessExit(pid, false, 1000));
+    }
+}
+#endif
+
 QJsonObject makeResponse(bool ok, const QString& message = QString())
 {
     QJsonObject response;
@@ -1375,8 +1727,22 @@ public:
             stopTrackedRuntimeBestEffort(u"Helper idle timeout cleanup."_s);
             QCoreApplication::quit();
         });
+        // Polling fallback for platforms/kernels without process descriptors.
+        // When pidfd/kqueue watches are installed this timer stays stopped.
         m_ownerWatchdogTimer.setInterval(2000);
         connect(&m_ownerWatchdogTimer, &QTimer::timeout, this, [this]() {
+#if !defined(Q_OS_WIN)
+            if (m_runtimeActive && m_runtimeIsChild && m_runtimeNotifier == nullptr) {
+                int status = 0;
+                if (::waitpid(static_cast<pid_t>(m_runtimePid), &status, WNOHANG) == static_cast<pid_t>(m_runtimePid)) {
+                    handleRuntimeExited(status);
+                    return;
+                }
+            }
+            if (m_ownerNotifier != nullptr) {
+                return;
+            }
+#endif
             if (m_ownerPid <= 0 || !m_runtimeActive) {
                 m_ownerWatchdogMissCount = 0;
                 return;
@@ -1462,8 +1828,15 @@ private:
         }
         if (action == u"start_tun"_s) {
             QString error;
-            return startTun(request, &error) ? makeResponse(true, u"TUN started."_s)
-                                             : makeResponse(false, error);
+            if (!startTun(request, &error)) {
+                return makeResponse(false, error);
+            }
+            QJsonObject response = makeResponse(true, u"TUN started."_s);
+            response.insert(u"runtime_pid"_s, m_runtimePid);
+            if (!m_runtimeTuning.isEmpty()) {
+                response.insert(u"tun_tuning"_s, m_runtimeTuning);
+            }
+            return response;
         }
         if (action == u"stop_tun"_s) {
             QString error;
@@ -1474,10 +1847,102 @@ private:
         return makeResponse(false, u"Unsupported action."_s);
     }
 
+#if !defined(Q_OS_WIN)
+    static void closeProcessWatch(QSocketNotifier*& notifier, int& fd)
+    {
+        if (notifier != nullptr) {
+            notifier->setEnabled(false);
+            notifier->deleteLater();
+            notifier = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    QSocketNotifier* openProcessWatch(qint64 pid, int* fdOut)
+    {
+        const int fd = openProcessExitWatchFd(static_cast<pid_t>(pid));
+        *fdOut = fd;
+        if (fd < 0) {
+            return nullptr;
+        }
+        return new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    }
+
+    void installRuntimeWatches()
+    {
+        closeProcessWatch(m_runtimeNotifier, m_runtimeWatchFd);
+        closeProcessWatch(m_ownerNotifier, m_ownerWatchFd);
+
+        if (m_runtimePid > 0) {
+            m_runtimeNotifier = openProcessWatch(m_runtimePid, &m_runtimeWatchFd);
+            if (m_runtimeNotifier != nullptr) {
+                connect(m_runtimeNotifier, &QSocketNotifier::activated, this, [this]() {
+                    drainProcessExitWatchFd(m_runtimeWatchFd);
+                    int status = 0;
+                    const pid_t waited = m_runtimeIsChild
+                        ? ::waitpid(static_cast<pid_t>(m_runtimePid), &status, WNOHANG)
+                        : static_cast<pid_t>(m_runtimePid);
+                    if (waited == static_cast<pid_t>(m_runtimePid) || (waited < 0 && errno == ECHILD)) {
+                        handleRuntimeExited(status);
+                    }
+                });
+            }
+        }
+        if (m_ownerPid > 0) {
+            m_ownerNotifier = openProcessWatch(m_ownerPid, &m_ownerWatchFd);
+            if (m_ownerNotifier != nullptr) {
+                connect(m_ownerNotifier, &QSocketNotifier::activated, this, [this]() {
+                    drainProcessExitWatchFd(m_ownerWatchFd);
+                    closeProcessWatch(m_ownerNotifier, m_ownerWatchFd);
+                    stopTrackedRuntimeBestEffort(u"Owner process exited unexpectedly."_s);
+                    QCoreApplication::quit();
+                });
+            }
+        }
+
+        const bool needsPolling = (m_runtimeIsChild && m_runtimeNotifier == nullptr)
+            || (m_ownerPid > 0 && m_ownerNotifier == nullptr);
+        if (needsPolling) {
+            m_ownerWatchdogTimer.start();
+        } else {
+            m_ownerWatchdogTimer.stop();
+        }
+    }
+
+    void handleRuntimeExited(int status)
+    {
+        if (!m_runtimeActive) {
+            return;
+        }
+        if (!m_runtimeLogPath.isEmpty()) {
+            appendLineToFile(
+                m_runtimeLogPath,
+                u"[System] Xray runtime exited unexpectedly (%1)."_s.arg(describeWaitStatus(status)));
+        }
+#if defined(Q_OS_MACOS)
+        Q_UNUSED(cleanupMacTunRoutes(m_runtimeTunIf, m_runtimeServerIp));
+#endif
+        if (!m_runtimePidPath.isEmpty()) {
+            QFile::remove(m_runtimePidPath);
+        }
+        clearRuntimeTracking();
+    }
+#endif
+
     void clearRuntimeTracking()
     {
+#if !defined(Q_OS_WIN)
+        closeProcessWatch(m_runtimeNotifier, m_runtimeWatchFd);
+        closeProcessWatch(m_ownerNotifier, m_ownerWatchFd);
+        m_runtimeIsChild = false;
+        m_runtimeLogPath.clear();
+#endif
         m_runtimeActive = false;
         m_runtimePid = -1;
+        m_runtimeTuning = QJsonObject {};
         m_runtimePidPath.clear();
         m_runtimeTunIf.clear();
         m_runtimeServerIp.clear();
@@ -1513,10 +1978,14 @@ private:
         const QString configPath = request.value(u"config_path"_s).toString().trimmed();
         const QString pidPath = request.value(u"pid_path"_s).toString().trimmed();
         const QString logPath = request.value(u"log_path"_s).toString().trimmed();
+        const QString assetDir = request.value(u"asset_dir"_s).toString().trimmed();
         const QString tunIf = request.value(u"tun_if"_s).toString().trimmed();
         const QString serverIpRequested = request.value(u"server_ip"_s).toString().trimmed();
         const QString serverHostRequested = request.value(u"server_host"_s).toString().trimmed();
         const qint64 ownerPid = request.value(u"owner_pid"_s).toVariant().toLongLong();
+        // Only IPv6-minimum to Ethernet values; anything else keeps xray's own MTU.
+        const int requestedMtu = request.value(u"tun_mtu"_s).toInt(0);
+        const int tunMtu = requestedMtu >= 1280 && requestedMtu <= 1500 ? requestedMtu : 0;
 
         if (xrayPath.isEmpty() || configPath.isEmpty() || pidPath.isEmpty() || logPath.isEmpty()) {
             if (errorOut != nullptr) {
@@ -1537,6 +2006,16 @@ private:
             return false;
         }
 
+#if defined(Q_OS_MACOS)
+        // Checked before spawning: nothing below could wait for the interface.
+        if (tunIf.isEmpty()) {
+            if (errorOut != nullptr) {
+                *errorOut = u"Missing TUN interface name."_s;
+            }
+            return false;
+        }
+#endif
+
         QDir().mkpath(QFileInfo(pidPath).absolutePath());
         QDir().mkpath(QFileInfo(logPath).absolutePath());
 
@@ -1567,6 +2046,11 @@ private:
         detachedProcess.setProgram(xrayPath);
         detachedProcess.setArguments({u"run"_s, u"-config"_s, configPath});
         detachedProcess.setWorkingDirectory(workingDir);
+        if (!assetDir.isEmpty()) {
+            QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+            environment.insert(u"XRAY_LOCATION_ASSET"_s, assetDir);
+            detachedProcess.setProcessEnvironment(environment);
+        }
         detachedProcess.setStandardOutputFile(logPath, QIODevice::Append);
         detachedProcess.setStandardErrorFile(logPath, QIODevice::Append);
         const bool started = detachedProcess.startDetached(&pidValue);
@@ -1587,49 +2071,82 @@ private:
         pidFileOut.write(QByteArray::number(pidValue));
         pidFileOut.close();
 #else
-        const QString cmd =
-            quoteForSh(xrayPath)
-            + u" run -config "_s
-            + quoteForSh(configPath)
-            + u" >> "_s
-            + quoteForSh(logPath)
-            + u" 2>&1 & echo $! > "_s
-            + quoteForSh(pidPath);
-        QString stderrText;
-        if (!runShell(cmd, 10000, &stderrText)) {
+        // A pid file left behind by a crashed helper may still name a live
+        // runtime, or, after a reboot, an unrelated process.
+        const qint64 stalePid = readPidFile(pidPath);
+        if (stalePid > 0) {
+            if (isManagedRuntimeProcess(static_cast<pid_t>(stalePid), xrayPath)) {
+                terminateRuntimeProcess(static_cast<pid_t>(stalePid), false);
+            }
+            QFile::remove(pidPath);
+        }
+
+        // The child inherits the helper environment; the helper is long-lived,
+        // so a previous request's asset directory must not leak into this one.
+        if (assetDir.isEmpty()) {
+            qunsetenv("XRAY_LOCATION_ASSET");
+        } else {
+            qputenv("XRAY_LOCATION_ASSET", QFile::encodeName(assetDir));
+        }
+
+        QString spawnError;
+        const pid_t spawnedPid = spawnRuntimeProcess(
+            xrayPath,
+            {u"run"_s, u"-config"_s, configPath},
+            QFileInfo(xrayPath).absolutePath(),
+            logPath,
+            &spawnError);
+        if (spawnedPid <= 0) {
             if (errorOut != nullptr) {
-                *errorOut = stderrText.isEmpty()
+                *errorOut = spawnError.isEmpty()
                     ? u"Failed to start Xray in privileged helper."_s
-                    : stderrText;
+                    : spawnError;
             }
             return false;
         }
-#endif
+        const qint64 pidValue = spawnedPid;
 
-#if defined(Q_OS_MACOS)
-        if (tunIf.isEmpty()) {
+        // Track the child immediately so every failure path below can stop it
+        // by pid instead of going through the pid file.
+        m_runtimePid = pidValue;
+        m_runtimeIsChild = true;
+
+        // The pid file is kept only so the app can clean up a runtime orphaned
+        // by a crashed helper; liveness is tracked through the process handle.
+        if (!writePidFile(pidPath, pidValue)) {
+            terminateRuntimeProcess(spawnedPid, true);
+            clearRuntimeTracking();
             if (errorOut != nullptr) {
-                *errorOut = u"Missing TUN interface name."_s;
+                *errorOut = u"Failed to write privileged TUN pid file."_s;
             }
             return false;
         }
+#endif
 
+#if defined(Q_OS_MACOS)
         // Wait until xray creates the requested utun interface.
         bool tunReady = false;
+        bool runtimeExited = false;
         for (int i = 0; i < 80; ++i) {
             QString ifErr;
             if (runShell(u"/sbin/ifconfig %1 >/dev/null 2>&1"_s.arg(tunIf), 1200, &ifErr)) {
                 tunReady = true;
                 break;
             }
+            // Stop waiting as soon as xray dies instead of burning the full timeout.
+            if (::waitpid(spawnedPid, nullptr, WNOHANG) == spawnedPid) {
+                runtimeExited = true;
+                break;
+            }
             QThread::msleep(150);
         }
         if (!tunReady) {
             const QString startupLogLine = lastNonEmptyLogLine(logPath);
-            const QString cleanupCmd = u"if [ -f %1 ]; then PID=$(cat %1); [ -n \"$PID\" ] && kill \"$PID\" >/dev/null 2>&1; rm -f %1; fi"_s
-                .arg(quoteForSh(pidPath));
-            QString ignored;
-            runShell(cleanupCmd, 3000, &ignored);
+            if (!runtimeExited) {
+                terminateRuntimeProcess(spawnedPid, true);
+            }
+            QFile::remove(pidPath);
+            clearRuntimeTracking();
             if (errorOut != nullptr) {
                 *errorOut = startupLogLine.isEmpty()
                     ? u"TUN interface was not ready in time (%1)."_s.arg(tunIf)
@@ -1638,6 +2155,14 @@ private:
             return false;
         }
 
+        if (tunMtu > 0) {
+            QString mtuErr;
+            if (runShell(u"/sbin/ifconfig %1 mtu %2"_s.arg(tunIf).arg(tunMtu), 3000, &mtuErr)) {
+                m_runtimeTuning = QJsonObject {{u"tun_if"_s, tunIf}, {u"mtu"_s, tunMtu}};
+                appendLineToFile(logPath, u"[System] macOS TUN tuning: if=%1;mtu=%2"_s.arg(tunIf).arg(tunMtu));
+            }
+        }
+
         // Cleanup stale legacy split-routes from older builds (best effort).
         QString cleanupServerIp = resolveIpForHost(serverIpRequested);
         if (cleanupServerIp.isEmpty()) {
@@ -1648,10 +2173,9 @@ private:
         // Route system traffic through TUN and keep server endpoint direct.
         QString routeError;
         if (!applyMacTunRoutes(tunIf, cleanupServerIp, &routeError)) {
-            const QString cleanupCmd = u"if [ -f %1 ]; then PID=$(cat %1); [ -n \"$PID\" ] && kill \"$PID\" >/dev/null 2>&1; rm -f %1; fi"_s
-                .arg(quoteForSh(pidPath));
-            QString ignored;
-            runShell(cleanupCmd, 3000, &ignored);
+            terminateRuntimeProcess(spawnedPid, true);
+            QFile::remove(pidPath);
+            clearRuntimeTracking();
             if (errorOut != nullptr) {
                 *errorOut = routeError.trimmed().isEmpty()
                     ? u"Failed to apply TUN routes."_s
@@ -1660,6 +2184,8 @@ private:
             return false;
         }
 #elif defined(Q_OS_WIN)
+        // Wintun takes its MTU from the xray config; there is nothing to re-apply.
+        Q_UNUSED(tunMtu)
         QString resolvedServerIp = resolveIpForHost(serverIpRequested);
         if (resolvedServerIp.isEmpty()) {
             resolvedServerIp = resolveIpForHost(serverHostRequested);
@@ -1727,37 +2253,33 @@ private:
             }
             return false;
         }
+
+        m_runtimeTuning = tuneLinuxTunInterface(
+            tunIf,
+            tunMtu,
+            request.value(u"tun_txqueuelen"_s).toInt(0));
+        if (!m_runtimeTuning.isEmpty()) {
+            appendLineToFile(
+                logPath,
+                u"[System] Linux TUN tuning: if=%1;mtu=%2;txqueuelen=%3;offloads=%4"_s
+                    .arg(m_runtimeTuning.value(u"tun_if"_s).toString(),
+                         m_runtimeTuning.contains(u"mtu"_s)
+                             ? QString::number(m_runtimeTuning.value(u"mtu"_s).toInt())
+                             : u"unchanged"_s,
+                         m_runtimeTuning.contains(u"txqueuelen"_s)
+                             ? QString::number(m_runtimeTuning.value(u"txqueuelen"_s).toInt())
+                             : u"unchanged"_s,
+                         m_runtimeTuning.value(u"offloads"_s).toString(u"unavailable"_s)));
+        }
 #else
         Q_UNUSED(tunIf)
+        Q_UNUSED(tunMtu)
         Q_UNUSED(serverIpRequested)
         Q_UNUSED(serverHostRequested)
 #endif
 
-        QFile pidFile(pidPath);
-        if (!pidFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            if (errorOut != nullptr) {
-                *errorOut = u"TUN start failed: pid file not created."_s;
-            }
-            return false;
-        }
-        const QString pidText = QString::fromUtf8(pidFile.readAll()).trimmed();
-        if (pidText.isEmpty()) {
-            if (errorOut != nullptr) {
-                *errorOut = u"TUN start failed: invalid pid."_s;
-            }
-            return false;
-        }
-        bool pidOk = false;
-        const qint64 pid = pidText.toLongLong(&pidOk);
-        if (!pidOk || pid <= 0) {
-            if (errorOut != nullptr) {
-                *errorOut = u"TUN start failed: invalid pid."_s;
-            }
-            return false;
-        }
-
         m_runtimeActive = true;
-        m_runtimePid = pid;
+        m_runtimePid = pidValue;
         m_runtimePidPath = pidPath;
         m_runtimeTunIf = tunIf;
         m_runtimeServerIp = resolveIpForHost(serverIpRequested);
@@ -1766,11 +2288,31 @@ private:
         }
         m_ownerPid = ownerPid;
         m_ownerWatchdogMissCount = 0;
+#if defined(Q_OS_WIN)
         if (m_ownerPid > 0) {
             m_ownerWatchdogTimer.start();
         } else {
             m_ownerWatchdogTimer.stop();
         }
+#else
+        m_runtimeIsChild = true;
+        m_runtimeLogPath = logPath;
+        installRuntimeWatches();
+
+        // xray may have died while routes were being validated; the watch only
+        // reports future exits, so reap an already-exited child here.
+        int earlyStatus = 0;
+        if (::waitpid(spawnedPid, &earlyStatus, WNOHANG) == spawnedPid) {
+            handleRuntimeExited(earlyStatus);
+            if (errorOut != nullptr) {
+                const QString startupLogLine = lastNonEmptyLogLine(logPath);
+                *errorOut = startupLogLine.isEmpty()
+                    ? u"Xray exited during TUN startup."_s
+                    : u"Xray exited during TUN startup: %1"_s.arg(startupLogLine);
+            }
+            return false;
+        }
+#endif
 
         return true;
     }
@@ -1778,6 +2320,7 @@ private:
     bool stopTun(const QJsonObject& request, QString* errorOut)
     {
         const QString pidPath = request.value(u"pid_path"_s).toString().trimmed();
+        const QString xrayPath = request.value(u"xray_path"_s).toString().trimmed();
         const QString tunIf = request.value(u"tun_if"_s).toString().trimmed();
         const QString serverIp = request.value(u"server_ip"_s).toString().trimmed();
         if (pidPath.isEmpty()) {
@@ -1795,6 +2338,7 @@ private:
 #endif
 
 #if defined(Q_OS_WIN)
+        Q_UNUSED(xrayPath)
         if (QFile::exists(pidPath)) {
             QFile pidFileIn(pidPath);
             if (pidFileIn.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -1819,18 +2363,20 @@ private:
             *errorOut = cleanupError.trimmed();
         }
 #else
-        const QString cmd = QString::fromUtf8("if [ -f %1 ]; then "
-            "PID=$(cat %1); "
-            "if [ -n \"$PID\" ]; then kill \"$PID\" >/dev/null 2>&1; sleep 0.2; kill -9 \"$PID\" >/dev/null 2>&1 || true; fi; "
-            "rm -f %1; "
-            "fi")
-            .arg(quoteForSh(pidPath));
-        QString stopErr;
-        if (!runShell(cmd, 10000, &stopErr)) {
+        // Silence the exit watch first so a requested stop is not reported as a crash.
+        closeProcessWatch(m_runtimeNotifier, m_runtimeWatchFd);
+        if (m_runtimePid > 0 && m_runtimeIsChild) {
+            terminateRuntimeProcess(static_cast<pid_t>(m_runtimePid), true);
+        }
+        const qint64 filePid = readPidFile(pidPath);
+        if (filePid > 0
+            && filePid != m_runtimePid
+            && isManagedRuntimeProcess(static_cast<pid_t>(filePid), xrayPath)) {
+            terminateRuntimeProcess(static_cast<pid_t>(filePid), false);
+        }
+        if (QFile::exists(pidPath) && !QFile::remove(pidPath)) {
             if (errorOut != nullptr) {
-                *errorOut = stopErr.isEmpty()
-                    ? u"Failed to stop privileged TUN process."_s
-                    : stopErr;
+                *errorOut = u"Failed to stop privileged TUN process."_s;
             }
             return false;
         }
@@ -1854,6 +2400,15 @@ private:
     QString m_runtimePidPath;
     QString m_runtimeTunIf;
     QString m_runtimeServerIp;
+    QJsonObject m_runtimeTuning;
+#if !defined(Q_OS_WIN)
+    bool m_runtimeIsChild = false;
+    QString m_runtimeLogPath;
+    int m_runtimeWatchFd = -1;
+    int m_ownerWatchFd = -1;
+    QSocketNotifier* m_runtimeNotifier = nullptr;
+    QSocketNotifier* m_ownerNotifier = nullptr;
+#endif
 };
 
 } // namespace
@@ -0,0 +1,666 @@
+module;
+#include <QDir>
+#include <QFile>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QMetaObject>
+#include <QNetworkProxy>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTimer>
+#include <QUuid>
+#include <QtGlobal>
+
+#include <algorithm>
+
+module genyconnect.backend.tunnelbenchmark;
+
+import genyconnect.backend.routingrulecompiler;
+import genyconnect.backend.serverprofile;
+
+namespace {
+constexpr int kLaunchTimeoutMs = 6000;
+constexpr int kInboundPollMs = 100;
+constexpr int kLatencyTimeoutMs = 4000;
+constexpr int kProcessStopTimeoutMs = 1000;
+// Per-request size of both transfer directions; phases are time based and
+// streams simply issue the next request when one completes.
+constexpr qint64 kTransferRequestBytes = 256LL * 1024 * 1024;
+constexpr int kUdpProbeCount = 100;
+constexpr int kUdpProbeIntervalMs = 10;
+constexpr int kUdpProbeTimeoutMs = 1000;
+constexpr const char *kConfigFileName = "tunnel-benchmark.json";
+constexpr const char *kServerInboundTag = "bench-server";
+
+double medianOf(QList<double> values)
+{
+    if (values.isEmpty()) {
+        return -1.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(values.size() / 2);
+}
+
+bool hasRuleLists(const TunnelBenchmark::Options& options)
+{
+    return !options.blockDomains.isEmpty() || !options.directDomains.isEmpty() || !options.proxyDomains.isEmpty();
+}
+
+// Entries as the builder emitted them before rule compilation: bare names
+// become `domain:` matchers, everything else is kept verbatim.
+QStringList rawMatchers(const QStringList& entries)
+{
+    QStringList matchers;
+    matchers.reserve(entries.size());
+    for (const QString& entry : entries) {
+        const QString trimmed = entry.trimmed();
+        if (!trimmed.isEmpty()) {
+            matchers.append(trimmed.contains(':') ? trimmed : QStringLiteral("domain:%1").arg(trimmed));
+        }
+    }
+    return matchers;
+}
+
+QList<XrayConfigBuilder::RoutingRule> listRules(const TunnelBenchmark::Options& options, int *matcherCount)
+{
+    QList<XrayConfigBuilder::RoutingRule> rules;
+    *matcherCount = 0;
+    const auto append = [&rules, matcherCount](const QStringList& domains, const QStringList& ips, const QString& outboundTag) {
+        if (!domains.isEmpty()) {
+            XrayConfigBuilder::RoutingRule rule;
+            rule.domains = domains;
+            rule.outboundTag = outboundTag;
+            rules.append(rule);
+        }
+        if (!ips.isEmpty()) {
+            XrayConfigBuilder::RoutingRule rule;
+            rule.ips = ips;
+            rule.outboundTag = outboundTag;
+            rules.append(rule);
+        }
+        *matcherCount += static_cast<int>(domains.size() + ips.size());
+    };
+
+    if (options.compileRules) {
+        const RoutingRuleCompiler::Result compiled =
+            RoutingRuleCompiler::compile(options.blockDomains, options.directDomains, options.proxyDomains);
+        append(compiled.block.domains, compiled.block.ips, QStringLiteral("block"));
+        append(compiled.direct.domains, compiled.direct.ips, QStringLiteral("direct"));
+        append(compiled.proxy.domains, compiled.proxy.ips, QStringLiteral("proxy"));
+    } else {
+        append(rawMatchers(options.blockDomains), {}, QStringLiteral("block"));
+        append(rawMatchers(options.directDomains), {}, QStringLiteral("direct"));
+        append(rawMatchers(options.proxyDomains), {}, QStringLiteral("proxy"));
+    }
+    return rules;
+}
+
+QNetworkRequest measurementRequest(const QUrl& url, int timeoutMs)
+{
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setRawHeader("Cache-Control", "no-cache");
+    request.setRawHeader("User-Agent", "GenyConnect-SpeedTest/1.0");
+    request.setTransferTimeout(timeoutMs);
+    return request;
+}
+
+XrayConfigBuilder::Config loopbackConfig(
+    const TunnelBenchmark::Options& options,
+    quint16 clientPort,
+    quint16 serverPort,
+    int *ruleMatchers)
+{
+    const QString userId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    ServerProfile profile;
+    profile.id = QStringLiteral("tunnel-benchmark");
+    profile.name = QStringLiteral("Tunnel benchmark");
+    profile.protocol = options.protocol;
+    profile.address = QStringLiteral("127.0.0.1");
+    profile.port = serverPort;
+    profile.userId = userId;
+    profile.network = QStringLiteral("tcp");
+    profile.security = QStringLiteral("none");
+
+    XrayConfigBuilder::BuildOptions build;
+    build.socksPort = clientPort;
+    build.httpPort = clientPort;
+    build.enableStatsApi = false;
+    build.enableMux = options.mux;
+    build.core = options.core;
+    build.logLevel = QStringLiteral("warning");
+    XrayConfigBuilder::Config config = XrayConfigBuilder::buildConfig(profile, build);
+
+    QJsonObject settings {
+        {QStringLiteral("clients"), QJsonArray {QJsonObject {{QStringLiteral("id"), userId}}}}
+    };
+    if (options.protocol == QStringLiteral("vless")) {
+        settings.insert(QStringLiteral("decryption"), QStringLiteral("none"));
+    }
+    XrayConfigBuilder::Inbound server;
+    server.tag = QString::fromLatin1(kServerInboundTag);
+    server.protocol = options.protocol;
+    server.listen = QStringLiteral("127.0.0.1");
+    server.port = serverPort;
+    server.settings = settings;
+    config.inbounds.append(server);
+
+    // The builder sends loopback destinations direct. Here the client side
+    // must take the tunnel and only the server side may leave through freedom.
+    XrayConfigBuilder::RoutingRule serverRule;
+    serverRule.inboundTags = {QString::fromLatin1(kServerInboundTag)};
+    serverRule.outboundTag = QStringLiteral("direct");
+    XrayConfigBuilder::RoutingRule clientRule;
+    clientRule.inboundTags = {QStringLiteral("mixed-in")};
+    clientRule.outboundTag = QStringLiteral("proxy");
+    // Routing lists sit in front of the client rule, so every tunneled
+    // connection is matched against all of them first.
+    QList<XrayConfigBuilder::RoutingRule> rules {serverRule};
+    rules.append(listRules(options, ruleMatchers));
+    rules.append(clientRule);
+    rules.append(config.rules);
+    config.rules = rules;
+    return config;
+}
+
+quint16 reservePort()
+{
+    // The short window until xray binds the port is acceptable for a
+    // loopback-only listener.
+    QTcpServer reservation;
+    if (!reservation.listen(QHostAddress::LocalHost, 0)) {
+        return 0;
+    }
+    const quint16 port = reservation.serverPort();
+    reservation.close();
+    return port;
+}
+
+double overheadPct(double direct, double tunneled)
+{
+    return direct > 0.0 ? (1.0 - tunneled / direct) * 100.0 : -1.0;
+}
+}
+
+QJsonObject TunnelBenchmarkPass::toJson() const
+{
+    QJsonObject obj;
+    obj[QStringLiteral("ok")] = ok;
+    obj[QStringLiteral("latencyMs")] = latencyMs;
+    obj[QStringLiteral("downloadMbps")] = downloadMbps;
+    obj[QStringLiteral("uploadMbps")] = uploadMbps;
+    obj[QStringLiteral("udp")] = udp.toJson();
+    if (!error.isEmpty()) {
+        obj[QStringLiteral("error")] = error;
+    }
+    return obj;
+}
+
+TunnelBenchmark::TunnelBenchmark(QObject *parent)
+    : QObject(parent)
+{
+    m_network.setProxy(QNetworkProxy::NoProxy);
+
+    m_serverThread.setObjectName(QStringLiteral("GenyConnectLoopbackServer"));
+    m_server = new LoopbackSpeedServer();
+    m_server->moveToThread(&m_serverThread);
+    connect(&m_serverThread, &QThread::finished, m_server, &QObject::deleteLater);
+    m_echoServer = new UdpEchoServer();
+    m_echoServer->moveToThread(&m_serverThread);
+    connect(&m_serverThread, &QThread::finished, m_echoServer, &QObject::deleteLater);
+    m_serverThread.start();
+
+    connect(&m_engine, &SpeedTestEngine::finished, this, &TunnelBenchmark::onTransferFinished);
+    connect(&m_udpProbe, &UdpProbe::finished, this, [this]() {
+        if (m_step != Step::Udp) {
+            return;
+        }
+        currentPass().udp = m_udpProbe.result();
+        finishPass(true);
+    });
+
+    connect(&m_process, &XrayProcessManager::stopped, this, [this]() {
+        if (m_stage == Stage::Stopping) {
+            finishRun(!m_cancelled && m_direct.ok && m_tunnel.ok,
+                      m_cancelled ? QStringLiteral("Cancelled.") : m_tunnel.error);
+        } else if (m_stage == Stage::Launching || m_stage == Stage::Tunnel) {
+            finishPass(false, QStringLiteral("xray-core exited during the measurement."));
+        }
+    });
+    connect(&m_process, &XrayProcessManager::errorOccurred, this, [this](const QString& error) {
+        if (m_stage == Stage::Launching && !m_process.isRunning()) {
+            finishPass(false, error);
+        }
+    });
+}
+
+TunnelBenchmark::~TunnelBenchmark()
+{
+    abortNetwork();
+    m_process.stop(kProcessStopTimeoutMs);
+    if (!m_configPath.isEmpty()) {
+        QFile::remove(m_configPath);
+    }
+    stopServer();
+    m_serverThread.quit();
+    m_serverThread.wait();
+}
+
+void TunnelBenchmark::setExecutablePath(const QString& path)
+{
+    m_process.setExecutablePath(path);
+}
+
+void TunnelBenchmark::setWorkingDirectory(const QString& path)
+{
+    m_workingDirectory = path;
+    m_process.setWorkingDirectory(path);
+}
+
+bool TunnelBenchmark::start(const Options& options, QString *errorMessage)
+{
+    QString error;
+    if (m_running) {
+        error = QStringLiteral("Tunnel benchmark is already running.");
+    } else if (m_process.executablePath().trimmed().isEmpty()) {
+        error = QStringLiteral("xray-core executable path is not set.");
+    } else if (options.protocol != QStringLiteral("vless") && options.protocol != QStringLiteral("vmess")) {
+        error = QStringLiteral("Unsupported benchmark protocol: %1").arg(options.protocol);
+    } else if (m_workingDirectory.isEmpty() || !QDir().mkpath(m_workingDirectory)) {
+        error = QStringLiteral("Cannot create the benchmark directory.");
+    }
+    if (error.isEmpty()) {
+        LoopbackSpeedServer *server = m_server;
+        UdpEchoServer *echoServer = m_echoServer;
+        QMetaObject::invokeMethod(server, [server, echoServer, &error]() {
+            if (server->start(&error) && !echoServer->start(&error)) {
+                server->stop();
+            }
+        }, Qt::BlockingQueuedConnection);
+    }
+    if (!error.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+
+    m_options = options;
+    m_options.durationMs = qMax(500, options.durationMs);
+    m_options.streams = qBound(1, options.streams, SpeedTestEngine::kMaxStreams);
+    m_options.latencyProbes = qMax(1, options.latencyProbes);
+    m_direct = TunnelBenchmarkPass();
+    m_tunnel = TunnelBenchmarkPass();
+    m_ruleMatchers = 0;
+    m_configPath = QDir(m_workingDirectory).filePath(QString::fromLatin1(kConfigFileName));
+    m_running = true;
+    m_cancelled = false;
+    m_stage = Stage::Direct;
+    m_network.setProxy(QNetworkProxy::NoProxy);
+    m_network.clearConnectionCache();
+    QTimer::singleShot(0, this, &TunnelBenchmark::startPass);
+    return true;
+}
+
+void TunnelBenchmark::addSyntheticRules(Options *options, int entries)
+{
+    for (int i = 0; i < entries; ++i) {
+        const int site = i / 4;
+        const QString base = QStringLiteral("site%1.example.net").arg(site);
+        QString entry;
+        switch (i % 4) {
+        case 0:
+            entry = QStringLiteral("domain:%1").arg(base);
+            break;
+        case 1:
+            entry = QStringLiteral("full:www.%1").arg(base);
+            break;
+        case 2:
+            entry = QStringLiteral("cdn.%1").arg(base);
+            break;
+        default:
+            entry = QStringLiteral("domain:api.%1").arg(base);
+            break;
+        }
+        QStringList& list = site % 3 == 0 ? options->blockDomains
+                            : (site % 3 == 1 ? options->directDomains : options->proxyDomains);
+        list.append(entry);
+    }
+}
+
+void TunnelBenchmark::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    m_cancelled = true;
+    if (m_stage != Stage::Stopping) {
+        finishPass(false, QStringLiteral("Cancelled."));
+    }
+}
+
+bool TunnelBenchmark::isRunning() const
+{
+    return m_running;
+}
+
+const TunnelBenchmarkPass& TunnelBenchmark::direct() const
+{
+    return m_direct;
+}
+
+const TunnelBenchmarkPass& TunnelBenchmark::tunnel() const
+{
+    return m_tunnel;
+}
+
+double TunnelBenchmark::downloadOverheadPct() const
+{
+    return m_direct.ok && m_tunnel.ok ? overheadPct(m_direct.downloadMbps, m_tunnel.downloadMbps) : -1.0;
+}
+
+double TunnelBenchmark::uploadOverheadPct() const
+{
+    return m_direct.ok && m_tunnel.ok ? overheadPct(m_direct.uploadMbps, m_tunnel.uploadMbps) : -1.0;
+}
+
+double TunnelBenchmark::addedLatencyMs() const
+{
+    return m_direct.ok && m_tunnel.ok ? qMax(0.0, m_tunnel.latencyMs - m_direct.latencyMs) : -1.0;
+}
+
+QJsonObject TunnelBenchmark::toJson() const
+{
+    QJsonObject options;
+    options[QStringLiteral("protocol")] = m_options.protocol;
+    options[QStringLiteral("mux")] = m_options.mux;
+    options[QStringLiteral("durationMs")] = m_options.durationMs;
+    options[QStringLiteral("streams")] = m_options.streams;
+    options[QStringLiteral("latencyProbes")] = m_options.latencyProbes;
+    options[QStringLiteral("xrayVersion")] = m_options.core.version;
+    if (hasRuleLists(m_options)) {
+        options[QStringLiteral("ruleEntries")] = static_cast<int>(
+            m_options.blockDomains.size() + m_options.directDomains.size() + m_options.proxyDomains.size());
+        options[QStringLiteral("ruleMatchers")] = m_ruleMatchers;
+        options[QStringLiteral("compileRules")] = m_options.compileRules;
+    }
+
+    const bool udpMeasured = m_direct.udp.measured() && m_tunnel.udp.measured();
+    QJsonObject overhead;
+    overhead[QStringLiteral("downloadPct")] = downloadOverheadPct();
+    overhead[QStringLiteral("uploadPct")] = uploadOverheadPct();
+    overhead[QStringLiteral("latencyMs")] = addedLatencyMs();
+    overhead[QStringLiteral("udpRttMs")] =
+        udpMeasured ? qMax(0.0, m_tunnel.udp.rttMedianMs - m_direct.udp.rttMedianMs) : -1.0;
+    overhead[QStringLiteral("udpLossPct")] = udpMeasured ? m_tunnel.udp.lossPct : -1.0;
+
+    QJsonObject obj;
+    obj[QStringLiteral("options")] = options;
+    obj[QStringLiteral("direct")] = m_direct.toJson();
+    obj[QStringLiteral("tunnel")] = m_tunnel.toJson();
+    obj[QStringLiteral("overhead")] = overhead;
+    return obj;
+}
+
+TunnelBenchmarkPass& TunnelBenchmark::currentPass()
+{
+    return m_stage == Stage::Direct ? m_direct : m_tunnel;
+}
+
+void TunnelBenchmark::startPass()
+{
+    if (!m_running || (m_stage != Stage::Direct && m_stage != Stage::Tunnel)) {
+        return;
+    }
+    m_step = Step::Latency;
+    m_latencySamples.clear();
+    m_latencyAttempts = 0;
+    emit progressChanged(m_stage == Stage::Direct ? QStringLiteral("direct latency") : QStringLiteral("tunnel latency"));
+    runLatencyProbe();
+}
+
+void TunnelBenchmark::runLatencyProbe()
+{
+    if (m_step != Step::Latency) {
+        return;
+    }
+    if (m_latencyAttempts >= m_options.latencyProbes) {
+        if (m_latencySamples.isEmpty()) {
+            finishPass(false, QStringLiteral("Latency probes failed."));
+        } else {
+            currentPass().latencyMs = medianOf(m_latencySamples);
+            startTransfer(false);
+        }
+        return;
+    }
+
+    ++m_latencyAttempts;
+    QUrl url = m_server->downloadUrl(1);
+    QNetworkRequest request;
+    if (hasRuleLists(m_options)) {
+        // A fresh connection to a name makes xray run its domain matchers on every probe.
+        url.setHost(QStringLiteral("localhost"));
+        request = measurementRequest(url, kLatencyTimeoutMs);
+        request.setRawHeader("Connection", "close");
+    } else {
+        request = measurementRequest(url, kLatencyTimeoutMs);
+    }
+    m_requestTimer.start();
+    QNetworkReply *reply = m_network.get(request);
+    m_reply = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (m_reply != reply) {
+            return;
+        }
+        m_reply = nullptr;
+        if (reply->error() == QNetworkReply::NoError) {
+            m_latencySamples.append(static_cast<double>(m_requestTimer.nsecsElapsed()) / 1.0e6);
+        }
+        runLatencyProbe();
+    });
+}
+
+void TunnelBenchmark::startTransfer(bool upload)
+{
+    m_step = upload ? Step::Upload : Step::Download;
+    const QString pass = m_stage == Stage::Direct ? QStringLiteral("direct") : QStringLiteral("tunnel");
+    emit progressChanged(QStringLiteral("%1 %2").arg(pass, upload ? QStringLiteral("upload") : QStringLiteral("download")));
+
+    QNetworkRequest request = measurementRequest(
+        upload ? m_server->uploadUrl() : m_server->downloadUrl(kTransferRequestBytes),
+        0);
+    if (upload) {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QStringLiteral("application/octet-stream"));
+    }
+    m_requestTimer.start();
+    m_engine.start(request, upload, kTransferRequestBytes, 0, m_options.durationMs, m_options.streams, m_options.streams);
+}
+
+void TunnelBenchmark::onTransferFinished(QNetworkReply::NetworkError error, const QString& errorText)
+{
+    if (m_step == Step::Latency || m_step == Step::Udp) {
+        return;
+    }
+    const qint64 elapsedMs = m_requestTimer.elapsed();
+    if (error != QNetworkReply::NoError) {
+        finishPass(false, errorText);
+        return;
+    }
+    const double mbps = elapsedMs > 0
+        ? (static_cast<double>(m_engine.totalBytes()) * 8.0) / (static_cast<double>(elapsedMs) * 1000.0)
+        : 0.0;
+    if (mbps <= 0.0) {
+        finishPass(false, QStringLiteral("No data transferred."));
+        return;
+    }
+
+    if (m_step == Step::Download) {
+        currentPass().downloadMbps = mbps;
+        startTransfer(true);
+        return;
+    }
+    currentPass().uploadMbps = mbps;
+    startUdpProbe();
+}
+
+void TunnelBenchmark::startUdpProbe()
+{
+    m_step = Step::Udp;
+    const bool tunneled = m_stage == Stage::Tunnel;
+    emit progressChanged(tunneled ? QStringLiteral("tunnel udp") : QStringLiteral("direct udp"));
+
+    UdpProbe::Options options;
+    options.host = QStringLiteral("127.0.0.1");
+    options.port = m_echoServer->port();
+    options.socksPort = tunneled ? m_clientPort : 0;
+    options.count = kUdpProbeCount;
+    options.intervalMs = kUdpProbeIntervalMs;
+    options.timeoutMs = kUdpProbeTimeoutMs;
+    QString error;
+    if (!m_udpProbe.start(options, &error)) {
+        currentPass().udp.error = error;
+        finishPass(true);
+    }
+}
+
+void TunnelBenchmark::finishPass(bool ok, const QString& error)
+{
+    if (!m_running || m_stage == Stage::Idle || m_stage == Stage::Stopping) {
+        return;
+    }
+    m_step = Step::Latency;
+    abortNetwork();
+    if (m_inboundProbe) {
+        m_inboundProbe->abort();
+        m_inboundProbe->deleteLater();
+        m_inboundProbe = nullptr;
+    }
+
+    TunnelBenchmarkPass& pass = currentPass();
+    pass.ok = ok;
+    pass.error = ok ? QString() : error;
+
+    if (m_stage == Stage::Direct) {
+        if (!ok || m_cancelled) {
+            finishRun(false, m_cancelled ? QStringLiteral("Cancelled.")
+                                         : QStringLiteral("Direct pass failed: %1").arg(error));
+            return;
+        }
+        launchTunnel();
+        return;
+    }
+
+    if (m_process.isRunning()) {
+        m_stage = Stage::Stopping;
+        m_process.stop(0);
+        return;
+    }
+    finishRun(ok && !m_cancelled, m_cancelled ? QStringLiteral("Cancelled.") : error);
+}
+
+void TunnelBenchmark::launchTunnel()
+{
+    m_stage = Stage::Launching;
+    m_stageTimer.start();
+    emit progressChanged(QStringLiteral("launching xray-core"));
+
+    m_clientPort = reservePort();
+    m_serverPort = reservePort();
+    if (m_clientPort == 0 || m_serverPort == 0 || m_clientPort == m_serverPort) {
+        finishPass(false, QStringLiteral("No free local port."));
+        return;
+    }
+
+    const QByteArray config = XrayConfigBuilder::serialize(loopbackConfig(m_options, m_clientPort, m_serverPort, &m_ruleMatchers));
+    QSaveFile file(m_configPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(config) != config.size()
+        || !file.commit()) {
+        finishPass(false, QStringLiteral("Failed to write benchmark config: %1").arg(file.errorString()));
+        return;
+    }
+
+    QString error;
+    if (!m_process.start(m_configPath, &error)) {
+        finishPass(false, error);
+        return;
+    }
+    m_network.setProxy(QNetworkProxy(QNetworkProxy::Socks5Proxy, QStringLiteral("127.0.0.1"), m_clientPort));
+    m_network.clearConnectionCache();
+    pollInbound();
+}
+
+void TunnelBenchmark::pollInbound()
+{
+    if (m_stage != Stage::Launching) {
+        return;
+    }
+    if (m_stageTimer.elapsed() > kLaunchTimeoutMs) {
+        finishPass(false, QStringLiteral("xray-core did not open its inbound in time."));
+        return;
+    }
+
+    auto *socket = new QTcpSocket(this);
+    m_inboundProbe = socket;
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        socket->abort();
+        socket->deleteLater();
+        if (m_inboundProbe != socket || m_stage != Stage::Launching) {
+            return;
+        }
+        m_inboundProbe = nullptr;
+        m_stage = Stage::Tunnel;
+        startPass();
+    });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket](QAbstractSocket::SocketError) {
+        socket->deleteLater();
+        if (m_inboundProbe != socket) {
+            return;
+        }
+        m_inboundProbe = nullptr;
+        QTimer::singleShot(kInboundPollMs, this, &TunnelBenchmark::pollInbound);
+    });
+    socket->connectToHost(QHostAddress::LocalHost, m_clientPort);
+}
+
+void TunnelBenchmark::abortNetwork()
+{
+    m_engine.stop();
+    m_udpProbe.stop();
+    if (m_reply) {
+        QNetworkReply *reply = m_reply;
+        m_reply = nullptr;
+        QObject::disconnect(reply, nullptr, this, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void TunnelBenchmark::stopServer()
+{
+    LoopbackSpeedServer *server = m_server;
+    UdpEchoServer *echoServer = m_echoServer;
+    if (!server || !m_serverThread.isRunning()) {
+        return;
+    }
+    QMetaObject::invokeMethod(server, [server, echoServer]() {
+        server->stop();
+        echoServer->stop();
+    }, Qt::BlockingQueuedConnection);
+}
+
+void TunnelBenchmark::finishRun(bool ok, const QString& error)
+{
+    m_running = false;
+    m_stage = Stage::Idle;
+    m_network.setProxy(QNetworkProxy::NoProxy);
+    m_network.clearConnectionCache();
+    if (!m_configPath.isEmpty()) {
+        QFile::remove(m_configPath);
+    }
+    stopServer();
+    emit finished(ok, error);
+}
@@ -0,0 +1,246 @@
+/*!
+ * @file        tunnelbenchmark.cppm
+ * @brief       Measures the throughput and latency cost of the tunnel on loopback.
+ *
+ * @details
+ * Runs the same speed test twice against a LoopbackSpeedServer: once
+ * directly and once through the local mixed inbound of a temporary
+ * xray-core. That xray-core also hosts the server side, so the proxy
+ * outbound loops back to a second inbound of the same process and leaves
+ * through `freedom` to the loopback server. A UDP echo server on the same
+ * thread measures datagram round trip, jitter and loss over the SOCKS5 UDP
+ * association of the mixed inbound. The network is out of the
+ * picture; the difference between the passes is what this build of the
+ * client and the chosen config cost. The client config comes from
+ * XrayConfigBuilder, so it matches what a normal connect produces.
+ *
+ * With routing lists set, every tunneled latency probe opens a new
+ * connection to `localhost`, which xray matches against all list rules
+ * before the catch-all proxy rule; the median probe latency then includes
+ * the per-connection rule-matching cost of those lists.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QThread>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.tunnelbenchmark;
+import genyconnect.backend.loopbackspeedserver;
+import genyconnect.backend.speedtestengine;
+import genyconnect.backend.udpprobe;
+import genyconnect.backend.xraycapabilities;
+import genyconnect.backend.xrayconfigbuilder;
+import genyconnect.backend.xrayprocessmanager;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct TunnelBenchmarkPass
+ * @brief Measurement of one pass, direct or through the tunnel.
+ */
+GENYCONNECT_MODULE_EXPORT struct TunnelBenchmarkPass {
+    bool ok = false;             //!< Latency and both transfers were measured.
+    double latencyMs = -1.0;     //!< Median request latency, sub-millisecond resolution.
+    double downloadMbps = 0.0;   //!< Download throughput.
+    double uploadMbps = 0.0;     //!< Upload throughput.
+    UdpProbeResult udp;          //!< Datagram train; informational, does not affect `ok`.
+    QString error;               //!< Failure description when `ok` is false.
+
+    /**
+     * @brief Serialize pass to JSON.
+     * @return JSON object.
+     */
+    QJsonObject toJson() const;
+};
+
+/**
+ * @class TunnelBenchmark
+ * @brief Direct and tunneled loopback passes with the overhead between them.
+ */
+GENYCONNECT_MODULE_EXPORT class TunnelBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Options
+     * @brief Tunnel config and measurement settings.
+     */
+    struct Options {
+        QString protocol = QStringLiteral("vless"); //!< Loopback protocol, `vless` or `vmess`.
+        bool mux = false;                 //!< Enable mux on the proxy outbound.
+        int durationMs = 5000;            //!< Length of each transfer phase.
+        int streams = 4;                  //!< Parallel streams of each transfer phase.
+        int latencyProbes = 20;           //!< Sequential requests per latency measurement.
+        XrayCapabilities core;            //!< Probed core features; unprobed keeps defaults.
+        QStringList blockDomains;         //!< Routing entries matched on every tunneled connection; none may match `localhost`.
+        QStringList directDomains;        //!< As blockDomains, routed direct.
+        QStringList proxyDomains;         //!< As blockDomains, routed through the proxy.
+        bool compileRules = true;         //!< Reduce the lists with RoutingRuleCompiler; false emits them as entered.
+    };
+
+    /**
+     * @brief Construct benchmark.
+     * @param parent Optional QObject parent.
+     */
+    explicit TunnelBenchmark(QObject *parent = nullptr);
+    ~TunnelBenchmark() override;
+
+    /**
+     * @brief Set the xray-core executable under test.
+     * @param path Executable path.
+     */
+    void setExecutablePath(const QString& path);
+
+    /**
+     * @brief Set the directory for the temporary config.
+     * @param path Writable directory.
+     */
+    void setWorkingDirectory(const QString& path);
+
+    /**
+     * @brief Start the direct pass, then the tunneled pass.
+     * @param options Tunnel config and measurement settings.
+     * @param errorMessage Optional output message on failure.
+     * @return True when the run started.
+     */
+    bool start(const Options& options, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Fill the routing lists with synthetic entries; three in four
+     *        are covered by a broader entry, as in merged community lists.
+     * @param options Options to fill.
+     * @param entries Total entry count across the three lists.
+     */
+    static void addSyntheticRules(Options *options, int entries);
+
+    /**
+     * @brief Abort the run; finished() reports a cancellation.
+     */
+    void cancel();
+
+    /**
+     * @brief Whether a run is in progress.
+     * @return True between start() and finished().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Result of the direct pass.
+     * @return Pass measurement.
+     */
+    const TunnelBenchmarkPass& direct() const;
+
+    /**
+     * @brief Result of the tunneled pass.
+     * @return Pass measurement.
+     */
+    const TunnelBenchmarkPass& tunnel() const;
+
+    /**
+     * @brief Download throughput lost to the tunnel.
+     * @return Percent of the direct throughput, `-1` when a pass failed.
+     */
+    double downloadOverheadPct() const;
+
+    /**
+     * @brief Upload throughput lost to the tunnel.
+     * @return Percent of the direct throughput, `-1` when a pass failed.
+     */
+    double uploadOverheadPct() const;
+
+    /**
+     * @brief Request latency added by the tunnel.
+     * @return Milliseconds, `-1` when a pass failed.
+     */
+    double addedLatencyMs() const;
+
+    /**
+     * @brief Options, both passes and the overhead as JSON.
+     * @return JSON object suitable for CI artifacts.
+     */
+    QJsonObject toJson() const;
+
+signals:
+    //! Emitted when a pass or one of its steps starts.
+    void progressChanged(const QString& step);
+    //! Emitted once per run.
+    void finished(bool ok, const QString& error);
+
+private:
+    enum class Stage {
+        Idle,
+        Direct,
+        Launching,
+        Tunnel,
+        Stopping
+    };
+
+    enum class Step {
+        Latency,
+        Download,
+        Upload,
+        Udp
+    };
+
+    TunnelBenchmarkPass& currentPass();
+    void startPass();
+    void runLatencyProbe();
+    void startTransfer(bool upload);
+    void onTransferFinished(QNetworkReply::NetworkError error, const QString& errorText);
+    void startUdpProbe();
+    void finishPass(bool ok, const QString& error = QString());
+    void launchTunnel();
+    void pollInbound();
+    void abortNetwork();
+    void stopServer();
+    void finishRun(bool ok, const QString& error);
+
+    QString m_workingDirectory;                      //!< Directory for the config.
+    Options m_options;                               //!< Options of the current run.
+    Stage m_stage = Stage::Idle;                     //!< Pass in progress.
+    Step m_step = Step::Latency;                     //!< Step of the pass in progress.
+    TunnelBenchmarkPass m_direct;                    //!< Direct pass.
+    TunnelBenchmarkPass m_tunnel;                    //!< Tunneled pass.
+    LoopbackSpeedServer *m_server = nullptr;         //!< Lives on m_serverThread.
+    UdpEchoServer *m_echoServer = nullptr;           //!< Lives on m_serverThread.
+    QThread m_serverThread;                          //!< Keeps the server off the client's event loop.
+    XrayProcessManager m_process;                    //!< Temporary xray-core (client and server side).
+    QNetworkAccessManager m_network;                 //!< Client of both passes.
+    SpeedTestEngine m_engine {&m_network};           //!< Transfers of both passes.
+    UdpProbe m_udpProbe;                             //!< Datagram train of both passes.
+    QPointer<QNetworkReply> m_reply;                 //!< Latency probe in flight.
+    QPointer<QTcpSocket> m_inboundProbe;             //!< Readiness probe of the mixed inbound.
+    QElapsedTimer m_stageTimer;                      //!< Time since the stage started.
+    QElapsedTimer m_requestTimer;                    //!< Time since the request or transfer started.
+    QList<double> m_latencySamples;                  //!< Latency samples of the current pass.
+    int m_latencyAttempts = 0;                       //!< Latency probes started.
+    QString m_configPath;                            //!< Temporary config.
+    quint16 m_clientPort = 0;                        //!< Mixed inbound port.
+    quint16 m_serverPort = 0;                        //!< Server-side inbound port.
+    int m_ruleMatchers = 0;                          //!< Matchers emitted for the routing lists.
+    bool m_running = false;                          //!< Run in progress.
+    bool m_cancelled = false;                        //!< Run cancelled by the caller.
+};
+
+#include "tunnelbenchmark.moc"
@@ -0,0 +1,555 @@
+module;
+#include <QHostInfo>
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+#include <QUrl>
+#include <QtEndian>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+module genyconnect.backend.udpprobe;
+
+namespace {
+constexpr char kEchoMagic[] = "GCUP";
+// Magic, sequence number and send timestamp.
+constexpr int kEchoHeaderBytes = 16;
+constexpr int kMaxPayloadBytes = 1200;
+constexpr int kMaxCount = 1000;
+constexpr int kHandshakeTimeoutMs = 3000;
+constexpr char kDnsProbeName[] = "cloudflare.com";
+
+double percentileOf(const QList<double>& sorted, double percentile)
+{
+    if (sorted.isEmpty()) {
+        return -1.0;
+    }
+    const double ratio = qBound(0.0, percentile / 100.0, 1.0);
+    const qsizetype index = qBound<qsizetype>(
+        0,
+        static_cast<qsizetype>(std::round(static_cast<double>(sorted.size() - 1) * ratio)),
+        sorted.size() - 1);
+    return sorted.at(index);
+}
+
+// Length of the SOCKS5 UDP request header in front of the payload, -1 when malformed.
+qsizetype socksHeaderLength(const QByteArray& datagram)
+{
+    if (datagram.size() < 4 || datagram.at(2) != 0) {
+        return -1;
+    }
+    qsizetype length = -1;
+    switch (static_cast<quint8>(datagram.at(3))) {
+    case 0x01:
+        length = 4 + 4 + 2;
+        break;
+    case 0x04:
+        length = 4 + 16 + 2;
+        break;
+    case 0x03:
+        length = datagram.size() > 4 ? 4 + 1 + static_cast<quint8>(datagram.at(4)) + 2 : -1;
+        break;
+    default:
+        break;
+    }
+    return length > 0 && length <= datagram.size() ? length : -1;
+}
+}
+
+bool UdpProbeResult::measured() const
+{
+    return received > 0;
+}
+
+QJsonObject UdpProbeResult::toJson() const
+{
+    QJsonObject obj;
+    obj[QStringLiteral("sent")] = sent;
+    obj[QStringLiteral("received")] = received;
+    obj[QStringLiteral("reordered")] = reordered;
+    obj[QStringLiteral("duplicates")] = duplicates;
+    obj[QStringLiteral("lossPct")] = lossPct;
+    obj[QStringLiteral("reorderPct")] = reorderPct;
+    obj[QStringLiteral("rttMinMs")] = rttMinMs;
+    obj[QStringLiteral("rttMedianMs")] = rttMedianMs;
+    obj[QStringLiteral("rttP95Ms")] = rttP95Ms;
+    obj[QStringLiteral("jitterMs")] = jitterMs;
+    if (!error.isEmpty()) {
+        obj[QStringLiteral("error")] = error;
+    }
+    return obj;
+}
+
+QVariantMap UdpProbeResult::toVariantMap() const
+{
+    return toJson().toVariantMap();
+}
+
+UdpEchoServer::UdpEchoServer(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QUdpSocket(this))
+{
+    connect(m_socket, &QUdpSocket::readyRead, this, &UdpEchoServer::onReadyRead);
+}
+
+UdpEchoServer::~UdpEchoServer()
+{
+    stop();
+}
+
+bool UdpEchoServer::start(QString *errorMessage)
+{
+    if (m_socket->state() == QAbstractSocket::BoundState) {
+        return true;
+    }
+    if (!m_socket->bind(QHostAddress::LocalHost, 0)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Cannot bind the UDP echo socket: %1").arg(m_socket->errorString());
+        }
+        return false;
+    }
+    m_port = m_socket->localPort();
+    m_echoed = 0;
+    return true;
+}
+
+void UdpEchoServer::stop()
+{
+    m_socket->close();
+    m_port = 0;
+}
+
+quint16 UdpEchoServer::port() const
+{
+    return m_port;
+}
+
+qint64 UdpEchoServer::echoedDatagrams() const
+{
+    return m_echoed;
+}
+
+void UdpEchoServer::onReadyRead()
+{
+    while (m_socket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram();
+        if (!datagram.isValid()) {
+            continue;
+        }
+        if (m_socket->writeDatagram(datagram.makeReply(datagram.data())) >= 0) {
+            ++m_echoed;
+        }
+    }
+}
+
+UdpProbe::UdpProbe(QObject *parent)
+    : QObject(parent)
+{
+    m_sendTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_sendTimer, &QTimer::timeout, this, &UdpProbe::sendNext);
+    m_deadline.setSingleShot(true);
+    connect(&m_deadline, &QTimer::timeout, this, [this]() {
+        finish(m_relayPort == 0 ? QStringLiteral("Timed out before the first datagram was sent.") : QString());
+    });
+    connect(&m_socket, &QUdpSocket::readyRead, this, &UdpProbe::onReadyRead);
+}
+
+UdpProbe::~UdpProbe()
+{
+    stop();
+}
+
+bool UdpProbe::start(const Options& options, QString *errorMessage)
+{
+    stop();
+
+    QString error;
+    if (options.host.trimmed().isEmpty() || options.port == 0) {
+        error = QStringLiteral("UDP probe target is not set.");
+    } else if (options.socksPort > 0 && options.socksHost.trimmed().isEmpty()) {
+        error = QStringLiteral("SOCKS5 host is not set.");
+    } else if (!m_socket.bind(QHostAddress::Any, 0)) {
+        error = QStringLiteral("Cannot bind the UDP probe socket: %1").arg(m_socket.errorString());
+    }
+    if (!error.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+
+    m_options = options;
+    m_options.host = options.host.trimmed();
+    m_options.count = qBound(1, options.count, kMaxCount);
+    m_options.intervalMs = qMax(1, options.intervalMs);
+    m_options.timeoutMs = qMax(100, options.timeoutMs);
+    m_options.payloadBytes = qBound(kEchoHeaderBytes, options.payloadBytes, kMaxPayloadBytes);
+    m_result = UdpProbeResult();
+    m_controlBuffer.clear();
+    m_greeted = false;
+    m_relay.clear();
+    m_relayPort = 0;
+    m_sentAtNs.clear();
+    m_answered.clear();
+    m_rttMs.clear();
+    m_highestSequence = -1;
+    m_lastTransitMs = -1.0;
+    m_dnsIdBase = static_cast<quint16>(QRandomGenerator::global()->bounded(65536));
+    ++m_generation;
+    m_running = true;
+
+    m_deadline.start(kHandshakeTimeoutMs);
+    if (m_options.socksPort > 0) {
+        openAssociation();
+    } else {
+        resolveTarget();
+    }
+    return true;
+}
+
+void UdpProbe::stop()
+{
+    m_running = false;
+    ++m_generation;
+    m_sendTimer.stop();
+    m_deadline.stop();
+    if (m_control) {
+        QTcpSocket *control = m_control;
+        m_control = nullptr;
+        QObject::disconnect(control, nullptr, this, nullptr);
+        control->abort();
+        control->deleteLater();
+    }
+    m_socket.close();
+}
+
+bool UdpProbe::isRunning() const
+{
+    return m_running;
+}
+
+const UdpProbeResult& UdpProbe::result() const
+{
+    return m_result;
+}
+
+void UdpProbe::resolveTarget()
+{
+    const QHostAddress address(m_options.host);
+    if (!address.isNull()) {
+        startTrain(address, m_options.port);
+        return;
+    }
+    const quint64 generation = m_generation;
+    QHostInfo::lookupHost(m_options.host, this, [this, generation](const QHostInfo& info) {
+        if (generation != m_generation || !m_running) {
+            return;
+        }
+        const QList<QHostAddress> addresses = info.addresses();
+        if (info.error() != QHostInfo::NoError || addresses.isEmpty()) {
+            finish(QStringLiteral("Cannot resolve %1: %2").arg(m_options.host, info.errorString()));
+            return;
+        }
+        const auto ipv4 = std::find_if(addresses.cbegin(), addresses.cend(), [](const QHostAddress& candidate) {
+            return candidate.protocol() == QAbstractSocket::IPv4Protocol;
+        });
+        startTrain(ipv4 != addresses.cend() ? *ipv4 : addresses.constFirst(), m_options.port);
+    });
+}
+
+void UdpProbe::openAssociation()
+{
+    auto *control = new QTcpSocket(this);
+    m_control = control;
+    connect(control, &QTcpSocket::connected, this, [control]() {
+        // Version 5, one method: no authentication.
+        control->write(QByteArray::fromHex("050100"));
+    });
+    connect(control, &QTcpSocket::readyRead, this, &UdpProbe::onControlReadyRead);
+    connect(control, &QTcpSocket::errorOccurred, this, [this, control](QAbstractSocket::SocketError) {
+        if (m_control != control || !m_running) {
+            return;
+        }
+        // The association ends with the control connection.
+        finish(m_relayPort == 0
+                   ? QStringLiteral("SOCKS5 connection failed: %1").arg(control->errorString())
+                   : QStringLiteral("SOCKS5 proxy closed the UDP association."));
+    });
+    control->connectToHost(m_options.socksHost.trimmed(), m_options.socksPort);
+}
+
+void UdpProbe::onControlReadyRead()
+{
+    if (!m_control || !m_running) {
+        return;
+    }
+    m_controlBuffer += m_control->readAll();
+
+    if (!m_greeted) {
+        if (m_controlBuffer.size() < 2) {
+            return;
+        }
+        if (m_controlBuffer.at(0) != 0x05) {
+            finish(QStringLiteral("Local proxy is not a SOCKS5 server."));
+            return;
+        }
+        if (m_controlBuffer.at(1) != 0x00) {
+            finish(QStringLiteral("SOCKS5 proxy requires authentication."));
+            return;
+        }
+        m_controlBuffer.remove(0, 2);
+        m_greeted = true;
+
+        // UDP ASSOCIATE from any address on the probe socket's port.
+        QByteArray request = QByteArray::fromHex("0503000100000000");
+        char port[2];
+        qToBigEndian<quint16>(m_socket.localPort(), port);
+        request.append(port, 2);
+        m_control->write(request);
+    }
+
+    if (m_relayPort != 0 || m_controlBuffer.size() < 4) {
+        return;
+    }
+    if (m_controlBuffer.at(0) != 0x05) {
+        finish(QStringLiteral("Malformed SOCKS5 reply."));
+        return;
+    }
+    const int reply = static_cast<quint8>(m_controlBuffer.at(1));
+    if (reply != 0) {
+        finish(QStringLiteral("SOCKS5 proxy refused UDP ASSOCIATE (code %1).").arg(reply));
+        return;
+    }
+    qsizetype addressLength = 0;
+    switch (static_cast<quint8>(m_controlBuffer.at(3))) {
+    case 0x01:
+        addressLength = 4;
+        break;
+    case 0x04:
+        addressLength = 16;
+        break;
+    case 0x03:
+        if (m_controlBuffer.size() < 5) {
+            return;
+        }
+        addressLength = 1 + static_cast<quint8>(m_controlBuffer.at(4));
+        break;
+    default:
+        finish(QStringLiteral("Malformed SOCKS5 reply."));
+        return;
+    }
+    if (m_controlBuffer.size() < 4 + addressLength + 2) {
+        return;
+    }
+
+    QHostAddress relay;
+    const auto *bytes = reinterpret_cast<const uchar *>(m_controlBuffer.constData());
+    if (addressLength == 4) {
+        relay.setAddress(qFromBigEndian<quint32>(bytes + 4));
+    } else if (addressLength == 16) {
+        relay.setAddress(bytes + 4);
+    }
+    const quint16 relayPort = qFromBigEndian<quint16>(bytes + 4 + addressLength);
+    m_controlBuffer.clear();
+    // An unspecified or named relay means "the address you reached me on".
+    if (relay.isNull() || relay == QHostAddress::AnyIPv4 || relay == QHostAddress::AnyIPv6) {
+        relay = m_control->peerAddress();
+    }
+    if (relayPort == 0) {
+        finish(QStringLiteral("SOCKS5 proxy returned no UDP relay port."));
+        return;
+    }
+    startTrain(relay, relayPort);
+}
+
+void UdpProbe::startTrain(const QHostAddress& relay, quint16 relayPort)
+{
+    m_relay = relay;
+    m_relayPort = relayPort;
+    m_deadline.stop();
+    m_clock.start();
+    m_sendTimer.start(m_options.intervalMs);
+    sendNext();
+}
+
+void UdpProbe::sendNext()
+{
+    if (!m_running) {
+        return;
+    }
+    const auto sequence = static_cast<quint32>(m_result.sent);
+    const QByteArray payload = encodeRequest(sequence);
+    m_sentAtNs.append(m_clock.nsecsElapsed());
+    m_answered.append(false);
+    const qint64 written = m_socket.writeDatagram(
+        m_options.socksPort > 0 ? wrapSocks(payload) : payload,
+        m_relay,
+        m_relayPort);
+    if (written < 0 && m_result.sent == 0) {
+        finish(QStringLiteral("Cannot send datagram: %1").arg(m_socket.errorString()));
+        return;
+    }
+    // A later send error is a local drop and counts as loss.
+    ++m_result.sent;
+
+    if (m_result.sent >= m_options.count) {
+        m_sendTimer.stop();
+        m_deadline.start(m_options.timeoutMs);
+    }
+}
+
+void UdpProbe::onReadyRead()
+{
+    while (m_socket.hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket.receiveDatagram();
+        if (!m_running || !datagram.isValid()) {
+            continue;
+        }
+        const QByteArray data = datagram.data();
+        if (m_options.socksPort <= 0) {
+            handleReply(data);
+            continue;
+        }
+        const qsizetype headerLength = socksHeaderLength(data);
+        if (headerLength > 0) {
+            handleReply(data.mid(headerLength));
+        }
+    }
+}
+
+void UdpProbe::handleReply(const QByteArray& payload)
+{
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    const auto *bytes = reinterpret_cast<const uchar *>(payload.constData());
+
+    qint64 sequence = -1;
+    if (m_options.responder == Responder::Echo) {
+        if (payload.size() < kEchoHeaderBytes || !payload.startsWith(kEchoMagic)) {
+            return;
+        }
+        sequence = qFromBigEndian<quint32>(bytes + 4);
+    } else {
+        // Header of a response (QR set) to one of our queries.
+        if (payload.size() < 12 || (bytes[2] & 0x80) == 0) {
+            return;
+        }
+        sequence = static_cast<quint16>(qFromBigEndian<quint16>(bytes) - m_dnsIdBase);
+    }
+    if (sequence < 0 || sequence >= m_sentAtNs.size()) {
+        return;
+    }
+    if (m_answered.at(sequence)) {
+        ++m_result.duplicates;
+        return;
+    }
+    m_answered[sequence] = true;
+    ++m_result.received;
+
+    const double transitMs = static_cast<double>(nowNs - m_sentAtNs.at(sequence)) / 1.0e6;
+    m_rttMs.append(transitMs);
+    if (sequence < m_highestSequence) {
+        ++m_result.reordered;
+    } else {
+        m_highestSequence = sequence;
+    }
+    // RFC 3550 section 6.4.1, in arrival order.
+    if (m_lastTransitMs >= 0.0) {
+        const double difference = std::abs(transitMs - m_lastTransitMs);
+        const double jitter = qMax(0.0, m_result.jitterMs);
+        m_result.jitterMs = jitter + (difference - jitter) / 16.0;
+    }
+    m_lastTransitMs = transitMs;
+
+    if (m_result.sent >= m_options.count && m_result.received >= m_result.sent) {
+        finish();
+    }
+}
+
+QByteArray UdpProbe::encodeRequest(quint32 sequence) const
+{
+    if (m_options.responder == Responder::Dns) {
+        QByteArray query;
+        query.reserve(32);
+        char header[12] = {};
+        qToBigEndian<quint16>(static_cast<quint16>(m_dnsIdBase + sequence), header);
+        header[2] = 0x01; // Recursion desired.
+        header[5] = 0x01; // One question.
+        query.append(header, sizeof(header));
+        for (const QByteArray& label : QByteArray(kDnsProbeName).split('.')) {
+            query.append(static_cast<char>(label.size()));
+            query.append(label);
+        }
+        // Root label, type A, class IN.
+        query.append(QByteArray::fromHex("0000010001"));
+        return query;
+    }
+
+    QByteArray datagram(m_options.payloadBytes, '\0');
+    std::memcpy(datagram.data(), kEchoMagic, 4);
+    qToBigEndian<quint32>(sequence, datagram.data() + 4);
+    qToBigEndian<quint64>(static_cast<quint64>(m_clock.nsecsElapsed()), datagram.data() + 8);
+    return datagram;
+}
+
+QByteArray UdpProbe::wrapSocks(const QByteArray& payload) const
+{
+    QByteArray datagram;
+    datagram.reserve(payload.size() + 32);
+    datagram.append(QByteArray::fromHex("000000"));
+
+    const QHostAddress address(m_options.host);
+    if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+        char ipv4[4];
+        qToBigEndian<quint32>(address.toIPv4Address(), ipv4);
+        datagram.append('\x01');
+        datagram.append(ipv4, 4);
+    } else if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+        const Q_IPV6ADDR ipv6 = address.toIPv6Address();
+        datagram.append('\x04');
+        datagram.append(reinterpret_cast<const char *>(ipv6.c), 16);
+    } else {
+        // The proxy resolves the name, so nothing leaks to the local resolver.
+        const QByteArray name = QUrl::toAce(m_options.host).left(255);
+        datagram.append('\x03');
+        datagram.append(static_cast<char>(name.size()));
+        datagram.append(name);
+    }
+    char port[2];
+    qToBigEndian<quint16>(m_options.port, port);
+    datagram.append(port, 2);
+    datagram.append(payload);
+    return datagram;
+}
+
+void UdpProbe::finish(const QString& error)
+{
+    if (!m_running) {
+        return;
+    }
+    stop();
+
+    if (m_result.sent > 0) {
+        m_result.lossPct = qBound(
+            0.0,
+            static_cast<double>(m_result.sent - m_result.received) * 100.0 / static_cast<double>(m_result.sent),
+            100.0);
+    }
+    if (m_result.received > 0) {
+        m_result.reorderPct =
+            static_cast<double>(m_result.reordered) * 100.0 / static_cast<double>(m_result.received);
+    }
+    QList<double> sorted = m_rttMs;
+    std::sort(sorted.begin(), sorted.end());
+    m_result.rttMinMs = sorted.isEmpty() ? -1.0 : sorted.constFirst();
+    m_result.rttMedianMs = percentileOf(sorted, 50.0);
+    m_result.rttP95Ms = percentileOf(sorted, 95.0);
+
+    QString failure = error;
+    if (failure.isEmpty() && m_result.sent > 0 && m_result.received == 0) {
+        failure = QStringLiteral("No datagram was answered.");
+    }
+    m_result.error = failure;
+    emit finished(failure.isEmpty(), failure);
+}
@@ -0,0 +1,245 @@
+/*!
+ * @file        udpprobe.cppm
+ * @brief       UDP round-trip probe for latency, jitter, loss and reordering.
+ *
+ * @details
+ * TCP connect probes cannot see packet loss: a lost SYN is retransmitted and
+ * only shows up as a slow sample. UdpProbe sends a train of sequence-numbered,
+ * timestamped datagrams at a fixed interval and matches the replies, so a
+ * missing reply is a lost datagram, a reply older than the newest one seen is
+ * reordered, and the spread of the round-trip times is the jitter (the
+ * RFC 3550 interarrival estimator applied to the round trip).
+ *
+ * Through the tunnel the datagrams travel over a SOCKS5 UDP ASSOCIATE of the
+ * local mixed inbound; in TUN mode or for loopback tests they are sent
+ * directly. The responder is either an echo service, which returns each
+ * datagram unchanged, or a DNS resolver, which answers one query per
+ * datagram and carries the sequence number in the query id.
+ *
+ * UdpEchoServer is the echo service on `127.0.0.1`, used by the loopback
+ * benchmark and anywhere a responder under local control is needed.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVariantMap>
+
+#include <atomic>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.udpprobe;
+#endif
+
+#ifdef Q_MOC_RUN
+#define GENYCONNECT_MODULE_EXPORT
+#else
+#define GENYCONNECT_MODULE_EXPORT export
+#endif
+
+/**
+ * @struct UdpProbeResult
+ * @brief Outcome of one datagram train.
+ */
+GENYCONNECT_MODULE_EXPORT struct UdpProbeResult {
+    int sent = 0;                //!< Datagrams sent.
+    int received = 0;            //!< Distinct datagrams answered within the timeout.
+    int reordered = 0;           //!< Replies that arrived after a later datagram's reply.
+    int duplicates = 0;          //!< Replies for a datagram already answered.
+    double lossPct = 0.0;        //!< Unanswered share of sent datagrams.
+    double reorderPct = 0.0;     //!< Reordered share of received datagrams.
+    double rttMinMs = -1.0;      //!< Fastest round trip.
+    double rttMedianMs = -1.0;   //!< Median round trip.
+    double rttP95Ms = -1.0;      //!< 95th percentile round trip.
+    double jitterMs = -1.0;      //!< RFC 3550 interarrival jitter of the round trip.
+    QString error;               //!< Failure description, empty when the train ran.
+
+    /**
+     * @brief Whether the train measured anything.
+     * @return True when at least one datagram was answered.
+     */
+    bool measured() const;
+
+    /**
+     * @brief Serialize result to JSON.
+     * @return JSON object.
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Convert result to a QML-friendly map.
+     * @return Variant map with the JSON keys.
+     */
+    QVariantMap toVariantMap() const;
+};
+
+/**
+ * @class UdpEchoServer
+ * @brief Returns every datagram to its sender on `127.0.0.1`.
+ */
+GENYCONNECT_MODULE_EXPORT class UdpEchoServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Construct a stopped server.
+     * @param parent Optional QObject parent.
+     */
+    explicit UdpEchoServer(QObject *parent = nullptr);
+    ~UdpEchoServer() override;
+
+    /**
+     * @brief Bind an ephemeral loopback port.
+     * @param errorMessage Optional output message on failure.
+     * @return True when bound.
+     */
+    bool start(QString *errorMessage = nullptr);
+
+    /**
+     * @brief Close the socket.
+     */
+    void stop();
+
+    /**
+     * @brief Bound port.
+     * @return Port, 0 when stopped.
+     */
+    quint16 port() const;
+
+    /**
+     * @brief Datagrams returned since start().
+     * @return Datagram count; safe to read from any thread.
+     */
+    qint64 echoedDatagrams() const;
+
+private:
+    void onReadyRead();
+
+    QUdpSocket *m_socket = nullptr;                  //!< Loopback socket.
+    std::atomic<quint16> m_port {0};                 //!< Bound port.
+    std::atomic<qint64> m_echoed {0};                //!< Datagrams returned.
+};
+
+/**
+ * @class UdpProbe
+ * @brief Sends one datagram train and measures the replies.
+ */
+GENYCONNECT_MODULE_EXPORT class UdpProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @enum Responder
+     * @brief Service that answers the datagrams.
+     */
+    enum class Responder {
+        Echo,   //!< Returns each datagram unchanged.
+        Dns     //!< Answers a DNS query; the query id carries the sequence number.
+    };
+
+    /**
+     * @struct Options
+     * @brief Target, path and train shape.
+     */
+    struct Options {
+        QString host;                     //!< Responder address or host name.
+        quint16 port = 0;                 //!< Responder port.
+        Responder responder = Responder::Echo; //!< Kind of responder.
+        QString socksHost = QStringLiteral("127.0.0.1"); //!< SOCKS5 server offering UDP ASSOCIATE.
+        quint16 socksPort = 0;            //!< SOCKS5 port; 0 sends directly.
+        int count = 50;                   //!< Datagrams in the train.
+        int intervalMs = 20;              //!< Gap between datagrams.
+        int timeoutMs = 1000;             //!< Wait for replies after the last datagram.
+        int payloadBytes = 64;            //!< Echo datagram size.
+    };
+
+    /**
+     * @brief Construct probe.
+     * @param parent Optional QObject parent.
+     */
+    explicit UdpProbe(QObject *parent = nullptr);
+    ~UdpProbe() override;
+
+    /**
+     * @brief Start a train; a running train is stopped first.
+     * @param options Target, path and train shape.
+     * @param errorMessage Optional output message on invalid options.
+     * @return True when the train started; finished() follows.
+     */
+    bool start(const Options& options, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Abort the train without emitting finished().
+     */
+    void stop();
+
+    /**
+     * @brief Whether a train is running.
+     * @return True between start() and finished()/stop().
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Result of the last train.
+     * @return Result; partial while running.
+     */
+    const UdpProbeResult& result() const;
+
+signals:
+    /**
+     * @brief Emitted once per train.
+     * @param ok True when at least one datagram was answered.
+     * @param error Failure description when @p ok is false.
+     */
+    void finished(bool ok, const QString& error);
+
+private:
+    void resolveTarget();
+    void openAssociation();
+    void onControlReadyRead();
+    void startTrain(const QHostAddress& relay, quint16 relayPort);
+    void sendNext();
+    void onReadyRead();
+    void handleReply(const QByteArray& payload);
+    QByteArray encodeRequest(quint32 sequence) const;
+    QByteArray wrapSocks(const QByteArray& payload) const;
+    void finish(const QString& error = QString());
+
+    Options m_options;                               //!< Options of the current train.
+    UdpProbeResult m_result;                         //!< Result of the current train.
+    QPointer<QTcpSocket> m_control;                  //!< SOCKS5 control connection; holds the association.
+    QByteArray m_controlBuffer;                      //!< Unparsed SOCKS5 reply bytes.
+    bool m_greeted = false;                          //!< SOCKS5 method negotiation done.
+    QUdpSocket m_socket;                             //!< Datagram socket.
+    QHostAddress m_relay;                            //!< Where datagrams are sent.
+    quint16 m_relayPort = 0;                         //!< Port datagrams are sent to.
+    QTimer m_sendTimer;                              //!< Paces the train.
+    QTimer m_deadline;                               //!< Handshake and reply timeout.
+    QElapsedTimer m_clock;                           //!< Time base of the send timestamps.
+    QList<qint64> m_sentAtNs;                        //!< Send time per sequence number.
+    QList<bool> m_answered;                          //!< Reply seen per sequence number.
+    QList<double> m_rttMs;                           //!< Round trips in arrival order.
+    qint64 m_highestSequence = -1;                   //!< Newest sequence number answered.
+    double m_lastTransitMs = -1.0;                   //!< Round trip of the previous reply.
+    quint16 m_dnsIdBase = 0;                         //!< Random base of the DNS query ids.
+    quint64 m_generation = 0;                        //!< Invalidates lookups of earlier trains.
+    bool m_running = false;                          //!< Train in progress.
+};
+
+#include "udpprobe.moc"
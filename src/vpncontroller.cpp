@@ -1,6 +1,7 @@
 module;
 #include <QAbstractItemModel>
 #include <QClipboard>
+#include <QCryptographicHash>
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
@@ -42,7 +43,9 @@ module;
 #include <cmath>
 #include <cerrno>
 #include <cstring>
+#include <optional>
 #include <string>
+#include <utility>
 
 #if defined(Q_OS_WIN)
 extern "C" {
@@ -68,10 +71,28 @@ extern "C" {
 module genyconnect.backend.vpncontroller;
 
 import genyconnect.backend.linkparser;
+import genyconnect.backend.profilestore;
+import genyconnect.backend.routingrulecompiler;
+import genyconnect.backend.ruleassets;
 
 namespace {
 constexpr int kMaxLogLines = 200;
+constexpr int kMaxReportedRuleConflicts = 10;
+constexpr int kInlineRuleLimit = 1000;
+constexpr int kRuleSourceFetchTimeoutMs = 30000;
+constexpr int kRuleSourceRefreshIntervalMs = 12 * 60 * 60 * 1000;
+constexpr int kRuleSourceStartupRefreshDelayMs = 5000;
+constexpr qint64 kRuleSourceMaxBytes = 64LL * 1024 * 1024;
+constexpr char kProfilesStore[] = "profiles";
+constexpr char kSubscriptionsStore[] = "subscriptions";
+constexpr char kProfileUsageStore[] = "profile usage";
+constexpr char kSpeedTestHistoryStore[] = "speed test history";
+constexpr char kSettingsStore[] = "settings";
+// Profiles shown from the startup cache: about one screen of the list.
+constexpr qsizetype kStartupProfileCacheSize = 50;
 constexpr int kSpeedTestTickIntervalMs = 100;
+// Publishes the snapshot when no frame arrives, e.g. while the window is hidden.
+constexpr int kSpeedTestSnapshotFallbackMs = 100;
 constexpr int kSpeedTestHistoryMaxItems = 20;
 constexpr qint64 kSpeedTestUploadPayloadBytes = 8 * 1024 * 1024;
 constexpr int kSpeedTestSamplingWindowMs = 280;
@@ -79,28 +100,45 @@ constexpr int kSpeedTestWarmupMs = 1200;
 constexpr int kSpeedTestLatencyProbeCount = 8;
 constexpr int kSpeedTestLatencyProbeTimeoutMs = 1800;
 constexpr int kSpeedTestLatencyProbeGapMs = 120;
+// UDP train of the latency phase: 50 datagrams over one second. A DNS resolver
+// is the responder, since public echo services are rare and often filtered.
+constexpr int kSpeedTestUdpProbeCount = 50;
+constexpr int kSpeedTestUdpProbeIntervalMs = 20;
+constexpr int kSpeedTestUdpProbeTimeoutMs = 1000;
+constexpr char kSpeedTestUdpProbeHost[] = "1.1.1.1";
+constexpr quint16 kSpeedTestUdpProbePort = 53;
+constexpr int kSpeedTestLoadedProbeIntervalMs = 250;
+constexpr int kSpeedTestLoadedProbeMaxInFlight = 2;
 constexpr int kSpeedTestMinimumSizeMb = 5;
 constexpr int kSpeedTestDefaultSizeMb = 10;
 constexpr int kSpeedTestMaximumSizeMb = 25;
 constexpr int kSpeedTestDownloadTimeoutBaseMs = 14000;
 constexpr int kSpeedTestDownloadTimeoutPerMbMs = 1200;
 constexpr int kSpeedTestNoProgressTimeoutMs = 14000;
-constexpr int kSpeedTestUploadResponseIdleFinalizeMs = 1500;
-constexpr double kSpeedTestDownloadCompletionRatio = 0.92;
+constexpr double kSpeedTestPhaseCompletionRatio = 0.92;
+// Tiny response on a host apart from the speed-test endpoints, so probes do not
+// queue behind transfer connections.
+constexpr const char *kLatencyProbeEndpoint = "https://cp.cloudflare.com/generate_204";
 constexpr int kProfilePingTimeoutMs = 3200;
 constexpr int kProfilePingStaggerMs = 140;
 constexpr int kSubscriptionFetchTimeoutMs = 15000;
+constexpr int kSubscriptionFetchConcurrency = 6;
+constexpr int kSubscriptionFetchPerHost = 2;
+constexpr int kSubscriptionFetchAttempts = 3;
 constexpr const char kDefaultProfileGroup[] = "General";
 constexpr int kProxySelfCheckMaxAttempts = 4;
 constexpr int kProxySelfCheckRetryDelayMs = 700;
-constexpr int kMaxPrivilegedTunLogLinesPerTick = 64;
-constexpr int kMaxPrivilegedTunLogBufferBytes = 512 * 1024;
-constexpr int kPrivilegedTunLogBufferKeepBytes = 256 * 1024;
 constexpr int kProfileUsageSaveDelayMs = 2500;
 constexpr int kPublicIpTimeoutMs = 6500;
 constexpr int kPublicIpRetryDelayMs = 2200;
 constexpr const char kPublicIpEndpoint[] = "https://api.ipify.org?format=text";
 constexpr const char kManagedRuntimeRecordFile[] = "managed-runtime.json";
+constexpr int kMaxCachedXrayBinaries = 4;
+constexpr int kTunTxQueueLen = 1000;
+constexpr int kTunPathMtuProbeLow = 1280;
+constexpr int kTunPathMtuProbeHigh = 1500;
+constexpr int kTunPathMtuProbeTimeoutMs = 2500;
+constexpr qint64 kTunPathMtuProbeMaxAgeSecs = 24 * 60 * 60;
 
 struct ProxyApplyResult {
     bool enable = false;
@@ -150,63 +188,6 @@ void addUsageToBucket(QJsonObject *profileUsageObject,
     profileUsageObject->insert(bucketName, buckets);
 }
 
-QByteArray decodeFlexibleBase64(const QByteArray& rawInput)
-{
-    QByteArray raw = rawInput.trimmed();
-    raw.replace('-', '+');
-    raw.replace('_', '/');
-    const int padding = raw.size() % 4;
-    if (padding > 0) {
-        raw.append(QByteArray(4 - padding, '='));
-    }
-
-    QByteArray decoded = QByteArray::fromBase64(raw, QByteArray::AbortOnBase64DecodingErrors);
-    if (!decoded.isEmpty()) {
-        return decoded;
-    }
-
-    return QByteArray::fromBase64(rawInput.trimmed(), QByteArray::AbortOnBase64DecodingErrors);
-}
-
-QStringList extractShareLinks(const QString& text)
-{
-    QStringList links;
-    const QString normalized = text;
-    const QStringList lines = normalized.split(QRegularExpression(QStringLiteral("[\\r\\n]+")), Qt::SkipEmptyParts);
-    for (QString line : lines) {
-        line = line.trimmed();
-        if (line.isEmpty()) {
-            continue;
-        }
-
-        const QStringList tokens = line.split(QRegularExpression(QStringLiteral("[\\s,]+")), Qt::SkipEmptyParts);
-        for (const QString& token : tokens) {
-            const QString candidate = token.trimmed();
-            if (candidate.startsWith(QStringLiteral("vmess://"), Qt::CaseInsensitive)
-                || candidate.startsWith(QStringLiteral("vless://"), Qt::CaseInsensitive)) {
-                links.append(candidate);
-            }
-        }
-    }
-    links.removeDuplicates();
-    return links;
-}
-
-QStringList extractSubscriptionLinks(const QByteArray& payload)
-{
-    const QString plain = QString::fromUtf8(payload).trimmed();
-    QStringList links = extractShareLinks(plain);
-    if (!links.isEmpty()) {
-        return links;
-    }
-
-    const QByteArray decoded = decodeFlexibleBase64(payload);
-    if (decoded.isEmpty()) {
-        return {};
-    }
-    return extractShareLinks(QString::fromUtf8(decoded));
-}
-
 QString createSubscriptionId()
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
@@ -251,246 +232,50 @@ QString normalizeSubscriptionNameValue(const QString& rawName, const QString& fa
     return trimmed.isEmpty() ? deriveSubscriptionNameFromUrl(fallbackUrl) : trimmed;
 }
 
-bool isNoisyTrafficLine(const QString& line)
-{
-    if (!line.contains(QStringLiteral(" accepted "))) {
-        return false;
-    }
-    // Drop high-frequency link-local broadcast noise in TUN mode
-    // (for example: udp:* -> 169.254.255.255:137 [tun-in -> direct]),
-    // which can flood logs and stall UI updates.
-    if (line.contains(QStringLiteral("[tun-in -> direct]"))
-        && (line.contains(QStringLiteral("udp:169.254.255.255:137"))
-            || line.contains(QStringLiteral("udp:255.255.255.255:137"))
-            || line.contains(QStringLiteral("udp:169.254.255.255:138"))
-            || line.contains(QStringLiteral("udp:255.255.255.255:138"))
-            || line.contains(QStringLiteral("from tcp:169.254."))
-            || line.contains(QStringLiteral("from udp:169.254."))
-            || line.contains(QStringLiteral("udp:224.")))) {
-        return true;
-    }
-    // Keep tun-in traffic visible for diagnostics; suppress only noisy local-proxy chatter.
-    if (line.contains(QStringLiteral("[tun-in ->"))) {
-        return false;
-    }
-    return line.contains(QStringLiteral(">> proxy"))
-           || line.contains(QStringLiteral("socks ->"))
-           || line.contains(QStringLiteral("mixed-in ->"));
-}
-
-bool ruleHasInboundTag(const QJsonObject& rule, const QString& inboundTag)
+bool isRemoteRuleSource(const QString& location)
 {
-    const QJsonArray tags = rule.value(QStringLiteral("inboundTag")).toArray();
-    for (const QJsonValue& value : tags) {
-        if (value.toString().compare(inboundTag, Qt::CaseInsensitive) == 0) {
-            return true;
-        }
-    }
-    return false;
+    const QString scheme = QUrl(location.trimmed()).scheme().toLower();
+    return scheme == QStringLiteral("http") || scheme == QStringLiteral("https");
 }
 
-bool ruleHasIp(const QJsonObject& rule, const QString& ipCidr)
+QString localRuleSourcePath(const QString& location)
 {
-    const QJsonArray ips = rule.value(QStringLiteral("ip")).toArray();
-    for (const QJsonValue& value : ips) {
-        if (value.toString().compare(ipCidr, Qt::CaseInsensitive) == 0) {
-            return true;
-        }
-    }
-    return false;
+    const QUrl url(location.trimmed());
+    return url.isLocalFile() ? url.toLocalFile() : location.trimmed();
 }
 
-void ensureTunNoiseBlockRules(QJsonObject* config)
+// Runs on the worker pool: inline rules come first, then each source's
+// entries in source order, as the lists were always assembled.
+RoutingRuleCompiler::Result compileRoutingRuleInputs(
+    QStringList blockEntries,
+    QStringList directEntries,
+    QStringList proxyEntries,
+    const QList<QPair<QString, QString>>& sourceFiles)
 {
-    if (config == nullptr) {
-        return;
-    }
-
-    QJsonObject routing = config->value(QStringLiteral("routing")).toObject();
-    QJsonArray rules = routing.value(QStringLiteral("rules")).toArray();
-    if (rules.isEmpty()) {
-        return;
-    }
-
-    bool hasUdpPortNoiseBlock = false;
-    bool hasLinkLocalNoiseBlock = false;
-    bool directPrivateRuleScoped = false;
-    for (int i = 0; i < rules.size(); ++i) {
-        QJsonObject rule = rules.at(i).toObject();
-        if (rule.value(QStringLiteral("outboundTag")).toString() != QStringLiteral("direct")) {
-            continue;
-        }
-        const QJsonArray ips = rule.value(QStringLiteral("ip")).toArray();
-        bool looksLikePrivateDirect = false;
-        for (const QJsonValue& ip : ips) {
-            const QString cidr = ip.toString();
-            if (cidr == QStringLiteral("10.0.0.0/8")
-                || cidr == QStringLiteral("100.64.0.0/10")
-                || cidr == QStringLiteral("127.0.0.0/8")
-                || cidr == QStringLiteral("169.254.0.0/16")
-                || cidr == QStringLiteral("172.16.0.0/12")
-                || cidr == QStringLiteral("192.168.0.0/16")) {
-                looksLikePrivateDirect = true;
-                break;
-            }
-        }
-        if (!looksLikePrivateDirect) {
-            continue;
-        }
-
-        const QJsonArray inboundTags = rule.value(QStringLiteral("inboundTag")).toArray();
-        bool onlyMixedIn = (inboundTags.size() == 1
-                            && inboundTags.first().toString().compare(QStringLiteral("mixed-in"), Qt::CaseInsensitive) == 0);
-        if (!onlyMixedIn) {
-            rule.insert(QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("mixed-in")});
-            rules[i] = rule;
-        }
-        directPrivateRuleScoped = true;
-    }
-    for (const QJsonValue& value : rules) {
-        const QJsonObject rule = value.toObject();
-        if (rule.value(QStringLiteral("outboundTag")).toString() != QStringLiteral("block")) {
+    for (const auto& [target, path] : sourceFiles) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
             continue;
         }
-        if (!ruleHasInboundTag(rule, QStringLiteral("tun-in"))) {
-            continue;
-        }
-        if (rule.value(QStringLiteral("network")).toString() == QStringLiteral("udp")
-            && rule.value(QStringLiteral("port")).toString().contains(QStringLiteral("137"))) {
-            hasUdpPortNoiseBlock = true;
-        }
-        if (rule.value(QStringLiteral("network")).toString() == QStringLiteral("udp")
-            && (ruleHasIp(rule, QStringLiteral("169.254.0.0/16"))
-                || ruleHasIp(rule, QStringLiteral("255.255.255.255/32"))
-                || ruleHasIp(rule, QStringLiteral("224.0.0.0/4")))) {
-            hasLinkLocalNoiseBlock = true;
-        }
-    }
-
-    QJsonArray prefix;
-    if (!hasUdpPortNoiseBlock) {
-        prefix.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("udp")},
-            {QStringLiteral("port"), QStringLiteral("137,138,5353,5355")},
-            {QStringLiteral("outboundTag"), QStringLiteral("block")}
-        });
-    }
-    if (!hasLinkLocalNoiseBlock) {
-        prefix.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("udp")},
-            {QStringLiteral("ip"), QJsonArray {
-                QStringLiteral("169.254.0.0/16"),
-                QStringLiteral("255.255.255.255/32"),
-                QStringLiteral("224.0.0.0/4")
-            }},
-            {QStringLiteral("outboundTag"), QStringLiteral("block")}
-        });
-    }
-
-    if (!prefix.isEmpty()) {
-        for (const QJsonValue& value : rules) {
-            prefix.append(value);
+        const QStringList entries = RuleAssets::parseRuleList(file.readAll());
+        if (target == QStringLiteral("block")) {
+            blockEntries.append(entries);
+        } else if (target == QStringLiteral("direct")) {
+            directEntries.append(entries);
+        } else {
+            proxyEntries.append(entries);
         }
-        routing.insert(QStringLiteral("rules"), prefix);
-        config->insert(QStringLiteral("routing"), routing);
-        return;
-    }
-
-    if (directPrivateRuleScoped) {
-        routing.insert(QStringLiteral("rules"), rules);
-        config->insert(QStringLiteral("routing"), routing);
-    }
-}
-
-bool hasRulePort53ToDnsOutForTun(const QJsonObject& rule)
-{
-    if (rule.value(QStringLiteral("outboundTag")).toString() != QStringLiteral("dns-out")) {
-        return false;
     }
-    if (!ruleHasInboundTag(rule, QStringLiteral("tun-in"))) {
-        return false;
-    }
-    const QString port = rule.value(QStringLiteral("port")).toString();
-    return port.contains(QStringLiteral("53"));
+    return RoutingRuleCompiler::compile(blockEntries, directEntries, proxyEntries);
 }
 
-void ensureTunDnsSupport(QJsonObject* config, const QStringList& dnsServers)
+QString normalizedRuleTarget(const QString& target)
 {
-    if (config == nullptr) {
-        return;
-    }
-
-    QJsonArray outbounds = config->value(QStringLiteral("outbounds")).toArray();
-    bool hasDnsOut = false;
-    for (const QJsonValue& value : outbounds) {
-        const QJsonObject outbound = value.toObject();
-        if (outbound.value(QStringLiteral("tag")).toString() == QStringLiteral("dns-out")
-            && outbound.value(QStringLiteral("protocol")).toString() == QStringLiteral("dns")) {
-            hasDnsOut = true;
-            break;
-        }
-    }
-    if (!hasDnsOut) {
-        outbounds.append(QJsonObject {
-            {QStringLiteral("tag"), QStringLiteral("dns-out")},
-            {QStringLiteral("protocol"), QStringLiteral("dns")},
-            {QStringLiteral("settings"), QJsonObject {}}
-        });
-        config->insert(QStringLiteral("outbounds"), outbounds);
-    }
-
-    QJsonObject dns = config->value(QStringLiteral("dns")).toObject();
-    QJsonArray serverArray;
-    for (const QString& server : dnsServers) {
-        const QString trimmed = server.trimmed();
-        if (!trimmed.isEmpty()) {
-            serverArray.append(trimmed);
-        }
-    }
-    if (serverArray.isEmpty()) {
-        serverArray = QJsonArray {
-            QStringLiteral("1.1.1.1"),
-            QStringLiteral("8.8.8.8"),
-            QStringLiteral("9.9.9.9")
-        };
-    }
-    dns.insert(QStringLiteral("servers"), serverArray);
-    const QString queryStrategy = dns.value(QStringLiteral("queryStrategy")).toString().trimmed();
-    if (queryStrategy.isEmpty()
-        || queryStrategy.compare(QStringLiteral("UseIPv4"), Qt::CaseInsensitive) == 0) {
-        dns.insert(QStringLiteral("queryStrategy"), QStringLiteral("UseIP"));
-    }
-    config->insert(QStringLiteral("dns"), dns);
-
-    QJsonObject routing = config->value(QStringLiteral("routing")).toObject();
-    QJsonArray rules = routing.value(QStringLiteral("rules")).toArray();
-    bool hasTunDnsRule = false;
-    for (const QJsonValue& value : rules) {
-        if (hasRulePort53ToDnsOutForTun(value.toObject())) {
-            hasTunDnsRule = true;
-            break;
-        }
-    }
-
-    if (!hasTunDnsRule) {
-        QJsonArray prefixedRules;
-        prefixedRules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("tcp,udp")},
-            {QStringLiteral("port"), QStringLiteral("53")},
-            {QStringLiteral("outboundTag"), QStringLiteral("dns-out")}
-        });
-        for (const QJsonValue& value : rules) {
-            prefixedRules.append(value);
-        }
-        routing.insert(QStringLiteral("rules"), prefixedRules);
-        config->insert(QStringLiteral("routing"), routing);
+    const QString value = target.trimmed().toLower();
+    if (value == QStringLiteral("proxy") || value == QStringLiteral("direct") || value == QStringLiteral("block")) {
+        return value;
     }
+    return {};
 }
 
 QList<QUrl> speedTestPingUrls()
@@ -537,12 +322,35 @@ QUrl speedTestUrlForPhase(const QString& phase, int attempt)
     return {};
 }
 
-QByteArray buildUploadPayload()
+// Same score the tuner gave the candidate: latency under load when it was sampled.
+double batchSpeedTestScore(const SpeedTestResult& result)
 {
-    QByteArray payload;
-    payload.resize(kSpeedTestUploadPayloadBytes);
-    payload.fill('x');
-    return payload;
+    const int latencyMs = result.bufferbloatMs >= 0 ? result.pingMs + result.bufferbloatMs : result.pingMs;
+    return TransportTuner::score(result.downloadMbps, latencyMs);
+}
+
+QString bufferbloatGradeForIncrease(int increaseMs)
+{
+    if (increaseMs < 0) {
+        return {};
+    }
+    // Thresholds follow the common bufferbloat grading used by public tests.
+    if (increaseMs < 5) {
+        return QStringLiteral("A+");
+    }
+    if (increaseMs < 30) {
+        return QStringLiteral("A");
+    }
+    if (increaseMs < 60) {
+        return QStringLiteral("B");
+    }
+    if (increaseMs < 200) {
+        return QStringLiteral("C");
+    }
+    if (increaseMs < 400) {
+        return QStringLiteral("D");
+    }
+    return QStringLiteral("F");
 }
 
 double mbpsFromBytes(qint64 bytes, qint64 elapsedMs)
@@ -610,6 +418,86 @@ bool checkLocalProxyConnectivitySync(quint16 socksPort, QString *errorMessage)
     return ok;
 }
 
+bool pingWithDontFragment(const QString& ipv4, int packetSize)
+{
+    // ICMP echo: 20 byte IPv4 header + 8 byte ICMP header around the payload.
+    const QString payload = QString::number(packetSize - 28);
+    QProcess process;
+#if defined(Q_OS_WIN)
+    process.start(QStringLiteral("ping"),
+                  {QStringLiteral("-n"), QStringLiteral("1"), QStringLiteral("-w"), QStringLiteral("1000"),
+                   QStringLiteral("-f"), QStringLiteral("-l"), payload, ipv4});
+#elif defined(Q_OS_MACOS)
+    process.start(QStringLiteral("/sbin/ping"),
+                  {QStringLiteral("-n"), QStringLiteral("-c"), QStringLiteral("1"), QStringLiteral("-t"), QStringLiteral("1"),
+                   QStringLiteral("-D"), QStringLiteral("-s"), payload, ipv4});
+#else
+    process.start(QStringLiteral("ping"),
+                  {QStringLiteral("-4"), QStringLiteral("-n"), QStringLiteral("-c"), QStringLiteral("1"),
+                   QStringLiteral("-W"), QStringLiteral("1"), QStringLiteral("-M"), QStringLiteral("do"),
+                   QStringLiteral("-s"), payload, ipv4});
+#endif
+    if (!process.waitForStarted(2000)) {
+        return false;
+    }
+    if (!process.waitForFinished(kTunPathMtuProbeTimeoutMs)) {
+        process.kill();
+        process.waitForFinished(500);
+        return false;
+    }
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        return false;
+    }
+#if defined(Q_OS_WIN)
+    // Windows ping exits with 0 for some ICMP errors; only a real reply carries TTL=.
+    return QString::fromLocal8Bit(process.readAllStandardOutput()).contains(QStringLiteral("TTL="), Qt::CaseInsensitive);
+#else
+    return true;
+#endif
+}
+
+int probePathMtuSync(const QString& host)
+{
+    QString ipv4;
+    const QHostAddress parsed(host.trimmed());
+    if (!parsed.isNull()) {
+        if (parsed.protocol() == QAbstractSocket::IPv4Protocol) {
+            ipv4 = parsed.toString();
+        }
+    } else if (!host.trimmed().isEmpty()) {
+        const QHostInfo info = QHostInfo::fromName(host.trimmed());
+        for (const QHostAddress& address : info.addresses()) {
+            if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+                ipv4 = address.toString();
+                break;
+            }
+        }
+    }
+    if (ipv4.isEmpty()) {
+        return 0;
+    }
+
+    // Binary search between the IPv6 minimum and Ethernet MTU. If even the
+    // minimum does not get through, ICMP is filtered and the result is unknown.
+    if (!pingWithDontFragment(ipv4, kTunPathMtuProbeLow)) {
+        return 0;
+    }
+    if (pingWithDontFragment(ipv4, kTunPathMtuProbeHigh)) {
+        return kTunPathMtuProbeHigh;
+    }
+    int low = kTunPathMtuProbeLow;
+    int high = kTunPathMtuProbeHigh;
+    while (high - low > 4) {
+        const int mid = low + (high - low) / 2;
+        if (pingWithDontFragment(ipv4, mid)) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
 QString quoteForShell(const QString& value)
 {
     QString escaped = value;
@@ -1034,6 +922,7 @@ double combinedSpeedTestAverageMbps(double downloadMbps, double uploadMbps)
     }
     return qMax(down, up);
 }
+
 }
 
 VpnController::VpnController(QObject *parent)
@@ -1046,12 +935,17 @@ VpnController::VpnController(QObject *parent)
     QDir().mkpath(m_dataDirectory);
 
     m_profilesPath = QDir(m_dataDirectory).filePath(QStringLiteral("profiles.json"));
+    m_profileStorePath = QDir(m_dataDirectory).filePath(QStringLiteral("profiles.bin"));
+    m_startupProfileCachePath = QDir(m_dataDirectory).filePath(QStringLiteral("profiles-startup.bin"));
     m_subscriptionsPath = QDir(m_dataDirectory).filePath(QStringLiteral("subscriptions.json"));
     m_runtimeConfigPath = QDir(m_dataDirectory).filePath(QStringLiteral("xray-runtime-config.json"));
     m_profileUsagePath = QDir(m_dataDirectory).filePath(QStringLiteral("profile-traffic-usage.json"));
+    m_speedTestHistoryPath = QDir(m_dataDirectory).filePath(QStringLiteral("speed-test-history.json"));
     m_privilegedTunPidPath = QDir(m_dataDirectory).filePath(QStringLiteral("xray-tun.pid"));
     m_privilegedTunLogPath = QDir(m_dataDirectory).filePath(QStringLiteral("xray-tun.log"));
     m_managedRuntimeRecordPath = QDir(m_dataDirectory).filePath(QString::fromLatin1(kManagedRuntimeRecordFile));
+    m_ruleAssetDirectory = QDir(m_dataDirectory).filePath(QStringLiteral("assets"));
+    m_ruleSourceCacheDirectory = QDir(m_dataDirectory).filePath(QStringLiteral("rule-sources"));
 
     m_buildOptions.socksPort = 10808;
     m_buildOptions.httpPort = 10808;
@@ -1065,24 +959,66 @@ VpnController::VpnController(QObject *parent)
     m_memoryUsageTimer.start();
     m_statsPollTimer.setInterval(1000);
     connect(&m_statsPollTimer, &QTimer::timeout, this, &VpnController::pollTrafficStats);
-    m_privilegedTunLogTimer.setInterval(200);
-    connect(&m_privilegedTunLogTimer, &QTimer::timeout, this, &VpnController::pollPrivilegedTunLogs);
     m_profileUsageSaveTimer.setSingleShot(true);
     m_profileUsageSaveTimer.setInterval(kProfileUsageSaveDelayMs);
     connect(&m_profileUsageSaveTimer, &QTimer::timeout, this, [this]() {
         saveProfileUsage();
     });
-    m_logsFlushTimer.setSingleShot(true);
-    m_logsFlushTimer.setInterval(120);
-    connect(&m_logsFlushTimer, &QTimer::timeout, this, [this]() {
-        if (!m_logsDirty) {
-            return;
-        }
-        m_logsDirty = false;
-        emit logsChanged();
+    // Log filtering, TUN log tailing and history trimming run on the backend
+    // thread; the UI only receives coalesced snapshots.
+    m_backendThread.setObjectName(QStringLiteral("GenyConnectBackend"));
+    m_logPipeline = new LogPipeline();
+    m_logPipeline->setCapacity(kMaxLogLines);
+    m_logPipeline->moveToThread(&m_backendThread);
+    connect(&m_backendThread, &QThread::finished, m_logPipeline, &QObject::deleteLater);
+    connect(m_logPipeline, &LogPipeline::snapshotReady, this, &VpnController::onLogSnapshot);
+    // Subscription payloads are hashed and parsed there too; only the merge
+    // into the profile model runs on the GUI thread.
+    m_subscriptionDecoder = new SubscriptionDecoder();
+    m_subscriptionDecoder->moveToThread(&m_backendThread);
+    connect(&m_backendThread, &QThread::finished, m_subscriptionDecoder, &QObject::deleteLater);
+    connect(m_subscriptionDecoder, &SubscriptionDecoder::decoded, this, &VpnController::onSubscriptionDecoded);
+    m_backendThread.start();
+    m_persistence.setWorkerThread(&m_backendThread);
+    registerPersistenceStores();
+    connect(&m_persistence, &PersistenceService::writeFailed, this, [this](const QString& store, const QString& error) {
+        appendSystemLog(QStringLiteral("[System] Failed to save %1: %2").arg(store, error.trimmed()));
     });
     m_speedTestTimer.setInterval(kSpeedTestTickIntervalMs);
     connect(&m_speedTestTimer, &QTimer::timeout, this, &VpnController::onSpeedTestTick);
+    m_speedTestLoadedProbeTimer.setInterval(kSpeedTestLoadedProbeIntervalMs);
+    connect(&m_speedTestLoadedProbeTimer, &QTimer::timeout, this, &VpnController::runLoadedLatencyProbe);
+    connect(&m_speedTestTunnelProbe, &SpeedTestLatencyProbe::sampled, this, [this](int latencyMs) {
+        if (!m_speedTestRunning) {
+            return;
+        }
+        if (m_speedTestPhase == SpeedTestSnapshot::Latency) {
+            m_speedTestIdleProbeSamples.append(latencyMs);
+        } else if (m_speedTestPhase == SpeedTestSnapshot::Upload) {
+            m_speedTestUploadLatencySamples.append(latencyMs);
+        } else if (m_speedTestPhase == SpeedTestSnapshot::Download) {
+            m_speedTestDownloadLatencySamples.append(latencyMs);
+        }
+    });
+    connect(&m_speedTestEngine, &SpeedTestEngine::progressChanged, this, &VpnController::onSpeedTestProgress);
+    connect(&m_speedTestEngine, &SpeedTestEngine::finished, this, &VpnController::onSpeedTestFinished);
+    connect(&m_speedTestUdpProbe, &UdpProbe::finished, this, &VpnController::onSpeedTestUdpProbeFinished);
+    SubscriptionFetcher::Options subscriptionFetchOptions;
+    subscriptionFetchOptions.maxConcurrent = kSubscriptionFetchConcurrency;
+    subscriptionFetchOptions.maxPerHost = kSubscriptionFetchPerHost;
+    subscriptionFetchOptions.maxAttempts = kSubscriptionFetchAttempts;
+    subscriptionFetchOptions.timeoutMs = kSubscriptionFetchTimeoutMs;
+    m_subscriptionFetcher.setOptions(subscriptionFetchOptions);
+    connect(&m_subscriptionFetcher, &SubscriptionFetcher::fetched, this, &VpnController::onSubscriptionFetched);
+    connect(&m_subscriptionFetcher, &SubscriptionFetcher::finished, this, &VpnController::onSubscriptionFetchesFinished);
+    m_speedTestSnapshotTimer.setSingleShot(true);
+    m_speedTestSnapshotTimer.setInterval(kSpeedTestSnapshotFallbackMs);
+    connect(&m_speedTestSnapshotTimer, &QTimer::timeout, this, &VpnController::publishSpeedTestSnapshot);
+    // Transitions and results are published at once so the snapshot never lags the properties.
+    connect(this, &VpnController::speedTestChanged, this, [this]() {
+        m_speedTestSnapshotDirty = true;
+        publishSpeedTestSnapshot();
+    });
     m_publicIpRetryTimer.setSingleShot(true);
     connect(&m_publicIpRetryTimer, &QTimer::timeout, this, [this]() {
         if (!connected()) {
@@ -1094,9 +1030,59 @@ VpnController::VpnController(QObject *parent)
     connect(&m_processManager, &XrayProcessManager::started, this, &VpnController::onProcessStarted);
     connect(&m_processManager, &XrayProcessManager::stopped, this, &VpnController::onProcessStopped);
     connect(&m_processManager, &XrayProcessManager::errorOccurred, this, &VpnController::onProcessError);
-    connect(&m_processManager, &XrayProcessManager::logLine, this, &VpnController::onLogLine);
+    connect(&m_processManager, &XrayProcessManager::logLine, m_logPipeline, &LogPipeline::appendRuntimeLine);
     connect(&m_processManager, &XrayProcessManager::trafficChanged, this, &VpnController::onTrafficUpdated);
     connect(&m_updater, &Updater::systemLog, this, &VpnController::appendSystemLog);
+    // Events on the tunnel's own device are side effects of connecting, not
+    // host network changes.
+    m_networkMonitor.setIgnoredInterfaces({
+        QStringLiteral("tun*"),
+        QStringLiteral("utun*"),
+        QStringLiteral("xray*"),
+        QStringLiteral("genyconnect*"),
+        QStringLiteral("wintun*")
+    });
+    connect(&m_networkMonitor, &NetworkMonitor::networkChanged, this, &VpnController::handleNetworkChanged);
+    connect(&m_networkMonitor, &NetworkMonitor::aboutToSleep, this, [this]() {
+        if (connected()) {
+            appendSystemLog(QStringLiteral("[System] System is suspending; tunnel will be re-validated on resume."));
+        }
+    });
+    m_networkMonitor.start();
+    m_proxyHealthMonitor.setProxyPort(m_buildOptions.socksPort);
+    connect(&m_proxyHealthMonitor, &ProxyHealthMonitor::sampleAdded, this, &VpnController::proxyHealthChanged);
+    connect(&m_proxyHealthMonitor, &ProxyHealthMonitor::roundFinished, this, &VpnController::onProxyHealthRoundFinished);
+    connect(&m_proxyHealthMonitor, &ProxyHealthMonitor::healthChanged, this, [this]() {
+        if (!connected()) {
+            return;
+        }
+        if (m_proxyHealthMonitor.isHealthy()) {
+            appendSystemLog(QStringLiteral("[System] Proxy health restored."));
+        } else {
+            appendSystemLog(QStringLiteral("[System] Proxy health degraded: no probe target is reachable through the tunnel."));
+        }
+    });
+    connect(&m_transportTuner, &TransportTuner::progressChanged, this, [this](int index, int count) {
+        if (m_transportTuner.isRunning()) {
+            m_transportTunerStatus = QStringLiteral("Testing %1 of %2: %3")
+                                         .arg(index + 1)
+                                         .arg(count)
+                                         .arg(m_transportTuner.candidates().at(index).label);
+        }
+        emit transportTunerChanged();
+    });
+    connect(&m_transportTuner, &TransportTuner::finished, this, &VpnController::onTransportTunerFinished);
+    connect(&m_batchSpeedTest, &TransportTuner::progressChanged, this, [this](int index, int count) {
+        if (m_batchSpeedTest.isRunning()) {
+            m_batchSpeedTestStatus = QStringLiteral("Testing %1 of %2: %3")
+                                         .arg(index + 1)
+                                         .arg(count)
+                                         .arg(m_batchSpeedTest.candidates().at(index).label);
+        }
+        recordBatchSpeedTestResult(index);
+        emit batchSpeedTestChanged();
+    });
+    connect(&m_batchSpeedTest, &TransportTuner::finished, this, &VpnController::onBatchSpeedTestFinished);
     connect(&m_profileModel, &QAbstractItemModel::rowsInserted, this, [this]() {
         recomputeProfileStats();
         refreshProfileGroups();
@@ -1116,10 +1102,14 @@ VpnController::VpnController(QObject *parent)
 
     updateMemoryUsage();
 
+    // Only settings and the small cached first page of profiles are read
+    // synchronously; they are needed to lay out the first frame. Profiles,
+    // subscriptions and usage load in parallel on the worker pool and the
+    // xray version comes from cache or a background probe.
     loadSettings();
-    loadProfiles();
-    loadSubscriptions();
-    loadProfileUsage();
+    QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::setEnabled, Qt::QueuedConnection, m_loggingEnabled);
+    showStartupProfileCache();
+    startStartupLoad();
     refreshProfileGroups();
     m_updater.setAppVersion(QCoreApplication::applicationVersion());
 
@@ -1129,24 +1119,10 @@ VpnController::VpnController(QObject *parent)
     } else if (m_xrayExecutablePath.isEmpty()) {
         m_xrayExecutablePath = detectDefaultXrayPath();
     }
-    detectProcessRoutingSupport();
-    cleanupManagedRuntimeOnStartup();
-
-    if (m_profileModel.rowCount() == 0) {
-        m_currentProfileIndex = -1;
-    } else if (!m_currentProfileId.trimmed().isEmpty()) {
-        const int resolvedIndex = m_profileModel.indexOfId(m_currentProfileId.trimmed());
-        if (resolvedIndex >= 0) {
-            m_currentProfileIndex = resolvedIndex;
-        } else if (m_currentProfileIndex < 0 || m_currentProfileIndex >= m_profileModel.rowCount()) {
-            m_currentProfileIndex = 0;
-        }
-    } else if (m_currentProfileIndex < 0 || m_currentProfileIndex >= m_profileModel.rowCount()) {
-        m_currentProfileIndex = 0;
-    }
-    const auto startupProfile = m_profileModel.profileAt(m_currentProfileIndex);
-    m_currentProfileId = startupProfile.has_value() ? startupProfile->id.trimmed() : QString();
-    recomputeProfileStats();
+    refreshXrayCapabilities();
+    QTimer::singleShot(0, this, [this]() {
+        cleanupManagedRuntimeOnStartup();
+    });
 
     QTimer::singleShot(1500, this, [this]() {
         m_updater.checkForUpdates(false);
@@ -1154,6 +1130,19 @@ VpnController::VpnController(QObject *parent)
     QTimer::singleShot(900, this, [this]() {
         applyKillSwitchState();
     });
+    m_ruleSourceRefreshTimer.setInterval(kRuleSourceRefreshIntervalMs);
+    connect(&m_ruleSourceRefreshTimer, &QTimer::timeout, this, [this]() {
+        queueRuleSourceRefresh(true);
+    });
+    m_ruleSourceRefreshTimer.start();
+    QTimer::singleShot(kRuleSourceStartupRefreshDelayMs, this, [this]() {
+        queueRuleSourceRefresh(true);
+    });
+    // Rule lists are compiled ahead of the connect and again whenever their
+    // inputs change, so connecting only reuses the result.
+    connect(this, &VpnController::routingRulesChanged, this, &VpnController::scheduleRoutingRuleCompile);
+    connect(this, &VpnController::ruleSourcesChanged, this, &VpnController::scheduleRoutingRuleCompile);
+    scheduleRoutingRuleCompile();
 
     connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
         m_shutdownInProgress.store(true);
@@ -1168,7 +1157,7 @@ VpnController::VpnController(QObject *parent)
         m_statsPollTimer.stop();
         endProfileUsageSession(m_activeProfileUsageId);
         if (m_privilegedTunManaged) {
-            m_privilegedTunLogTimer.stop();
+            QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::stopTail, Qt::QueuedConnection);
             QString stopError;
             if (!stopPrivilegedTunProcess(&stopError) && !stopError.trimmed().isEmpty()) {
                 appendSystemLog(QStringLiteral("[System] %1").arg(stopError.trimmed()));
@@ -1182,6 +1171,8 @@ VpnController::VpnController(QObject *parent)
         }
         clearManagedRuntimeRecord();
         cleanupDetachedHelpers();
+        saveProfileUsage();
+        m_persistence.flush();
     });
 }
 
@@ -1199,7 +1190,6 @@ VpnController::~VpnController()
     endProfileUsageSession(m_activeProfileUsageId);
     m_profileUsageSaveTimer.stop();
     if (m_privilegedTunManaged) {
-        m_privilegedTunLogTimer.stop();
         QString stopError;
         Q_UNUSED(stopPrivilegedTunProcess(&stopError));
         m_privilegedTunManaged = false;
@@ -1217,6 +1207,9 @@ VpnController::~VpnController()
     }
     saveProfileUsage();
     cleanupDetachedHelpers();
+    m_persistence.flush();
+    m_backendThread.quit();
+    m_backendThread.wait();
 }
 
 ConnectionState VpnController::connectionState() const
@@ -1302,12 +1295,56 @@ bool VpnController::speedTestRunning() const
 
 QString VpnController::speedTestState() const
 {
-    return m_speedTestState;
+    return SpeedTestSnapshot::stateOf(m_speedTestPhase);
 }
 
 QString VpnController::speedTestPhase() const
 {
-    return m_speedTestPhase;
+    return SpeedTestSnapshot::nameOf(m_speedTestPhase);
+}
+
+SpeedTestSnapshot VpnController::speedTestSnapshot() const
+{
+    return m_speedTestSnapshot;
+}
+
+void VpnController::publishSpeedTestSnapshot()
+{
+    if (!m_speedTestSnapshotDirty) {
+        return;
+    }
+    m_speedTestSnapshotDirty = false;
+    m_speedTestSnapshotTimer.stop();
+
+    SpeedTestSnapshot snapshot;
+    snapshot.running = m_speedTestRunning;
+    snapshot.phase = m_speedTestPhase;
+    snapshot.elapsedSec = m_speedTestElapsedSec;
+    snapshot.durationSec = m_speedTestDurationSec;
+    snapshot.progress = m_speedTestProgress;
+    snapshot.currentMbps = m_speedTestCurrentMbps;
+    snapshot.peakMbps = m_speedTestPeakMbps;
+    snapshot.averageMbps = m_speedTestAverageMbps;
+    snapshot.downloadMbps = m_speedTestDownloadMbps;
+    snapshot.uploadMbps = m_speedTestUploadMbps;
+    snapshot.pingMs = m_speedTestPingMs;
+    snapshot.jitterMs = m_speedTestJitterMs;
+    snapshot.streamCount = m_speedTestEngine.usedStreamCount();
+    if (snapshot == m_speedTestSnapshot) {
+        return;
+    }
+    m_speedTestSnapshot = snapshot;
+    emit speedTestSnapshotChanged();
+}
+
+void VpnController::requestSpeedTestSnapshot()
+{
+    if (m_speedTestSnapshotDirty) {
+        return;
+    }
+    m_speedTestSnapshotDirty = true;
+    m_speedTestSnapshotTimer.start();
+    emit speedTestFrameRequested();
 }
 
 int VpnController::speedTestElapsedSec() const
@@ -1375,6 +1412,32 @@ int VpnController::speedTestLatencyMaxMs() const
     return m_speedTestLatencyMaxMs;
 }
 
+QVariantMap VpnController::speedTestLatencyProfile() const
+{
+    const auto distribution = [](const QVector<int>& samples) {
+        QVariantMap map;
+        map.insert(QStringLiteral("p50"), percentileLatency(samples, 50.0));
+        map.insert(QStringLiteral("p90"), percentileLatency(samples, 90.0));
+        map.insert(QStringLiteral("p99"), percentileLatency(samples, 99.0));
+        map.insert(QStringLiteral("samples"), samples.size());
+        return map;
+    };
+
+    QVariantMap profile;
+    profile.insert(QStringLiteral("idle"), distribution(m_speedTestLatencySamples));
+    profile.insert(QStringLiteral("download"), distribution(m_speedTestDownloadLatencySamples));
+    profile.insert(QStringLiteral("upload"), distribution(m_speedTestUploadLatencySamples));
+    profile.insert(QStringLiteral("bufferbloatMs"), m_speedTestBufferbloatMs);
+    profile.insert(QStringLiteral("bufferbloatGrade"), m_speedTestBufferbloatGrade);
+    profile.insert(QStringLiteral("udp"), m_speedTestUdpResult.toVariantMap());
+    return profile;
+}
+
+QString VpnController::speedTestBufferbloatGrade() const
+{
+    return m_speedTestBufferbloatGrade;
+}
+
 double VpnController::speedTestDownloadMbps() const
 {
     return m_speedTestDownloadMbps;
@@ -1392,7 +1455,28 @@ QString VpnController::speedTestError() const
 
 QStringList VpnController::speedTestHistory() const
 {
-    return m_speedTestHistory;
+    return m_speedTestHistoryModel.summaries(kSpeedTestHistoryMaxItems);
+}
+
+int VpnController::speedTestStreamCount() const
+{
+    return m_speedTestEngine.usedStreamCount();
+}
+
+QVariantList VpnController::speedTestStreams() const
+{
+    QVariantList out;
+    for (const SpeedTestStream& stream : m_speedTestEngine.streams()) {
+        QVariantMap item;
+        item.insert(QStringLiteral("id"), stream.id);
+        item.insert(QStringLiteral("bytes"), stream.bytes);
+        item.insert(QStringLiteral("mbps"), mbpsFromBytes(stream.bytes, stream.activeMs));
+        item.insert(QStringLiteral("requests"), stream.requests);
+        item.insert(QStringLiteral("active"), stream.active);
+        item.insert(QStringLiteral("error"), stream.error);
+        out.append(item);
+    }
+    return out;
 }
 
 int VpnController::speedTestSelectedSizeMb() const
@@ -1462,6 +1546,11 @@ QObject *VpnController::updater()
     return &m_updater;
 }
 
+QObject *VpnController::speedTestHistoryModel()
+{
+    return &m_speedTestHistoryModel;
+}
+
 QString VpnController::xrayExecutablePath() const
 {
     return m_xrayExecutablePath;
@@ -1831,16 +1920,10 @@ void VpnController::setXrayExecutablePath(const QString& path)
         return;
     }
 
-    const bool hadSupport = m_processRoutingSupported;
     m_xrayExecutablePath = normalized;
-    m_processRoutingSupportChecked = false;
-    m_processRoutingSupported = false;
     emit xrayExecutablePathChanged();
-    if (hadSupport) {
-        emit processRoutingSupportChanged();
-    }
     saveSettings();
-    detectProcessRoutingSupport();
+    refreshXrayCapabilities();
 }
 
 void VpnController::setLoggingEnabled(bool enabled)
@@ -1850,6 +1933,7 @@ void VpnController::setLoggingEnabled(bool enabled)
     }
 
     m_loggingEnabled = enabled;
+    QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::setEnabled, Qt::QueuedConnection, m_loggingEnabled);
     if (!m_loggingEnabled) {
         clearLogsInternal();
     }
@@ -1920,9 +2004,8 @@ void VpnController::setUseSystemProxy(bool enabled)
 
     m_useSystemProxy = enabled;
     emit useSystemProxyChanged();
+    m_modeExplicitlyChosen = true;
     saveSettings();
-    QSettings settings;
-    settings.setValue(QStringLiteral("network/modeExplicitlyChosen"), true);
 
     if (m_connectionState == ConnectionState::Connected) {
         applySystemProxy(enabled, !enabled);
@@ -1943,9 +2026,8 @@ void VpnController::setTunMode(bool enabled)
         emit useSystemProxyChanged();
     }
 
+    m_modeExplicitlyChosen = true;
     saveSettings();
-    QSettings settings;
-    settings.setValue(QStringLiteral("network/modeExplicitlyChosen"), true);
 }
 
 void VpnController::setKillSwitchEnabled(bool enabled)
@@ -2047,32 +2129,350 @@ void VpnController::setBlockDomainRules(const QString& value)
     saveSettings();
 }
 
-void VpnController::setCustomDnsServers(const QString& value)
+QVariantList VpnController::ruleSourceItems() const
 {
-    const QString normalized = parseDnsServers(value).join('\n');
-    if (m_customDnsServers == normalized) {
-        return;
+    QVariantList items;
+    items.reserve(m_ruleSources.size());
+    for (const QJsonValue& value : m_ruleSources) {
+        const QJsonObject source = value.toObject();
+        const qint64 updatedAt = source.value(QStringLiteral("updatedAt")).toInteger();
+        QVariantMap item;
+        item.insert(QStringLiteral("location"), source.value(QStringLiteral("location")).toString());
+        item.insert(QStringLiteral("target"), source.value(QStringLiteral("target")).toString());
+        item.insert(QStringLiteral("entries"), source.value(QStringLiteral("entries")).toInt());
+        item.insert(QStringLiteral("remote"), isRemoteRuleSource(source.value(QStringLiteral("location")).toString()));
+        item.insert(QStringLiteral("updatedAt"), updatedAt > 0
+                                                     ? QDateTime::fromSecsSinceEpoch(updatedAt).toString(QStringLiteral("yyyy-MM-dd HH:mm"))
+                                                     : QString());
+        item.insert(QStringLiteral("error"), source.value(QStringLiteral("error")).toString());
+        items.append(item);
     }
-
-    m_customDnsServers = normalized;
-    emit customDnsServersChanged();
-    saveSettings();
+    return items;
 }
 
-QString VpnController::proxyAppRules() const
+bool VpnController::ruleSourcesBusy() const
 {
-    return m_proxyAppRules;
+    return m_ruleSourcesBusy;
 }
 
-void VpnController::setProxyAppRules(const QString& value)
+bool VpnController::addRuleSource(const QString& location, const QString& target)
 {
-    if (m_proxyAppRules == value) {
-        return;
+    const QString trimmed = location.trimmed();
+    const QString normalizedTarget = normalizedRuleTarget(target);
+    if (trimmed.isEmpty() || normalizedTarget.isEmpty()) {
+        return false;
+    }
+    for (const QJsonValue& value : std::as_const(m_ruleSources)) {
+        const QJsonObject source = value.toObject();
+        if (source.value(QStringLiteral("location")).toString() == trimmed
+            && source.value(QStringLiteral("target")).toString() == normalizedTarget) {
+            return false;
+        }
     }
 
-    m_proxyAppRules = value;
-    emit appRulesChanged();
-    saveSettings();
+    const bool remote = isRemoteRuleSource(trimmed);
+    QJsonObject source {
+        {QStringLiteral("location"), trimmed},
+        {QStringLiteral("target"), normalizedTarget}
+    };
+    if (!remote) {
+        QFile file(localRuleSourcePath(trimmed));
+        if (!file.open(QIODevice::ReadOnly)) {
+            appendSystemLog(QStringLiteral("[System] Rule source not readable: %1").arg(trimmed));
+            return false;
+        }
+        source.insert(QStringLiteral("entries"), RuleAssets::parseRuleList(file.readAll()).size());
+        source.insert(QStringLiteral("updatedAt"), QFileInfo(file).lastModified().toSecsSinceEpoch());
+    }
+
+    m_ruleSources.append(source);
+    saveSettings();
+    emit ruleSourcesChanged();
+    appendSystemLog(QStringLiteral("[System] Rule source added for %1 rules: %2").arg(normalizedTarget, trimmed));
+
+    if (remote && !m_ruleSourceRefreshQueue.contains(trimmed)) {
+        m_ruleSourceRefreshQueue.append(trimmed);
+        if (!m_ruleSourcesBusy) {
+            m_ruleSourcesBusy = true;
+            emit ruleSourcesChanged();
+            startNextRuleSourceFetch();
+        }
+    }
+    return true;
+}
+
+void VpnController::removeRuleSource(int index)
+{
+    if (index < 0 || index >= m_ruleSources.size()) {
+        return;
+    }
+
+    const QString location = m_ruleSources.at(index).toObject().value(QStringLiteral("location")).toString();
+    m_ruleSources.removeAt(index);
+    bool stillReferenced = false;
+    for (const QJsonValue& value : std::as_const(m_ruleSources)) {
+        if (value.toObject().value(QStringLiteral("location")).toString() == location) {
+            stillReferenced = true;
+            break;
+        }
+    }
+    if (!stillReferenced && isRemoteRuleSource(location)) {
+        QFile::remove(ruleSourceCachePath(location));
+        m_ruleSourceRefreshQueue.removeAll(location);
+    }
+
+    saveSettings();
+    emit ruleSourcesChanged();
+}
+
+int VpnController::refreshRuleSources()
+{
+    return queueRuleSourceRefresh(false);
+}
+
+int VpnController::queueRuleSourceRefresh(bool staleOnly)
+{
+    const qint64 staleBefore = QDateTime::currentSecsSinceEpoch() - kRuleSourceRefreshIntervalMs / 1000;
+    int queued = 0;
+    for (const QJsonValue& value : std::as_const(m_ruleSources)) {
+        const QJsonObject source = value.toObject();
+        const QString location = source.value(QStringLiteral("location")).toString();
+        if (!isRemoteRuleSource(location) || m_ruleSourceRefreshQueue.contains(location)) {
+            continue;
+        }
+        if (staleOnly && source.value(QStringLiteral("updatedAt")).toInteger() > staleBefore) {
+            continue;
+        }
+        m_ruleSourceRefreshQueue.append(location);
+        ++queued;
+    }
+
+    if (queued > 0 && !m_ruleSourcesBusy) {
+        m_ruleSourcesBusy = true;
+        emit ruleSourcesChanged();
+        startNextRuleSourceFetch();
+    }
+    return queued;
+}
+
+void VpnController::startNextRuleSourceFetch()
+{
+    if (m_ruleSourceRefreshQueue.isEmpty()) {
+        m_ruleSourcesBusy = false;
+        emit ruleSourcesChanged();
+        return;
+    }
+
+    const QString location = m_ruleSourceRefreshQueue.takeFirst();
+    QNetworkRequest request{QUrl(location)};
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setTransferTimeout(kRuleSourceFetchTimeoutMs);
+    request.setRawHeader("User-Agent", "GenyConnect-Rules/1.0");
+
+    QNetworkReply *reply = m_subscriptionNetworkManager.get(request);
+    connect(reply, &QNetworkReply::downloadProgress, reply, [reply](qint64 received, qint64) {
+        if (received > kRuleSourceMaxBytes) {
+            reply->setProperty("_geny_too_large", true);
+            reply->abort();
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, location]() {
+        reply->deleteLater();
+
+        if (reply->property("_geny_too_large").toBool()) {
+            finishRuleSourceFetch(location, -1, QStringLiteral("list is larger than %1 MB").arg(kRuleSourceMaxBytes / (1024 * 1024)));
+            return;
+        }
+        if (reply->error() != QNetworkReply::NoError) {
+            finishRuleSourceFetch(location, -1, reply->errorString().trimmed());
+            return;
+        }
+
+        // Lists can be tens of megabytes; parse and cache them off the GUI thread.
+        const QByteArray payload = reply->readAll();
+        const QString cacheDirectory = m_ruleSourceCacheDirectory;
+        const QString cachePath = ruleSourceCachePath(location);
+        const QPointer<VpnController> guard(this);
+        [[maybe_unused]] auto parseFuture = QtConcurrent::run([guard, location, payload, cacheDirectory, cachePath]() {
+            QString error;
+            int entries = -1;
+            const qsizetype parsed = RuleAssets::parseRuleList(payload).size();
+            if (parsed == 0) {
+                error = QStringLiteral("no rules found");
+            } else if (QDir().mkpath(cacheDirectory)
+                       && PersistenceService::writeFileAtomically(cachePath, payload, &error)) {
+                entries = static_cast<int>(parsed);
+            } else if (error.isEmpty()) {
+                error = QStringLiteral("cannot write cache");
+            }
+            if (!guard) {
+                return;
+            }
+            QMetaObject::invokeMethod(guard.data(), [guard, location, entries, error]() {
+                if (guard) {
+                    guard->finishRuleSourceFetch(location, entries, error);
+                }
+            }, Qt::QueuedConnection);
+        });
+    });
+}
+
+void VpnController::finishRuleSourceFetch(const QString& location, int entries, const QString& error)
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (qsizetype i = 0; i < m_ruleSources.size(); ++i) {
+        QJsonObject source = m_ruleSources.at(i).toObject();
+        if (source.value(QStringLiteral("location")).toString() != location) {
+            continue;
+        }
+        if (entries >= 0) {
+            source.insert(QStringLiteral("entries"), entries);
+            source.insert(QStringLiteral("updatedAt"), now);
+            source.remove(QStringLiteral("error"));
+        } else {
+            // Keep serving the last good copy; retry on the next interval.
+            source.insert(QStringLiteral("error"), error);
+        }
+        m_ruleSources.replace(i, source);
+    }
+
+    appendSystemLog(entries >= 0
+                        ? QStringLiteral("[System] Rule source refreshed: %1 (%2 entries).").arg(location).arg(entries)
+                        : QStringLiteral("[System] Rule source refresh failed for %1: %2").arg(location, error));
+    saveSettings();
+    emit ruleSourcesChanged();
+    startNextRuleSourceFetch();
+}
+
+QString VpnController::ruleSourceCachePath(const QString& location) const
+{
+    const QByteArray key = QCryptographicHash::hash(location.trimmed().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(m_ruleSourceCacheDirectory).filePath(QString::fromLatin1(key) + QStringLiteral(".txt"));
+}
+
+QList<QPair<QString, QString>> VpnController::ruleSourceFiles() const
+{
+    QList<QPair<QString, QString>> files;
+    files.reserve(m_ruleSources.size());
+    for (const QJsonValue& value : m_ruleSources) {
+        const QJsonObject source = value.toObject();
+        const QString location = source.value(QStringLiteral("location")).toString();
+        files.append({source.value(QStringLiteral("target")).toString(),
+                      isRemoteRuleSource(location) ? ruleSourceCachePath(location) : localRuleSourcePath(location)});
+    }
+    return files;
+}
+
+QByteArray VpnController::routingRuleKey() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    // The inline limit decides what spills into rule assets, which reuse this key.
+    hash.addData(QByteArray::number(kInlineRuleLimit));
+    for (const QString *rules : {&m_blockDomainRules, &m_directDomainRules, &m_proxyDomainRules}) {
+        hash.addData(QByteArrayView("\n#"));
+        hash.addData(rules->toUtf8());
+    }
+    for (const auto& [target, path] : ruleSourceFiles()) {
+        const QFileInfo info(path);
+        hash.addData(QStringLiteral("\n%1 %2 %3 %4")
+                         .arg(target, path)
+                         .arg(info.exists() ? info.size() : -1)
+                         .arg(info.lastModified().toMSecsSinceEpoch())
+                         .toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+void VpnController::scheduleRoutingRuleCompile()
+{
+    if (!m_routingRuleCompileKey.isEmpty()) {
+        return;                                 // Re-checked when the running compile lands.
+    }
+    const QByteArray key = routingRuleKey();
+    if (key == m_compiledRoutingRulesKey) {
+        return;
+    }
+
+    m_routingRuleCompileKey = key;
+    const QPointer<VpnController> guard(this);
+    const QStringList blockEntries = parseRules(m_blockDomainRules);
+    const QStringList directEntries = parseRules(m_directDomainRules);
+    const QStringList proxyEntries = parseRules(m_proxyDomainRules);
+    const QList<QPair<QString, QString>> sourceFiles = ruleSourceFiles();
+    [[maybe_unused]] auto compileFuture = QtConcurrent::run([guard, key, blockEntries, directEntries, proxyEntries, sourceFiles]() {
+        QElapsedTimer compileTimer;
+        compileTimer.start();
+        const RoutingRuleCompiler::Result compiled =
+            compileRoutingRuleInputs(blockEntries, directEntries, proxyEntries, sourceFiles);
+        const qint64 elapsedMs = compileTimer.elapsed();
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, key, compiled, elapsedMs]() {
+            if (!guard) {
+                return;
+            }
+            guard->m_routingRuleCompileKey.clear();
+            // A connect may have compiled newer inputs in the meantime.
+            if (key == guard->routingRuleKey()) {
+                guard->m_compiledRoutingRules = compiled;
+                guard->m_compiledRoutingRulesKey = key;
+                if (compiled.inputEntries > 0) {
+                    guard->appendSystemLog(QStringLiteral("[System] Routing rules compiled: %1 entries -> %2 matchers in %3 ms.")
+                                               .arg(compiled.inputEntries)
+                                               .arg(compiled.outputEntries)
+                                               .arg(elapsedMs));
+                }
+            }
+            guard->scheduleRoutingRuleCompile();
+        }, Qt::QueuedConnection);
+    });
+}
+
+RoutingRuleCompiler::Result VpnController::compiledRoutingRules(QByteArray *key)
+{
+    const QByteArray current = routingRuleKey();
+    if (current != m_compiledRoutingRulesKey) {
+        // Only reached when a rule file changed on disk since the last compile
+        // or the connect raced the background compile.
+        m_compiledRoutingRules = compileRoutingRuleInputs(parseRules(m_blockDomainRules),
+                                                          parseRules(m_directDomainRules),
+                                                          parseRules(m_proxyDomainRules),
+                                                          ruleSourceFiles());
+        m_compiledRoutingRulesKey = current;
+    }
+    if (key) {
+        *key = current;
+    }
+    return m_compiledRoutingRules;
+}
+
+void VpnController::setCustomDnsServers(const QString& value)
+{
+    const QString normalized = parseDnsServers(value).join('\n');
+    if (m_customDnsServers == normalized) {
+        return;
+    }
+
+    m_customDnsServers = normalized;
+    emit customDnsServersChanged();
+    saveSettings();
+}
+
+QString VpnController::proxyAppRules() const
+{
+    return m_proxyAppRules;
+}
+
+void VpnController::setProxyAppRules(const QString& value)
+{
+    if (m_proxyAppRules == value) {
+        return;
+    }
+
+    m_proxyAppRules = value;
+    emit appRulesChanged();
+    saveSettings();
 }
 
 QString VpnController::directAppRules() const
@@ -2129,7 +2529,97 @@ QString VpnController::currentProfileUsageMonth() const
 
 bool VpnController::processRoutingSupported() const
 {
-    return m_processRoutingSupported;
+    return m_xrayCapabilities.processRouting;
+}
+
+int VpnController::lastNetworkRecoveryMs() const
+{
+    return m_lastNetworkRecoveryMs;
+}
+
+bool VpnController::startupLoading() const
+{
+    return !m_pendingStartupStores.isEmpty();
+}
+
+qint64 VpnController::firstFrameMs() const
+{
+    return m_firstFrameMs;
+}
+
+QVariantMap VpnController::proxyHealth() const
+{
+    return m_proxyHealthMonitor.summary();
+}
+
+QVariantList VpnController::proxyHealthSamples(int limit) const
+{
+    return m_proxyHealthMonitor.recentSamples(limit);
+}
+
+bool VpnController::transportTunerRunning() const
+{
+    return m_transportTuner.isRunning();
+}
+
+QString VpnController::transportTunerStatus() const
+{
+    return m_transportTunerStatus;
+}
+
+QVariantList VpnController::transportTunerResults() const
+{
+    QVariantList out;
+    for (const TransportTunerCandidate& candidate : m_transportTuner.candidates()) {
+        out.append(candidate.toVariantMap());
+    }
+    return out;
+}
+
+bool VpnController::batchSpeedTestRunning() const
+{
+    return m_batchSpeedTest.isRunning();
+}
+
+QString VpnController::batchSpeedTestStatus() const
+{
+    return m_batchSpeedTestStatus;
+}
+
+QVariantList VpnController::batchSpeedTestResults() const
+{
+    QVariantList out;
+    const QList<SpeedTestResult> ranked = rankedBatchSpeedTestResults();
+    for (int rank = 0; rank < ranked.size(); ++rank) {
+        const SpeedTestResult& result = ranked.at(rank);
+        out.append(QVariantMap {
+            {QStringLiteral("rank"), rank + 1},
+            {QStringLiteral("row"), m_profileModel.indexOfId(result.profileId)},
+            {QStringLiteral("profileId"), result.profileId},
+            {QStringLiteral("label"), result.profileName},
+            {QStringLiteral("ok"), true},
+            {QStringLiteral("measured"), true},
+            {QStringLiteral("latencyMs"), result.pingMs},
+            {QStringLiteral("throughputMbps"), result.downloadMbps},
+            {QStringLiteral("streams"), result.downloadStreams},
+            {QStringLiteral("loadedLatencyMs"), result.bufferbloatMs >= 0 ? result.pingMs + result.bufferbloatMs : -1},
+            {QStringLiteral("score"), batchSpeedTestScore(result)},
+            {QStringLiteral("error"), QString()}
+        });
+    }
+    if (m_batchSpeedTestRunMs <= 0) {
+        return out;
+    }
+    for (const TransportTunerCandidate& candidate : m_batchSpeedTest.candidates()) {
+        if (candidate.ok) {
+            continue;
+        }
+        QVariantMap item = candidate.toVariantMap();
+        item.insert(QStringLiteral("rank"), -1);
+        item.insert(QStringLiteral("row"), m_profileModel.indexOfId(candidate.profileId));
+        out.append(item);
+    }
+    return out;
 }
 
 quint16 VpnController::socksPort() const
@@ -2185,7 +2675,7 @@ bool VpnController::importProfileLink(const QString& link)
 
 int VpnController::importProfileBatch(const QString& text)
 {
-    const QStringList links = extractSubscriptionLinks(text.toUtf8());
+    const QStringList links = SubscriptionDecoder::extractLinks(text.toUtf8());
     if (links.isEmpty()) {
         setLastError(QStringLiteral("No supported VMESS/VLESS links found in input."));
         return 0;
@@ -2256,6 +2746,10 @@ bool VpnController::addSubscription(const QString& url, const QString& name, con
         entry.url = normalizedUrl;
         entry.name = normalizedName;
         entry.group = normalizedGroup;
+        // Re-adding re-imports, so profiles pick up a changed name or group.
+        entry.etag.clear();
+        entry.lastModified.clear();
+        entry.contentHash.clear();
         m_subscriptionEntries[existingIndex] = entry;
     } else {
         entry.id = createSubscriptionId();
@@ -2270,7 +2764,7 @@ bool VpnController::addSubscription(const QString& url, const QString& name, con
     emit subscriptionsChanged();
 
     beginSubscriptionOperation(QStringLiteral("Fetching %1...").arg(entry.name));
-    startSubscriptionFetch(entry, false);
+    startSubscriptionFetches({entry}, false);
     return true;
 }
 
@@ -2289,11 +2783,8 @@ int VpnController::refreshSubscriptions()
         return 0;
     }
 
-    m_subscriptionRefreshQueue = m_subscriptionEntries;
-    m_subscriptionRefreshSuccessCount = 0;
-    m_subscriptionRefreshFailCount = 0;
     beginSubscriptionOperation(QStringLiteral("Refreshing subscriptions..."));
-    startSubscriptionFetch(m_subscriptionRefreshQueue.takeFirst(), true);
+    startSubscriptionFetches(m_subscriptionEntries, true);
     return m_subscriptionEntries.size();
 }
 
@@ -2320,11 +2811,8 @@ int VpnController::refreshSubscriptionsByGroup(const QString& group)
         return 0;
     }
 
-    m_subscriptionRefreshQueue = filtered;
-    m_subscriptionRefreshSuccessCount = 0;
-    m_subscriptionRefreshFailCount = 0;
     beginSubscriptionOperation(QStringLiteral("Refreshing group '%1'...").arg(normalizedGroup));
-    startSubscriptionFetch(m_subscriptionRefreshQueue.takeFirst(), true);
+    startSubscriptionFetches(filtered, true);
     return filtered.size();
 }
 
@@ -2334,6 +2822,25 @@ int VpnController::importLinks(
     const QString& sourceName,
     const QString& groupName,
     int *lastImportedIndex)
+{
+    QList<ServerProfile> profiles;
+    profiles.reserve(links.size());
+    for (const QString& linkLine : links) {
+        QString parseError;
+        auto parsed = LinkParser::parse(linkLine, &parseError);
+        if (parsed.has_value()) {
+            profiles.append(parsed.value());
+        }
+    }
+    return importProfiles(profiles, sourceId, sourceName, groupName, lastImportedIndex);
+}
+
+int VpnController::importProfiles(
+    const QList<ServerProfile>& profiles,
+    const QString& sourceId,
+    const QString& sourceName,
+    const QString& groupName,
+    int *lastImportedIndex)
 {
     const QString normalizedGroup = normalizeGroupName(groupName);
     const QString normalizedSourceName = sourceName.trimmed().isEmpty()
@@ -2345,14 +2852,7 @@ int VpnController::importLinks(
 
     int importCount = 0;
     int lastIndex = -1;
-    for (const QString& linkLine : links) {
-        QString parseError;
-        auto parsed = LinkParser::parse(linkLine, &parseError);
-        if (!parsed.has_value()) {
-            continue;
-        }
-
-        auto profile = parsed.value();
+    for (ServerProfile profile : profiles) {
         if (profile.name.trimmed().isEmpty()) {
             profile.name = QStringLiteral("%1 %2")
             .arg(profile.protocol.toUpper(), profile.address);
@@ -2386,109 +2886,217 @@ void VpnController::endSubscriptionOperation(const QString& message)
     emit subscriptionStateChanged();
 }
 
-void VpnController::startSubscriptionFetch(const SubscriptionEntry& entry, bool fromRefresh)
+void VpnController::startSubscriptionFetches(const QList<SubscriptionEntry>& entries, bool fromRefresh)
 {
-    const QString url = entry.url.trimmed();
-    const QUrl parsedUrl(url);
-    if (!parsedUrl.isValid()) {
-        if (fromRefresh) {
+    m_subscriptionFetcher.stop();
+    m_subscriptionFetchEntries.clear();
+    m_subscriptionDecodeFetches.clear();
+    ++m_subscriptionFetchGeneration;
+    m_subscriptionDecodesPending = 0;
+    m_subscriptionFetchesDone = false;
+    m_subscriptionFetchFromRefresh = fromRefresh;
+    m_subscriptionRefreshSuccessCount = 0;
+    m_subscriptionRefreshFailCount = 0;
+    m_subscriptionRefreshImportedCount = 0;
+
+    // Validators are only trusted while the profiles they describe are still there.
+    QSet<QString> importedSourceIds;
+    const auto allProfiles = m_profileModel.profiles();
+    for (const ServerProfile& profile : allProfiles) {
+        importedSourceIds.insert(profile.sourceId.trimmed());
+    }
+
+    QList<SubscriptionFetchRequest> requests;
+    for (SubscriptionEntry entry : entries) {
+        const QUrl parsedUrl(entry.url.trimmed());
+        if (!parsedUrl.isValid() || m_subscriptionFetchEntries.contains(entry.id)) {
             ++m_subscriptionRefreshFailCount;
-            if (!m_subscriptionRefreshQueue.isEmpty()) {
-                startSubscriptionFetch(m_subscriptionRefreshQueue.takeFirst(), true);
-            } else {
-                finishRefreshSubscriptions();
-            }
+            continue;
+        }
+        if (!importedSourceIds.contains(entry.id)) {
+            entry.etag.clear();
+            entry.lastModified.clear();
+            entry.contentHash.clear();
+        }
+        m_subscriptionFetchEntries.insert(entry.id, entry);
+        requests.append({entry.id, parsedUrl, entry.etag.toLatin1(), entry.lastModified.toLatin1()});
+    }
+
+    if (requests.isEmpty()) {
+        if (fromRefresh) {
+            finishRefreshSubscriptions();
         } else {
             endSubscriptionOperation(QStringLiteral("Invalid subscription URL."));
         }
         return;
     }
+    m_subscriptionFetcher.enqueue(requests);
+}
 
-    QNetworkRequest request(parsedUrl);
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
-    request.setTransferTimeout(kSubscriptionFetchTimeoutMs);
-    request.setRawHeader("User-Agent", "GenyConnect-Subscription/1.0");
-
-    QNetworkReply* reply = m_subscriptionNetworkManager.get(request);
-    auto* watchdog = new QTimer(reply);
-    watchdog->setSingleShot(true);
-    watchdog->setInterval(kSubscriptionFetchTimeoutMs + 2000);
-    connect(watchdog, &QTimer::timeout, reply, [reply]() {
-        if (reply->isFinished()) {
-            return;
-        }
-        reply->setProperty("_geny_timeout", true);
-        reply->abort();
-    });
-    watchdog->start();
-    connect(reply, &QNetworkReply::finished, this, [this, reply, entry, url, fromRefresh]() {
-        const bool hadError = (reply->error() != QNetworkReply::NoError);
-        QByteArray payload;
-        if (reply->isOpen()) {
-            payload = reply->readAll();
-        }
-        const bool timedOut = reply->property("_geny_timeout").toBool();
-        const QString netError = reply->errorString().trimmed();
-        reply->deleteLater();
+void VpnController::onSubscriptionFetched(const SubscriptionFetchResult& result)
+{
+    const auto it = m_subscriptionFetchEntries.constFind(result.key);
+    if (it == m_subscriptionFetchEntries.cend()) {
+        return;
+    }
+    if (!result.ok || result.notModified) {
+        applySubscriptionResult(result, SubscriptionDecodeResult());
+        return;
+    }
 
-        int importedCount = 0;
-        if (!hadError) {
-            const QStringList links = extractSubscriptionLinks(payload);
-            int lastImportedIndex = -1;
-            importedCount = importLinks(links, entry.id, entry.name, entry.group, &lastImportedIndex);
-            if (importedCount > 0) {
-                saveProfiles();
-                if (m_currentProfileIndex < 0 && lastImportedIndex >= 0) {
-                    setCurrentProfileIndex(lastImportedIndex);
-                }
-                if (m_autoPingProfiles) {
-                    pingAllProfiles();
-                }
-                appendSystemLog(QStringLiteral("[Subscription] Imported %1 profile(s) from %2 (%3).")
-                                    .arg(importedCount)
-                                    .arg(entry.name, entry.group));
-                if (!m_lastError.isEmpty()) {
-                    setLastError(QString());
-                }
-                if (m_connectionState == ConnectionState::Error) {
-                    setConnectionState(ConnectionState::Disconnected);
-                }
-            }
-        }
+    // The entry stays in flight until its payload comes back decoded.
+    SubscriptionFetchResult pending = result;
+    pending.payload.clear();
+    m_subscriptionDecodeFetches.insert(result.key, pending);
+    ++m_subscriptionDecodesPending;
+    QMetaObject::invokeMethod(m_subscriptionDecoder, &SubscriptionDecoder::decode, Qt::QueuedConnection,
+                              m_subscriptionFetchGeneration, result.key, result.payload, it->contentHash);
+}
+
+void VpnController::onSubscriptionDecoded(const SubscriptionDecodeResult& decoded)
+{
+    // Results of a fetch round that was restarted are dropped.
+    if (decoded.generation != m_subscriptionFetchGeneration) {
+        return;
+    }
+    const SubscriptionFetchResult result = m_subscriptionDecodeFetches.take(decoded.key);
+    --m_subscriptionDecodesPending;
+    applySubscriptionResult(result, decoded);
+    if (m_subscriptionFetchesDone && m_subscriptionDecodesPending == 0) {
+        completeSubscriptionFetches();
+    }
+}
+
+void VpnController::applySubscriptionResult(
+    const SubscriptionFetchResult& result,
+    const SubscriptionDecodeResult& decoded)
+{
+    const SubscriptionEntry entry = m_subscriptionFetchEntries.take(result.key);
+    if (entry.id.isEmpty()) {
+        return;
+    }
+    const bool fromRefresh = m_subscriptionFetchFromRefresh;
 
+    const QString contentHash = decoded.contentHash;
+    const bool unchanged = result.ok && (result.notModified || decoded.unchanged);
+    if (unchanged) {
+        // Nothing to parse or merge; only keep the validators current.
+        storeSubscriptionValidators(entry.id, result, result.notModified ? entry.contentHash : contentHash);
+        appendSystemLog(QStringLiteral("[Subscription] %1 (%2) is unchanged%3.")
+                            .arg(entry.name, entry.group,
+                                 result.notModified ? QStringLiteral(" (304)") : QString()));
         if (fromRefresh) {
-            if (importedCount > 0) {
-                ++m_subscriptionRefreshSuccessCount;
-            } else {
-                ++m_subscriptionRefreshFailCount;
-                appendSystemLog(QStringLiteral("[Subscription] Refresh failed for %1 (%2): %3")
-                                    .arg(entry.name, entry.group, hadError ? netError : QStringLiteral("no valid profiles")));
+            ++m_subscriptionRefreshSuccessCount;
+        } else {
+            endSubscriptionOperation(QStringLiteral("Subscription is up to date."));
+        }
+        return;
+    }
+
+    int importedCount = 0;
+    if (result.ok) {
+        int lastImportedIndex = -1;
+        importedCount = importProfiles(decoded.profiles, entry.id, entry.name, entry.group, &lastImportedIndex);
+        if (importedCount > 0) {
+            saveProfiles();
+            storeSubscriptionValidators(entry.id, result, contentHash);
+            if (m_currentProfileIndex < 0 && lastImportedIndex >= 0) {
+                setCurrentProfileIndex(lastImportedIndex);
             }
-            if (!m_subscriptionRefreshQueue.isEmpty()) {
-                startSubscriptionFetch(m_subscriptionRefreshQueue.takeFirst(), true);
-                return;
+            // A refresh pings once after the last fetch instead of once per subscription.
+            if (m_autoPingProfiles && !fromRefresh) {
+                pingAllProfiles();
+            }
+            appendSystemLog(QStringLiteral("[Subscription] Imported %1 profile(s) from %2 (%3).")
+                                .arg(importedCount)
+                                .arg(entry.name, entry.group));
+            if (!m_lastError.isEmpty()) {
+                setLastError(QString());
+            }
+            if (m_connectionState == ConnectionState::Error) {
+                setConnectionState(ConnectionState::Disconnected);
             }
-            finishRefreshSubscriptions();
-            return;
         }
+    }
 
+    if (fromRefresh) {
         if (importedCount > 0) {
-            endSubscriptionOperation(QStringLiteral("Imported %1 profile(s).").arg(importedCount));
+            ++m_subscriptionRefreshSuccessCount;
+            m_subscriptionRefreshImportedCount += importedCount;
+        } else {
+            ++m_subscriptionRefreshFailCount;
+            appendSystemLog(QStringLiteral("[Subscription] Refresh failed for %1 (%2) after %3 attempt(s): %4")
+                                .arg(entry.name, entry.group)
+                                .arg(result.attempts)
+                                .arg(result.ok ? QStringLiteral("no valid profiles") : result.error));
+        }
+        return;
+    }
+
+    if (importedCount > 0) {
+        endSubscriptionOperation(QStringLiteral("Imported %1 profile(s).").arg(importedCount));
+        return;
+    }
+
+    const QString message = !result.ok
+                                ? (result.timedOut
+                                       ? QStringLiteral("Subscription fetch timed out.")
+                                       : (result.error.isEmpty()
+                                              ? QStringLiteral("Failed to fetch subscription URL.")
+                                              : QStringLiteral("Subscription fetch failed: %1").arg(result.error)))
+                                : QStringLiteral("Subscription payload has no supported VMESS/VLESS links.");
+    appendSystemLog(QStringLiteral("[Subscription] %1 (%2): %3")
+                        .arg(entry.name, entry.group, message));
+    setLastError(message);
+    endSubscriptionOperation(message);
+}
+
+void VpnController::storeSubscriptionValidators(
+    const QString& id,
+    const SubscriptionFetchResult& result,
+    const QString& contentHash)
+{
+    for (SubscriptionEntry& entry : m_subscriptionEntries) {
+        if (entry.id != id) {
+            continue;
+        }
+        // A 304 may omit the validators; keep the ones that produced it.
+        const QString etag = result.etag.isEmpty() && result.notModified
+                                 ? entry.etag
+                                 : QString::fromLatin1(result.etag);
+        const QString lastModified = result.lastModified.isEmpty() && result.notModified
+                                         ? entry.lastModified
+                                         : QString::fromLatin1(result.lastModified);
+        if (entry.etag == etag && entry.lastModified == lastModified && entry.contentHash == contentHash) {
             return;
         }
+        entry.etag = etag;
+        entry.lastModified = lastModified;
+        entry.contentHash = contentHash;
+        saveSubscriptions();
+        return;
+    }
+}
 
-        const QString message = hadError
-                                    ? (timedOut
-                                           ? QStringLiteral("Subscription fetch timed out.")
-                                           : (netError.isEmpty()
-                                                  ? QStringLiteral("Failed to fetch subscription URL.")
-                                                  : QStringLiteral("Subscription fetch failed: %1").arg(netError)))
-                                    : QStringLiteral("Subscription payload has no supported VMESS/VLESS links.");
-        appendSystemLog(QStringLiteral("[Subscription] %1 (%2): %3")
-                            .arg(entry.name, entry.group, message));
-        setLastError(message);
-        endSubscriptionOperation(message);
-    });
+void VpnController::onSubscriptionFetchesFinished()
+{
+    m_subscriptionFetchesDone = true;
+    if (m_subscriptionDecodesPending == 0) {
+        completeSubscriptionFetches();
+    }
+}
+
+void VpnController::completeSubscriptionFetches()
+{
+    m_subscriptionFetchEntries.clear();
+    m_subscriptionDecodeFetches.clear();
+    if (!m_subscriptionFetchFromRefresh) {
+        return;
+    }
+    if (m_subscriptionRefreshImportedCount > 0 && m_autoPingProfiles) {
+        pingAllProfiles();
+    }
+    finishRefreshSubscriptions();
 }
 
 void VpnController::finishRefreshSubscriptions()
@@ -2829,6 +3437,39 @@ bool VpnController::updateProfileBasics(int row, const QString& name, const QStr
     return true;
 }
 
+QVariantMap VpnController::profileTransportTuning(int row) const
+{
+    const QList<ServerProfile>& profiles = m_profileModel.profiles();
+    if (row < 0 || row >= profiles.size()) {
+        return {};
+    }
+    return profiles.at(row).transportTuning().toJson().toVariantMap();
+}
+
+bool VpnController::updateProfileTransportTuning(int row, const QVariantMap& tuning)
+{
+    QList<ServerProfile> profiles = m_profileModel.profiles();
+    if (row < 0 || row >= profiles.size()) {
+        setLastError(QStringLiteral("Profile is no longer available."));
+        return false;
+    }
+
+    ServerProfile& profile = profiles[row];
+    const TransportTuning updated = TransportTuning::fromJson(QJsonObject::fromVariantMap(tuning));
+    if (updated.toJson() == profile.transportTuning().toJson()) {
+        return true;
+    }
+
+    profile.setTransportTuning(updated);
+    m_profileModel.setProfiles(profiles);
+    saveProfiles();
+    appendSystemLog(
+        QStringLiteral("[Profile] Updated transport tuning for '%1'%2.")
+            .arg(profile.displayLabel(),
+                 row == m_currentProfileIndex && connected() ? QStringLiteral(" (applies on reconnect)") : QString()));
+    return true;
+}
+
 int VpnController::removeAllProfiles()
 {
     const int removedCount = m_profileModel.rowCount();
@@ -2992,6 +3633,16 @@ void VpnController::connectToProfile(int row)
         return;
     }
 
+    // Until the probe reports back nothing is known about the core, and the
+    // config would silently lose app rules and transport options.
+    if (m_xrayCapabilitiesPending) {
+        m_connectAfterProbeProfileIndex = row;
+        setCurrentProfileIndex(row);
+        setConnectionState(ConnectionState::Connecting);
+        appendSystemLog(QStringLiteral("[System] Checking xray-core capabilities before connecting..."));
+        return;
+    }
+
     setCurrentProfileIndex(row);
     const quint64 connectAttempt = m_connectAttemptCounter.fetch_add(1) + 1;
     m_disconnectRequested.store(false);
@@ -3057,14 +3708,17 @@ void VpnController::connectToProfile(int row)
                 if (ok) {
                     guard->m_disconnectRequested.store(false);
                     guard->m_privilegedTunManaged = true;
-                    guard->m_privilegedTunLogOffset = 0;
-                    guard->m_privilegedTunLogBuffer.clear();
-                    guard->m_privilegedTunLogTimer.start();
+                    QMetaObject::invokeMethod(guard->m_logPipeline, &LogPipeline::startTail,
+                                              Qt::QueuedConnection, guard->m_privilegedTunLogPath);
                     guard->writeManagedRuntimeRecord(guard->m_privilegedTunRuntimePid, QStringLiteral("tun"));
                     guard->beginProfileUsageSession(guard->m_activeProfileUsageId);
                     guard->setConnectionState(ConnectionState::Connected);
                     guard->setLastError(QString());
                     guard->appendSystemLog(QStringLiteral("[System] TUN mode active: system traffic should route through Xray TUN."));
+                    QJsonObject tuning = guard->m_lastTunTuning;
+                    tuning.insert(QStringLiteral("mtu"), guard->m_activeTunMtu);
+                    guard->recordTunTuning(guard->m_activeProfileUsageId, tuning);
+                    guard->startTunPathMtuProbe();
                     guard->appendSystemLog(QStringLiteral("[System] Xray started (privileged TUN). Local proxy (mixed): 127.0.0.1:%1.")
                                                .arg(guard->m_buildOptions.socksPort));
                     guard->m_statsPollTimer.start();
@@ -3115,6 +3769,7 @@ void VpnController::connectSelected()
 
 void VpnController::disconnect()
 {
+    m_connectAfterProbeProfileIndex = -1;
     m_disconnectRequested.store(true);
     m_connectAttemptCounter.fetch_add(1);
     m_statsPollTimer.stop();
@@ -3131,7 +3786,7 @@ void VpnController::disconnect()
     resetPerProfileUsageSamples();
 
     if (m_privilegedTunManaged) {
-        m_privilegedTunLogTimer.stop();
+        QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::stopTail, Qt::QueuedConnection);
         setConnectionState(ConnectionState::Connecting);
         const QPointer<VpnController> guard(this);
         [[maybe_unused]] auto tunStopFuture = QtConcurrent::run([guard]() {
@@ -3246,7 +3901,7 @@ void VpnController::setXrayExecutableFromUrl(const QUrl& url)
     setXrayExecutablePath(url.toLocalFile());
 }
 
-void VpnController::startSpeedTestRequest(const QUrl& url, bool upload, const QByteArray& payload)
+void VpnController::startSpeedTestRequest(const QUrl& url, bool upload)
 {
     QUrl requestUrl(url);
     QUrlQuery query(requestUrl);
@@ -3268,23 +3923,15 @@ void VpnController::startSpeedTestRequest(const QUrl& url, bool upload, const QB
     request.setTransferTimeout(timeoutMs);
 
     m_speedTestUploadMode = upload;
-    m_speedTestReply = upload
-                           ? m_speedTestNetworkManager.post(request, payload)
-                           : m_speedTestNetworkManager.get(request);
-    connect(m_speedTestReply, &QNetworkReply::downloadProgress, this, &VpnController::onSpeedTestDownloadProgress);
-    connect(m_speedTestReply, &QNetworkReply::uploadProgress, this, &VpnController::onSpeedTestUploadProgress);
-    connect(m_speedTestReply, &QNetworkReply::sslErrors, this, [this](const QList<QSslError>& errors) {
-        Q_UNUSED(errors)
-        if (m_speedTestReply != nullptr) {
-            m_speedTestReply->abort();
-        }
-    });
     m_speedTestRequestTimer.restart();
     m_speedTestSampleWindowStartMs = -1;
     m_speedTestSampleWindowStartBytes = m_speedTestBytesReceived;
     m_speedTestLastProgressElapsedMs = 0;
-    connect(m_speedTestReply, &QNetworkReply::readyRead, this, &VpnController::onSpeedTestReadyRead);
-    connect(m_speedTestReply, &QNetworkReply::finished, this, &VpnController::onSpeedTestFinished);
+    // Streams grow from one while throughput keeps rising; see updateSpeedTestSampling().
+    // Upload bodies are generated while they are sent; nothing is buffered up front.
+    // Phases end on the clock, not on a byte count, so fast links are
+    // measured over the same window as slow ones.
+    m_speedTestEngine.start(request, upload, kSpeedTestUploadPayloadBytes, 0, static_cast<int>(m_speedTestPhaseDurationMs));
 }
 
 void VpnController::startCurrentSpeedTestRequest()
@@ -3293,14 +3940,9 @@ void VpnController::startCurrentSpeedTestRequest()
         return;
     }
 
-    if (m_speedTestReply != nullptr) {
-        QObject::disconnect(m_speedTestReply, nullptr, this, nullptr);
-        m_speedTestReply->abort();
-        m_speedTestReply->deleteLater();
-        m_speedTestReply = nullptr;
-    }
+    m_speedTestEngine.stop();
 
-    const bool uploadPhase = (m_speedTestPhase == QStringLiteral("Upload"));
+    const bool uploadPhase = (m_speedTestPhase == SpeedTestSnapshot::Upload);
     const QList<QUrl> endpoints = uploadPhase
                                       ? speedTestUploadFallbackUrls(m_speedTestSelectedSizeMb)
                                       : speedTestDownloadFallbackUrls(m_speedTestSelectedSizeMb);
@@ -3318,15 +3960,14 @@ void VpnController::startCurrentSpeedTestRequest()
         finishSpeedTest(false, QStringLiteral("Invalid speed test endpoint."));
         return;
     }
+    (uploadPhase ? m_speedTestUploadEndpoint : m_speedTestDownloadEndpoint) = url.host();
 
-    const QByteArray payload = uploadPhase ? buildUploadPayload() : QByteArray();
-    startSpeedTestRequest(url, uploadPhase, payload);
+    startSpeedTestRequest(url, uploadPhase);
 }
 
 void VpnController::startPingPhase()
 {
-    m_speedTestState = QStringLiteral("Testing");
-    m_speedTestPhase = QStringLiteral("Latency");
+    m_speedTestPhase = SpeedTestSnapshot::Latency;
     m_speedTestDurationSec = 2;
     m_speedTestElapsedSec = 0;
     m_speedTestProgress = 0.0;
@@ -3339,6 +3980,11 @@ void VpnController::startPingPhase()
     m_speedTestLatencyAttemptCount = 0;
     m_speedTestLatencySuccessCount = 0;
     m_speedTestLatencySamples.clear();
+    m_speedTestIdleProbeSamples.clear();
+    m_speedTestDownloadLatencySamples.clear();
+    m_speedTestUploadLatencySamples.clear();
+    m_speedTestBufferbloatMs = -1;
+    m_speedTestBufferbloatGrade.clear();
     m_speedTestPingMs = -1;
     m_speedTestJitterMs = -1;
     m_speedTestLatencyMinMs = -1;
@@ -3351,11 +3997,14 @@ void VpnController::startPingPhase()
     m_speedTestSampleWindowStartMs = -1;
     m_speedTestSampleWindowStartBytes = 0;
     m_speedTestWarmupUntilMs = 0;
-    m_speedTestExpectedBytes = 0;
+    m_speedTestPhaseDurationMs = 0;
+    m_speedTestUdpResult = UdpProbeResult();
+    m_speedTestLatencyWaitingForUdp = false;
     m_speedTestPhaseTimer.restart();
     m_speedTestSampleTimer.restart();
     emit speedTestChanged();
 
+    startSpeedTestUdpProbe();
     QTimer::singleShot(0, this, [this]() {
         runNextSpeedTestLatencyProbe();
     });
@@ -3363,8 +4012,7 @@ void VpnController::startPingPhase()
 
 void VpnController::startDownloadPhase()
 {
-    m_speedTestState = QStringLiteral("Testing");
-    m_speedTestPhase = QStringLiteral("Download");
+    m_speedTestPhase = SpeedTestSnapshot::Download;
     m_speedTestDurationSec = qMax(4, normalizedSpeedTestSizeMb(m_speedTestSelectedSizeMb));
     m_speedTestElapsedSec = 0;
     m_speedTestProgress = 0.0;
@@ -3379,12 +4027,14 @@ void VpnController::startDownloadPhase()
     m_speedTestSampleWindowStartMs = -1;
     m_speedTestSampleWindowStartBytes = 0;
     m_speedTestAttempt = 0;
-    m_speedTestExpectedBytes =
-        static_cast<qint64>(normalizedSpeedTestSizeMb(m_speedTestSelectedSizeMb)) * 1024 * 1024;
+    m_speedTestPhaseDurationMs = static_cast<qint64>(m_speedTestDurationSec) * 1000;
+    m_speedTestDownloadLatencySamples.clear();
+    m_speedTestTunnelProbe.abort();
     m_speedTestPhaseTimer.restart();
     m_speedTestWarmupUntilMs = kSpeedTestWarmupMs;
     m_speedTestLastProgressElapsedMs = 0;
     m_speedTestSampleTimer.restart();
+    m_speedTestLoadedProbeTimer.start();
     emit speedTestChanged();
 
     startCurrentSpeedTestRequest();
@@ -3392,8 +4042,7 @@ void VpnController::startDownloadPhase()
 
 void VpnController::startUploadPhase()
 {
-    m_speedTestState = QStringLiteral("Testing");
-    m_speedTestPhase = QStringLiteral("Upload");
+    m_speedTestPhase = SpeedTestSnapshot::Upload;
     m_speedTestDurationSec = qMax(3, normalizedSpeedTestSizeMb(m_speedTestSelectedSizeMb) / 2);
     m_speedTestElapsedSec = 0;
     m_speedTestProgress = 0.0;
@@ -3408,33 +4057,42 @@ void VpnController::startUploadPhase()
     m_speedTestSampleWindowStartMs = -1;
     m_speedTestSampleWindowStartBytes = 0;
     m_speedTestAttempt = 0;
-    m_speedTestExpectedBytes = kSpeedTestUploadPayloadBytes;
+    m_speedTestPhaseDurationMs = static_cast<qint64>(m_speedTestDurationSec) * 1000;
+    m_speedTestUploadLatencySamples.clear();
+    m_speedTestTunnelProbe.abort();
     m_speedTestPhaseTimer.restart();
     m_speedTestWarmupUntilMs = kSpeedTestWarmupMs;
     m_speedTestLastProgressElapsedMs = 0;
     m_speedTestSampleTimer.restart();
+    m_speedTestLoadedProbeTimer.start();
     emit speedTestChanged();
     startCurrentSpeedTestRequest();
 }
 
 void VpnController::startAnalyzePhase()
 {
-    m_speedTestState = QStringLiteral("Analyzing");
-    m_speedTestPhase = QStringLiteral("Analyzing");
+    m_speedTestPhase = SpeedTestSnapshot::Analyzing;
     m_speedTestDurationSec = 1;
     m_speedTestElapsedSec = 0;
     m_speedTestProgress = 1.0;
+    m_speedTestLoadedProbeTimer.stop();
+    m_speedTestTunnelProbe.abort();
+    finalizeSpeedTestBufferbloatMetrics();
     finalizeSpeedTestQualityMetrics();
     emit speedTestChanged();
 }
 
 void VpnController::runNextSpeedTestLatencyProbe()
 {
-    if (!m_speedTestRunning || m_speedTestPhase != QStringLiteral("Latency")) {
+    if (!m_speedTestRunning || m_speedTestPhase != SpeedTestSnapshot::Latency) {
         return;
     }
 
     if (m_speedTestLatencyAttemptCount >= kSpeedTestLatencyProbeCount) {
+        if (m_speedTestUdpProbe.isRunning()) {
+            m_speedTestLatencyWaitingForUdp = true;
+            return;
+        }
         finalizeSpeedTestLatencyMetrics();
         startDownloadPhase();
         return;
@@ -3455,6 +4113,8 @@ void VpnController::runNextSpeedTestLatencyProbe()
     }
 
     ++m_speedTestLatencyAttemptCount;
+    // Idle baseline for bufferbloat, sampled the same way as under load.
+    m_speedTestTunnelProbe.probe(QUrl(QString::fromLatin1(kLatencyProbeEndpoint)), kSpeedTestLatencyProbeTimeoutMs);
     m_speedTestProgress = qBound(
         0.0,
         static_cast<double>(m_speedTestLatencyAttemptCount) / static_cast<double>(kSpeedTestLatencyProbeCount),
@@ -3468,7 +4128,7 @@ void VpnController::runNextSpeedTestLatencyProbe()
             return;
         }
         socketGuard->setProperty("gc_probe_done", true);
-        if (!m_speedTestRunning || m_speedTestPhase != QStringLiteral("Latency")) {
+        if (!m_speedTestRunning || m_speedTestPhase != SpeedTestSnapshot::Latency) {
             socketGuard->abort();
             socketGuard->deleteLater();
             return;
@@ -3486,7 +4146,7 @@ void VpnController::runNextSpeedTestLatencyProbe()
             0.0,
             static_cast<double>(m_speedTestLatencyAttemptCount) / static_cast<double>(kSpeedTestLatencyProbeCount),
             1.0);
-        emit speedTestChanged();
+        requestSpeedTestSnapshot();
         QTimer::singleShot(kSpeedTestLatencyProbeGapMs, this, [this]() {
             runNextSpeedTestLatencyProbe();
         });
@@ -3509,6 +4169,85 @@ void VpnController::runNextSpeedTestLatencyProbe()
     socket->connectToHost(host, static_cast<quint16>(port));
 }
 
+void VpnController::runLoadedLatencyProbe()
+{
+    const bool uploadPhase = (m_speedTestPhase == SpeedTestSnapshot::Upload);
+    if (!m_speedTestRunning || (!uploadPhase && m_speedTestPhase != SpeedTestSnapshot::Download)) {
+        m_speedTestLoadedProbeTimer.stop();
+        return;
+    }
+    // Only sample once the transfer moves data. The probe shares the transfer's
+    // network manager, so it crosses the same proxy or TUN path.
+    if (m_speedTestBytesReceived <= 0) {
+        return;
+    }
+    m_speedTestTunnelProbe.probe(QUrl(QString::fromLatin1(kLatencyProbeEndpoint)),
+                                 kSpeedTestLatencyProbeTimeoutMs,
+                                 kSpeedTestLoadedProbeMaxInFlight);
+}
+
+void VpnController::startSpeedTestUdpProbe()
+{
+    // Through the mixed inbound in TUN mode too: tun-in hijacks port 53 to
+    // the built-in resolver, which would answer from its cache.
+    UdpProbe::Options options;
+    options.host = QString::fromLatin1(kSpeedTestUdpProbeHost);
+    options.port = kSpeedTestUdpProbePort;
+    options.responder = UdpProbe::Responder::Dns;
+    options.socksPort = m_buildOptions.socksPort;
+    options.count = kSpeedTestUdpProbeCount;
+    options.intervalMs = kSpeedTestUdpProbeIntervalMs;
+    options.timeoutMs = kSpeedTestUdpProbeTimeoutMs;
+
+    QString error;
+    if (!m_speedTestUdpProbe.start(options, &error)) {
+        m_speedTestUdpResult.error = error;
+        appendSystemLog(QStringLiteral("[SpeedTest] UDP probe unavailable (%1); loss and jitter come from TCP connects.").arg(error));
+    }
+}
+
+void VpnController::onSpeedTestUdpProbeFinished(bool ok, const QString& error)
+{
+    if (!m_speedTestRunning) {
+        return;
+    }
+    m_speedTestUdpResult = m_speedTestUdpProbe.result();
+    if (ok) {
+        appendSystemLog(QStringLiteral("[SpeedTest] UDP probe: %1/%2 answered, loss %3%, jitter %4 ms, reordered %5.")
+                            .arg(m_speedTestUdpResult.received)
+                            .arg(m_speedTestUdpResult.sent)
+                            .arg(m_speedTestUdpResult.lossPct, 0, 'f', 1)
+                            .arg(qMax(0.0, m_speedTestUdpResult.jitterMs), 0, 'f', 1)
+                            .arg(m_speedTestUdpResult.reordered));
+    } else {
+        appendSystemLog(QStringLiteral("[SpeedTest] UDP probe failed (%1); loss and jitter come from TCP connects.").arg(error));
+    }
+    finalizeSpeedTestLatencyMetrics();
+    requestSpeedTestSnapshot();
+
+    if (m_speedTestLatencyWaitingForUdp) {
+        m_speedTestLatencyWaitingForUdp = false;
+        runNextSpeedTestLatencyProbe();
+    }
+}
+
+void VpnController::finalizeSpeedTestBufferbloatMetrics()
+{
+    // Both sides come from the tunnel probe; the TCP connect samples of the
+    // latency phase do not cross the proxy.
+    const int idleMs = percentileLatency(m_speedTestIdleProbeSamples, 50.0);
+    const int loadedMs = qMax(
+        percentileLatency(m_speedTestDownloadLatencySamples, 50.0),
+        percentileLatency(m_speedTestUploadLatencySamples, 50.0));
+    if (idleMs < 0 || loadedMs < 0) {
+        m_speedTestBufferbloatMs = -1;
+        m_speedTestBufferbloatGrade.clear();
+        return;
+    }
+    m_speedTestBufferbloatMs = qMax(0, loadedMs - idleMs);
+    m_speedTestBufferbloatGrade = bufferbloatGradeForIncrease(m_speedTestBufferbloatMs);
+}
+
 void VpnController::finalizeSpeedTestLatencyMetrics()
 {
     if (m_speedTestLatencySamples.isEmpty()) {
@@ -3533,6 +4272,14 @@ void VpnController::finalizeSpeedTestLatencyMetrics()
     } else {
         m_speedTestPacketLossPct = 0.0;
     }
+
+    // TCP retransmits hide loss; datagrams that never came back do not.
+    if (m_speedTestUdpResult.measured() && m_speedTestUdpResult.error.isEmpty()) {
+        m_speedTestPacketLossPct = m_speedTestUdpResult.lossPct;
+        if (m_speedTestUdpResult.jitterMs >= 0.0) {
+            m_speedTestJitterMs = qRound(m_speedTestUdpResult.jitterMs);
+        }
+    }
 }
 
 int VpnController::percentileLatency(const QVector<int>& samples, double percentile)
@@ -3560,7 +4307,12 @@ void VpnController::finalizeSpeedTestQualityMetrics()
     const double latencyPenalty = qMin(45.0, static_cast<double>(latencyMs) * 0.18);
     const double jitterPenalty = qMin(30.0, static_cast<double>(jitterMs) * 0.55);
     const double lossPenalty = qMin(40.0, lossPct * 2.2);
-    const int score = static_cast<int>(qRound(qBound(0.0, 100.0 - latencyPenalty - jitterPenalty - lossPenalty, 100.0)));
+    const double bufferbloatPenalty =
+        m_speedTestBufferbloatMs >= 0 ? qMin(20.0, static_cast<double>(m_speedTestBufferbloatMs) * 0.06) : 0.0;
+    const int score = static_cast<int>(qRound(qBound(
+        0.0,
+        100.0 - latencyPenalty - jitterPenalty - lossPenalty - bufferbloatPenalty,
+        100.0)));
 
     m_speedTestQualityScore = score;
     m_speedTestRouteStabilityPct = qBound(0, score, 100);
@@ -3568,28 +4320,24 @@ void VpnController::finalizeSpeedTestQualityMetrics()
 
 void VpnController::finishSpeedTest(bool ok, const QString& error)
 {
-    if (m_speedTestReply != nullptr) {
-        QObject::disconnect(m_speedTestReply, nullptr, this, nullptr);
-        m_speedTestReply->abort();
-        m_speedTestReply->deleteLater();
-        m_speedTestReply = nullptr;
-    }
+    m_speedTestEngine.stop();
+    m_speedTestUdpProbe.stop();
+    m_speedTestLatencyWaitingForUdp = false;
     m_speedTestTimer.stop();
+    m_speedTestLoadedProbeTimer.stop();
+    m_speedTestTunnelProbe.abort();
     m_speedTestRunning = false;
     m_speedTestCurrentMbps = 0.0;
     m_speedTestAverageMbps = ok ? combinedSpeedTestAverageMbps(m_speedTestDownloadMbps, m_speedTestUploadMbps) : 0.0;
     m_speedTestProgress = ok ? 1.0 : m_speedTestProgress;
     if (ok) {
-        m_speedTestState = QStringLiteral("Completed");
-        m_speedTestPhase = QStringLiteral("Completed");
+        m_speedTestPhase = SpeedTestSnapshot::Completed;
         m_speedTestError.clear();
     } else if (m_speedTestCancelledByUser) {
-        m_speedTestState = QStringLiteral("Cancelled");
-        m_speedTestPhase = QStringLiteral("Cancelled");
+        m_speedTestPhase = SpeedTestSnapshot::Cancelled;
         m_speedTestError.clear();
     } else {
-        m_speedTestState = QStringLiteral("Failed");
-        m_speedTestPhase = QStringLiteral("Failed");
+        m_speedTestPhase = SpeedTestSnapshot::Failed;
         m_speedTestError = error;
     }
     m_speedTestPhaseTimer.invalidate();
@@ -3597,29 +4345,7 @@ void VpnController::finishSpeedTest(bool ok, const QString& error)
     emit speedTestChanged();
 
     if (ok) {
-        const double downMbps = qMax(0.0, m_speedTestDownloadMbps);
-        const double upMbps = qMax(0.0, m_speedTestUploadMbps);
-        const double overallMbps = qMax(0.0, m_speedTestAverageMbps);
-        QString resultLine = QStringLiteral("Size %1 MB: DL %2 Mbps | UL %3 Mbps | AVG %4 Mbps")
-                                 .arg(normalizedSpeedTestSizeMb(m_speedTestSelectedSizeMb))
-                                 .arg(QString::number(downMbps, 'f', 2))
-                                 .arg(QString::number(upMbps, 'f', 2))
-                                 .arg(QString::number(overallMbps, 'f', 2));
-        if (m_speedTestPingMs >= 0) {
-            resultLine += QStringLiteral(" | Ping %1 ms").arg(m_speedTestPingMs);
-        }
-        if (m_speedTestJitterMs >= 0) {
-            resultLine += QStringLiteral(" | Jitter %1 ms").arg(m_speedTestJitterMs);
-        }
-        resultLine += QStringLiteral(" | Loss %1%").arg(QString::number(m_speedTestPacketLossPct, 'f', 1));
-        if (m_speedTestQualityScore >= 0) {
-            resultLine += QStringLiteral(" | Quality %1/100").arg(m_speedTestQualityScore);
-        }
-        m_speedTestHistory.prepend(resultLine);
-        while (m_speedTestHistory.size() > kSpeedTestHistoryMaxItems) {
-            m_speedTestHistory.removeLast();
-        }
-        appendSystemLog(QStringLiteral("[SpeedTest] %1").arg(resultLine));
+        recordSpeedTestResult();
     } else if (!m_speedTestCancelledByUser) {
         appendSystemLog(QStringLiteral("[SpeedTest] Failed: %1").arg(error));
     } else {
@@ -3629,12 +4355,49 @@ void VpnController::finishSpeedTest(bool ok, const QString& error)
     emit speedTestChanged();
 }
 
+void VpnController::recordSpeedTestResult()
+{
+    SpeedTestResult result;
+    result.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    result.profileId = m_activeProfileUsageId.trimmed();
+    const auto profile = m_profileModel.profileAt(m_profileModel.indexOfId(result.profileId));
+    if (profile.has_value()) {
+        result.profileName = profile->displayLabel();
+        result.profilePingMs = profile->lastPingMs;
+        result.transport = QStringLiteral("%1/%2/%3")
+                               .arg(profile->protocol.toString(),
+                                    profile->network.toString(),
+                                    profile->security.toString());
+    }
+    if (m_speedTestUsingDirectFallback) {
+        // Download went around the tunnel; keep the row, but do not credit the profile's transport.
+        result.transport = QStringLiteral("direct");
+    }
+    result.sizeMb = normalizedSpeedTestSizeMb(m_speedTestSelectedSizeMb);
+    result.downloadMbps = qMax(0.0, m_speedTestDownloadMbps);
+    result.uploadMbps = qMax(0.0, m_speedTestUploadMbps);
+    result.averageMbps = qMax(0.0, m_speedTestAverageMbps);
+    result.pingMs = m_speedTestPingMs;
+    result.jitterMs = m_speedTestJitterMs;
+    result.lossPct = m_speedTestPacketLossPct;
+    result.qualityScore = m_speedTestQualityScore;
+    result.bufferbloatMs = m_speedTestBufferbloatMs;
+    result.bufferbloatGrade = m_speedTestBufferbloatGrade;
+    result.downloadStreams = m_speedTestDownloadStreams;
+    result.uploadStreams = m_speedTestUploadStreams;
+    result.downloadEndpoint = m_speedTestDownloadEndpoint;
+    result.uploadEndpoint = m_speedTestUploadEndpoint;
+
+    m_speedTestHistoryModel.append(result);
+    m_persistence.markDirty(QString::fromLatin1(kSpeedTestHistoryStore));
+    appendSystemLog(QStringLiteral("[SpeedTest] %1").arg(result.summary()));
+}
+
 void VpnController::startSpeedTest()
 {
     if (!connected()) {
         m_speedTestError = QStringLiteral("Connect to VPN before running speed test.");
-        m_speedTestState = QStringLiteral("Failed");
-        m_speedTestPhase = QStringLiteral("Failed");
+        m_speedTestPhase = SpeedTestSnapshot::Failed;
         emit speedTestChanged();
         appendSystemLog(QStringLiteral("[SpeedTest] %1").arg(m_speedTestError));
         return;
@@ -3649,8 +4412,7 @@ void VpnController::startSpeedTest()
 
     m_speedTestRunning = true;
     m_speedTestCancelledByUser = false;
-    m_speedTestState = QStringLiteral("Preparing");
-    m_speedTestPhase = QStringLiteral("Preparing");
+    m_speedTestPhase = SpeedTestSnapshot::Preparing;
     m_speedTestElapsedSec = 0;
     m_speedTestDurationSec = 1;
     m_speedTestProgress = 0.0;
@@ -3665,7 +4427,7 @@ void VpnController::startSpeedTest()
     m_speedTestUploadMbps = 0.0;
     m_speedTestAverageMbps = 0.0;
     m_speedTestError.clear();
-    m_speedTestExpectedBytes = 0;
+    m_speedTestPhaseDurationMs = 0;
     m_speedTestBytesReceived = 0;
     m_speedTestLastBytes = 0;
     m_speedTestPhaseBytes = 0;
@@ -3696,25 +4458,263 @@ void VpnController::cancelSpeedTest()
 {
     const bool wasRunning = m_speedTestRunning;
     m_speedTestCancelledByUser = true;
-    if (m_speedTestReply != nullptr) {
-        QObject::disconnect(m_speedTestReply, nullptr, this, nullptr);
-        m_speedTestReply->abort();
-        m_speedTestReply->deleteLater();
-        m_speedTestReply = nullptr;
-    }
+    m_speedTestEngine.stop();
 
     if (m_speedTestTimer.isActive()) {
         m_speedTestTimer.stop();
     }
 
-    if (wasRunning) {
-        finishSpeedTest(false, QStringLiteral("Cancelled by user."));
+    if (wasRunning) {
+        finishSpeedTest(false, QStringLiteral("Cancelled by user."));
+        return;
+    }
+
+    resetSpeedTestState(true);
+    m_speedTestCancelledByUser = false;
+}
+
+bool VpnController::startTransportTuner(int row)
+{
+    const QList<ServerProfile>& profiles = m_profileModel.profiles();
+    QString error;
+    if (row < 0 || row >= profiles.size()) {
+        error = QStringLiteral("Profile is no longer available.");
+    } else if (m_speedTestRunning) {
+        error = QStringLiteral("Wait for the speed test to finish before tuning.");
+    } else if (m_batchSpeedTest.isRunning()) {
+        error = QStringLiteral("Wait for the batch speed test to finish before tuning.");
+    } else if (m_tunMode && connected()) {
+        // Candidate traffic would be captured by the active TUN device and
+        // measure the running tunnel instead of the candidate.
+        error = QStringLiteral("Disconnect TUN mode before tuning.");
+    }
+
+    if (error.isEmpty()) {
+        XrayConfigBuilder::BuildOptions options = m_buildOptions;
+        options.core = m_xrayCapabilities;
+        m_transportTuner.setExecutablePath(m_xrayExecutablePath);
+        m_transportTuner.setWorkingDirectory(m_dataDirectory);
+        m_transportTuner.setEndpoints(
+            QUrl(QString::fromLatin1(kLatencyProbeEndpoint)),
+            speedTestDownloadUrlForSizeMb(kSpeedTestMaximumSizeMb));
+        m_transportTuner.start(profiles.at(row), options, &error);
+    }
+
+    if (!error.isEmpty()) {
+        m_transportTunerStatus = error;
+        emit transportTunerChanged();
+        appendSystemLog(QStringLiteral("[Tuner] %1").arg(error));
+        return false;
+    }
+
+    m_transportTunerStatus = QStringLiteral("Preparing %1 candidate(s)...").arg(m_transportTuner.candidates().size());
+    emit transportTunerChanged();
+    appendSystemLog(QStringLiteral("[Tuner] Benchmarking %1 transport setting(s) for '%2'.")
+                        .arg(m_transportTuner.candidates().size())
+                        .arg(profiles.at(row).displayLabel()));
+    return true;
+}
+
+void VpnController::cancelTransportTuner()
+{
+    m_transportTuner.cancel();
+}
+
+bool VpnController::startBatchSpeedTest()
+{
+    const QString normalizedCurrentGroup = normalizeGroupName(m_currentProfileGroup);
+    const bool allGroups = (m_currentProfileGroup.compare(QStringLiteral("All"), Qt::CaseInsensitive) == 0);
+    QList<ServerProfile> profiles;
+    for (const ServerProfile& profile : m_profileModel.profiles()) {
+        const QString profileGroup = normalizeGroupName(profile.groupName);
+        if (!isProfileGroupEnabled(profileGroup)) {
+            continue;
+        }
+        if (!allGroups && profileGroup.compare(normalizedCurrentGroup, Qt::CaseInsensitive) != 0) {
+            continue;
+        }
+        profiles.append(profile);
+    }
+
+    QString error;
+    if (m_speedTestRunning) {
+        error = QStringLiteral("Wait for the speed test to finish before benchmarking.");
+    } else if (m_transportTuner.isRunning()) {
+        error = QStringLiteral("Wait for transport tuning to finish before benchmarking.");
+    } else if (m_tunMode && connected()) {
+        // Same constraint as the tuner: the TUN device would capture the
+        // benchmark traffic and measure the running tunnel instead.
+        error = QStringLiteral("Disconnect TUN mode before benchmarking.");
+    }
+
+    if (error.isEmpty()) {
+        XrayConfigBuilder::BuildOptions options = m_buildOptions;
+        options.core = m_xrayCapabilities;
+        m_batchSpeedTest.setExecutablePath(m_xrayExecutablePath);
+        m_batchSpeedTest.setWorkingDirectory(m_dataDirectory);
+        m_batchSpeedTest.setEndpoints(
+            QUrl(QString::fromLatin1(kLatencyProbeEndpoint)),
+            speedTestDownloadUrlForSizeMb(kSpeedTestMaximumSizeMb));
+        if (m_batchSpeedTest.startBatch(profiles, options, &error)) {
+            m_batchSpeedTestRunMs = QDateTime::currentMSecsSinceEpoch();
+        }
+    }
+
+    if (!error.isEmpty()) {
+        m_batchSpeedTestStatus = error;
+        emit batchSpeedTestChanged();
+        appendSystemLog(QStringLiteral("[SpeedTest] %1").arg(error));
+        return false;
+    }
+
+    m_batchSpeedTestStatus = QStringLiteral("Preparing %1 profile(s)...").arg(profiles.size());
+    emit batchSpeedTestChanged();
+    appendSystemLog(QStringLiteral("[SpeedTest] Benchmarking %1 profile(s) in %2.")
+                        .arg(profiles.size())
+                        .arg(currentProfileGroupLabel()));
+    return true;
+}
+
+void VpnController::cancelBatchSpeedTest()
+{
+    m_batchSpeedTest.cancel();
+}
+
+int VpnController::batchSpeedTestBestRow() const
+{
+    const QList<SpeedTestResult> ranked = rankedBatchSpeedTestResults();
+    if (ranked.isEmpty()) {
+        return -1;
+    }
+    return m_profileModel.indexOfId(ranked.constFirst().profileId);
+}
+
+void VpnController::recordBatchSpeedTestResult(int index)
+{
+    const QList<TransportTunerCandidate>& candidates = m_batchSpeedTest.candidates();
+    if (index < 0 || index >= candidates.size()) {
+        return;
+    }
+    const TransportTunerCandidate& candidate = candidates.at(index);
+    if (!candidate.measured || !candidate.ok) {
+        return;
+    }
+
+    SpeedTestResult result;
+    result.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    result.batchRunMs = m_batchSpeedTestRunMs;
+    result.profileId = candidate.profileId;
+    result.profileName = candidate.label;
+    const auto profile = m_profileModel.profileAt(m_profileModel.indexOfId(candidate.profileId));
+    if (profile.has_value()) {
+        result.profilePingMs = profile->lastPingMs;
+        result.transport = QStringLiteral("%1/%2/%3")
+                               .arg(profile->protocol.toString(),
+                                    profile->network.toString(),
+                                    profile->security.toString());
+    }
+    result.downloadMbps = candidate.throughputMbps;
+    result.averageMbps = candidate.throughputMbps;
+    result.pingMs = candidate.latencyMs;
+    if (candidate.latencyMs >= 0 && candidate.loadedLatencyMs >= 0) {
+        result.bufferbloatMs = qMax(0, candidate.loadedLatencyMs - candidate.latencyMs);
+        result.bufferbloatGrade = bufferbloatGradeForIncrease(result.bufferbloatMs);
+    }
+    result.downloadStreams = candidate.streams;
+    result.downloadEndpoint = speedTestDownloadUrlForSizeMb(kSpeedTestMaximumSizeMb).host();
+
+    m_speedTestHistoryModel.append(result);
+    m_persistence.markDirty(QString::fromLatin1(kSpeedTestHistoryStore));
+}
+
+QList<SpeedTestResult> VpnController::rankedBatchSpeedTestResults() const
+{
+    QList<SpeedTestResult> ranked = m_speedTestHistoryModel.batchResults(m_batchSpeedTestRunMs);
+    std::stable_sort(ranked.begin(), ranked.end(), [](const SpeedTestResult& left, const SpeedTestResult& right) {
+        return batchSpeedTestScore(left) > batchSpeedTestScore(right);
+    });
+    return ranked;
+}
+
+void VpnController::onBatchSpeedTestFinished(bool ok, const QString& error)
+{
+    const QList<SpeedTestResult> ranked = rankedBatchSpeedTestResults();
+    for (int rank = 0; rank < ranked.size(); ++rank) {
+        const SpeedTestResult& result = ranked.at(rank);
+        appendSystemLog(QStringLiteral("[SpeedTest] #%1 %2: %3 ms, %4 Mbps.")
+                            .arg(rank + 1)
+                            .arg(result.profileName)
+                            .arg(result.pingMs)
+                            .arg(QString::number(result.downloadMbps, 'f', 2)));
+    }
+
+    if (ranked.isEmpty()) {
+        m_batchSpeedTestStatus = ok ? QStringLiteral("No profile could be measured.") : error;
+    } else {
+        const SpeedTestResult& best = ranked.constFirst();
+        m_batchSpeedTestStatus = QStringLiteral("%1%2 of %3 profile(s) measured; fastest: %4 (%5 Mbps).")
+                                     .arg(ok ? QString() : QStringLiteral("%1 ").arg(error))
+                                     .arg(ranked.size())
+                                     .arg(m_batchSpeedTest.candidates().size())
+                                     .arg(best.profileName, QString::number(best.downloadMbps, 'f', 2));
+    }
+    appendSystemLog(QStringLiteral("[SpeedTest] %1").arg(m_batchSpeedTestStatus));
+    emit batchSpeedTestChanged();
+}
+
+void VpnController::onTransportTunerFinished(bool ok, const QString& error)
+{
+    for (const TransportTunerCandidate& candidate : m_transportTuner.candidates()) {
+        if (!candidate.measured) {
+            continue;
+        }
+        appendSystemLog(candidate.ok
+                            ? QStringLiteral("[Tuner] %1%2: %3 ms idle, %4 ms loaded, %5 Mbps.")
+                                  .arg(candidate.label,
+                                       candidate.current ? QStringLiteral(" (current)") : QString())
+                                  .arg(candidate.latencyMs)
+                                  .arg(candidate.loadedLatencyMs)
+                                  .arg(QString::number(candidate.throughputMbps, 'f', 2))
+                            : QStringLiteral("[Tuner] %1: failed (%2).").arg(candidate.label, candidate.error));
+    }
+
+    if (!ok) {
+        m_transportTunerStatus = error;
+        appendSystemLog(QStringLiteral("[Tuner] %1").arg(error));
+        emit transportTunerChanged();
+        return;
+    }
+
+    const int winnerIndex = m_transportTuner.recommendedIndex();
+    const int row = m_profileModel.indexOfId(m_transportTuner.profileId());
+    if (winnerIndex < 0 || row < 0) {
+        m_transportTunerStatus = QStringLiteral("Current settings are already the fastest.");
+        appendSystemLog(QStringLiteral("[Tuner] %1").arg(m_transportTunerStatus));
+        emit transportTunerChanged();
         return;
     }
 
-    resetSpeedTestState(true);
-    m_speedTestState = QStringLiteral("Idle");
-    m_speedTestCancelledByUser = false;
+    // Only the benchmarked knobs change; other overrides edited meanwhile stay.
+    const TransportTunerCandidate& winner = m_transportTuner.candidates().at(winnerIndex);
+    QList<ServerProfile> profiles = m_profileModel.profiles();
+    ServerProfile& profile = profiles[row];
+    TransportTuning tuning = profile.transportTuning();
+    tuning.mux = winner.tuning.mux;
+    if (!winner.tuning.tcpCongestion.isEmpty()) {
+        tuning.tcpCongestion = winner.tuning.tcpCongestion;
+    }
+    if (winner.tuning.fragment) {
+        tuning.fragment = winner.tuning.fragment;
+    }
+    profile.setTransportTuning(tuning);
+    m_profileModel.setProfiles(profiles);
+    saveProfiles();
+
+    m_transportTunerStatus = QStringLiteral("Applied %1 (%2 Mbps).")
+                                 .arg(winner.label, QString::number(winner.throughputMbps, 'f', 2));
+    appendSystemLog(QStringLiteral("[Tuner] Stored '%1' for '%2'; used from the next connect.")
+                        .arg(winner.label, profile.displayLabel()));
+    emit transportTunerChanged();
 }
 
 QUrl VpnController::speedTestDownloadUrlForSizeMb(int sizeMb) const
@@ -3940,35 +4940,14 @@ void VpnController::onProcessError(const QString& error)
     setConnectionState(ConnectionState::Error);
 }
 
-void VpnController::scheduleLogsChanged()
-{
-    m_logsDirty = true;
-    if (!m_logsFlushTimer.isActive()) {
-        m_logsFlushTimer.start();
-    }
-}
-
-void VpnController::onLogLine(const QString& line)
+void VpnController::onLogSnapshot(const QStringList& lines, const QString& latestRuntimeLine)
 {
-    if (!m_loggingEnabled) {
-        return;
-    }
-    if (isNoisyTrafficLine(line)) {
-        return;
-    }
-    // Hide internal Stats API polling noise from UI logs.
-    if (line.contains(QStringLiteral("[api-in -> api]"))) {
-        return;
-    }
-
-    m_latestLogLine = line;
-    emit latestLogLineChanged();
-
-    m_recentLogs.append(line);
-    while (m_recentLogs.size() > kMaxLogLines) {
-        m_recentLogs.removeFirst();
+    m_recentLogs = lines;
+    if (m_latestLogLine != latestRuntimeLine) {
+        m_latestLogLine = latestRuntimeLine;
+        emit latestLogLineChanged();
     }
-    scheduleLogsChanged();
+    emit logsChanged();
 }
 
 void VpnController::onTrafficUpdated()
@@ -4057,34 +5036,12 @@ void VpnController::onSpeedTestTick()
 
     updateSpeedTestSampling(false);
 
-    const bool transferPhase =
-        (m_speedTestPhase == QStringLiteral("Download") || m_speedTestPhase == QStringLiteral("Upload"));
-    const bool uploadPhase = (m_speedTestPhase == QStringLiteral("Upload"));
+    const bool transferPhase = SpeedTestSnapshot::isTransfer(m_speedTestPhase);
+    const bool uploadPhase = (m_speedTestPhase == SpeedTestSnapshot::Upload);
     const qint64 elapsedMs = m_speedTestPhaseTimer.isValid() ? m_speedTestPhaseTimer.elapsed() : 0;
     const qint64 sinceProgressMs = qMax<qint64>(0, elapsedMs - m_speedTestLastProgressElapsedMs);
-    const bool uploadPayloadSent =
-        uploadPhase && m_speedTestExpectedBytes > 0 && m_speedTestBytesReceived >= m_speedTestExpectedBytes;
-
-    if (transferPhase
-        && m_speedTestPhaseTimer.isValid()
-        && uploadPayloadSent
-        && sinceProgressMs >= kSpeedTestUploadResponseIdleFinalizeMs) {
-        updateSpeedTestSampling(true);
-        const qint64 elapsedForMbps = qMax<qint64>(
-            1,
-            m_speedTestMeasuredDurationMs > 0
-                ? m_speedTestMeasuredDurationMs
-                : (m_speedTestPhaseTimer.isValid()
-                       ? m_speedTestPhaseTimer.elapsed()
-                       : m_speedTestRequestTimer.elapsed()));
-        const qint64 bytesForMbps = m_speedTestMeasuredBytes > 0 ? m_speedTestMeasuredBytes : m_speedTestBytesReceived;
-        const double averageMbps = mbpsFromBytes(bytesForMbps, elapsedForMbps);
-        m_speedTestUploadMbps = qMax(0.0, qMax(averageMbps, m_speedTestAverageMbps));
-        m_speedTestProgress = 1.0;
-        appendSystemLog(QStringLiteral("[SpeedTest] Upload response idle timeout reached; finalizing upload with transmitted data."));
-        startAnalyzePhase();
-        finishSpeedTest(true);
-        return;
+    if (transferPhase && m_speedTestPhaseDurationMs > 0) {
+        m_speedTestProgress = qBound(0.0, static_cast<double>(elapsedMs) / static_cast<double>(m_speedTestPhaseDurationMs), 1.0);
     }
 
     if (transferPhase
@@ -4141,106 +5098,56 @@ void VpnController::onSpeedTestTick()
         finishSpeedTest(false, QStringLiteral("Speed test stalled waiting for transfer progress."));
         return;
     }
-    emit speedTestChanged();
-}
-
-void VpnController::onSpeedTestReadyRead()
-{
-    auto *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!m_speedTestRunning || m_speedTestReply == nullptr || reply == nullptr || reply != m_speedTestReply) {
-        return;
-    }
-    if (!reply->isOpen()) {
-        return;
-    }
-
-    const QByteArray chunk = reply->readAll();
-    Q_UNUSED(chunk)
+    requestSpeedTestSnapshot();
 }
 
-void VpnController::onSpeedTestDownloadProgress(qint64 received, qint64 total)
+void VpnController::onSpeedTestProgress()
 {
     if (!m_speedTestRunning) {
         return;
     }
-    if (m_speedTestUploadMode) {
-        return;
-    }
 
-    if (received > m_speedTestBytesReceived) {
-        if (m_speedTestPingMs < 0 && m_speedTestRequestTimer.isValid()) {
+    const qint64 transferred = m_speedTestEngine.totalBytes();
+    if (transferred > m_speedTestBytesReceived) {
+        if (!m_speedTestUploadMode && m_speedTestPingMs < 0 && m_speedTestRequestTimer.isValid()) {
             const qint64 elapsedMs = qMax<qint64>(1, m_speedTestRequestTimer.elapsed());
             m_speedTestPingMs = static_cast<int>(qMin<qint64>(elapsedMs, 60000));
         }
-        m_speedTestBytesReceived = received;
-        m_speedTestPhaseBytes = received;
-        if (m_speedTestPhaseTimer.isValid()) {
-            m_speedTestLastProgressElapsedMs = m_speedTestPhaseTimer.elapsed();
-        }
-    }
-
-    const qint64 expected = m_speedTestExpectedBytes > 0
-                                ? m_speedTestExpectedBytes
-                                : (total > 0 ? total : 0);
-    if (expected > 0) {
-        m_speedTestProgress = qBound(
-            0.0,
-            static_cast<double>(m_speedTestBytesReceived) / static_cast<double>(expected),
-            1.0);
-    }
-    emit speedTestChanged();
-}
-
-void VpnController::onSpeedTestUploadProgress(qint64 sent, qint64 total)
-{
-    Q_UNUSED(total)
-    if (!m_speedTestRunning || !m_speedTestUploadMode) {
-        return;
-    }
-    if (sent > m_speedTestBytesReceived) {
-        const qint64 delta = sent - m_speedTestBytesReceived;
-        m_speedTestBytesReceived = sent;
-        m_speedTestPhaseBytes += delta;
+        m_speedTestPhaseBytes += transferred - m_speedTestBytesReceived;
+        m_speedTestBytesReceived = transferred;
         if (m_speedTestPhaseTimer.isValid()) {
             m_speedTestLastProgressElapsedMs = m_speedTestPhaseTimer.elapsed();
         }
-        if (m_speedTestExpectedBytes > 0) {
-            m_speedTestProgress = qBound(
-                0.0,
-                static_cast<double>(m_speedTestBytesReceived) / static_cast<double>(m_speedTestExpectedBytes),
-                1.0);
-        }
     }
-    emit speedTestChanged();
+    // Streams opened but cut off by the deadline before moving a byte do not count.
+    (m_speedTestUploadMode ? m_speedTestUploadStreams : m_speedTestDownloadStreams) = m_speedTestEngine.usedStreamCount();
+    // With many streams progress arrives far more often than the UI can use;
+    // onSpeedTestTick() publishes the counters at its fixed cadence.
 }
 
-void VpnController::onSpeedTestFinished()
+void VpnController::onSpeedTestFinished(QNetworkReply::NetworkError errorCode, const QString& errorText)
 {
-    if (m_speedTestReply == nullptr) {
-        return;
-    }
-
-    const QString phaseAtFinish = m_speedTestPhase;
-    const QString errorText = m_speedTestReply->errorString();
-    const QNetworkReply::NetworkError replyErrorCode = m_speedTestReply->error();
-    const bool replyHadError = (replyErrorCode != QNetworkReply::NoError);
-    m_speedTestReply->deleteLater();
-    m_speedTestReply = nullptr;
+    const SpeedTestSnapshot::Phase phaseAtFinish = m_speedTestPhase;
+    const QNetworkReply::NetworkError replyErrorCode = errorCode;
+    // A phase that ran out its duration without a byte is a dead endpoint.
+    const bool stalled = (replyErrorCode == QNetworkReply::NoError && m_speedTestBytesReceived <= 0);
+    const bool replyHadError = (replyErrorCode != QNetworkReply::NoError) || stalled;
+    const QString failureText = stalled ? QStringLiteral("Speed test returned no transferable data.") : errorText;
 
     if (!m_speedTestRunning) {
         return;
     }
 
     if (replyHadError && !m_speedTestCancelledByUser) {
-        const bool uploadPhase = (phaseAtFinish == QStringLiteral("Upload"));
+        const bool uploadPhase = (phaseAtFinish == SpeedTestSnapshot::Upload);
         const bool operationCanceled = (replyErrorCode == QNetworkReply::OperationCanceledError);
-        const bool uploadPayloadSent =
-            uploadPhase && m_speedTestExpectedBytes > 0 && m_speedTestBytesReceived >= m_speedTestExpectedBytes;
-        const bool downloadMostlyComplete =
-            !uploadPhase
-            && m_speedTestExpectedBytes > 0
-            && static_cast<double>(m_speedTestBytesReceived) >= (static_cast<double>(m_speedTestExpectedBytes) * kSpeedTestDownloadCompletionRatio);
-        if (operationCanceled && (uploadPayloadSent || downloadMostlyComplete)) {
+        const bool phaseMostlyRun =
+            m_speedTestPhaseDurationMs > 0
+            && m_speedTestBytesReceived > 0
+            && m_speedTestPhaseTimer.isValid()
+            && static_cast<double>(m_speedTestPhaseTimer.elapsed())
+                   >= static_cast<double>(m_speedTestPhaseDurationMs) * kSpeedTestPhaseCompletionRatio;
+        if (operationCanceled && phaseMostlyRun) {
             updateSpeedTestSampling(true);
             const qint64 elapsedMs = qMax<qint64>(
                 1,
@@ -4257,7 +5164,7 @@ void VpnController::onSpeedTestFinished()
             if (uploadPhase) {
                 m_speedTestUploadMbps = qMax(0.0, finalMbps);
                 m_speedTestProgress = 1.0;
-                appendSystemLog(QStringLiteral("[SpeedTest] Upload finalized after request cancellation with full payload sent."));
+                appendSystemLog(QStringLiteral("[SpeedTest] Upload finalized after request cancellation near the end of the phase."));
                 startAnalyzePhase();
                 finishSpeedTest(true);
                 return;
@@ -4268,7 +5175,7 @@ void VpnController::onSpeedTestFinished()
             if (m_speedTestPingMs < 0) {
                 m_speedTestPingMs = static_cast<int>(qMin<qint64>(elapsedMs, 60000));
             }
-            appendSystemLog(QStringLiteral("[SpeedTest] Download accepted after cancellation with sufficient sampled bytes."));
+            appendSystemLog(QStringLiteral("[SpeedTest] Download accepted after cancellation near the end of the phase."));
             startUploadPhase();
             return;
         }
@@ -4279,7 +5186,7 @@ void VpnController::onSpeedTestFinished()
         if (m_speedTestAttempt < endpoints.size()) {
             appendSystemLog(QStringLiteral("[SpeedTest] %1 endpoint failed (%2). Trying fallback %3/%4.")
                                 .arg(uploadPhase ? QStringLiteral("Upload") : QStringLiteral("Download"))
-                                .arg(errorText.trimmed().isEmpty() ? QStringLiteral("network error") : errorText.trimmed())
+                                .arg(failureText.trimmed().isEmpty() ? QStringLiteral("network error") : failureText.trimmed())
                                 .arg(m_speedTestAttempt + 1)
                                 .arg(endpoints.size()));
             startCurrentSpeedTestRequest();
@@ -4303,12 +5210,12 @@ void VpnController::onSpeedTestFinished()
         if (operationCanceled) {
             finishSpeedTest(false, QStringLiteral("Speed test request timed out or was interrupted."));
         } else {
-            finishSpeedTest(false, errorText);
+            finishSpeedTest(false, failureText);
         }
         return;
     }
 
-    if (phaseAtFinish != QStringLiteral("Download") && phaseAtFinish != QStringLiteral("Upload")) {
+    if (!SpeedTestSnapshot::isTransfer(phaseAtFinish)) {
         finishSpeedTest(false, QStringLiteral("Speed test finished in invalid state."));
         return;
     }
@@ -4328,7 +5235,7 @@ void VpnController::onSpeedTestFinished()
     const double averageMbps = mbpsFromBytes(m_speedTestMeasuredBytes > 0 ? m_speedTestMeasuredBytes : m_speedTestBytesReceived, elapsedMs);
     const double finalMbps = qMax(averageMbps, m_speedTestAverageMbps);
 
-    if (phaseAtFinish == QStringLiteral("Download")) {
+    if (phaseAtFinish == SpeedTestSnapshot::Download) {
         m_speedTestDownloadMbps = qMax(0.0, finalMbps);
         m_speedTestProgress = 1.0;
         if (m_speedTestPingMs < 0) {
@@ -4349,8 +5256,7 @@ void VpnController::updateSpeedTestSampling(bool finalizeWindow)
     if (!m_speedTestRunning || !m_speedTestPhaseTimer.isValid()) {
         return;
     }
-    const bool transferPhase =
-        (m_speedTestPhase == QStringLiteral("Download") || m_speedTestPhase == QStringLiteral("Upload"));
+    const bool transferPhase = SpeedTestSnapshot::isTransfer(m_speedTestPhase);
     if (!transferPhase) {
         return;
     }
@@ -4372,6 +5278,9 @@ void VpnController::updateSpeedTestSampling(bool finalizeWindow)
 
     const qint64 windowBytes = qMax<qint64>(0, m_speedTestBytesReceived - m_speedTestSampleWindowStartBytes);
     const double instantMbps = mbpsFromBytes(windowBytes, windowMs);
+    if (!finalizeWindow && m_speedTestSampleWindowStartMs >= m_speedTestWarmupUntilMs) {
+        m_speedTestEngine.adapt(instantMbps);
+    }
     const double alpha = 0.24;
     if (m_speedTestCurrentMbps <= 0.01) {
         m_speedTestCurrentMbps = instantMbps;
@@ -4407,13 +5316,6 @@ void VpnController::updateSpeedTestSampling(bool finalizeWindow)
         }
     }
 
-    if (m_speedTestExpectedBytes > 0) {
-        m_speedTestProgress = qBound(
-            0.0,
-            static_cast<double>(m_speedTestBytesReceived) / static_cast<double>(m_speedTestExpectedBytes),
-            1.0);
-    }
-
     m_speedTestSampleWindowStartMs = elapsedMs;
     m_speedTestSampleWindowStartBytes = m_speedTestBytesReceived;
 }
@@ -4466,6 +5368,21 @@ void VpnController::setConnectionState(ConnectionState state)
     m_connectionState = state;
     emit connectionStateChanged();
     applyKillSwitchState();
+    if (state == ConnectionState::Connected && m_networkRecoveryReconnecting) {
+        finishNetworkRecovery(QStringLiteral("reconnected"));
+    } else if (state == ConnectionState::Error
+               || (state == ConnectionState::Disconnected && !m_networkRecoveryReconnecting)) {
+        m_networkRecoveryPending = false;
+        m_networkRecoveryReconnecting = false;
+    }
+    if (state == ConnectionState::Connected) {
+        m_proxyHealthMonitor.clear();
+        m_proxyHealthMonitor.start();
+    } else {
+        m_proxyHealthMonitor.stop();
+        m_proxySelfCheckRoundId = 0;
+        m_networkRecheckRoundId = 0;
+    }
     if (state == ConnectionState::Connected) {
         m_disconnectRequested.store(false);
         m_publicIpRetryCount = 0;
@@ -4503,22 +5420,12 @@ void VpnController::appendSystemLog(const QString& message)
     if (!m_loggingEnabled) {
         return;
     }
-    const bool duplicate = !m_recentLogs.isEmpty() && m_recentLogs.last() == message;
-    if (duplicate) {
-        return;
-    }
-
-    m_recentLogs.append(message);
-    while (m_recentLogs.size() > kMaxLogLines) {
-        m_recentLogs.removeFirst();
-    }
-    scheduleLogsChanged();
+    QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::appendSystemLine, Qt::QueuedConnection, message);
 }
 
 void VpnController::resetSpeedTestState(bool emitSignal)
 {
-    m_speedTestState = QStringLiteral("Idle");
-    m_speedTestPhase = QStringLiteral("Idle");
+    m_speedTestPhase = SpeedTestSnapshot::Idle;
     m_speedTestElapsedSec = 0;
     m_speedTestDurationSec = 0;
     m_speedTestProgress = 0.0;
@@ -4543,9 +5450,19 @@ void VpnController::resetSpeedTestState(bool emitSignal)
     m_speedTestLatencyAttemptCount = 0;
     m_speedTestLatencySuccessCount = 0;
     m_speedTestLatencySamples.clear();
+    m_speedTestIdleProbeSamples.clear();
+    m_speedTestDownloadLatencySamples.clear();
+    m_speedTestUploadLatencySamples.clear();
+    m_speedTestLoadedProbeTimer.stop();
+    m_speedTestTunnelProbe.abort();
+    m_speedTestUdpProbe.stop();
+    m_speedTestUdpResult = UdpProbeResult();
+    m_speedTestLatencyWaitingForUdp = false;
+    m_speedTestBufferbloatMs = -1;
+    m_speedTestBufferbloatGrade.clear();
     m_speedTestUploadMode = false;
     m_speedTestPhaseBytes = 0;
-    m_speedTestExpectedBytes = 0;
+    m_speedTestPhaseDurationMs = 0;
     m_speedTestSampleWindowStartMs = -1;
     m_speedTestSampleWindowStartBytes = 0;
     m_speedTestMeasuredBytes = 0;
@@ -4553,6 +5470,10 @@ void VpnController::resetSpeedTestState(bool emitSignal)
     m_speedTestLastProgressElapsedMs = 0;
     m_speedTestWarmupUntilMs = 0;
     m_speedTestCancelledByUser = false;
+    m_speedTestDownloadStreams = 0;
+    m_speedTestUploadStreams = 0;
+    m_speedTestDownloadEndpoint.clear();
+    m_speedTestUploadEndpoint.clear();
     m_speedTestUsingDirectFallback = false;
     m_speedTestPhaseTimer.invalidate();
     m_speedTestSampleTimer.invalidate();
@@ -4571,50 +5492,96 @@ void VpnController::runProxySelfCheckAttempt(int attempt)
     if (!connected()) {
         return;
     }
-    const quint16 socksPort = m_buildOptions.socksPort;
-    const bool useSystemProxyMode = m_useSystemProxy;
-    const bool tunMode = m_tunMode;
-    const QPointer<VpnController> guard(this);
+    m_proxySelfCheckAttempt = attempt;
+    m_proxySelfCheckRoundId = m_proxyHealthMonitor.probeNow();
+}
 
-    [[maybe_unused]] auto proxySelfCheckFuture = QtConcurrent::run([guard, socksPort, useSystemProxyMode, tunMode, attempt]() {
-        QString error;
-        const bool ok = checkLocalProxyConnectivitySync(socksPort, &error);
-        if (!guard) {
+void VpnController::onProxyHealthRoundFinished(quint64 roundId, bool ok, const QString& error)
+{
+    if (!connected()) {
+        return;
+    }
+
+    if (roundId == m_networkRecheckRoundId) {
+        m_networkRecheckRoundId = 0;
+        if (!m_networkRecoveryPending || m_networkRecoveryReconnecting) {
+            return;
+        }
+        if (ok) {
+            finishNetworkRecovery(QStringLiteral("tunnel still healthy"));
             return;
         }
 
-        QMetaObject::invokeMethod(guard.data(), [guard, socksPort, useSystemProxyMode, tunMode, ok, error, attempt]() {
-            if (!guard || !guard->connected()) {
-                return;
-            }
+        appendSystemLog(QStringLiteral("[System] Re-validation failed (%1); reconnecting.").arg(error));
+        m_networkRecoveryReconnecting = true;
+        m_pendingReconnectProfileIndex = m_currentProfileIndex;
+        disconnect();
+        return;
+    }
 
-            if (ok) {
-                guard->appendSystemLog(QStringLiteral("[System] Proxy self-test passed (127.0.0.1:%1 is forwarding traffic).")
-                                           .arg(socksPort));
-                if (!useSystemProxyMode && !tunMode) {
-                    guard->appendSystemLog(QStringLiteral("[System] Clean mode note: macOS system traffic is NOT auto-routed in this mode."));
-                }
-                return;
-            }
+    if (roundId != m_proxySelfCheckRoundId) {
+        return;
+    }
+    m_proxySelfCheckRoundId = 0;
 
-            if (attempt + 1 < kProxySelfCheckMaxAttempts) {
-                QTimer::singleShot(kProxySelfCheckRetryDelayMs, guard.data(), [guard, attempt]() {
-                    if (guard && guard->connected()) {
-                        guard->runProxySelfCheckAttempt(attempt + 1);
-                    }
-                });
-                return;
-            }
+    const quint16 socksPort = m_buildOptions.socksPort;
+    if (ok) {
+        appendSystemLog(QStringLiteral("[System] Proxy self-test passed (127.0.0.1:%1 is forwarding traffic).")
+                            .arg(socksPort));
+        if (!m_useSystemProxy && !m_tunMode) {
+            appendSystemLog(QStringLiteral("[System] Clean mode note: macOS system traffic is NOT auto-routed in this mode."));
+        }
+        return;
+    }
 
-            guard->appendSystemLog(QStringLiteral("[System] Proxy self-test failed: %1").arg(error));
-            if (useSystemProxyMode) {
-                guard->appendSystemLog(QStringLiteral("[System] Hint: verify system proxy state and retry with proper permissions."));
-            } else {
-                guard->appendSystemLog(QStringLiteral("[System] Hint: Clean mode requires apps to use 127.0.0.1:%1 manually.")
-                                           .arg(socksPort));
+    const int attempt = m_proxySelfCheckAttempt;
+    if (attempt + 1 < kProxySelfCheckMaxAttempts) {
+        QTimer::singleShot(kProxySelfCheckRetryDelayMs, this, [this, attempt]() {
+            if (connected()) {
+                runProxySelfCheckAttempt(attempt + 1);
             }
-        }, Qt::QueuedConnection);
-    });
+        });
+        return;
+    }
+
+    appendSystemLog(QStringLiteral("[System] Proxy self-test failed: %1").arg(error));
+    if (m_useSystemProxy) {
+        appendSystemLog(QStringLiteral("[System] Hint: verify system proxy state and retry with proper permissions."));
+    } else {
+        appendSystemLog(QStringLiteral("[System] Hint: Clean mode requires apps to use 127.0.0.1:%1 manually.")
+                            .arg(socksPort));
+    }
+}
+
+void VpnController::handleNetworkChanged(const QString& reason)
+{
+    if (!connected() || m_networkRecoveryReconnecting) {
+        return;
+    }
+
+    if (!m_networkRecoveryPending) {
+        m_networkRecoveryPending = true;
+        m_networkRecoveryTimer.start();
+    }
+    appendSystemLog(QStringLiteral("[System] Network change detected (%1); re-validating tunnel.").arg(reason));
+
+    // Targeted re-validation first: most roams keep the outer connection
+    // usable, and a full reconnect would needlessly drop every flow.
+    m_networkRecheckRoundId = m_proxyHealthMonitor.probeNow();
+}
+
+void VpnController::finishNetworkRecovery(const QString& how)
+{
+    if (!m_networkRecoveryPending) {
+        return;
+    }
+    m_networkRecoveryPending = false;
+    m_networkRecoveryReconnecting = false;
+    m_lastNetworkRecoveryMs = static_cast<int>(m_networkRecoveryTimer.elapsed());
+    appendSystemLog(QStringLiteral("[System] Network change recovery: %1 in %2 ms.")
+                        .arg(how)
+                        .arg(m_lastNetworkRecoveryMs));
+    emit networkRecoveryChanged();
 }
 
 bool VpnController::checkLocalProxyConnectivity(QString *errorMessage) const
@@ -4622,93 +5589,123 @@ bool VpnController::checkLocalProxyConnectivity(QString *errorMessage) const
     return checkLocalProxyConnectivitySync(m_buildOptions.socksPort, errorMessage);
 }
 
-bool VpnController::detectProcessRoutingSupport()
+bool VpnController::detectProcessRoutingSupport() const
 {
-    if (m_processRoutingSupportChecked) {
-        return m_processRoutingSupported;
-    }
+    // Answered from the capability cache or the background probe; connect
+    // paths never run the core just to ask.
+    return m_xrayCapabilities.processRouting;
+}
 
-    m_processRoutingSupportChecked = true;
-    const bool previous = m_processRoutingSupported;
-    m_processRoutingSupported = false;
-    const QString previousVersion = m_xrayVersion;
-    m_xrayVersion = QStringLiteral("Unknown");
+void VpnController::refreshXrayCapabilities()
+{
+    const quint64 generation = ++m_xrayCapabilityProbeGeneration;
+    const QString executablePath = m_xrayExecutablePath.trimmed();
+    const QString fingerprint = XrayCapabilities::binaryFingerprint(executablePath);
+    if (fingerprint.isEmpty()) {
+        m_xrayCapabilitiesPending = false;
+        XrayCapabilities missing;
+        missing.version = executablePath.isEmpty() ? QStringLiteral("Not detected") : QStringLiteral("Unavailable");
+        applyXrayCapabilities(missing);
+        return;
+    }
 
-    if (m_xrayExecutablePath.trimmed().isEmpty()) {
-        m_xrayVersion = QStringLiteral("Not detected");
-        if (previousVersion != m_xrayVersion) {
-            emit xrayVersionChanged();
-        }
-        if (previous != m_processRoutingSupported) {
-            emit processRoutingSupportChanged();
-        }
-        return m_processRoutingSupported;
+    const QString canonicalPath = QFileInfo(executablePath).canonicalFilePath();
+    const XrayCapabilities cached = XrayCapabilities::fromJson(m_xrayCapabilityCache.value(canonicalPath).toObject());
+    if (cached.fingerprint == fingerprint) {
+        m_xrayCapabilitiesPending = false;
+        applyXrayCapabilities(cached);
+        return;
     }
 
-    QProcess process;
-    process.start(m_xrayExecutablePath, {QStringLiteral("version")});
-    if (!process.waitForStarted(2000)) {
-        m_xrayVersion = QStringLiteral("Unavailable");
-        if (previousVersion != m_xrayVersion) {
-            emit xrayVersionChanged();
+    // Nothing is known about this binary until the probe reports back.
+    m_xrayCapabilitiesPending = true;
+    applyXrayCapabilities(XrayCapabilities {});
+
+    const QPointer<VpnController> guard(this);
+    const QJsonObject cache = m_xrayCapabilityCache;
+    [[maybe_unused]] auto probeFuture = QtConcurrent::run([guard, executablePath, canonicalPath, fingerprint, cache, generation]() {
+        // A reinstalled or copied binary keeps its content hash; reuse what is
+        // known about it instead of running it again.
+        const QByteArray contentHash = XrayCapabilities::hashBinary(executablePath);
+        XrayCapabilities caps;
+        if (!contentHash.isEmpty()) {
+            for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+                const XrayCapabilities known = XrayCapabilities::fromJson(it.value().toObject());
+                if (known.contentHash == contentHash) {
+                    caps = known;
+                    caps.executablePath = canonicalPath;
+                    caps.fingerprint = fingerprint;
+                    break;
+                }
+            }
         }
-        if (previous != m_processRoutingSupported) {
-            emit processRoutingSupportChanged();
+        if (!caps.isProbed()) {
+            caps = XrayCapabilities::probe(executablePath, contentHash);
         }
-        return m_processRoutingSupported;
-    }
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, caps, generation]() {
+            if (!guard || guard->m_xrayCapabilityProbeGeneration != generation) {
+                return;
+            }
+            guard->m_xrayCapabilitiesPending = false;
+            guard->cacheXrayCapabilities(caps);
+            guard->applyXrayCapabilities(caps);
+        }, Qt::QueuedConnection);
+    });
+}
 
-    if (!process.waitForFinished(3000)) {
-        process.kill();
-        process.waitForFinished(500);
-        m_xrayVersion = QStringLiteral("Unavailable");
-        if (previousVersion != m_xrayVersion) {
-            emit xrayVersionChanged();
+void VpnController::cacheXrayCapabilities(const XrayCapabilities& capabilities)
+{
+    // Failed probes are usually transient (slow disk, AV scan); retry next run.
+    if (!capabilities.isProbed() || capabilities.version == QStringLiteral("Unavailable")) {
+        return;
+    }
+    const QJsonObject entry = capabilities.toJson();
+    if (m_xrayCapabilityCache.value(capabilities.executablePath).toObject() == entry) {
+        return;
+    }
+    m_xrayCapabilityCache.insert(capabilities.executablePath, entry);
+    for (const QString& path : m_xrayCapabilityCache.keys()) {
+        if (m_xrayCapabilityCache.size() <= kMaxCachedXrayBinaries) {
+            break;
         }
-        if (previous != m_processRoutingSupported) {
-            emit processRoutingSupportChanged();
+        if (path != capabilities.executablePath) {
+            m_xrayCapabilityCache.remove(path);
         }
-        return m_processRoutingSupported;
     }
+    saveSettings();
+}
 
-    const QString output = QString::fromUtf8(process.readAllStandardOutput())
-                           + QString::fromUtf8(process.readAllStandardError());
-
-    const QRegularExpression regex(QStringLiteral("Xray\\s+(\\d+)\\.(\\d+)\\.(\\d+)"));
-    const QRegularExpressionMatch match = regex.match(output);
-    if (match.hasMatch()) {
-        m_xrayVersion = QStringLiteral("%1.%2.%3")
-        .arg(match.captured(1), match.captured(2), match.captured(3));
-        const int major = match.captured(1).toInt();
-        const int minor = match.captured(2).toInt();
-        const int patch = match.captured(3).toInt();
-
-        const bool versionSupported =
-            major > 26
-            || (major == 26 && minor > 1)
-            || (major == 26 && minor == 1 && patch >= 23);
-
-#if defined(Q_OS_WIN) || defined(Q_OS_LINUX)
-        m_processRoutingSupported = versionSupported;
-#else
-        // Xray process-name routing currently supports Windows/Linux only.
-        m_processRoutingSupported = false;
-#endif
-    } else if (process.exitCode() == 0) {
-        m_xrayVersion = QStringLiteral("Detected");
-    } else {
-        m_xrayVersion = QStringLiteral("Unavailable");
-    }
+void VpnController::applyXrayCapabilities(const XrayCapabilities& capabilities)
+{
+    const bool previous = m_xrayCapabilities.processRouting;
+    const QString previousVersion = m_xrayVersion;
+    m_xrayCapabilities = capabilities;
+    m_xrayVersion = capabilities.version.isEmpty() ? QStringLiteral("Unknown") : capabilities.version;
 
     if (previousVersion != m_xrayVersion) {
         emit xrayVersionChanged();
     }
-
-    if (previous != m_processRoutingSupported) {
+    if (previous != m_xrayCapabilities.processRouting) {
         emit processRoutingSupportChanged();
     }
+    if (!m_xrayCapabilitiesPending && m_connectAfterProbeProfileIndex >= 0) {
+        QTimer::singleShot(0, this, &VpnController::resumeDeferredConnect);
+    }
+}
 
-    return m_processRoutingSupported;
+void VpnController::resumeDeferredConnect()
+{
+    if (m_xrayCapabilitiesPending || m_connectAfterProbeProfileIndex < 0) {
+        return;
+    }
+    const int row = std::exchange(m_connectAfterProbeProfileIndex, -1);
+    // The waiting attempt holds the Connecting state; hand it back so the
+    // connect runs through the regular entry point.
+    setConnectionState(ConnectionState::Disconnected);
+    connectToProfile(row);
 }
 
 QStringList VpnController::parseRules(const QString& value)
@@ -4824,13 +5821,13 @@ void VpnController::updateMemoryUsage()
 
 void VpnController::clearLogsInternal()
 {
+    // Lines still waiting for the next snapshot must go as well.
+    QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::clear, Qt::QueuedConnection);
     if (m_recentLogs.isEmpty() && m_latestLogLine.isEmpty()) {
         return;
     }
     m_recentLogs.clear();
     m_latestLogLine.clear();
-    m_logsDirty = false;
-    m_logsFlushTimer.stop();
     emit latestLogLineChanged();
     emit logsChanged();
 }
@@ -5399,8 +6396,9 @@ void VpnController::appendAppRule(const QString& target, const QString& process)
     }
 
     if (!detectProcessRoutingSupport()) {
-        appendSystemLog(QStringLiteral(
-            "[System] App rule update ignored: process routing is unsupported on this platform/runtime."));
+        appendSystemLog(m_xrayCapabilitiesPending
+                            ? QStringLiteral("[System] App rule update ignored: xray-core capabilities are still being checked.")
+                            : QStringLiteral("[System] App rule update ignored: process routing is unsupported on this platform/runtime."));
         return;
     }
 
@@ -5454,39 +6452,70 @@ void VpnController::appendAppRule(const QString& target, const QString& process)
     setBlockAppRules(blockRules);
 }
 
-void VpnController::loadProfileUsage()
+QJsonObject VpnController::readStoredProfileUsage(const QString& path)
 {
-    m_profileUsageRoot = QJsonObject {};
-    QFile file(m_profileUsagePath);
-    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
-        return;
+    QJsonObject root;
+    QFile file(path);
+    if (file.exists() && file.open(QIODevice::ReadOnly)) {
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error == QJsonParseError::NoError && doc.isObject()) {
+            root = doc.object();
+        }
     }
+    if (!root.contains(QStringLiteral("profiles"))
+        || !root.value(QStringLiteral("profiles")).isObject()) {
+        root.insert(QStringLiteral("profiles"), QJsonObject {});
+    }
+    return root;
+}
 
-    QJsonParseError parseError;
-    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
-    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
-        return;
+void VpnController::applyStoredProfileUsage(const QJsonObject& root)
+{
+    // Usage recorded while the file was loading wins for the profiles it touched.
+    QJsonObject merged = root;
+    const QJsonObject recorded = m_profileUsageRoot.value(QStringLiteral("profiles")).toObject();
+    if (!recorded.isEmpty()) {
+        QJsonObject profiles = merged.value(QStringLiteral("profiles")).toObject();
+        for (auto it = recorded.constBegin(); it != recorded.constEnd(); ++it) {
+            profiles.insert(it.key(), it.value());
+        }
+        merged.insert(QStringLiteral("profiles"), profiles);
     }
-    m_profileUsageRoot = doc.object();
-    if (!m_profileUsageRoot.contains(QStringLiteral("profiles"))
-        || !m_profileUsageRoot.value(QStringLiteral("profiles")).isObject()) {
-        m_profileUsageRoot.insert(QStringLiteral("profiles"), QJsonObject {});
+    m_profileUsageRoot = merged;
+    releaseStartupStore(QString::fromLatin1(kProfileUsageStore));
+    emit profileUsageChanged();
+    if (!recorded.isEmpty()) {
+        saveProfileUsage();
     }
 }
 
-void VpnController::saveProfileUsage() const
+QList<SpeedTestResult> VpnController::readStoredSpeedTestHistory(const QString& path)
 {
-    if (m_profileUsagePath.trimmed().isEmpty()) {
-        return;
+    QFile file(path);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return {};
     }
+    return SpeedTestHistoryModel::deserialize(file.readAll());
+}
 
-    QSaveFile file(m_profileUsagePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        return;
+void VpnController::applyStoredSpeedTestHistory(const QList<SpeedTestResult>& results)
+{
+    // Tests finished while the file was loading are newer than anything stored.
+    const QList<SpeedTestResult> recorded = m_speedTestHistoryModel.results();
+    QList<SpeedTestResult> merged = results;
+    merged.append(recorded);
+    m_speedTestHistoryModel.setResults(merged);
+    releaseStartupStore(QString::fromLatin1(kSpeedTestHistoryStore));
+    emit speedTestChanged();
+    if (!recorded.isEmpty()) {
+        m_persistence.markDirty(QString::fromLatin1(kSpeedTestHistoryStore));
     }
+}
 
-    file.write(QJsonDocument(m_profileUsageRoot).toJson(QJsonDocument::Compact));
-    file.commit();
+void VpnController::saveProfileUsage()
+{
+    m_persistence.markDirty(QString::fromLatin1(kProfileUsageStore));
 }
 
 void VpnController::scheduleProfileUsageSave()
@@ -6256,8 +7285,6 @@ bool VpnController::startPrivilegedTunProcess(QString *errorMessage)
     m_privilegedTunRuntimePid = -1;
     QFile::remove(m_privilegedTunPidPath);
     QFile::remove(m_privilegedTunLogPath);
-    m_privilegedTunLogOffset = 0;
-    m_privilegedTunLogBuffer.clear();
 
     const QString serverText = m_activeProfileAddress.trimmed();
     const QHostAddress parsed(serverText);
@@ -6288,11 +7315,14 @@ bool VpnController::startPrivilegedTunProcess(QString *errorMessage)
                 {QStringLiteral("config_path"), m_runtimeConfigPath},
                 {QStringLiteral("pid_path"), m_privilegedTunPidPath},
                 {QStringLiteral("log_path"), m_privilegedTunLogPath},
+                {QStringLiteral("asset_dir"), m_activeRuleAssetDirectory},
                 {QStringLiteral("tun_if"), tunIf},
                 {QStringLiteral("server_ip"), m_lastTunServerIp},
                 {QStringLiteral("server_host"), m_activeProfileAddress.trimmed()},
                 {QStringLiteral("owner_pid"), static_cast<qint64>(QCoreApplication::applicationPid())},
-                {QStringLiteral("dns_servers"), QJsonArray::fromStringList(parseDnsServers(m_customDnsServers))}
+                {QStringLiteral("dns_servers"), QJsonArray::fromStringList(parseDnsServers(m_customDnsServers))},
+                {QStringLiteral("tun_mtu"), m_activeTunMtu},
+                {QStringLiteral("tun_txqueuelen"), kTunTxQueueLen}
             },
             &response,
             &helperError,
@@ -6315,24 +7345,28 @@ bool VpnController::startPrivilegedTunProcess(QString *errorMessage)
         return false;
     }
 
-    QFile pidFile(m_privilegedTunPidPath);
-    if (!pidFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        if (errorMessage) {
-            *errorMessage = QStringLiteral("TUN start failed: pid file was not created.");
+    m_lastTunTuning = response.value(QStringLiteral("tun_tuning")).toObject();
+
+    // Newer helpers report the spawned pid directly; older ones only leave it
+    // in the pid file.
+    qint64 pidValue = response.value(QStringLiteral("runtime_pid")).toVariant().toLongLong();
+    if (pidValue <= 0) {
+        QFile pidFile(m_privilegedTunPidPath);
+        if (!pidFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            if (errorMessage) {
+                *errorMessage = QStringLiteral("TUN start failed: pid file was not created.");
+            }
+            return false;
         }
-        return false;
-    }
-    const QString pidText = QString::fromUtf8(pidFile.readAll()).trimmed();
-    pidFile.close();
-    if (pidText.isEmpty()) {
-        if (errorMessage) {
-            *errorMessage = QStringLiteral("TUN start failed: invalid process id.");
+        const QString pidText = QString::fromUtf8(pidFile.readAll()).trimmed();
+        pidFile.close();
+        bool pidOk = false;
+        pidValue = pidText.toLongLong(&pidOk);
+        if (!pidOk) {
+            pidValue = -1;
         }
-        return false;
     }
-    bool pidOk = false;
-    const qint64 pidValue = pidText.toLongLong(&pidOk);
-    if (!pidOk || pidValue <= 0) {
+    if (pidValue <= 0) {
         if (errorMessage) {
             *errorMessage = QStringLiteral("TUN start failed: invalid process id.");
         }
@@ -6402,6 +7436,7 @@ bool VpnController::stopPrivilegedTunProcess(QString *errorMessage)
             QJsonObject{
                 {QStringLiteral("action"), QStringLiteral("stop_tun")},
                 {QStringLiteral("pid_path"), m_privilegedTunPidPath},
+                {QStringLiteral("xray_path"), m_xrayExecutablePath},
                 {QStringLiteral("tun_if"), m_selectedTunInterfaceName.trimmed()},
                 {QStringLiteral("server_ip"), m_lastTunServerIp.trimmed()}
             },
@@ -6412,68 +7447,23 @@ bool VpnController::stopPrivilegedTunProcess(QString *errorMessage)
             *errorMessage = helperError.isEmpty()
             ? QStringLiteral("Privileged helper failed to stop TUN runtime.")
             : helperError;
-        }
-        return false;
-    }
-
-    if (!response.value(QStringLiteral("ok")).toBool(false)) {
-        if (errorMessage) {
-            *errorMessage = response.value(QStringLiteral("message")).toString().trimmed();
-            if (errorMessage->isEmpty()) {
-                *errorMessage = QStringLiteral("Privileged helper rejected TUN stop.");
-            }
-        }
-        return false;
-    }
-
-    m_lastTunServerIp.clear();
-    m_privilegedTunRuntimePid = -1;
-    return true;
-}
-
-void VpnController::pollPrivilegedTunLogs()
-{
-    if (!m_privilegedTunManaged || !m_loggingEnabled) {
-        return;
-    }
-
-    QFile file(m_privilegedTunLogPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return;
-    }
-
-    if (m_privilegedTunLogOffset > file.size()) {
-        m_privilegedTunLogOffset = 0;
-        m_privilegedTunLogBuffer.clear();
-    }
-    if (!file.seek(m_privilegedTunLogOffset)) {
-        return;
-    }
-
-    const QByteArray chunk = file.readAll();
-    m_privilegedTunLogOffset = file.pos();
-    file.close();
-    if (chunk.isEmpty()) {
-        return;
-    }
-
-    m_privilegedTunLogBuffer.append(chunk);
-    if (m_privilegedTunLogBuffer.size() > kMaxPrivilegedTunLogBufferBytes) {
-        m_privilegedTunLogBuffer = m_privilegedTunLogBuffer.right(kPrivilegedTunLogBufferKeepBytes);
-        appendSystemLog(QStringLiteral("[System] Log stream is very busy. Older lines were trimmed to keep UI responsive."));
+        }
+        return false;
     }
 
-    int processedLines = 0;
-    int newLineIndex = m_privilegedTunLogBuffer.indexOf('\n');
-    while (newLineIndex >= 0 && processedLines < kMaxPrivilegedTunLogLinesPerTick) {
-        const QByteArray lineBytes = m_privilegedTunLogBuffer.left(newLineIndex).trimmed();
-        m_privilegedTunLogBuffer.remove(0, newLineIndex + 1);
-        if (!lineBytes.isEmpty()) {
-            onLogLine(QString::fromUtf8(lineBytes));
+    if (!response.value(QStringLiteral("ok")).toBool(false)) {
+        if (errorMessage) {
+            *errorMessage = response.value(QStringLiteral("message")).toString().trimmed();
+            if (errorMessage->isEmpty()) {
+                *errorMessage = QStringLiteral("Privileged helper rejected TUN stop.");
+            }
         }
-        ++processedLines;
-        newLineIndex = m_privilegedTunLogBuffer.indexOf('\n');
+        return false;
     }
+
+    m_lastTunServerIp.clear();
+    m_privilegedTunRuntimePid = -1;
+    return true;
 }
 
 bool VpnController::applyMacTunRoutes(QString *errorMessage)
@@ -6583,9 +7573,9 @@ bool VpnController::writeRuntimeConfig(const ServerProfile& profile, QString *er
     options.dnsServers = parseDnsServers(m_customDnsServers);
     m_selectedTunInterfaceName = options.tunInterfaceName;
     options.whitelistMode = m_whitelistMode;
-    options.proxyDomains = parseRules(m_proxyDomainRules);
-    options.directDomains = parseRules(m_directDomainRules);
-    options.blockDomains = parseRules(m_blockDomainRules);
+    QByteArray routingKey;
+    options.compiledRules = compiledRoutingRules(&routingKey);
+    options.inlineRuleLimit = kInlineRuleLimit;
     options.proxyProcesses = parseRules(m_proxyAppRules);
     options.directProcesses = parseRules(m_directAppRules);
     options.blockProcesses = parseRules(m_blockAppRules);
@@ -6594,20 +7584,66 @@ bool VpnController::writeRuntimeConfig(const ServerProfile& profile, QString *er
                              || !options.directProcesses.isEmpty()
                              || !options.blockProcesses.isEmpty();
 
-    options.enableProcessRouting = detectProcessRoutingSupport();
-    if (hasAppRules && !options.enableProcessRouting) {
-        appendSystemLog(QStringLiteral(
-            "[System] App rules ignored: current xray-core does not support process routing (requires Xray 26.1.23+)."
-            ));
+    m_activeTunMtu = 0;
+    if (m_tunMode) {
+        // Use the path MTU measured on a previous connect to this profile;
+        // until one is recorded the platform default applies.
+        const int pathMtu = m_tunTuningByProfile.value(profile.id.trimmed()).toObject()
+                                .value(QStringLiteral("pathMtu")).toInt(0);
+        options.tunMtu = XrayConfigBuilder::recommendedTunMtu(profile, pathMtu);
+        m_activeTunMtu = options.tunMtu;
+        if (!XrayConfigBuilder::usesDatagramTransport(profile)) {
+            appendSystemLog(QStringLiteral("[System] TUN MTU: %1 (platform default; stream transport).").arg(options.tunMtu));
+        } else {
+            appendSystemLog(pathMtu > 0
+                                ? QStringLiteral("[System] TUN MTU: %1 (path MTU %2).").arg(options.tunMtu).arg(pathMtu)
+                                : QStringLiteral("[System] TUN MTU: %1 (platform default; path MTU not probed yet).").arg(options.tunMtu));
+        }
     }
 
-    QJsonObject config = XrayConfigBuilder::build(profile, options);
-    if (options.enableTun) {
-        ensureTunDnsSupport(&config, parseDnsServers(m_customDnsServers));
-        // Ensure noisy link-local/broadcast packets are blocked in TUN mode.
-        // This prevents direct-route packet loops that can spike xray CPU usage.
-        ensureTunNoiseBlockRules(&config);
+    options.core = m_xrayCapabilities;
+    options.enableProcessRouting = detectProcessRoutingSupport();
+    if (hasAppRules && !options.enableProcessRouting) {
+        appendSystemLog(m_xrayCapabilitiesPending
+                            ? QStringLiteral("[System] App rules ignored for this connection: xray-core capabilities are still being checked.")
+                            : QStringLiteral("[System] App rules ignored: current xray-core does not support process routing (requires Xray 26.1.23+)."));
+    }
+
+    // The builder already emits the TUN DNS hijack and noise block rules, so
+    // the typed config is written out directly without a JSON tree round-trip.
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    const XrayConfigBuilder::Config config = XrayConfigBuilder::buildConfig(profile, options);
+    const QByteArray configBytes = XrayConfigBuilder::serialize(config);
+    const qint64 buildMicros = buildTimer.nsecsElapsed() / 1000;
+
+    // Oversized lists are referenced as ext: matchers; their assets must be
+    // on disk (and the core pointed at them) before xray reads the config.
+    m_activeRuleAssetDirectory.clear();
+    if (!config.siteAssets.isEmpty() || !config.ipAssets.isEmpty()) {
+        QString assetError;
+        bool siteRewritten = false;
+        bool ipRewritten = false;
+        const bool stored =
+            (config.siteAssets.isEmpty()
+             || RuleAssets::store(m_ruleAssetDirectory, QString::fromLatin1(RuleAssets::kSiteFileName),
+                                  config.siteAssets, routingKey, &siteRewritten, &assetError))
+            && (config.ipAssets.isEmpty()
+                || RuleAssets::store(m_ruleAssetDirectory, QString::fromLatin1(RuleAssets::kIpFileName),
+                                     config.ipAssets, routingKey, &ipRewritten, &assetError));
+        if (!stored) {
+            if (errorMessage) {
+                *errorMessage = QStringLiteral("Failed to write rule assets: %1").arg(assetError);
+            }
+            return false;
+        }
+        RuleAssets::mirrorCoreAssets(QFileInfo(m_xrayExecutablePath).absolutePath(), m_ruleAssetDirectory);
+        m_activeRuleAssetDirectory = m_ruleAssetDirectory;
+        appendSystemLog(QStringLiteral("[System] Large rule lists referenced from %1 (%2).")
+                            .arg(m_ruleAssetDirectory,
+                                 siteRewritten || ipRewritten ? QStringLiteral("rebuilt") : QStringLiteral("unchanged")));
     }
+    m_processManager.setAssetDirectory(m_activeRuleAssetDirectory);
 
     if (m_tunMode && !options.tunInterfaceName.trimmed().isEmpty()) {
         appendSystemLog(QStringLiteral("[System] TUN interface selected: %1").arg(options.tunInterfaceName));
@@ -6621,8 +7657,7 @@ bool VpnController::writeRuntimeConfig(const ServerProfile& profile, QString *er
         return false;
     }
 
-    const QJsonDocument doc(config);
-    file.write(doc.toJson(QJsonDocument::Indented));
+    file.write(configBytes);
 
     if (!file.commit()) {
         if (errorMessage) {
@@ -6631,9 +7666,94 @@ bool VpnController::writeRuntimeConfig(const ServerProfile& profile, QString *er
         return false;
     }
 
+    appendSystemLog(QStringLiteral("[System] Runtime config: %1 routing rule(s), %2 KB, built in %3 us.")
+                        .arg(config.rules.size())
+                        .arg((configBytes.size() + 1023) / 1024)
+                        .arg(buildMicros));
+    if (config.ruleEntriesOut < config.ruleEntriesIn) {
+        appendSystemLog(QStringLiteral("[System] Routing rules compiled: %1 entries reduced to %2 matcher(s).")
+                            .arg(config.ruleEntriesIn)
+                            .arg(config.ruleEntriesOut));
+    }
+    for (qsizetype i = 0; i < config.ruleConflicts.size() && i < kMaxReportedRuleConflicts; ++i) {
+        appendSystemLog(QStringLiteral("[System] Routing conflict: %1").arg(config.ruleConflicts.at(i)));
+    }
+    if (config.ruleConflicts.size() > kMaxReportedRuleConflicts) {
+        appendSystemLog(QStringLiteral("[System] Routing conflict: %1 more not shown.")
+                            .arg(config.ruleConflicts.size() - kMaxReportedRuleConflicts));
+    }
     return true;
 }
 
+void VpnController::recordTunTuning(const QString& profileId, const QJsonObject& values)
+{
+    const QString id = profileId.trimmed();
+    if (id.isEmpty() || values.isEmpty()) {
+        return;
+    }
+
+    QJsonObject entry = m_tunTuningByProfile.value(id).toObject();
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        entry.insert(it.key(), it.value());
+    }
+    entry.insert(QStringLiteral("updatedAt"), QDateTime::currentSecsSinceEpoch());
+    m_tunTuningByProfile.insert(id, entry);
+    saveSettings();
+}
+
+void VpnController::startTunPathMtuProbe()
+{
+    const QString profileId = m_activeProfileUsageId.trimmed();
+    const QString host = m_lastTunServerIp.trimmed().isEmpty()
+                             ? m_activeProfileAddress.trimmed()
+                             : m_lastTunServerIp.trimmed();
+    if (profileId.isEmpty() || host.isEmpty()) {
+        return;
+    }
+    // Only datagram transports size the TUN MTU from the path.
+    const auto profile = m_profileModel.profileAt(m_currentProfileIndex);
+    if (!profile.has_value() || !XrayConfigBuilder::usesDatagramTransport(*profile)) {
+        return;
+    }
+
+    const qint64 probedAt = m_tunTuningByProfile.value(profileId).toObject()
+                                .value(QStringLiteral("pathMtuProbedAt")).toInteger(0);
+    if (probedAt > 0 && QDateTime::currentSecsSinceEpoch() - probedAt < kTunPathMtuProbeMaxAgeSecs) {
+        return;
+    }
+
+    // The server endpoint is routed around the tunnel, so this measures the
+    // physical path the outer transport actually uses. The result is applied
+    // on the next connect to avoid restarting an already working tunnel.
+    const QPointer<VpnController> guard(this);
+    [[maybe_unused]] auto probeFuture = QtConcurrent::run([guard, profileId, host]() {
+        const int pathMtu = probePathMtuSync(host);
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, profileId, pathMtu]() {
+            if (!guard) {
+                return;
+            }
+            const int previous = guard->m_tunTuningByProfile.value(profileId).toObject()
+                                     .value(QStringLiteral("pathMtu")).toInt(0);
+            QJsonObject values {
+                {QStringLiteral("pathMtuProbedAt"), QDateTime::currentSecsSinceEpoch()}
+            };
+            if (pathMtu > 0) {
+                values.insert(QStringLiteral("pathMtu"), pathMtu);
+            }
+            guard->recordTunTuning(profileId, values);
+            if (pathMtu > 0 && pathMtu != previous) {
+                guard->appendSystemLog(QStringLiteral("[System] Path MTU to server: %1 (applied on next connect).")
+                                           .arg(pathMtu));
+            } else if (pathMtu <= 0) {
+                guard->appendSystemLog(QStringLiteral("[System] Path MTU probe inconclusive (ICMP filtered); keeping estimated TUN MTU."));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
 QString VpnController::detectDefaultXrayPath() const
 {
     QStringList candidates;
@@ -6674,63 +7794,284 @@ QString VpnController::detectDefaultXrayPath() const
     return QString();
 }
 
-void VpnController::loadProfiles()
+void VpnController::showStartupProfileCache()
 {
-    QFile file(m_profilesPath);
-    if (!file.exists()) {
+    std::optional<QList<ServerProfile>> cached = ProfileStore::readFile(m_startupProfileCachePath);
+    if (!cached.has_value() || cached->isEmpty()) {
         return;
     }
+    for (ServerProfile& profile : cached.value()) {
+        normalizeStoredProfile(profile);
+        m_startupCachedProfileIds.insert(profile.id);
+    }
+    m_profileModel.setProfiles(cached.value());
+}
 
-    if (!file.open(QIODevice::ReadOnly)) {
+void VpnController::startStartupLoad()
+{
+    m_startupTimer.start();
+    m_pendingStartupStores = {
+        QString::fromLatin1(kProfilesStore),
+        QString::fromLatin1(kSubscriptionsStore),
+        QString::fromLatin1(kProfileUsageStore),
+        QString::fromLatin1(kSpeedTestHistoryStore)
+    };
+
+    const QPointer<VpnController> guard(this);
+    const QString profileStorePath = m_profileStorePath;
+    const QString profilesPath = m_profilesPath;
+    [[maybe_unused]] auto profilesFuture = QtConcurrent::run([guard, profileStorePath, profilesPath]() {
+        const StoredProfiles stored = readStoredProfiles(profileStorePath, profilesPath);
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, stored]() {
+            if (!guard) {
+                return;
+            }
+            guard->applyStoredProfiles(stored);
+            guard->maybeFinishStartupLoad();
+        }, Qt::QueuedConnection);
+    });
+
+    const QString subscriptionsPath = m_subscriptionsPath;
+    [[maybe_unused]] auto subscriptionsFuture = QtConcurrent::run([guard, subscriptionsPath]() {
+        const QList<SubscriptionEntry> entries = readStoredSubscriptions(subscriptionsPath);
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, entries]() {
+            if (!guard) {
+                return;
+            }
+            guard->applyStoredSubscriptions(entries);
+            guard->maybeFinishStartupLoad();
+        }, Qt::QueuedConnection);
+    });
+
+    const QString profileUsagePath = m_profileUsagePath;
+    [[maybe_unused]] auto usageFuture = QtConcurrent::run([guard, profileUsagePath]() {
+        const QJsonObject root = readStoredProfileUsage(profileUsagePath);
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, root]() {
+            if (!guard) {
+                return;
+            }
+            guard->applyStoredProfileUsage(root);
+            guard->maybeFinishStartupLoad();
+        }, Qt::QueuedConnection);
+    });
+
+    const QString speedTestHistoryPath = m_speedTestHistoryPath;
+    [[maybe_unused]] auto speedTestHistoryFuture = QtConcurrent::run([guard, speedTestHistoryPath]() {
+        const QList<SpeedTestResult> results = readStoredSpeedTestHistory(speedTestHistoryPath);
+        if (!guard) {
+            return;
+        }
+        QMetaObject::invokeMethod(guard.data(), [guard, results]() {
+            if (!guard) {
+                return;
+            }
+            guard->applyStoredSpeedTestHistory(results);
+            guard->maybeFinishStartupLoad();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void VpnController::releaseStartupStore(const QString& store)
+{
+    m_pendingStartupStores.remove(store);
+    // Saves requested while the store was loading were declined; write them now.
+    if (m_persistence.isDirty(store)) {
+        m_persistence.markDirty(store);
+    }
+}
+
+void VpnController::maybeFinishStartupLoad()
+{
+    if (!m_pendingStartupStores.isEmpty()) {
         return;
     }
 
-    QJsonParseError parseError;
-    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
-    if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
+    if (m_profileModel.rowCount() == 0) {
+        m_currentProfileIndex = -1;
+    } else if (!m_currentProfileId.trimmed().isEmpty()) {
+        const int resolvedIndex = m_profileModel.indexOfId(m_currentProfileId.trimmed());
+        if (resolvedIndex >= 0) {
+            m_currentProfileIndex = resolvedIndex;
+        } else if (m_currentProfileIndex < 0 || m_currentProfileIndex >= m_profileModel.rowCount()) {
+            m_currentProfileIndex = 0;
+        }
+    } else if (m_currentProfileIndex < 0 || m_currentProfileIndex >= m_profileModel.rowCount()) {
+        m_currentProfileIndex = 0;
+    }
+    const auto startupProfile = m_profileModel.profileAt(m_currentProfileIndex);
+    m_currentProfileId = startupProfile.has_value() ? startupProfile->id.trimmed() : QString();
+    recomputeProfileStats();
+    emit currentProfileIndexChanged();
+    emit profileUsageChanged();
+    emit startupLoadingChanged();
+
+    appendSystemLog(QStringLiteral("[System] Startup: %1 profile(s) and %2 subscription(s) loaded in %3 ms.")
+                        .arg(m_profileModel.rowCount())
+                        .arg(m_subscriptionEntries.size())
+                        .arg(m_startupTimer.elapsed()));
+
+    if (m_autoPingProfiles && m_profileModel.rowCount() > 0) {
+        QTimer::singleShot(50, this, [this]() { pingAllProfiles(); });
+    }
+}
+
+void VpnController::recordFirstFrame(qint64 elapsedMs)
+{
+    if (m_firstFrameMs >= 0) {
         return;
     }
+    m_firstFrameMs = elapsedMs;
+    appendSystemLog(QStringLiteral("[System] Startup: first frame after %1 ms.").arg(elapsedMs));
+    emit startupTimingChanged();
+}
 
-    QList<ServerProfile> loadedProfiles;
-    for (const QJsonValue &value : doc.array()) {
-        if (!value.isObject()) {
-            continue;
+void VpnController::postRuntimeLogLine(const QString& line)
+{
+    QMetaObject::invokeMethod(m_logPipeline, &LogPipeline::appendRuntimeLine, Qt::QueuedConnection, line);
+}
+
+VpnController::StoredProfiles VpnController::readStoredProfiles(const QString& storePath, const QString& legacyJsonPath)
+{
+    StoredProfiles result;
+    std::optional<QList<ServerProfile>> stored;
+    if (QFileInfo::exists(storePath)) {
+        stored = ProfileStore::readFile(storePath, &result.storeError);
+    }
+    if (!stored.has_value()) {
+        // Installations from before the binary store keep profiles in JSON.
+        QFile file(legacyJsonPath);
+        if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+            return result;
+        }
+        stored = ProfileStore::fromJson(file.readAll());
+        if (!stored.has_value()) {
+            return result;
         }
+        result.fromLegacyJson = true;
+    }
 
-        auto profile = ServerProfile::fromJson(value.toObject());
-        if (profile.has_value()) {
-            auto normalized = profile.value();
-            normalized.groupName = normalizeGroupName(normalized.groupName);
-            if (normalized.sourceName.trimmed().isEmpty()) {
-                normalized.sourceName = QStringLiteral("Manual import");
-            }
-            if (normalized.sourceId.trimmed().isEmpty()) {
-                normalized.sourceId = QStringLiteral("manual");
-            }
-            loadedProfiles.append(normalized);
+    result.profiles = std::move(stored.value());
+    for (ServerProfile& profile : result.profiles) {
+        normalizeStoredProfile(profile);
+    }
+    return result;
+}
+
+void VpnController::applyStoredProfiles(const StoredProfiles& stored)
+{
+    if (!stored.storeError.isEmpty()) {
+        appendSystemLog(QStringLiteral("[System] Profile store could not be read (%1); trying JSON backup.")
+                            .arg(stored.storeError));
+    }
+
+    // Profiles imported while the store was loading go after the stored ones;
+    // the cached page shown meanwhile is replaced.
+    QList<ServerProfile> addedMeanwhile;
+    for (const ServerProfile& profile : m_profileModel.profiles()) {
+        if (!m_startupCachedProfileIds.contains(profile.id)) {
+            addedMeanwhile.append(profile);
         }
     }
+    m_startupCachedProfileIds.clear();
+    m_profileModel.setProfiles(stored.profiles);
+    for (const ServerProfile& profile : addedMeanwhile) {
+        m_profileModel.addProfile(profile);
+    }
+    releaseStartupStore(QString::fromLatin1(kProfilesStore));
+    if (stored.fromLegacyJson || !addedMeanwhile.isEmpty()) {
+        saveProfiles();
+    }
+}
 
-    m_profileModel.setProfiles(loadedProfiles);
-    if (m_autoPingProfiles && !loadedProfiles.isEmpty()) {
-        QTimer::singleShot(50, this, [this]() { pingAllProfiles(); });
+void VpnController::normalizeStoredProfile(ServerProfile& profile)
+{
+    profile.groupName = normalizeGroupName(profile.groupName);
+    if (profile.sourceName.trimmed().isEmpty()) {
+        profile.sourceName = QStringLiteral("Manual import");
+    }
+    if (profile.sourceId.trimmed().isEmpty()) {
+        profile.sourceId = QStringLiteral("manual");
+    }
+}
+
+bool VpnController::exportProfiles(const QUrl& fileUrl)
+{
+    const QString path = fileUrl.toLocalFile();
+    if (path.isEmpty()) {
+        setLastError(QStringLiteral("Choose a file to export profiles to."));
+        return false;
+    }
+
+    QString error;
+    if (!PersistenceService::writeFileAtomically(path, ProfileStore::toJson(m_profileModel.profiles()), &error)) {
+        setLastError(QStringLiteral("Failed to export profiles: %1").arg(error));
+        return false;
+    }
+    appendSystemLog(QStringLiteral("[Export] Exported %1 profile(s) to %2.")
+                        .arg(m_profileModel.rowCount())
+                        .arg(QDir::toNativeSeparators(path)));
+    return true;
+}
+
+int VpnController::importProfiles(const QUrl& fileUrl)
+{
+    const QString path = fileUrl.toLocalFile();
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        setLastError(QStringLiteral("Profile file could not be opened."));
+        return 0;
+    }
+
+    QString error;
+    const std::optional<QList<ServerProfile>> imported = ProfileStore::fromJson(file.readAll(), &error);
+    if (!imported.has_value()) {
+        setLastError(QStringLiteral("Profile file is not valid: %1").arg(error));
+        return 0;
+    }
+
+    int importCount = 0;
+    for (ServerProfile profile : imported.value()) {
+        normalizeStoredProfile(profile);
+        if (m_profileModel.addProfile(profile)) {
+            ++importCount;
+        }
+    }
+    if (importCount <= 0) {
+        setLastError(QStringLiteral("No valid profiles were found in the file."));
+        return 0;
+    }
+
+    saveProfiles();
+    appendSystemLog(QStringLiteral("[Import] Imported %1 profile(s) from file.").arg(importCount));
+    if (!m_lastError.isEmpty()) {
+        setLastError(QString());
     }
+    return importCount;
 }
 
-void VpnController::loadSubscriptions()
+QList<VpnController::SubscriptionEntry> VpnController::readStoredSubscriptions(const QString& path)
 {
-    QFile file(m_subscriptionsPath);
+    QFile file(path);
     if (!file.exists()) {
-        return;
+        return {};
     }
     if (!file.open(QIODevice::ReadOnly)) {
-        return;
+        return {};
     }
 
     QJsonParseError parseError;
     const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
     if (parseError.error != QJsonParseError::NoError || !doc.isArray()) {
-        return;
+        return {};
     }
 
     QList<SubscriptionEntry> loaded;
@@ -6754,6 +8095,9 @@ void VpnController::loadSubscriptions()
             entry.url = obj.value(QStringLiteral("url")).toString().trimmed();
             entry.name = obj.value(QStringLiteral("name")).toString().trimmed();
             entry.group = obj.value(QStringLiteral("group")).toString().trimmed();
+            entry.etag = obj.value(QStringLiteral("etag")).toString();
+            entry.lastModified = obj.value(QStringLiteral("lastModified")).toString();
+            entry.contentHash = obj.value(QStringLiteral("contentHash")).toString();
         } else {
             continue;
         }
@@ -6783,50 +8127,146 @@ void VpnController::loadSubscriptions()
         loaded.append(entry);
     }
 
-    m_subscriptionEntries = loaded;
+    return loaded;
 }
 
-void VpnController::saveProfiles() const
+void VpnController::applyStoredSubscriptions(const QList<SubscriptionEntry>& entries)
 {
-    QJsonArray arr;
-    const auto allProfiles = m_profileModel.profiles();
-    for (const auto &profile : allProfiles) {
-        arr.append(profile.toJson());
+    // Keep subscriptions added while the file was loading.
+    QList<SubscriptionEntry> merged = entries;
+    for (const SubscriptionEntry& added : std::as_const(m_subscriptionEntries)) {
+        const bool known = std::any_of(merged.cbegin(), merged.cend(), [&added](const SubscriptionEntry& entry) {
+            return entry.url.compare(added.url, Qt::CaseInsensitive) == 0;
+        });
+        if (!known) {
+            merged.append(added);
+        }
     }
-
-    QSaveFile file(m_profilesPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        return;
+    const bool addedMeanwhile = merged.size() > entries.size();
+    m_subscriptionEntries = merged;
+    releaseStartupStore(QString::fromLatin1(kSubscriptionsStore));
+    emit subscriptionsChanged();
+    if (addedMeanwhile) {
+        saveSubscriptions();
     }
+}
 
-    file.write(QJsonDocument(arr).toJson(QJsonDocument::Indented));
-    file.commit();
+void VpnController::saveProfiles()
+{
+    m_persistence.markDirty(QString::fromLatin1(kProfilesStore));
 }
 
-void VpnController::saveSubscriptions() const
+void VpnController::saveSubscriptions()
 {
-    QJsonArray arr;
-    for (const SubscriptionEntry& entry : m_subscriptionEntries) {
-        QJsonObject obj;
-        obj[QStringLiteral("id")] = entry.id;
-        obj[QStringLiteral("name")] = entry.name;
-        obj[QStringLiteral("group")] = entry.group;
-        obj[QStringLiteral("url")] = entry.url;
-        arr.append(obj);
-    }
+    m_persistence.markDirty(QString::fromLatin1(kSubscriptionsStore));
+}
 
-    QSaveFile file(m_subscriptionsPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        return;
-    }
-    file.write(QJsonDocument(arr).toJson(QJsonDocument::Indented));
-    file.commit();
+void VpnController::registerPersistenceStores()
+{
+    // Providers run on the GUI thread and only take implicitly shared copies;
+    // serialization and disk I/O happen in the returned writers on the backend thread.
+    // Stores still being read at startup are never written, so an early save
+    // cannot replace the file with a partial view.
+    m_persistence.registerStore(QString::fromLatin1(kProfilesStore), [this]() -> PersistenceService::Writer {
+        if (m_pendingStartupStores.contains(QString::fromLatin1(kProfilesStore))) {
+            return {};
+        }
+        const QList<ServerProfile> profiles = m_profileModel.profiles();
+        const QString path = m_profileStorePath;
+        const QString cachePath = m_startupProfileCachePath;
+        return [profiles, path, cachePath](QString *errorMessage) {
+            if (!PersistenceService::writeFileAtomically(path, ProfileStore::serialize(profiles), errorMessage)) {
+                return false;
+            }
+            // The first page is shown from this cache at the next start, before the store is read.
+            PersistenceService::writeFileAtomically(
+                cachePath, ProfileStore::serialize(profiles.mid(0, kStartupProfileCacheSize)), nullptr);
+            return true;
+        };
+    });
+
+    m_persistence.registerStore(QString::fromLatin1(kSubscriptionsStore), [this]() -> PersistenceService::Writer {
+        if (m_pendingStartupStores.contains(QString::fromLatin1(kSubscriptionsStore))) {
+            return {};
+        }
+        const QList<SubscriptionEntry> entries = m_subscriptionEntries;
+        const QString path = m_subscriptionsPath;
+        return [entries, path](QString *errorMessage) {
+            QJsonArray arr;
+            for (const SubscriptionEntry& entry : entries) {
+                QJsonObject obj;
+                obj[QStringLiteral("id")] = entry.id;
+                obj[QStringLiteral("name")] = entry.name;
+                obj[QStringLiteral("group")] = entry.group;
+                obj[QStringLiteral("url")] = entry.url;
+                if (!entry.etag.isEmpty()) {
+                    obj[QStringLiteral("etag")] = entry.etag;
+                }
+                if (!entry.lastModified.isEmpty()) {
+                    obj[QStringLiteral("lastModified")] = entry.lastModified;
+                }
+                if (!entry.contentHash.isEmpty()) {
+                    obj[QStringLiteral("contentHash")] = entry.contentHash;
+                }
+                arr.append(obj);
+            }
+            return PersistenceService::writeFileAtomically(
+                path, QJsonDocument(arr).toJson(QJsonDocument::Compact), errorMessage);
+        };
+    });
+
+    m_persistence.registerStore(QString::fromLatin1(kProfileUsageStore), [this]() -> PersistenceService::Writer {
+        const QJsonObject root = m_profileUsageRoot;
+        const QString path = m_profileUsagePath;
+        if (path.trimmed().isEmpty()
+            || m_pendingStartupStores.contains(QString::fromLatin1(kProfileUsageStore))) {
+            return {};
+        }
+        return [root, path](QString *errorMessage) {
+            return PersistenceService::writeFileAtomically(
+                path, QJsonDocument(root).toJson(QJsonDocument::Compact), errorMessage);
+        };
+    });
+
+    m_persistence.registerStore(QString::fromLatin1(kSpeedTestHistoryStore), [this]() -> PersistenceService::Writer {
+        const QList<SpeedTestResult> results = m_speedTestHistoryModel.results();
+        const QString path = m_speedTestHistoryPath;
+        if (path.trimmed().isEmpty()
+            || m_pendingStartupStores.contains(QString::fromLatin1(kSpeedTestHistoryStore))) {
+            return {};
+        }
+        return [results, path](QString *errorMessage) {
+            return PersistenceService::writeFileAtomically(
+                path, SpeedTestHistoryModel::serialize(results), errorMessage);
+        };
+    });
+
+    m_persistence.registerStore(QString::fromLatin1(kSettingsStore), [this]() -> PersistenceService::Writer {
+        const QVariantMap values = settingsSnapshot();
+        return [values](QString *errorMessage) {
+            QSettings settings;
+            for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+                settings.setValue(it.key(), it.value());
+            }
+            settings.sync();
+            if (settings.status() != QSettings::NoError) {
+                if (errorMessage) {
+                    *errorMessage = QStringLiteral("settings storage is not writable");
+                }
+                return false;
+            }
+            return true;
+        };
+    });
 }
 
 void VpnController::loadSettings()
 {
     QSettings settings;
     m_xrayExecutablePath = settings.value(QStringLiteral("xray/executablePath")).toString().trimmed();
+    m_xrayCapabilityCache = QJsonDocument::fromJson(
+                                settings.value(QStringLiteral("xray/capabilitiesJson")).toString().toUtf8())
+                                .object();
     m_loggingEnabled = settings.value(QStringLiteral("logs/enabled"), true).toBool();
     m_autoPingProfiles = settings.value(QStringLiteral("profiles/autoPing"), false).toBool();
     m_currentProfileIndex = settings.value(QStringLiteral("profiles/currentIndex"), -1).toInt();
@@ -6882,6 +8322,7 @@ void VpnController::loadSettings()
     m_useSystemProxy = modeExplicitlyChosen
                            ? settings.value(QStringLiteral("network/useSystemProxy"), false).toBool()
                            : false;
+    m_modeExplicitlyChosen = modeExplicitlyChosen;
     if (m_tunMode) {
         m_useSystemProxy = false;
     }
@@ -6902,6 +8343,15 @@ void VpnController::loadSettings()
     m_proxyAppRules = settings.value(QStringLiteral("routing/proxyApps")).toString();
     m_directAppRules = settings.value(QStringLiteral("routing/directApps")).toString();
     m_blockAppRules = settings.value(QStringLiteral("routing/blockApps")).toString();
+    m_tunTuningByProfile = QJsonDocument::fromJson(
+                               settings.value(QStringLiteral("network/tunTuningJson")).toString().toUtf8())
+                               .object();
+    m_ruleSources = QJsonDocument::fromJson(
+                        settings.value(QStringLiteral("routing/ruleSourcesJson")).toString().toUtf8())
+                        .array();
+    m_buildOptions.transport = TransportTuning::fromJson(
+        QJsonDocument::fromJson(settings.value(QStringLiteral("network/transportDefaultsJson")).toString().toUtf8())
+            .object());
     m_speedTestSelectedSizeMb = normalizedSpeedTestSizeMb(
         settings.value(QStringLiteral("speedtest/sizeMb"), kSpeedTestDefaultSizeMb).toInt());
     const QString endpointTemplate = settings.value(
@@ -6914,15 +8364,24 @@ void VpnController::loadSettings()
                                               : endpointTemplate;
 }
 
-void VpnController::saveSettings() const
+void VpnController::saveSettings()
 {
-    QSettings settings;
-    settings.setValue(QStringLiteral("xray/executablePath"), m_xrayExecutablePath);
-    settings.setValue(QStringLiteral("logs/enabled"), m_loggingEnabled);
-    settings.setValue(QStringLiteral("profiles/autoPing"), m_autoPingProfiles);
-    settings.setValue(QStringLiteral("profiles/currentIndex"), m_currentProfileIndex);
-    settings.setValue(QStringLiteral("profiles/currentId"), m_currentProfileId);
-    settings.setValue(QStringLiteral("profiles/currentGroup"), m_currentProfileGroup);
+    m_persistence.markDirty(QString::fromLatin1(kSettingsStore));
+}
+
+QVariantMap VpnController::settingsSnapshot() const
+{
+    QVariantMap values;
+    values.insert(QStringLiteral("xray/executablePath"), m_xrayExecutablePath);
+    values.insert(
+        QStringLiteral("xray/capabilitiesJson"),
+        QString::fromUtf8(QJsonDocument(m_xrayCapabilityCache).toJson(QJsonDocument::Compact))
+        );
+    values.insert(QStringLiteral("logs/enabled"), m_loggingEnabled);
+    values.insert(QStringLiteral("profiles/autoPing"), m_autoPingProfiles);
+    values.insert(QStringLiteral("profiles/currentIndex"), m_currentProfileIndex);
+    values.insert(QStringLiteral("profiles/currentId"), m_currentProfileId);
+    values.insert(QStringLiteral("profiles/currentGroup"), m_currentProfileGroup);
 
     QJsonArray groupOptionsArray;
     for (const ProfileGroupOptions& options : m_profileGroupOptions) {
@@ -6933,26 +8392,42 @@ void VpnController::saveSettings() const
         obj[QStringLiteral("badge")] = options.badge;
         groupOptionsArray.append(obj);
     }
-    settings.setValue(
+    values.insert(
         QStringLiteral("profiles/groupOptionsJson"),
         QString::fromUtf8(QJsonDocument(groupOptionsArray).toJson(QJsonDocument::Compact))
         );
 
-    settings.setValue(QStringLiteral("network/useSystemProxy"), m_useSystemProxy);
-    settings.setValue(QStringLiteral("network/tunMode"), m_tunMode);
-    settings.setValue(QStringLiteral("network/killSwitchEnabled"), m_killSwitchEnabled);
-    settings.setValue(
+    values.insert(QStringLiteral("network/useSystemProxy"), m_useSystemProxy);
+    values.insert(QStringLiteral("network/tunMode"), m_tunMode);
+    if (m_modeExplicitlyChosen) {
+        values.insert(QStringLiteral("network/modeExplicitlyChosen"), true);
+    }
+    values.insert(QStringLiteral("network/killSwitchEnabled"), m_killSwitchEnabled);
+    values.insert(
         QStringLiteral("network/autoDisableSystemProxyOnDisconnect"),
         m_autoDisableSystemProxyOnDisconnect
         );
-    settings.setValue(QStringLiteral("routing/whitelistMode"), m_whitelistMode);
-    settings.setValue(QStringLiteral("routing/proxyDomains"), m_proxyDomainRules);
-    settings.setValue(QStringLiteral("routing/directDomains"), m_directDomainRules);
-    settings.setValue(QStringLiteral("routing/blockDomains"), m_blockDomainRules);
-    settings.setValue(QStringLiteral("routing/customDnsServers"), m_customDnsServers);
-    settings.setValue(QStringLiteral("routing/proxyApps"), m_proxyAppRules);
-    settings.setValue(QStringLiteral("routing/directApps"), m_directAppRules);
-    settings.setValue(QStringLiteral("routing/blockApps"), m_blockAppRules);
-    settings.setValue(QStringLiteral("speedtest/sizeMb"), m_speedTestSelectedSizeMb);
-    settings.setValue(QStringLiteral("speedtest/downloadEndpointTemplate"), m_speedTestDownloadEndpointTemplate);
+    values.insert(QStringLiteral("routing/whitelistMode"), m_whitelistMode);
+    values.insert(QStringLiteral("routing/proxyDomains"), m_proxyDomainRules);
+    values.insert(QStringLiteral("routing/directDomains"), m_directDomainRules);
+    values.insert(QStringLiteral("routing/blockDomains"), m_blockDomainRules);
+    values.insert(QStringLiteral("routing/customDnsServers"), m_customDnsServers);
+    values.insert(QStringLiteral("routing/proxyApps"), m_proxyAppRules);
+    values.insert(QStringLiteral("routing/directApps"), m_directAppRules);
+    values.insert(QStringLiteral("routing/blockApps"), m_blockAppRules);
+    values.insert(
+        QStringLiteral("routing/ruleSourcesJson"),
+        QString::fromUtf8(QJsonDocument(m_ruleSources).toJson(QJsonDocument::Compact))
+        );
+    values.insert(
+        QStringLiteral("network/transportDefaultsJson"),
+        QString::fromUtf8(QJsonDocument(m_buildOptions.transport.toJson()).toJson(QJsonDocument::Compact))
+        );
+    values.insert(
+        QStringLiteral("network/tunTuningJson"),
+        QString::fromUtf8(QJsonDocument(m_tunTuningByProfile).toJson(QJsonDocument::Compact))
+        );
+    values.insert(QStringLiteral("speedtest/sizeMb"), m_speedTestSelectedSizeMb);
+    values.insert(QStringLiteral("speedtest/downloadEndpointTemplate"), m_speedTestDownloadEndpointTemplate);
+    return values;
 }
@@ -21,15 +21,20 @@
 
 module;
 #include <QByteArray>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QObject>
 #include <QElapsedTimer>
 #include <QDateTime>
+#include <QHash>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkProxy>
+#include <QPair>
 #include <QProcess>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
 #include <QTimer>
 #include <QUrl>
 #include <QVector>
@@ -40,10 +45,23 @@ module;
 #ifndef Q_MOC_RUN
 export module genyconnect.backend.vpncontroller;
 import genyconnect.backend.connectionstate;
+import genyconnect.backend.logpipeline;
+import genyconnect.backend.networkmonitor;
+import genyconnect.backend.persistenceservice;
+import genyconnect.backend.proxyhealthmonitor;
+import genyconnect.backend.routingrulecompiler;
 import genyconnect.backend.serverprofile;
 import genyconnect.backend.serverprofilemodel;
+import genyconnect.backend.speedtestengine;
+import genyconnect.backend.speedtesthistory;
+import genyconnect.backend.speedtestsnapshot;
+import genyconnect.backend.subscriptiondecoder;
+import genyconnect.backend.subscriptionfetcher;
 import genyconnect.backend.systemproxymanager;
+import genyconnect.backend.transporttuner;
+import genyconnect.backend.udpprobe;
 import genyconnect.backend.updater;
+import genyconnect.backend.xraycapabilities;
 import genyconnect.backend.xrayconfigbuilder;
 import genyconnect.backend.xrayprocessmanager;
 #endif
@@ -93,6 +111,9 @@ GENYCONNECT_MODULE_EXPORT class VpnController : public QObject
     Q_PROPERTY(bool publicIpRefreshing READ publicIpRefreshing NOTIFY publicIpAddressChanged)
     Q_PROPERTY(QString latestRecordedUsage READ latestRecordedUsage NOTIFY profileUsageChanged)
     Q_PROPERTY(QString memoryUsageText READ memoryUsageText NOTIFY memoryUsageChanged)
+    // Live figures: refreshed at most once per frame. The speedTest* properties
+    // below are notified on phase transitions and results only.
+    Q_PROPERTY(SpeedTestSnapshot speedTestSnapshot READ speedTestSnapshot NOTIFY speedTestSnapshotChanged)
     Q_PROPERTY(bool speedTestRunning READ speedTestRunning NOTIFY speedTestChanged)
     Q_PROPERTY(QString speedTestState READ speedTestState NOTIFY speedTestChanged)
     Q_PROPERTY(QString speedTestPhase READ speedTestPhase NOTIFY speedTestChanged)
@@ -109,10 +130,14 @@ GENYCONNECT_MODULE_EXPORT class VpnController : public QObject
     Q_PROPERTY(int speedTestQualityScore READ speedTestQualityScore NOTIFY speedTestChanged)
     Q_PROPERTY(int speedTestLatencyMinMs READ speedTestLatencyMinMs NOTIFY speedTestChanged)
     Q_PROPERTY(int speedTestLatencyMaxMs READ speedTestLatencyMaxMs NOTIFY speedTestChanged)
+    Q_PROPERTY(QVariantMap speedTestLatencyProfile READ speedTestLatencyProfile NOTIFY speedTestChanged)
+    Q_PROPERTY(QString speedTestBufferbloatGrade READ speedTestBufferbloatGrade NOTIFY speedTestChanged)
     Q_PROPERTY(double speedTestDownloadMbps READ speedTestDownloadMbps NOTIFY speedTestChanged)
     Q_PROPERTY(double speedTestUploadMbps READ speedTestUploadMbps NOTIFY speedTestChanged)
     Q_PROPERTY(QString speedTestError READ speedTestError NOTIFY speedTestChanged)
     Q_PROPERTY(QStringList speedTestHistory READ speedTestHistory NOTIFY speedTestChanged)
+    Q_PROPERTY(int speedTestStreamCount READ speedTestStreamCount NOTIFY speedTestChanged)
+    Q_PROPERTY(QVariantList speedTestStreams READ speedTestStreams NOTIFY speedTestChanged)
     Q_PROPERTY(
         int speedTestSelectedSizeMb
         READ speedTestSelectedSizeMb
@@ -124,6 +149,7 @@ GENYCONNECT_MODULE_EXPORT class VpnController : public QObject
     Q_PROPERTY(QString currentProfileAddressValue READ currentProfileAddress NOTIFY currentProfileIndexChanged)
     Q_PROPERTY(QObject *profileModel READ profileModel CONSTANT)
     Q_PROPERTY(QObject *updater READ updater CONSTANT)
+    Q_PROPERTY(QObject *speedTestHistoryModel READ speedTestHistoryModel CONSTANT)
 
     Q_PROPERTY(QString xrayExecutablePath READ xrayExecutablePath WRITE setXrayExecutablePath NOTIFY xrayExecutablePathChanged)
     Q_PROPERTY(QString xrayVersion READ xrayVersion NOTIFY xrayVersionChanged)
@@ -154,6 +180,8 @@ GENYCONNECT_MODULE_EXPORT class VpnController : public QObject
     Q_PROPERTY(QString proxyDomainRules READ proxyDomainRules WRITE setProxyDomainRules NOTIFY routingRulesChanged)
     Q_PROPERTY(QString directDomainRules READ directDomainRules WRITE setDirectDomainRules NOTIFY routingRulesChanged)
     Q_PROPERTY(QString blockDomainRules READ blockDomainRules WRITE setBlockDomainRules NOTIFY routingRulesChanged)
+    Q_PROPERTY(QVariantList ruleSourceItems READ ruleSourceItems NOTIFY ruleSourcesChanged)
+    Q_PROPERTY(bool ruleSourcesBusy READ ruleSourcesBusy NOTIFY ruleSourcesChanged)
     Q_PROPERTY(QString customDnsServers READ customDnsServers WRITE setCustomDnsServers NOTIFY customDnsServersChanged)
     Q_PROPERTY(QString proxyAppRules READ proxyAppRules WRITE setProxyAppRules NOTIFY appRulesChanged)
     Q_PROPERTY(QString directAppRules READ directAppRules WRITE setDirectAppRules NOTIFY appRulesChanged)
@@ -163,6 +191,16 @@ GENYCONNECT_MODULE_EXPORT class VpnController : public QObject
     Q_PROPERTY(QString currentProfileUsageWeek READ currentProfileUsageWeek NOTIFY profileUsageChanged)
     Q_PROPERTY(QString currentProfileUsageMonth READ currentProfileUsageMonth NOTIFY profileUsageChanged)
     Q_PROPERTY(bool processRoutingSupported READ processRoutingSupported NOTIFY processRoutingSupportChanged)
+    Q_PROPERTY(int lastNetworkRecoveryMs READ lastNetworkRecoveryMs NOTIFY networkRecoveryChanged)
+    Q_PROPERTY(QVariantMap proxyHealth READ proxyHealth NOTIFY proxyHealthChanged)
+    Q_PROPERTY(bool transportTunerRunning READ transportTunerRunning NOTIFY transportTunerChanged)
+    Q_PROPERTY(QString transportTunerStatus READ transportTunerStatus NOTIFY transportTunerChanged)
+    Q_PROPERTY(QVariantList transportTunerResults READ transportTunerResults NOTIFY transportTunerChanged)
+    Q_PROPERTY(bool batchSpeedTestRunning READ batchSpeedTestRunning NOTIFY batchSpeedTestChanged)
+    Q_PROPERTY(QString batchSpeedTestStatus READ batchSpeedTestStatus NOTIFY batchSpeedTestChanged)
+    Q_PROPERTY(QVariantList batchSpeedTestResults READ batchSpeedTestResults NOTIFY batchSpeedTestChanged)
+    Q_PROPERTY(bool startupLoading READ startupLoading NOTIFY startupLoadingChanged)
+    Q_PROPERTY(qint64 firstFrameMs READ firstFrameMs NOTIFY startupTimingChanged)
     Q_PROPERTY(quint16 socksPort READ socksPort CONSTANT)
     Q_PROPERTY(quint16 httpPort READ httpPort CONSTANT)
 
@@ -244,10 +282,24 @@ public:
 
     /**
      * @brief Current speed-test phase.
-     * @return Phase string (`Ping`, `Download`, `Upload`, ...).
+     * @return Phase name (`Latency`, `Download`, `Upload`, ...).
      */
     QString speedTestPhase() const;
 
+    /**
+     * @brief Last published speed-test snapshot.
+     * @return Live figures as of the last publishSpeedTestSnapshot().
+     */
+    SpeedTestSnapshot speedTestSnapshot() const;
+
+    /**
+     * @brief Publish the live speed-test figures if they changed since the last frame.
+     *
+     * Meant to be driven by the window's frame cycle; speedTestFrameRequested()
+     * asks for the next frame, and a fallback timer publishes when none comes.
+     */
+    void publishSpeedTestSnapshot();
+
     /**
      * @brief Elapsed seconds in active phase.
      * @return Elapsed seconds.
@@ -286,6 +338,19 @@ public:
     int speedTestLatencyMinMs() const;
     int speedTestLatencyMaxMs() const;
 
+    /**
+     * @brief Idle and loaded latency distributions of the last speed test.
+     * @return Map with `idle`, `download` and `upload` entries (`p50`, `p90`, `p99`, `samples`),
+     *         plus `bufferbloatMs` and `bufferbloatGrade`.
+     */
+    QVariantMap speedTestLatencyProfile() const;
+
+    /**
+     * @brief Bufferbloat grade (`A+` to `F`) from latency increase under load.
+     * @return Grade, empty when not measured.
+     */
+    QString speedTestBufferbloatGrade() const;
+
     /**
      * @brief Final download test result.
      * @return Mbps value.
@@ -309,6 +374,18 @@ public:
      * @return History list (newest first).
      */
     QStringList speedTestHistory() const;
+
+    /**
+     * @brief Parallel streams that have carried data in the current transfer phase.
+     * @return Stream count, 0 outside transfer phases.
+     */
+    int speedTestStreamCount() const;
+
+    /**
+     * @brief Per-stream figures of the current transfer phase.
+     * @return List of maps (`id`, `bytes`, `mbps`, `requests`, `active`, `error`).
+     */
+    QVariantList speedTestStreams() const;
     int speedTestSelectedSizeMb() const;
     void setSpeedTestSelectedSizeMb(int sizeMb);
 
@@ -336,6 +413,12 @@ public:
      */
     QObject *updater();
 
+    /**
+     * @brief Access structured speed-test history for QML binding.
+     * @return Pointer to speed-test history model.
+     */
+    QObject *speedTestHistoryModel();
+
     /**
      * @brief Configured Xray executable path.
      * @return Executable path string.
@@ -500,6 +583,18 @@ public:
      */
     QString blockDomainRules() const;
 
+    /**
+     * @brief Rule list sources (local files or URLs) merged into the domain rules.
+     * @return List of maps with location, target, entries, updatedAt and error.
+     */
+    QVariantList ruleSourceItems() const;
+
+    /**
+     * @brief Whether remote rule sources are being refreshed.
+     * @return True while a refresh is running.
+     */
+    bool ruleSourcesBusy() const;
+
     /**
      * @brief Custom DNS servers used in generated runtime config.
      * @return Comma/newline-separated DNS servers.
@@ -584,6 +679,89 @@ public:
      */
     bool processRoutingSupported() const;
 
+    /**
+     * @brief Time the tunnel needed to recover after the last host network change.
+     * @return Milliseconds from detection to verified connectivity, or `-1` when not measured yet.
+     */
+    int lastNetworkRecoveryMs() const;
+
+    /**
+     * @brief Whether stored profiles, subscriptions or usage are still loading.
+     * @return True until every startup store has been applied.
+     */
+    bool startupLoading() const;
+
+    /**
+     * @brief Time from process start to the first rendered frame.
+     * @return Milliseconds, or `-1` when not recorded yet.
+     */
+    qint64 firstFrameMs() const;
+
+    /**
+     * @brief Record time-to-first-frame for this run (first call wins).
+     * @param elapsedMs Milliseconds from process start to the first swapped frame.
+     */
+    void recordFirstFrame(qint64 elapsedMs);
+
+    /**
+     * @brief Feed one runtime log line through the same path as xray-core output.
+     * @param line Raw runtime line.
+     */
+    void postRuntimeLogLine(const QString& line);
+
+    /**
+     * @brief Aggregated proxy health over recent probes.
+     * @return Map with healthy flag, success rate and median stage timings.
+     */
+    QVariantMap proxyHealth() const;
+
+    /**
+     * @brief Whether the transport tuner is benchmarking a profile.
+     * @return True while candidates are measured.
+     */
+    bool transportTunerRunning() const;
+
+    /**
+     * @brief Progress or outcome of the last transport tuner run.
+     * @return Status line.
+     */
+    QString transportTunerStatus() const;
+
+    /**
+     * @brief Candidates of the last transport tuner run.
+     * @return Maps with label, latencyMs, throughputMbps, score and error.
+     */
+    QVariantList transportTunerResults() const;
+
+    /**
+     * @brief Whether profiles of a group are being benchmarked.
+     * @return True while profiles are measured.
+     */
+    bool batchSpeedTestRunning() const;
+
+    /**
+     * @brief Progress or outcome of the last batch speed test.
+     * @return Status line.
+     */
+    QString batchSpeedTestStatus() const;
+
+    /**
+     * @brief Results of the last batch speed test, best first.
+     *
+     * Measured profiles come from the speed-test history; profiles that failed
+     * or are still pending follow with rank -1.
+     *
+     * @return Maps with rank, row, profileId, label, ok, measured, latencyMs, throughputMbps, streams, score and error.
+     */
+    QVariantList batchSpeedTestResults() const;
+
+    /**
+     * @brief Recent proxy health probe samples, newest last.
+     * @param limit Maximum number of samples.
+     * @return Sample maps (target, ok, connect/CONNECT-reply/TLS/TTFB timings).
+     */
+    Q_INVOKABLE QVariantList proxyHealthSamples(int limit = 60) const;
+
     /**
      * @brief Local SOCKS port currently used by runtime config.
      * @return SOCKS port value.
@@ -609,6 +787,20 @@ public:
      * @return Number of imported/updated profiles.
      */
     Q_INVOKABLE int importProfileBatch(const QString& text);
+
+    /**
+     * @brief Export all profiles as a portable JSON file.
+     * @param fileUrl Destination file URL.
+     * @return True when the file was written.
+     */
+    Q_INVOKABLE bool exportProfiles(const QUrl& fileUrl);
+
+    /**
+     * @brief Import profiles from a JSON file produced by exportProfiles().
+     * @param fileUrl Source file URL.
+     * @return Number of imported/updated profiles.
+     */
+    Q_INVOKABLE int importProfiles(const QUrl& fileUrl);
     /**
      * @brief Add subscription URL and import its profiles.
      * @param url Subscription endpoint URL.
@@ -633,6 +825,26 @@ public:
      */
     Q_INVOKABLE int refreshSubscriptionsByGroup(const QString& group);
 
+    /**
+     * @brief Add a rule list source and fetch it when remote.
+     * @param location Local file path/URL or http(s) URL.
+     * @param target Rule list it feeds: `proxy`, `direct` or `block`.
+     * @return True when the source was added.
+     */
+    Q_INVOKABLE bool addRuleSource(const QString& location, const QString& target);
+
+    /**
+     * @brief Remove a rule list source and its cached copy.
+     * @param index Index in ruleSourceItems.
+     */
+    Q_INVOKABLE void removeRuleSource(int index);
+
+    /**
+     * @brief Re-download all remote rule sources in the background.
+     * @return Number of sources queued.
+     */
+    Q_INVOKABLE int refreshRuleSources();
+
     /**
      * @brief Remove profile row.
      * @param row Row index.
@@ -640,6 +852,21 @@ public:
      */
     Q_INVOKABLE bool removeProfile(int row);
     Q_INVOKABLE bool updateProfileBasics(int row, const QString& name, const QString& groupName);
+
+    /**
+     * @brief Per-profile transport tuning overrides.
+     * @param row Row index.
+     * @return Set fields only (see TransportTuning); unset fields use global defaults.
+     */
+    Q_INVOKABLE QVariantMap profileTransportTuning(int row) const;
+
+    /**
+     * @brief Replace per-profile transport tuning overrides.
+     * @param row Row index.
+     * @param tuning Fields to set; missing or null fields fall back to global defaults.
+     * @return True when the profile exists.
+     */
+    Q_INVOKABLE bool updateProfileTransportTuning(int row, const QVariantMap& tuning);
     /**
      * @brief Remove all stored profiles.
      * @return Number of removed profiles.
@@ -700,6 +927,35 @@ public:
      */
     Q_INVOKABLE void cancelSpeedTest();
 
+    /**
+     * @brief Benchmark transport settings for a profile and keep the winner.
+     * @param row Profile row index.
+     * @return True when the run started.
+     */
+    Q_INVOKABLE bool startTransportTuner(int row);
+
+    /**
+     * @brief Abort the running transport tuner; profile settings stay unchanged.
+     */
+    Q_INVOKABLE void cancelTransportTuner();
+
+    /**
+     * @brief Benchmark every enabled profile of the current group without connecting.
+     * @return True when the run started.
+     */
+    Q_INVOKABLE bool startBatchSpeedTest();
+
+    /**
+     * @brief Abort the running batch speed test; results measured so far stay.
+     */
+    Q_INVOKABLE void cancelBatchSpeedTest();
+
+    /**
+     * @brief Fastest profile of the last batch speed test.
+     * @return Profile row index, or -1 when none was measured.
+     */
+    Q_INVOKABLE int batchSpeedTestBestRow() const;
+
     /**
      * @brief Format bytes into human-readable units.
      * @param bytes Raw byte count.
@@ -771,6 +1027,10 @@ signals:
     void memoryUsageChanged();
     //! Emitted when speed-test state/metrics change.
     void speedTestChanged();
+    //! Emitted when a new speed-test snapshot is published.
+    void speedTestSnapshotChanged();
+    //! Emitted when live speed-test figures changed and need a frame to be published.
+    void speedTestFrameRequested();
     //! Emitted when selected profile index changes.
     void currentProfileIndexChanged();
     //! Emitted when executable path changes.
@@ -796,6 +1056,8 @@ signals:
     void whitelistModeChanged();
     //! Emitted when domain rules are updated.
     void routingRulesChanged();
+    //! Emitted when rule sources or their refresh state change.
+    void ruleSourcesChanged();
     //! Emitted when custom DNS server list is updated.
     void customDnsServersChanged();
     //! Emitted when app/process rules are updated.
@@ -804,6 +1066,18 @@ signals:
     void profileUsageChanged();
     //! Emitted when process-routing capability is re-evaluated.
     void processRoutingSupportChanged();
+    //! Emitted when a network-change recovery completes.
+    void networkRecoveryChanged();
+    //! Emitted when a proxy health probe sample is recorded.
+    void proxyHealthChanged();
+    //! Emitted when transport tuner progress or results change.
+    void transportTunerChanged();
+    //! Emitted when batch speed test progress or results change.
+    void batchSpeedTestChanged();
+    //! Emitted once all stores read at startup have been applied.
+    void startupLoadingChanged();
+    //! Emitted when the first-frame time is recorded.
+    void startupTimingChanged();
     void publicIpAddressChanged();
     void killSwitchEnabledChanged();
 
@@ -814,21 +1088,18 @@ private slots:
     void onProcessStopped(int exitCode, QProcess::ExitStatus exitStatus);
     //! Handle process/runtime error callback.
     void onProcessError(const QString& error);
-    //! Handle incoming runtime log line.
-    void onLogLine(const QString& line);
+    //! Adopt a coalesced log snapshot published by the backend log pipeline.
+    void onLogSnapshot(const QStringList& lines, const QString& latestRuntimeLine);
     //! Handle traffic-updated signal from process manager.
     void onTrafficUpdated();
     //! Poll Xray API traffic stats.
     void pollTrafficStats();
     //! Tick handler for speed-test phase timings/samples.
     void onSpeedTestTick();
-    //! Read bytes during active speed-test request.
-    void onSpeedTestReadyRead();
-    void onSpeedTestDownloadProgress(qint64 received, qint64 total);
-    //! Update upload counters during upload phase.
-    void onSpeedTestUploadProgress(qint64 sent, qint64 total);
-    //! Handle speed-test request completion.
-    void onSpeedTestFinished();
+    //! Update transfer counters from the aggregate of all speed-test streams.
+    void onSpeedTestProgress();
+    //! Handle speed-test transfer phase completion.
+    void onSpeedTestFinished(QNetworkReply::NetworkError errorCode, const QString& errorText);
     void onPublicIpFinished();
 
 private:
@@ -837,6 +1108,9 @@ private:
         QString name;
         QString group;
         QString url;
+        QString etag;            //!< `ETag` of the last imported payload.
+        QString lastModified;    //!< `Last-Modified` of the last imported payload.
+        QString contentHash;     //!< SHA-256 of the last imported payload, hex.
     };
 
     struct ProfileGroupOptions {
@@ -847,6 +1121,12 @@ private:
         QString badge;
     };
 
+    struct StoredProfiles {
+        QList<ServerProfile> profiles;
+        bool fromLegacyJson = false;  //!< Read from `profiles.json`; needs migrating.
+        QString storeError;           //!< Why the binary store was not usable.
+    };
+
     /**
      * @brief Set connection state and emit change when needed.
      * @param state New state.
@@ -863,15 +1143,20 @@ private:
      * @brief Start one HTTP request for speed-test phase.
      * @param url Endpoint URL.
      * @param upload True for upload request.
-     * @param payload Upload body data.
      */
-    void startSpeedTestRequest(const QUrl& url, bool upload, const QByteArray& payload = QByteArray());
+    void startSpeedTestRequest(const QUrl& url, bool upload);
 
     /**
      * @brief Start request for current phase/attempt.
      */
     void startCurrentSpeedTestRequest();
     void runNextSpeedTestLatencyProbe();
+    //! Probe latency through the tunnel while a transfer phase loads it.
+    void runLoadedLatencyProbe();
+    //! Start the UDP datagram train of the latency phase.
+    void startSpeedTestUdpProbe();
+    //! Take the UDP result and resume the latency phase if it waited.
+    void onSpeedTestUdpProbeFinished(bool ok, const QString& error);
     void startPingPhase();
     void startDownloadPhase();
     void startUploadPhase();
@@ -889,6 +1174,7 @@ private:
     int normalizedSpeedTestSizeMb(int requested) const;
     void updateSpeedTestSampling(bool finalizeWindow = false);
     void finalizeSpeedTestLatencyMetrics();
+    void finalizeSpeedTestBufferbloatMetrics();
     void finalizeSpeedTestQualityMetrics();
     static int percentileLatency(const QVector<int>& samples, double percentile);
 
@@ -912,12 +1198,51 @@ private:
     void runProxySelfCheck();
     void runProxySelfCheckAttempt(int attempt);
 
+    /**
+     * @brief React to a debounced host network change while connected.
+     * @param reason Event kinds reported by the network monitor.
+     */
+    void handleNetworkChanged(const QString& reason);
+
+    /**
+     * @brief Record recovery time for a pending network-change recovery.
+     * @param how Short description of how connectivity was restored.
+     */
+    void finishNetworkRecovery(const QString& how);
+
+    /**
+     * @brief Dispatch a finished health round to the self-check or network re-validation waiting on it.
+     * @param roundId Round id returned by ProxyHealthMonitor::probeNow().
+     * @param ok True when at least one target passed.
+     * @param error First failure when no target passed.
+     */
+    void onProxyHealthRoundFinished(quint64 roundId, bool ok, const QString& error);
+
+    /**
+     * @brief Store the tuner's winning settings on the tuned profile.
+     * @param ok True when at least one candidate was measured.
+     * @param error Failure or cancellation reason.
+     */
+    void onTransportTunerFinished(bool ok, const QString& error);
+
+    /**
+     * @brief Log the ranking of a finished batch.
+     * @param ok True when at least one profile was measured.
+     * @param error Failure or cancellation reason.
+     */
+    void onBatchSpeedTestFinished(bool ok, const QString& error);
+
     /**
      * @brief Reset speed-test state variables.
      * @param emitSignal Emit speedTestChanged when true.
      */
     void resetSpeedTestState(bool emitSignal = true);
 
+    /**
+     * @brief Mark the live speed-test figures changed and request a frame.
+     */
+    void requestSpeedTestSnapshot();
+
     /**
      * @brief Check local proxy can reach test endpoint.
      * @param errorMessage Optional error output.
@@ -926,10 +1251,22 @@ private:
     bool checkLocalProxyConnectivity(QString *errorMessage) const;
 
     /**
-     * @brief Detect whether process-routing feature is supported.
-     * @return True if supported by current runtime.
+     * @brief Whether the process-routing feature is supported.
+     * @return True if supported by the current runtime; false while it is still being probed.
      */
-    bool detectProcessRoutingSupport();
+    bool detectProcessRoutingSupport() const;
+
+    /**
+     * @brief Load capabilities of the configured core from cache, or probe them in the background.
+     */
+    void refreshXrayCapabilities();
+    void cacheXrayCapabilities(const XrayCapabilities& capabilities);
+    void applyXrayCapabilities(const XrayCapabilities& capabilities);
+
+    /**
+     * @brief Run a connect that waited for the capability probe, once it reported back.
+     */
+    void resumeDeferredConnect();
 
     /**
      * @brief Parse newline/comma-separated rules.
@@ -952,8 +1289,14 @@ private:
     QVariantList profileUsageSessionsForId(const QString& profileId, int limit) const;
     QVariantMap latestUsageSnapshotForId(const QString& profileId) const;
     QString currentProfileUsageText(const QString& period) const;
-    void loadProfileUsage();
-    void saveProfileUsage() const;
+    static QJsonObject readStoredProfileUsage(const QString& path);
+    static QList<SpeedTestResult> readStoredSpeedTestHistory(const QString& path);
+    void applyStoredSpeedTestHistory(const QList<SpeedTestResult>& results);
+    void recordSpeedTestResult();
+    void recordBatchSpeedTestResult(int index);
+    QList<SpeedTestResult> rankedBatchSpeedTestResults() const;
+    void applyStoredProfileUsage(const QJsonObject& root);
+    void saveProfileUsage();
     void scheduleProfileUsageSave();
     void cleanupDetachedHelpers();
     void stopPrivilegedTunRuntimeByPidPath();
@@ -987,7 +1330,6 @@ private:
     bool requestElevationForTun(QString *errorMessage);
     bool startPrivilegedTunProcess(QString *errorMessage);
     bool stopPrivilegedTunProcess(QString *errorMessage);
-    void pollPrivilegedTunLogs();
     bool applyMacTunRoutes(QString *errorMessage);
     void clearMacTunRoutes();
 
@@ -999,6 +1341,18 @@ private:
      */
     bool writeRuntimeConfig(const ServerProfile& profile, QString *errorMessage);
 
+    /**
+     * @brief Merge TUN tuning values (MTU, path MTU, queue/offload state) into the per-profile record.
+     * @param profileId Profile identifier.
+     * @param values Values to merge.
+     */
+    void recordTunTuning(const QString& profileId, const QJsonObject& values);
+
+    /**
+     * @brief Measure path MTU to the active server in the background for the next connect.
+     */
+    void startTunPathMtuProbe();
+
     /**
      * @brief Attempt to detect default Xray executable path.
      * @return Best-effort executable path.
@@ -1006,16 +1360,44 @@ private:
     QString detectDefaultXrayPath() const;
 
     /**
-     * @brief Load stored profiles from disk.
+     * @brief Show the cached first page of the profile list until the store is read.
+     */
+    void showStartupProfileCache();
+
+    /**
+     * @brief Read profiles, usage and subscriptions in parallel on the worker pool.
+     */
+    void startStartupLoad();
+
+    /**
+     * @brief Resolve the current profile once every startup store has been applied.
+     */
+    void releaseStartupStore(const QString& store);
+    void maybeFinishStartupLoad();
+
+    /**
+     * @brief Read stored profiles from disk; safe to call from any thread.
+     * @param storePath Binary profile store.
+     * @param legacyJsonPath Pre-binary `profiles.json`, used when the store is missing or unreadable.
+     * @return Normalized profiles.
      */
-    void loadProfiles();
+    static StoredProfiles readStoredProfiles(const QString& storePath, const QString& legacyJsonPath);
+
+    /**
+     * @brief Install profiles read at startup in place of the cached page, keeping any added in the meantime.
+     * @param stored Result of readStoredProfiles().
+     */
+    void applyStoredProfiles(const StoredProfiles& stored);
 
     /**
      * @brief Persist current profiles to disk.
      */
-    void saveProfiles() const;
-    void loadSubscriptions();
-    void saveSubscriptions() const;
+    void saveProfiles();
+    static void normalizeStoredProfile(ServerProfile& profile);
+    static QList<SubscriptionEntry> readStoredSubscriptions(const QString& path);
+    void applyStoredSubscriptions(const QList<SubscriptionEntry>& entries);
+    void saveSubscriptions();
+    void registerPersistenceStores();
     int importLinks(
         const QStringList& links,
         const QString& sourceId = QString(),
@@ -1023,16 +1405,69 @@ private:
         const QString& groupName = QString(),
         int *lastImportedIndex = nullptr
     );
+    int importProfiles(
+        const QList<ServerProfile>& profiles,
+        const QString& sourceId,
+        const QString& sourceName,
+        const QString& groupName,
+        int *lastImportedIndex = nullptr
+    );
     void beginSubscriptionOperation(const QString& message);
     void endSubscriptionOperation(const QString& message);
-    void startSubscriptionFetch(const SubscriptionEntry& entry, bool fromRefresh);
+    void startSubscriptionFetches(const QList<SubscriptionEntry>& entries, bool fromRefresh);
+    void onSubscriptionFetched(const SubscriptionFetchResult& result);
+    void onSubscriptionDecoded(const SubscriptionDecodeResult& decoded);
+    void applySubscriptionResult(const SubscriptionFetchResult& result, const SubscriptionDecodeResult& decoded);
+    void storeSubscriptionValidators(
+        const QString& id,
+        const SubscriptionFetchResult& result,
+        const QString& contentHash);
+    void onSubscriptionFetchesFinished();
+    void completeSubscriptionFetches();
     void finishRefreshSubscriptions();
+    /**
+     * @brief Files contributed by rule sources to the routing lists.
+     * @return Pairs of target (`proxy`, `direct` or `block`) and local file or cached download.
+     */
+    QList<QPair<QString, QString>> ruleSourceFiles() const;
+    /**
+     * @brief Hash of everything the compiled routing lists depend on.
+     * @return Key over the inline rules and the size and modification time of
+     *         every rule source file; no file is read.
+     */
+    QByteArray routingRuleKey() const;
+    /**
+     * @brief Compile the routing lists on the worker pool unless the cached
+     *        result already matches the current inputs.
+     */
+    void scheduleRoutingRuleCompile();
+    /**
+     * @brief Compiled routing lists for the current inputs.
+     * @param key Output: input key the result belongs to.
+     * @return Cached result; compiled in place only when the inputs changed
+     *         since the last background compile.
+     */
+    RoutingRuleCompiler::Result compiledRoutingRules(QByteArray *key);
+    QString ruleSourceCachePath(const QString& location) const;
+    /**
+     * @brief Queue remote rule sources for download.
+     * @param staleOnly Only queue sources older than the refresh interval.
+     * @return Number of sources queued.
+     */
+    int queueRuleSourceRefresh(bool staleOnly);
+    void startNextRuleSourceFetch();
+    /**
+     * @brief Record the outcome of one rule source download and fetch the next.
+     * @param location Source URL.
+     * @param entries Parsed entries, or `-1` when the download failed.
+     * @param error Failure reason when @p entries is `-1`.
+     */
+    void finishRuleSourceFetch(const QString& location, int entries, const QString& error);
     void refreshProfileGroups();
     static QString normalizeGroupName(const QString& groupName);
     static QString normalizeGroupKey(const QString& groupName);
     static QString deriveSubscriptionName(const QString& url);
     void recomputeProfileStats();
-    void scheduleLogsChanged();
     int profileGroupOptionsIndex(const QString& groupName) const;
     ProfileGroupOptions profileGroupOptionsFor(const QString& groupName) const;
     void upsertProfileGroupOptions(const ProfileGroupOptions& options, bool save = true);
@@ -1043,9 +1478,15 @@ private:
     void loadSettings();
 
     /**
-     * @brief Save persistent controller settings.
+     * @brief Schedule a write-behind save of persistent controller settings.
+     */
+    void saveSettings();
+
+    /**
+     * @brief Capture persistent settings as key/value pairs.
+     * @return QSettings keys mapped to current values.
      */
-    void saveSettings() const;
+    QVariantMap settingsSnapshot() const;
 
     ConnectionState m_connectionState = ConnectionState::Disconnected;
     QString m_lastError;
@@ -1055,8 +1496,9 @@ private:
     qint64 m_txBytes = 0;
     qint64 m_memoryUsageBytes = 0;
     bool m_speedTestRunning = false;
-    QString m_speedTestState = QStringLiteral("Idle");
-    QString m_speedTestPhase = QStringLiteral("Idle");
+    SpeedTestSnapshot::Phase m_speedTestPhase = SpeedTestSnapshot::Idle;
+    SpeedTestSnapshot m_speedTestSnapshot;
+    bool m_speedTestSnapshotDirty = false;
     int m_speedTestElapsedSec = 0;
     int m_speedTestDurationSec = 18;
     double m_speedTestProgress = 0.0;
@@ -1073,7 +1515,9 @@ private:
     double m_speedTestDownloadMbps = 0.0;
     double m_speedTestUploadMbps = 0.0;
     QString m_speedTestError;
-    QStringList m_speedTestHistory;
+    SpeedTestHistoryModel m_speedTestHistoryModel;
+    QString m_speedTestDownloadEndpoint;
+    QString m_speedTestUploadEndpoint;
     qint64 m_speedTestBytesReceived = 0;
     qint64 m_speedTestLastBytes = 0;
     int m_speedTestAttempt = 0;
@@ -1082,9 +1526,16 @@ private:
     int m_speedTestLatencyAttemptCount = 0;
     int m_speedTestLatencySuccessCount = 0;
     QVector<int> m_speedTestLatencySamples;
+    QVector<int> m_speedTestIdleProbeSamples;
+    QVector<int> m_speedTestDownloadLatencySamples;
+    QVector<int> m_speedTestUploadLatencySamples;
+    UdpProbeResult m_speedTestUdpResult;
+    bool m_speedTestLatencyWaitingForUdp = false;
+    int m_speedTestBufferbloatMs = -1;
+    QString m_speedTestBufferbloatGrade;
     bool m_speedTestUploadMode = false;
     qint64 m_speedTestPhaseBytes = 0;
-    qint64 m_speedTestExpectedBytes = 0;
+    qint64 m_speedTestPhaseDurationMs = 0;
     qint64 m_speedTestSampleWindowStartMs = -1;
     qint64 m_speedTestSampleWindowStartBytes = 0;
     qint64 m_speedTestMeasuredBytes = 0;
@@ -1092,6 +1543,8 @@ private:
     qint64 m_speedTestLastProgressElapsedMs = 0;
     qint64 m_speedTestWarmupUntilMs = 0;
     bool m_speedTestCancelledByUser = false;
+    int m_speedTestDownloadStreams = 0;
+    int m_speedTestUploadStreams = 0;
     bool m_speedTestUsingDirectFallback = false;
     int m_speedTestSelectedSizeMb = 10;
     QString m_speedTestDownloadEndpointTemplate = QStringLiteral("https://speed.cloudflare.com/__down?bytes=%1");
@@ -1114,9 +1567,15 @@ private:
     QList<ProfileGroupOptions> m_profileGroupOptions;
     bool m_subscriptionBusy = false;
     QString m_subscriptionMessage;
-    QList<SubscriptionEntry> m_subscriptionRefreshQueue;
+    QHash<QString, SubscriptionEntry> m_subscriptionFetchEntries;  //!< In-flight fetches by subscription id.
+    bool m_subscriptionFetchFromRefresh = false;
     int m_subscriptionRefreshSuccessCount = 0;
     int m_subscriptionRefreshFailCount = 0;
+    int m_subscriptionRefreshImportedCount = 0;
+    QHash<QString, SubscriptionFetchResult> m_subscriptionDecodeFetches;  //!< Fetched, waiting for the decoder (payload dropped).
+    quint64 m_subscriptionFetchGeneration = 0;  //!< Bumped per fetch round; stale decodes are ignored.
+    int m_subscriptionDecodesPending = 0;
+    bool m_subscriptionFetchesDone = false;     //!< The fetcher reported finished().
     QStringList m_profileGroups;
     QString m_currentProfileGroup = QStringLiteral("All");
     int m_profileCount = 0;
@@ -1125,6 +1584,7 @@ private:
     int m_worstPingMs = -1;
     double m_profileScore = 0.0;
     bool m_useSystemProxy = false;
+    bool m_modeExplicitlyChosen = false;
     bool m_systemProxyApplied = false;
     bool m_proxyApplyInFlight = false;
     int m_pendingProxyApplyState = -1; // -1 none, 0 disable, 1 enable
@@ -1140,14 +1600,20 @@ private:
     QString m_proxyAppRules;
     QString m_directAppRules;
     QString m_blockAppRules;
-    bool m_processRoutingSupported = false;
-    bool m_processRoutingSupportChecked = false;
+    XrayCapabilities m_xrayCapabilities;          //!< Features of the configured core.
+    QJsonObject m_xrayCapabilityCache;            //!< Probed capabilities keyed by canonical binary path.
+    bool m_xrayCapabilitiesPending = false;       //!< Background probe in flight.
+    int m_connectAfterProbeProfileIndex = -1;     //!< Profile row whose connect waits for the probe, -1 for none.
+    quint64 m_xrayCapabilityProbeGeneration = 0;  //!< Invalidates superseded background probes.
 
     QString m_dataDirectory;
     QString m_profilesPath;
+    QString m_profileStorePath;
+    QString m_startupProfileCachePath;
     QString m_subscriptionsPath;
     QString m_runtimeConfigPath;
     QString m_profileUsagePath;
+    QString m_speedTestHistoryPath;
     QJsonObject m_profileUsageRoot;
     qint64 m_profileUsageLastRxSample = -1;
     qint64 m_profileUsageLastTxSample = -1;
@@ -1161,14 +1627,41 @@ private:
     Updater m_updater;
     SystemProxyManager m_systemProxyManager;
     XrayProcessManager m_processManager;
+    NetworkMonitor m_networkMonitor;
+    ProxyHealthMonitor m_proxyHealthMonitor;
+    TransportTuner m_transportTuner;
+    QString m_transportTunerStatus;
+    TransportTuner m_batchSpeedTest;
+    QString m_batchSpeedTestStatus;
+    qint64 m_batchSpeedTestRunMs = 0;     //!< Start time of the last batch; tags its history results.
+    QThread m_backendThread;              //!< Worker thread for non-UI backend work.
+    LogPipeline *m_logPipeline = nullptr; //!< Log filtering/tailing; lives on m_backendThread.
+    SubscriptionDecoder *m_subscriptionDecoder = nullptr; //!< Payload hashing/parsing; lives on m_backendThread.
+    PersistenceService m_persistence;     //!< Write-behind storage; writes on m_backendThread.
+    quint64 m_proxySelfCheckRoundId = 0;
+    int m_proxySelfCheckAttempt = 0;
+    quint64 m_networkRecheckRoundId = 0;
+    QElapsedTimer m_networkRecoveryTimer;
+    bool m_networkRecoveryPending = false;
+    bool m_networkRecoveryReconnecting = false;
+    int m_lastNetworkRecoveryMs = -1;
+    QSet<QString> m_pendingStartupStores;  //!< Stores still being read at startup; not written meanwhile.
+    QSet<QString> m_startupCachedProfileIds; //!< Cached profiles shown until the profile store is read.
+    QElapsedTimer m_startupTimer;
+    qint64 m_firstFrameMs = -1;
     XrayConfigBuilder::BuildOptions m_buildOptions;
     QTimer m_memoryUsageTimer;
     QTimer m_statsPollTimer;
     QTimer m_speedTestTimer;
+    QTimer m_speedTestLoadedProbeTimer;
+    QTimer m_speedTestSnapshotTimer;
     QNetworkAccessManager m_speedTestNetworkManager;
     QNetworkAccessManager m_subscriptionNetworkManager;
     QNetworkAccessManager m_publicIpNetworkManager;
-    QNetworkReply *m_speedTestReply = nullptr;
+    SpeedTestEngine m_speedTestEngine {&m_speedTestNetworkManager};
+    SpeedTestLatencyProbe m_speedTestTunnelProbe {&m_speedTestNetworkManager}; //!< Idle and loaded latency through the tunnel.
+    SubscriptionFetcher m_subscriptionFetcher {&m_subscriptionNetworkManager};
+    UdpProbe m_speedTestUdpProbe;
     QNetworkReply *m_publicIpReply = nullptr;
     QTimer m_publicIpRetryTimer;
     bool m_statsPolling = false;
@@ -1183,20 +1676,28 @@ private:
     QString m_privilegedTunHelperToken;
     QString m_privilegedTunPidPath;
     QString m_privilegedTunLogPath;
-    qint64 m_privilegedTunLogOffset = 0;
-    QByteArray m_privilegedTunLogBuffer;
-    QTimer m_privilegedTunLogTimer;
     QTimer m_profileUsageSaveTimer;
     QString m_managedRuntimeRecordPath;
     qint64 m_privilegedTunRuntimePid = -1;
     std::atomic<quint64> m_connectAttemptCounter {0};
     std::atomic_bool m_disconnectRequested {false};
     std::atomic_bool m_shutdownInProgress {false};
-    QTimer m_logsFlushTimer;
-    bool m_logsDirty = false;
     QString m_selectedTunInterfaceName;
     QString m_activeProfileAddress;
     QString m_lastTunServerIp;
+    QJsonObject m_tunTuningByProfile;
+    QJsonObject m_lastTunTuning;
+    int m_activeTunMtu = 0;
+    QString m_ruleAssetDirectory;           //!< Generated rule assets and mirrored core assets.
+    QString m_activeRuleAssetDirectory;     //!< Asset directory of the current runtime; empty when unused.
+    QString m_ruleSourceCacheDirectory;     //!< Downloaded copies of remote rule sources.
+    QJsonArray m_ruleSources;               //!< Rule sources: location, target, entries, updatedAt, error.
+    QStringList m_ruleSourceRefreshQueue;   //!< Remote locations waiting to be fetched.
+    bool m_ruleSourcesBusy = false;
+    QTimer m_ruleSourceRefreshTimer;
+    RoutingRuleCompiler::Result m_compiledRoutingRules; //!< Inline rules plus rule sources, compiled.
+    QByteArray m_compiledRoutingRulesKey;   //!< Input key of m_compiledRoutingRules; empty before the first compile.
+    QByteArray m_routingRuleCompileKey;     //!< Input key of the background compile in flight; empty when idle.
 };
 
 #include "vpncontroller.moc"
@@ -0,0 +1,315 @@
+module;
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QTimeZone>
+
+module genyconnect.backend.xraycapabilities;
+
+namespace {
+constexpr int kProbeStartTimeoutMs = 2000;
+constexpr int kProbeFinishTimeoutMs = 3000;
+constexpr const char *kCandidateTransports[] = {
+    "tcp", "raw", "ws", "grpc", "httpupgrade", "xhttp", "splithttp", "kcp", "quic", "h2"
+};
+constexpr const char *kCandidateTunStacks[] = {"system", "gvisor", "mixed"};
+
+struct OptionRelease {
+    const char *option;
+    int major;
+    int minor;
+    int patch;
+};
+
+// First Xray-core release whose config reference documents each tuning
+// option. Options not listed (tcpFastOpen, mux concurrency, policy levels)
+// predate every core GenyConnect can drive. A core older than the listed
+// release ignores the field, so where the release is uncertain the later one
+// is listed: the option is dropped on a core that might have honoured it,
+// never sent to one that cannot.
+constexpr OptionRelease kOptionReleases[] = {
+    // streamSettings.sockopt.tcpKeepAliveIdle, added next to tcpKeepAliveInterval.
+    {"tcpKeepAliveIdle", 1, 4, 0},
+    // streamSettings.sockopt.tcpcongestion (Linux TCP_CONGESTION).
+    {"tcpCongestion", 1, 5, 0},
+    // mux.xudpConcurrency, part of the XUDP mux rework.
+    {"xudpConcurrency", 1, 8, 0},
+    // streamSettings.sockopt.tcpNoDelay; placed between 1.8.0 and 1.8.6, so
+    // the later release is listed.
+    {"tcpNoDelay", 1, 8, 6},
+    // streamSettings.sockopt.tcpMptcp (Linux MPTCP).
+    {"tcpMptcp", 1, 8, 6}
+};
+
+bool runXray(const QString& executablePath, const QStringList& arguments, QString *output, int *exitCode)
+{
+    QProcess process;
+    process.start(executablePath, arguments);
+    if (!process.waitForStarted(kProbeStartTimeoutMs)) {
+        return false;
+    }
+    if (!process.waitForFinished(kProbeFinishTimeoutMs)) {
+        process.kill();
+        process.waitForFinished(500);
+        return false;
+    }
+    if (output) {
+        *output = QString::fromUtf8(process.readAllStandardOutput())
+                  + QString::fromUtf8(process.readAllStandardError());
+    }
+    if (exitCode) {
+        *exitCode = process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    }
+    return true;
+}
+
+// `run -test` parses the config and builds every handler without starting
+// them, so an unknown transport or stack is reported as a config error.
+bool configAccepted(const QString& executablePath, const QJsonObject& config)
+{
+    QTemporaryFile file(QDir::temp().filePath(QStringLiteral("genyconnect-probe-XXXXXX.json")));
+    if (!file.open()) {
+        return false;
+    }
+    file.write(QJsonDocument(config).toJson(QJsonDocument::Compact));
+    file.close();
+
+    int exitCode = -1;
+    return runXray(
+               executablePath,
+               {QStringLiteral("run"), QStringLiteral("-test"), QStringLiteral("-config"), file.fileName()},
+               nullptr,
+               &exitCode)
+           && exitCode == 0;
+}
+
+QJsonObject transportProbeConfig(const QString& network)
+{
+    return QJsonObject {
+        {QStringLiteral("log"), QJsonObject {{QStringLiteral("loglevel"), QStringLiteral("none")}}},
+        {QStringLiteral("outbounds"), QJsonArray {
+            QJsonObject {
+                {QStringLiteral("protocol"), QStringLiteral("vless")},
+                {QStringLiteral("settings"), QJsonObject {
+                    {QStringLiteral("vnext"), QJsonArray {
+                        QJsonObject {
+                            {QStringLiteral("address"), QStringLiteral("127.0.0.1")},
+                            {QStringLiteral("port"), 1},
+                            {QStringLiteral("users"), QJsonArray {
+                                QJsonObject {
+                                    {QStringLiteral("id"), QStringLiteral("00000000-0000-0000-0000-000000000000")},
+                                    {QStringLiteral("encryption"), QStringLiteral("none")}
+                                }
+                            }}
+                        }
+                    }}
+                }},
+                {QStringLiteral("streamSettings"), QJsonObject {{QStringLiteral("network"), network}}}
+            }
+        }}
+    };
+}
+
+QJsonObject tunProbeConfig(const QString& stack)
+{
+    return QJsonObject {
+        {QStringLiteral("log"), QJsonObject {{QStringLiteral("loglevel"), QStringLiteral("none")}}},
+        {QStringLiteral("inbounds"), QJsonArray {
+            QJsonObject {
+                {QStringLiteral("tag"), QStringLiteral("tun-in")},
+                {QStringLiteral("protocol"), QStringLiteral("tun")},
+                {QStringLiteral("settings"), QJsonObject {{QStringLiteral("stack"), stack}}}
+            }
+        }},
+        {QStringLiteral("outbounds"), QJsonArray {
+            QJsonObject {{QStringLiteral("protocol"), QStringLiteral("freedom")}}
+        }}
+    };
+}
+
+QJsonArray toStringArray(const QStringList& values)
+{
+    QJsonArray arr;
+    for (const QString& value : values) {
+        arr.append(value);
+    }
+    return arr;
+}
+
+QStringList fromStringArray(const QJsonArray& values)
+{
+    QStringList out;
+    for (const QJsonValue& value : values) {
+        const QString text = value.toString().trimmed();
+        if (!text.isEmpty()) {
+            out.append(text);
+        }
+    }
+    return out;
+}
+}
+
+bool XrayCapabilities::isProbed() const
+{
+    return !fingerprint.isEmpty();
+}
+
+bool XrayCapabilities::versionAtLeast(int major, int minor, int patch) const
+{
+    if (versionMajor < 0) {
+        return false;
+    }
+    if (versionMajor != major) {
+        return versionMajor > major;
+    }
+    if (versionMinor != minor) {
+        return versionMinor > minor;
+    }
+    return versionPatch >= patch;
+}
+
+bool XrayCapabilities::supportsTransport(const QString& network) const
+{
+    return transports.contains(network, Qt::CaseInsensitive);
+}
+
+bool XrayCapabilities::supportsTunStack(const QString& stack) const
+{
+    return tunStacks.contains(stack, Qt::CaseInsensitive);
+}
+
+bool XrayCapabilities::supportsOption(const QString& option) const
+{
+    if (versionMajor < 0) {
+        return false;
+    }
+    for (const OptionRelease& release : kOptionReleases) {
+        if (option == QLatin1StringView(release.option)) {
+            return versionAtLeast(release.major, release.minor, release.patch);
+        }
+    }
+    return true;
+}
+
+QJsonObject XrayCapabilities::toJson() const
+{
+    return QJsonObject {
+        {QStringLiteral("path"), executablePath},
+        {QStringLiteral("fingerprint"), fingerprint},
+        {QStringLiteral("sha256"), QString::fromLatin1(contentHash)},
+        {QStringLiteral("version"), version},
+        {QStringLiteral("versionParts"), QJsonArray {versionMajor, versionMinor, versionPatch}},
+        {QStringLiteral("processRouting"), processRouting},
+        {QStringLiteral("transports"), toStringArray(transports)},
+        {QStringLiteral("tunStacks"), toStringArray(tunStacks)}
+    };
+}
+
+XrayCapabilities XrayCapabilities::fromJson(const QJsonObject& obj)
+{
+    XrayCapabilities caps;
+    caps.fingerprint = obj.value(QStringLiteral("fingerprint")).toString();
+    if (caps.fingerprint.isEmpty()) {
+        return XrayCapabilities {};
+    }
+    caps.executablePath = obj.value(QStringLiteral("path")).toString();
+    caps.contentHash = obj.value(QStringLiteral("sha256")).toString().toLatin1();
+    caps.version = obj.value(QStringLiteral("version")).toString(QStringLiteral("Unknown"));
+    const QJsonArray parts = obj.value(QStringLiteral("versionParts")).toArray();
+    if (parts.size() == 3) {
+        caps.versionMajor = parts.at(0).toInt(-1);
+        caps.versionMinor = parts.at(1).toInt(-1);
+        caps.versionPatch = parts.at(2).toInt(-1);
+    }
+    caps.processRouting = obj.value(QStringLiteral("processRouting")).toBool();
+    caps.transports = fromStringArray(obj.value(QStringLiteral("transports")).toArray());
+    caps.tunStacks = fromStringArray(obj.value(QStringLiteral("tunStacks")).toArray());
+    return caps;
+}
+
+QString XrayCapabilities::binaryFingerprint(const QString& executablePath)
+{
+    const QFileInfo info(executablePath);
+    if (executablePath.trimmed().isEmpty() || !info.exists() || !info.isFile()) {
+        return {};
+    }
+    return QStringLiteral("%1|%2|%3")
+        .arg(info.canonicalFilePath())
+        .arg(info.size())
+        .arg(info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch());
+}
+
+QByteArray XrayCapabilities::hashBinary(const QString& executablePath)
+{
+    QFile file(executablePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return {};
+    }
+    return hash.result().toHex();
+}
+
+XrayCapabilities XrayCapabilities::probe(const QString& executablePath, const QByteArray& contentHash)
+{
+    XrayCapabilities caps;
+    caps.executablePath = QFileInfo(executablePath).canonicalFilePath();
+    caps.fingerprint = binaryFingerprint(executablePath);
+    caps.contentHash = contentHash.isEmpty() ? hashBinary(executablePath) : contentHash;
+    caps.version = QStringLiteral("Unavailable");
+
+    QString output;
+    int exitCode = -1;
+    if (!runXray(executablePath, {QStringLiteral("version")}, &output, &exitCode)) {
+        return caps;
+    }
+
+    const QRegularExpression regex(QStringLiteral("Xray\\s+(\\d+)\\.(\\d+)\\.(\\d+)"));
+    const QRegularExpressionMatch match = regex.match(output);
+    if (match.hasMatch()) {
+        caps.version = QStringLiteral("%1.%2.%3")
+                           .arg(match.captured(1), match.captured(2), match.captured(3));
+        caps.versionMajor = match.captured(1).toInt();
+        caps.versionMinor = match.captured(2).toInt();
+        caps.versionPatch = match.captured(3).toInt();
+#if defined(Q_OS_WIN) || defined(Q_OS_LINUX)
+        caps.processRouting = caps.versionAtLeast(26, 1, 23);
+#else
+        // Xray process-name routing currently supports Windows/Linux only.
+        caps.processRouting = false;
+#endif
+    } else if (exitCode == 0) {
+        caps.version = QStringLiteral("Detected");
+    } else {
+        return caps;
+    }
+
+    for (const char *transport : kCandidateTransports) {
+        const QString network = QString::fromLatin1(transport);
+        if (configAccepted(executablePath, transportProbeConfig(network))) {
+            caps.transports.append(network);
+        }
+    }
+    // Creating the TUN handler may need privileges the probe does not have;
+    // when no stack passes the list stays empty and means "unknown".
+    for (const char *stack : kCandidateTunStacks) {
+        const QString name = QString::fromLatin1(stack);
+        if (configAccepted(executablePath, tunProbeConfig(name))) {
+            caps.tunStacks.append(name);
+        }
+    }
+    return caps;
+}
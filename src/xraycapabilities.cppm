@@ -0,0 +1,119 @@
+/*!
+ * @file        xraycapabilities.cppm
+ * @brief       Feature detection for the configured xray-core binary.
+ *
+ * @details
+ * Which transports, TUN stacks and routing features a core understands
+ * depends on its version and build. Capabilities are probed once per binary
+ * (its version plus `run -test` against minimal configs, one per feature)
+ * and cached by binary identity: canonical path, size and modification time
+ * for the cheap check, plus a SHA-256 of the contents so a reinstalled or
+ * copied but identical binary is recognised without forking it again.
+ *
+ * @author      Kambiz Asadzadeh
+ * @since       09 Feb 2026
+ * @copyright   Copyright (c) 2026 Genyleap.
+ * @license     See LICENSE in repository root.
+ */
+
+module;
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+#ifndef Q_MOC_RUN
+export module genyconnect.backend.xraycapabilities;
+#endif
+
+/**
+ * @struct XrayCapabilities
+ * @brief Probed feature set of one xray-core binary.
+ *
+ * Nothing is assumed about a core that has not been probed: empty transport
+ * or TUN stack lists and an unknown version make every support check answer
+ * false, so callers leave optional features out of the config.
+ */
+export struct XrayCapabilities {
+    QString executablePath;         //!< Canonical path of the probed binary.
+    QString fingerprint;            //!< Path, size and mtime identity (see binaryFingerprint()).
+    QByteArray contentHash;         //!< Hex SHA-256 of the binary contents.
+    QString version = QStringLiteral("Unknown"); //!< Parsed version, or Detected/Unavailable/Not detected.
+    int versionMajor = -1;          //!< Parsed major version, `-1` when unknown.
+    int versionMinor = -1;          //!< Parsed minor version.
+    int versionPatch = -1;          //!< Parsed patch version.
+    bool processRouting = false;    //!< Process-name routing rules are supported on this platform.
+    QStringList transports;         //!< Stream networks accepted by the core (tcp, ws, xhttp, ...).
+    QStringList tunStacks;          //!< TUN inbound stacks accepted by the core.
+
+    /**
+     * @brief Whether the binary has been probed (or restored from cache).
+     * @return True when fingerprint is known.
+     */
+    bool isProbed() const;
+
+    /**
+     * @brief Whether the core is at least the given version.
+     * @return False when the version is unknown.
+     */
+    bool versionAtLeast(int major, int minor, int patch) const;
+
+    /**
+     * @brief Whether a stream network is supported.
+     * @param network Transport name as used in `streamSettings.network`.
+     * @return True when the probe saw the core accept it.
+     */
+    bool supportsTransport(const QString& network) const;
+
+    /**
+     * @brief Whether a TUN stack is supported.
+     * @param stack Stack name (system, gvisor, mixed).
+     * @return True when the probe saw the core accept it.
+     */
+    bool supportsTunStack(const QString& stack) const;
+
+    /**
+     * @brief Whether an outbound/policy tuning option is understood by the core.
+     * @param option TransportTuning field name (`xudpConcurrency`, `tcpMptcp`, ...).
+     * @return True when the core version is known and not older than the option.
+     *
+     * xray silently ignores unknown JSON fields, so `run -test` cannot detect
+     * them; support is decided from the release that introduced each option.
+     */
+    bool supportsOption(const QString& option) const;
+
+    /**
+     * @brief Serialize for the persistent capability cache.
+     * @return JSON object.
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * @brief Restore from the persistent capability cache.
+     * @param obj Object produced by toJson().
+     * @return Capabilities; not probed when the object is malformed.
+     */
+    static XrayCapabilities fromJson(const QJsonObject& obj);
+
+    /**
+     * @brief Cheap identity of a binary (canonical path, size, mtime).
+     * @param executablePath Binary path.
+     * @return Fingerprint, or empty when the file does not exist.
+     */
+    static QString binaryFingerprint(const QString& executablePath);
+
+    /**
+     * @brief Hash the binary contents.
+     * @param executablePath Binary path.
+     * @return Hex SHA-256, or empty when unreadable.
+     */
+    static QByteArray hashBinary(const QString& executablePath);
+
+    /**
+     * @brief Probe a binary; forks it several times, so run off the GUI thread.
+     * @param executablePath Binary path.
+     * @param contentHash Precomputed hashBinary() result; hashed here when empty.
+     * @return Probed capabilities (version "Unavailable" when it could not be run).
+     */
+    static XrayCapabilities probe(const QString& executablePath, const QByteArray& contentHash = {});
+};
@@ -1,11 +1,16 @@
 module;
+#include <QByteArray>
 #include <QHostAddress>
 #include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocale>
 #include <QStringList>
 #include <QUrl>
+#include <QVarLengthArray>
 #include <QtGlobal>
 
 module genyconnect.backend.xrayconfigbuilder;
+import genyconnect.backend.routingrulecompiler;
 
 namespace {
 QStringList defaultDnsServers()
@@ -48,6 +53,10 @@ QStringList tunDnsServers(const QStringList& values)
     return out.isEmpty() ? defaultDnsServers() : out;
 }
 
+constexpr int kMinTunMtu = 1280;
+constexpr int kMaxTunMtu = 1500;
+constexpr int kDefaultMuxConcurrency = 8;
+
 int defaultTunMtu()
 {
 #if defined(Q_OS_WIN)
@@ -60,43 +69,44 @@ int defaultTunMtu()
 #endif
 }
 
-QJsonObject buildMixedInbound(quint16 port)
+XrayConfigBuilder::Inbound buildMixedInbound(quint16 port)
 {
-    QJsonObject sniffing {
+    XrayConfigBuilder::Inbound inbound;
+    inbound.tag = QStringLiteral("mixed-in");
+    inbound.listen = QStringLiteral("127.0.0.1");
+    inbound.port = port;
+    inbound.protocol = QStringLiteral("mixed");
+    inbound.sniffing = QJsonObject {
         {QStringLiteral("enabled"), true},
         {QStringLiteral("destOverride"), QJsonArray {QStringLiteral("http"), QStringLiteral("tls"), QStringLiteral("quic"), QStringLiteral("fakedns")}},
         {QStringLiteral("routeOnly"), false}
     };
-
-    QJsonObject inbound {
-        {QStringLiteral("tag"), QStringLiteral("mixed-in")},
-        {QStringLiteral("listen"), QStringLiteral("127.0.0.1")},
-        {QStringLiteral("port"), static_cast<int>(port)},
-        {QStringLiteral("protocol"), QStringLiteral("mixed")},
-        {QStringLiteral("sniffing"), sniffing},
-        {QStringLiteral("settings"), QJsonObject {
-            {QStringLiteral("udp"), true},
-            {QStringLiteral("auth"), QStringLiteral("noauth")},
-            {QStringLiteral("allowTransparent"), false}
-        }}
+    inbound.settings = QJsonObject {
+        {QStringLiteral("udp"), true},
+        {QStringLiteral("auth"), QStringLiteral("noauth")},
+        {QStringLiteral("allowTransparent"), false}
     };
-
     return inbound;
 }
 
-QJsonObject buildTunInbound(const XrayConfigBuilder::BuildOptions& options)
+XrayConfigBuilder::Inbound buildTunInbound(const XrayConfigBuilder::BuildOptions& options)
 {
     QString tunStack = QStringLiteral("system");
 #if defined(Q_OS_LINUX)
     tunStack = QStringLiteral("gvisor");
 #endif
+    // Fall back to a stack the core accepts; with nothing probed the
+    // platform default is all there is to go on.
+    if (!options.core.supportsTunStack(tunStack) && !options.core.tunStacks.isEmpty()) {
+        tunStack = options.core.tunStacks.constFirst();
+    }
 
     QJsonObject settings {
         {QStringLiteral("address"), QJsonArray {
             QStringLiteral("172.19.0.1/30"),
             QStringLiteral("fd00:1234:5678::1/126")
         }},
-        {QStringLiteral("mtu"), defaultTunMtu()},
+        {QStringLiteral("mtu"), options.tunMtu > 0 ? qBound(kMinTunMtu, options.tunMtu, kMaxTunMtu) : defaultTunMtu()},
         {QStringLiteral("stack"), tunStack},
         {QStringLiteral("autoRoute"), options.tunAutoRoute},
         {QStringLiteral("strictRoute"), options.tunStrictRoute},
@@ -126,88 +136,99 @@ QJsonObject buildTunInbound(const XrayConfigBuilder::BuildOptions& options)
     settings.insert(QStringLiteral("autoOutboundsInterface"), QStringLiteral("auto"));
 #endif
 
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("tun-in")},
-        {QStringLiteral("protocol"), QStringLiteral("tun")},
-        {QStringLiteral("settings"), settings}
-    };
-}
-
-QJsonObject buildApiInbound(quint16 port)
-{
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("api-in")},
-        {QStringLiteral("listen"), QStringLiteral("127.0.0.1")},
-        {QStringLiteral("port"), static_cast<int>(port)},
-        {QStringLiteral("protocol"), QStringLiteral("dokodemo-door")},
-        {QStringLiteral("settings"), QJsonObject {
-            {QStringLiteral("address"), QStringLiteral("127.0.0.1")}
-        }}
-    };
+    XrayConfigBuilder::Inbound inbound;
+    inbound.tag = QStringLiteral("tun-in");
+    inbound.protocol = QStringLiteral("tun");
+    inbound.settings = settings;
+    return inbound;
 }
 
-QJsonObject buildDnsOutbound()
+XrayConfigBuilder::Inbound buildApiInbound(quint16 port)
 {
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("dns-out")},
-        {QStringLiteral("protocol"), QStringLiteral("dns")},
-        {QStringLiteral("settings"), QJsonObject {}}
+    XrayConfigBuilder::Inbound inbound;
+    inbound.tag = QStringLiteral("api-in");
+    inbound.listen = QStringLiteral("127.0.0.1");
+    inbound.port = port;
+    inbound.protocol = QStringLiteral("dokodemo-door");
+    inbound.settings = QJsonObject {
+        {QStringLiteral("address"), QStringLiteral("127.0.0.1")}
     };
+    return inbound;
 }
 
-QJsonObject buildDnsConfig(const XrayConfigBuilder::BuildOptions& options)
+XrayConfigBuilder::Outbound makeOutbound(const QString& tag, const QString& protocol, const QJsonObject& settings = {})
 {
-    const QStringList servers = options.dnsServers.isEmpty()
-        ? defaultDnsServers()
-        : options.dnsServers;
-    return QJsonObject {
-        {QStringLiteral("servers"), toStringArray(servers)},
-        {QStringLiteral("queryStrategy"), QStringLiteral("UseIP")}
-    };
+    XrayConfigBuilder::Outbound outbound;
+    outbound.tag = tag;
+    outbound.protocol = protocol;
+    outbound.settings = settings;
+    return outbound;
 }
 
-QString normalizeDomainRuleEntry(const QString& value)
+XrayConfigBuilder::Outbound buildFragProxyOutbound()
 {
-    const QString trimmed = value.trimmed();
-    if (trimmed.isEmpty()) {
-        return {};
-    }
-
-    if (trimmed.contains(':')) {
-        return trimmed;
-    }
-
-    return QStringLiteral("domain:%1").arg(trimmed);
+    return makeOutbound(QStringLiteral("frag-proxy"), QStringLiteral("freedom"), QJsonObject {
+        {QStringLiteral("fragment"), QJsonObject {
+            {QStringLiteral("packets"), QStringLiteral("tlshello")},
+            {QStringLiteral("length"), QStringLiteral("100-200")},
+            {QStringLiteral("interval"), QStringLiteral("10-20")}
+        }}
+    });
 }
 
-QJsonArray toDomainArray(const QStringList& values)
+QStringList toTrimmedList(const QStringList& values)
 {
-    QJsonArray out;
+    QStringList out;
+    out.reserve(values.size());
     for (const QString& value : values) {
-        const QString normalized = normalizeDomainRuleEntry(value);
-        if (!normalized.isEmpty()) {
-            out.append(normalized);
+        const QString trimmed = value.trimmed();
+        if (!trimmed.isEmpty()) {
+            out.append(trimmed);
         }
     }
     return out;
 }
 
-QJsonArray toProcessArray(const QStringList& values)
+// Move asset-encodable matchers of an oversized list into `assets` and
+// reference them with a single `ext:` matcher.
+QStringList spillToAsset(
+    const QStringList& matchers,
+    const QString& code,
+    int limit,
+    bool ip,
+    QList<RuleAssets::Set> *assets)
 {
-    QJsonArray out;
-    for (const QString& value : values) {
-        const QString trimmed = value.trimmed();
-        if (!trimmed.isEmpty()) {
-            out.append(trimmed);
-        }
+    if (limit <= 0 || matchers.size() <= limit) {
+        return matchers;
     }
-    return out;
+
+    QStringList inlined;
+    RuleAssets::Set set {code, {}};
+    set.matchers.reserve(matchers.size());
+    for (const QString& matcher : matchers) {
+        const bool encodable = ip ? !matcher.startsWith(QStringLiteral("geoip:"))
+                                  : RuleAssets::isSiteMatcher(matcher);
+        (encodable ? set.matchers : inlined).append(matcher);
+    }
+    if (set.matchers.isEmpty()) {
+        return matchers;
+    }
+
+    inlined.append(QStringLiteral("ext:%1:%2")
+                       .arg(QString::fromLatin1(ip ? RuleAssets::kIpFileName : RuleAssets::kSiteFileName), code));
+    assets->append(set);
+    return inlined;
 }
 
-QJsonObject buildRouting(const XrayConfigBuilder::BuildOptions& options)
+QList<XrayConfigBuilder::RoutingRule> buildRoutingRules(
+    const XrayConfigBuilder::BuildOptions& options,
+    const RoutingRuleCompiler::Result& compiled,
+    XrayConfigBuilder::Config *config)
 {
+    using RoutingRule = XrayConfigBuilder::RoutingRule;
+
     // Avoid geoip.dat dependency by using explicit private/link-local CIDRs.
-    const QJsonArray privateCidrs {
+    const QStringList privateCidrs {
         QStringLiteral("10.0.0.0/8"),
         QStringLiteral("100.64.0.0/10"),
         QStringLiteral("127.0.0.0/8"),
@@ -219,170 +240,282 @@ QJsonObject buildRouting(const XrayConfigBuilder::BuildOptions& options)
         QStringLiteral("fe80::/10")
     };
 
-    QJsonArray rules;
+    QList<RoutingRule> rules;
     if (options.enableStatsApi) {
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("api-in")}},
-            {QStringLiteral("outboundTag"), QStringLiteral("api")}
-        });
+        RoutingRule rule;
+        rule.inboundTags = {QStringLiteral("api-in")};
+        rule.outboundTag = QStringLiteral("api");
+        rules.append(rule);
     }
 
     if (options.enableTun) {
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("tcp,udp")},
-            {QStringLiteral("port"), QStringLiteral("53")},
-            {QStringLiteral("outboundTag"), QStringLiteral("dns-out")}
-        });
+        // DNS hijack and noise blocking must precede every other rule so
+        // tun-in DNS always reaches the built-in resolver.
+        RoutingRule dnsRule;
+        dnsRule.inboundTags = {QStringLiteral("tun-in")};
+        dnsRule.network = QStringLiteral("tcp,udp");
+        dnsRule.port = QStringLiteral("53");
+        dnsRule.outboundTag = QStringLiteral("dns-out");
+        rules.append(dnsRule);
 
         // Prevent local discovery/broadcast storms from looping in TUN mode
         // (notably NetBIOS/mDNS/LLMNR/link-local chatter on Windows/macOS).
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("udp")},
-            {QStringLiteral("port"), QStringLiteral("137,138,5353,5355")},
-            {QStringLiteral("outboundTag"), QStringLiteral("block")}
-        });
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("tun-in")}},
-            {QStringLiteral("network"), QStringLiteral("udp")},
-            {QStringLiteral("ip"), QJsonArray {
-                QStringLiteral("169.254.0.0/16"),
-                QStringLiteral("255.255.255.255/32"),
-                QStringLiteral("224.0.0.0/4")
-            }},
-            {QStringLiteral("outboundTag"), QStringLiteral("block")}
-        });
-    }
-
-    QJsonObject privateDirectRule {
-        {QStringLiteral("type"), QStringLiteral("field")},
-        {QStringLiteral("outboundTag"), QStringLiteral("direct")},
-        {QStringLiteral("ip"), privateCidrs}
-    };
+        RoutingRule discoveryRule;
+        discoveryRule.inboundTags = {QStringLiteral("tun-in")};
+        discoveryRule.network = QStringLiteral("udp");
+        discoveryRule.port = QStringLiteral("137,138,5353,5355");
+        discoveryRule.outboundTag = QStringLiteral("block");
+        rules.append(discoveryRule);
+
+        RoutingRule broadcastRule;
+        broadcastRule.inboundTags = {QStringLiteral("tun-in")};
+        broadcastRule.network = QStringLiteral("udp");
+        broadcastRule.ips = {
+            QStringLiteral("169.254.0.0/16"),
+            QStringLiteral("255.255.255.255/32"),
+            QStringLiteral("224.0.0.0/4")
+        };
+        broadcastRule.outboundTag = QStringLiteral("block");
+        rules.append(broadcastRule);
+    }
+
+    RoutingRule privateDirectRule;
+    privateDirectRule.outboundTag = QStringLiteral("direct");
+    privateDirectRule.ips = privateCidrs;
     if (options.enableTun) {
         // In TUN mode, keep RFC1918/link-local direct bypass only for local mixed
         // inbound traffic. Applying this rule to tun-in can create direct loops.
-        privateDirectRule.insert(QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("mixed-in")});
+        privateDirectRule.inboundTags = {QStringLiteral("mixed-in")};
     }
     rules.append(privateDirectRule);
 
-    QJsonObject localhostDirectRule {
-        {QStringLiteral("type"), QStringLiteral("field")},
-        {QStringLiteral("outboundTag"), QStringLiteral("direct")},
-        {QStringLiteral("domain"), QJsonArray {
-            QStringLiteral("full:localhost"),
-            QStringLiteral("domain:local"),
-            QStringLiteral("regexp:.*\\.local\\.?$")
-        }}
+    RoutingRule localhostDirectRule;
+    localhostDirectRule.outboundTag = QStringLiteral("direct");
+    localhostDirectRule.domains = {
+        QStringLiteral("full:localhost"),
+        QStringLiteral("domain:local"),
+        QStringLiteral("regexp:.*\\.local\\.?$")
     };
     if (options.enableTun) {
-        localhostDirectRule.insert(QStringLiteral("inboundTag"), QJsonArray {QStringLiteral("mixed-in")});
+        localhostDirectRule.inboundTags = {QStringLiteral("mixed-in")};
     }
     rules.append(localhostDirectRule);
 
-    auto appendDomainRule = [&rules](const QStringList& entries, const QString& outboundTag) {
-        const QJsonArray domains = toDomainArray(entries);
-        if (domains.isEmpty()) {
-            return;
+    auto appendTargetRules = [&rules, &options, config](const RoutingRuleCompiler::Target& target, const QString& outboundTag) {
+        if (!target.domains.isEmpty()) {
+            RoutingRule rule;
+            rule.domains = spillToAsset(target.domains, outboundTag, options.inlineRuleLimit, false, &config->siteAssets);
+            rule.outboundTag = outboundTag;
+            rules.append(rule);
+        }
+        if (!target.ips.isEmpty()) {
+            RoutingRule rule;
+            rule.ips = spillToAsset(target.ips, outboundTag, options.inlineRuleLimit, true, &config->ipAssets);
+            rule.outboundTag = outboundTag;
+            rules.append(rule);
         }
-
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("outboundTag"), outboundTag},
-            {QStringLiteral("domain"), domains}
-        });
     };
 
-    auto appendProcessRule = [&rules,& options](const QStringList& entries, const QString& outboundTag) {
+    auto appendProcessRule = [&rules, &options](const QStringList& entries, const QString& outboundTag) {
         if (!options.enableProcessRouting) {
             return;
         }
 
-        const QJsonArray processes = toProcessArray(entries);
-        if (processes.isEmpty()) {
+        RoutingRule rule;
+        rule.processes = toTrimmedList(entries);
+        if (rule.processes.isEmpty()) {
             return;
         }
-
-        rules.append(QJsonObject {
-            {QStringLiteral("type"), QStringLiteral("field")},
-            {QStringLiteral("outboundTag"), outboundTag},
-            {QStringLiteral("process"), processes}
-        });
+        rule.outboundTag = outboundTag;
+        rules.append(rule);
     };
 
-    appendDomainRule(options.blockDomains, QStringLiteral("block"));
+    appendTargetRules(compiled.block, QStringLiteral("block"));
     appendProcessRule(options.blockProcesses, QStringLiteral("block"));
-    appendDomainRule(options.directDomains, QStringLiteral("direct"));
+    appendTargetRules(compiled.direct, QStringLiteral("direct"));
     appendProcessRule(options.directProcesses, QStringLiteral("direct"));
-    appendDomainRule(options.proxyDomains, QStringLiteral("proxy"));
+    appendTargetRules(compiled.proxy, QStringLiteral("proxy"));
     appendProcessRule(options.proxyProcesses, QStringLiteral("proxy"));
 
     // In TUN mode we expect full-tunnel behavior by default; only explicit
     // direct/block rules should bypass proxy.
-    const QString defaultOutbound = options.enableTun
+    RoutingRule defaultRule;
+    defaultRule.outboundTag = options.enableTun
         ? QStringLiteral("proxy")
         : (options.whitelistMode ? QStringLiteral("direct") : QStringLiteral("proxy"));
-    rules.append(QJsonObject {
-        {QStringLiteral("type"), QStringLiteral("field")},
-        {QStringLiteral("outboundTag"), defaultOutbound},
-        {QStringLiteral("network"), QStringLiteral("tcp,udp")}
-    });
+    defaultRule.network = QStringLiteral("tcp,udp");
+    rules.append(defaultRule);
 
-    return QJsonObject {
-        {QStringLiteral("domainStrategy"), QStringLiteral("AsIs")},
-        {QStringLiteral("rules"), rules}
-    };
+    return rules;
 }
 
-QJsonObject buildPolicy()
+/**
+ * Appends compact JSON to a byte buffer in one pass. Callers emit a
+ * well-formed sequence; the writer only places separators and escapes.
+ */
+class CompactJsonWriter
 {
-    return QJsonObject {
-        {QStringLiteral("system"), QJsonObject {
-            {QStringLiteral("statsInboundDownlink"), true},
-            {QStringLiteral("statsInboundUplink"), true},
-            {QStringLiteral("statsOutboundDownlink"), true},
-            {QStringLiteral("statsOutboundUplink"), true}
-        }}
-    };
-}
+public:
+    explicit CompactJsonWriter(QByteArray *out)
+        : m_out(out)
+    {
+    }
 
-QJsonObject buildDirectOutbound()
-{
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("direct")},
-        {QStringLiteral("protocol"), QStringLiteral("freedom")},
-        {QStringLiteral("settings"), QJsonObject {}}
-    };
-}
+    void beginObject()
+    {
+        separate();
+        m_out->append('{');
+        m_firstInScope.append(true);
+    }
 
-QJsonObject buildBlockOutbound()
-{
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("block")},
-        {QStringLiteral("protocol"), QStringLiteral("blackhole")},
-        {QStringLiteral("settings"), QJsonObject {}}
-    };
-}
+    void endObject()
+    {
+        m_firstInScope.removeLast();
+        m_out->append('}');
+    }
 
-QJsonObject buildFragProxyOutbound()
-{
-    return QJsonObject {
-        {QStringLiteral("tag"), QStringLiteral("frag-proxy")},
-        {QStringLiteral("protocol"), QStringLiteral("freedom")},
-        {QStringLiteral("settings"), QJsonObject {
-            {QStringLiteral("fragment"), QJsonObject {
-                {QStringLiteral("packets"), QStringLiteral("tlshello")},
-                {QStringLiteral("length"), QStringLiteral("100-200")},
-                {QStringLiteral("interval"), QStringLiteral("10-20")}
-            }}
-        }}
-    };
-}
+    void beginArray()
+    {
+        separate();
+        m_out->append('[');
+        m_firstInScope.append(true);
+    }
+
+    void endArray()
+    {
+        m_firstInScope.removeLast();
+        m_out->append(']');
+    }
+
+    void key(const QString& name)
+    {
+        separate();
+        writeString(name);
+        m_out->append(':');
+        m_afterKey = true;
+    }
+
+    void value(const QString& text)
+    {
+        separate();
+        writeString(text);
+    }
+
+    void value(qint64 number)
+    {
+        separate();
+        m_out->append(QByteArray::number(number));
+    }
+
+    void value(bool flag)
+    {
+        separate();
+        m_out->append(flag ? "true" : "false");
+    }
+
+    void value(const QStringList& values)
+    {
+        beginArray();
+        for (const QString& entry : values) {
+            value(entry);
+        }
+        endArray();
+    }
+
+    void value(const QJsonValue& json)
+    {
+        switch (json.type()) {
+        case QJsonValue::Bool:
+            value(json.toBool());
+            break;
+        case QJsonValue::Double: {
+            const double number = json.toDouble();
+            separate();
+            // Integral values are written without exponent or fraction, as QJsonDocument does.
+            if (qAbs(number) < 9007199254740992.0 && static_cast<double>(static_cast<qint64>(number)) == number) {
+                m_out->append(QByteArray::number(static_cast<qint64>(number)));
+            } else {
+                m_out->append(QByteArray::number(number, 'g', QLocale::FloatingPointShortest));
+            }
+            break;
+        }
+        case QJsonValue::String:
+            value(json.toString());
+            break;
+        case QJsonValue::Array:
+            beginArray();
+            for (const QJsonValue& entry : json.toArray()) {
+                value(entry);
+            }
+            endArray();
+            break;
+        case QJsonValue::Object: {
+            const QJsonObject obj = json.toObject();
+            beginObject();
+            for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+                key(it.key());
+                value(it.value());
+            }
+            endObject();
+            break;
+        }
+        case QJsonValue::Null:
+        case QJsonValue::Undefined:
+            separate();
+            m_out->append("null");
+            break;
+        }
+    }
+
+private:
+    void separate()
+    {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (m_firstInScope.isEmpty()) {
+            return;
+        }
+        if (!m_firstInScope.last()) {
+            m_out->append(',');
+        }
+        m_firstInScope.last() = false;
+    }
+
+    void writeString(const QString& text)
+    {
+        static constexpr char kHex[] = "0123456789abcdef";
+        const QByteArray utf8 = text.toUtf8();
+        m_out->append('"');
+        for (const char ch : utf8) {
+            const auto byte = static_cast<uchar>(ch);
+            switch (ch) {
+            case '"': m_out->append("\\\""); break;
+            case '\\': m_out->append("\\\\"); break;
+            case '\b': m_out->append("\\b"); break;
+            case '\f': m_out->append("\\f"); break;
+            case '\n': m_out->append("\\n"); break;
+            case '\r': m_out->append("\\r"); break;
+            case '\t': m_out->append("\\t"); break;
+            default:
+                if (byte < 0x20) {
+                    m_out->append("\\u00");
+                    m_out->append(kHex[byte >> 4]);
+                    m_out->append(kHex[byte & 0xF]);
+                } else {
+                    m_out->append(ch);
+                }
+                break;
+            }
+        }
+        m_out->append('"');
+    }
+
+    QByteArray *m_out = nullptr;
+    QVarLengthArray<bool, 8> m_firstInScope;
+    bool m_afterKey = false;
+};
 
 QString normalizeTransportPath(const QString& path)
 {
@@ -414,7 +547,7 @@ QJsonObject buildTlsPeerSettings(const ServerProfile& profile)
         tlsSettings[QStringLiteral("serverName")] = profile.sni;
     }
     if (!profile.alpn.isEmpty()) {
-        const QStringList alpnParts = profile.alpn.split(',', Qt::SkipEmptyParts);
+        const QStringList alpnParts = profile.alpn.split(QLatin1Char(','), Qt::SkipEmptyParts);
         QJsonArray alpnValues;
         for (const QString& part : alpnParts) {
             alpnValues.append(part.trimmed());
@@ -424,67 +557,315 @@ QJsonObject buildTlsPeerSettings(const ServerProfile& profile)
         }
     }
     if (!profile.fingerprint.isEmpty()) {
-        tlsSettings[QStringLiteral("fingerprint")] = profile.fingerprint;
+        tlsSettings[QStringLiteral("fingerprint")] = profile.fingerprint.toString();
     }
     tlsSettings[QStringLiteral("allowInsecure")] = profile.allowInsecure;
     return tlsSettings;
 }
+
+QJsonObject buildSockopt(const TransportTuning& tuning, const XrayCapabilities& core)
+{
+    QJsonObject sockopt;
+    if (tuning.tcpFastOpen) {
+        sockopt.insert(QStringLiteral("tcpFastOpen"), *tuning.tcpFastOpen);
+    }
+    if (tuning.tcpKeepAliveIdle && core.supportsOption(QStringLiteral("tcpKeepAliveIdle"))) {
+        sockopt.insert(QStringLiteral("tcpKeepAliveIdle"), *tuning.tcpKeepAliveIdle);
+    }
+    if (tuning.tcpNoDelay && core.supportsOption(QStringLiteral("tcpNoDelay"))) {
+        sockopt.insert(QStringLiteral("tcpNoDelay"), *tuning.tcpNoDelay);
+    }
+#if defined(Q_OS_LINUX)
+    // Congestion control and MPTCP are applied through Linux-only socket options.
+    if (!tuning.tcpCongestion.isEmpty() && core.supportsOption(QStringLiteral("tcpCongestion"))) {
+        sockopt.insert(QStringLiteral("tcpCongestion"), tuning.tcpCongestion);
+    }
+    if (tuning.tcpMptcp && core.supportsOption(QStringLiteral("tcpMptcp"))) {
+        sockopt.insert(QStringLiteral("tcpMptcp"), *tuning.tcpMptcp);
+    }
+#endif
+    return sockopt;
 }
 
-QJsonObject XrayConfigBuilder::build(const ServerProfile& profile, const BuildOptions& options)
+QJsonObject buildPolicyLevel(const TransportTuning& tuning)
 {
-    QJsonArray inbounds;
-    inbounds.append(buildMixedInbound(options.socksPort));
+    QJsonObject level;
+    if (tuning.handshake) {
+        level.insert(QStringLiteral("handshake"), *tuning.handshake);
+    }
+    if (tuning.connIdle) {
+        level.insert(QStringLiteral("connIdle"), *tuning.connIdle);
+    }
+    if (tuning.bufferSizeKb) {
+        level.insert(QStringLiteral("bufferSize"), *tuning.bufferSizeKb);
+    }
+    return level;
+}
+
+}
+
+XrayConfigBuilder::Config XrayConfigBuilder::buildConfig(const ServerProfile& profile, const BuildOptions& options)
+{
+    Config config;
+    config.logLevel = options.logLevel;
+
+    config.inbounds.append(buildMixedInbound(options.socksPort));
     if (options.enableTun) {
-        inbounds.append(buildTunInbound(options));
+        config.inbounds.append(buildTunInbound(options));
     }
     if (options.enableStatsApi) {
-        inbounds.append(buildApiInbound(options.apiPort));
+        config.inbounds.append(buildApiInbound(options.apiPort));
     }
 
-    QJsonArray outbounds;
+    TransportTuning tuning = profile.transportTuning().overriding(options.transport);
+    if (!tuning.mux.has_value()) {
+        tuning.mux = options.enableMux;
+    }
     // Keep Reality fragmentation path enabled in both proxy and TUN modes.
     // Some censored networks require this for stable outbound reachability.
     const bool enableRealityFragDialer =
-        (profile.security == QStringLiteral("reality"));
-    outbounds.append(buildMainOutbound(profile, options.enableMux, enableRealityFragDialer));
+        (profile.security == QStringLiteral("reality")) && tuning.fragment.value_or(true);
+    config.outbounds.append(buildMainOutbound(profile, tuning, enableRealityFragDialer, options.core));
     if (options.enableTun) {
-        outbounds.append(buildDnsOutbound());
+        config.outbounds.append(makeOutbound(QStringLiteral("dns-out"), QStringLiteral("dns")));
     }
-    outbounds.append(buildDirectOutbound());
-    outbounds.append(buildBlockOutbound());
+    config.outbounds.append(makeOutbound(QStringLiteral("direct"), QStringLiteral("freedom")));
+    config.outbounds.append(makeOutbound(QStringLiteral("block"), QStringLiteral("blackhole")));
     if (enableRealityFragDialer) {
-        outbounds.append(buildFragProxyOutbound());
+        config.outbounds.append(buildFragProxyOutbound());
     }
 
-    QJsonObject config {
-        {QStringLiteral("log"), QJsonObject {
-            {QStringLiteral("loglevel"), options.logLevel}
-        }},
-        {QStringLiteral("inbounds"), inbounds},
-        {QStringLiteral("outbounds"), outbounds},
-        {QStringLiteral("routing"), buildRouting(options)},
-        {QStringLiteral("policy"), buildPolicy()},
-        {QStringLiteral("stats"), QJsonObject {}}
-    };
+    const RoutingRuleCompiler::Result compiled = options.compiledRules.has_value()
+        ? *options.compiledRules
+        : RoutingRuleCompiler::compile(options.blockDomains, options.directDomains, options.proxyDomains);
+    config.rules = buildRoutingRules(options, compiled, &config);
+    config.ruleConflicts = compiled.conflicts;
+    config.ruleEntriesIn = compiled.inputEntries;
+    config.ruleEntriesOut = compiled.outputEntries;
+    config.statsApi = options.enableStatsApi;
+    config.policyLevel = buildPolicyLevel(tuning);
 
-    if (options.enableStatsApi) {
-        config[QStringLiteral("api")] = QJsonObject {
-            {QStringLiteral("tag"), QStringLiteral("api")},
-            {QStringLiteral("services"), QJsonArray {QStringLiteral("StatsService")}}
-        };
-    }
     if (options.enableTun) {
-        config[QStringLiteral("dns")] = buildDnsConfig(options);
+        config.dnsServers = toTrimmedList(options.dnsServers);
+        if (config.dnsServers.isEmpty()) {
+            config.dnsServers = defaultDnsServers();
+        }
+        config.dnsQueryStrategy = QStringLiteral("UseIP");
     }
 
     return config;
 }
 
-QJsonObject XrayConfigBuilder::buildMainOutbound(
+QByteArray XrayConfigBuilder::serialize(const Config& config)
+{
+    qsizetype ruleEntries = 0;
+    for (const RoutingRule& rule : config.rules) {
+        ruleEntries += rule.domains.size() + rule.ips.size() + rule.processes.size();
+    }
+    QByteArray out;
+    out.reserve(4096 + ruleEntries * 32);
+    CompactJsonWriter writer(&out);
+
+    writer.beginObject();
+    writer.key(QStringLiteral("log"));
+    writer.beginObject();
+    writer.key(QStringLiteral("loglevel"));
+    writer.value(config.logLevel);
+    writer.endObject();
+
+    writer.key(QStringLiteral("inbounds"));
+    writer.beginArray();
+    for (const Inbound& inbound : config.inbounds) {
+        writer.beginObject();
+        writer.key(QStringLiteral("tag"));
+        writer.value(inbound.tag);
+        if (!inbound.listen.isEmpty()) {
+            writer.key(QStringLiteral("listen"));
+            writer.value(inbound.listen);
+        }
+        if (inbound.port > 0) {
+            writer.key(QStringLiteral("port"));
+            writer.value(static_cast<qint64>(inbound.port));
+        }
+        writer.key(QStringLiteral("protocol"));
+        writer.value(inbound.protocol);
+        if (!inbound.sniffing.isEmpty()) {
+            writer.key(QStringLiteral("sniffing"));
+            writer.value(QJsonValue(inbound.sniffing));
+        }
+        writer.key(QStringLiteral("settings"));
+        writer.value(QJsonValue(inbound.settings));
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.key(QStringLiteral("outbounds"));
+    writer.beginArray();
+    for (const Outbound& outbound : config.outbounds) {
+        writer.beginObject();
+        writer.key(QStringLiteral("tag"));
+        writer.value(outbound.tag);
+        writer.key(QStringLiteral("protocol"));
+        writer.value(outbound.protocol);
+        writer.key(QStringLiteral("settings"));
+        writer.value(QJsonValue(outbound.settings));
+        if (!outbound.streamSettings.isEmpty()) {
+            writer.key(QStringLiteral("streamSettings"));
+            writer.value(QJsonValue(outbound.streamSettings));
+        }
+        if (!outbound.mux.isEmpty()) {
+            writer.key(QStringLiteral("mux"));
+            writer.value(QJsonValue(outbound.mux));
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.key(QStringLiteral("routing"));
+    writer.beginObject();
+    writer.key(QStringLiteral("domainStrategy"));
+    writer.value(config.domainStrategy);
+    writer.key(QStringLiteral("rules"));
+    writer.beginArray();
+    for (const RoutingRule& rule : config.rules) {
+        writer.beginObject();
+        writer.key(QStringLiteral("type"));
+        writer.value(QStringLiteral("field"));
+        if (!rule.inboundTags.isEmpty()) {
+            writer.key(QStringLiteral("inboundTag"));
+            writer.value(rule.inboundTags);
+        }
+        if (!rule.network.isEmpty()) {
+            writer.key(QStringLiteral("network"));
+            writer.value(rule.network);
+        }
+        if (!rule.port.isEmpty()) {
+            writer.key(QStringLiteral("port"));
+            writer.value(rule.port);
+        }
+        if (!rule.ips.isEmpty()) {
+            writer.key(QStringLiteral("ip"));
+            writer.value(rule.ips);
+        }
+        if (!rule.domains.isEmpty()) {
+            writer.key(QStringLiteral("domain"));
+            writer.value(rule.domains);
+        }
+        if (!rule.processes.isEmpty()) {
+            writer.key(QStringLiteral("process"));
+            writer.value(rule.processes);
+        }
+        writer.key(QStringLiteral("outboundTag"));
+        writer.value(rule.outboundTag);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+
+    writer.key(QStringLiteral("policy"));
+    writer.beginObject();
+    if (!config.policyLevel.isEmpty()) {
+        writer.key(QStringLiteral("levels"));
+        writer.beginObject();
+        writer.key(QStringLiteral("0"));
+        writer.value(QJsonValue(config.policyLevel));
+        writer.endObject();
+    }
+    writer.key(QStringLiteral("system"));
+    writer.beginObject();
+    for (const QString& counter : {
+             QStringLiteral("statsInboundDownlink"),
+             QStringLiteral("statsInboundUplink"),
+             QStringLiteral("statsOutboundDownlink"),
+             QStringLiteral("statsOutboundUplink")}) {
+        writer.key(counter);
+        writer.value(true);
+    }
+    writer.endObject();
+    writer.endObject();
+
+    writer.key(QStringLiteral("stats"));
+    writer.beginObject();
+    writer.endObject();
+
+    if (config.statsApi) {
+        writer.key(QStringLiteral("api"));
+        writer.beginObject();
+        writer.key(QStringLiteral("tag"));
+        writer.value(QStringLiteral("api"));
+        writer.key(QStringLiteral("services"));
+        writer.value(QStringList {QStringLiteral("StatsService")});
+        writer.endObject();
+    }
+
+    if (!config.dnsServers.isEmpty()) {
+        writer.key(QStringLiteral("dns"));
+        writer.beginObject();
+        writer.key(QStringLiteral("servers"));
+        writer.value(config.dnsServers);
+        writer.key(QStringLiteral("queryStrategy"));
+        writer.value(config.dnsQueryStrategy);
+        writer.endObject();
+    }
+
+    writer.endObject();
+    return out;
+}
+
+QJsonObject XrayConfigBuilder::build(const ServerProfile& profile, const BuildOptions& options)
+{
+    return QJsonDocument::fromJson(serialize(buildConfig(profile, options))).object();
+}
+
+bool XrayConfigBuilder::usesDatagramTransport(const ServerProfile& profile)
+{
+    const QString network = profile.network.trimmed().toLower();
+    return network == QStringLiteral("kcp")
+           || network == QStringLiteral("mkcp")
+           || network == QStringLiteral("quic");
+}
+
+int XrayConfigBuilder::recommendedTunMtu(const ServerProfile& profile, int pathMtu)
+{
+    // Stream transports hand tunnelled packets to a TCP connection that the
+    // kernel segments to the path MTU on its own, so a smaller TUN MTU only
+    // costs throughput. Datagram transports put each packet into one outer
+    // UDP datagram, which has to fit the path.
+    if (pathMtu <= 0 || !usesDatagramTransport(profile)) {
+        return defaultTunMtu();
+    }
+
+    const QString network = profile.network.trimmed().toLower();
+    const QString protocol = profile.protocol.trimmed().toLower();
+
+    // Outer IPv4 and UDP headers, then the transport's own framing; QUIC
+    // encryption is part of its header and tag.
+    int overhead = 20 + 8;
+    if (network == QStringLiteral("quic")) {
+        overhead += 30;
+    } else {
+        overhead += 24;
+    }
+
+    // Per-packet framing of the proxy protocol's UDP payloads.
+    if (protocol == QStringLiteral("vmess")) {
+        overhead += 2 + 16;
+    } else if (protocol == QStringLiteral("shadowsocks") || protocol == QStringLiteral("ss")) {
+        overhead += 2 + 16 + 16;
+    } else if (protocol == QStringLiteral("trojan")) {
+        overhead += 10;
+    } else if (protocol == QStringLiteral("vless")) {
+        overhead += 2;
+    }
+
+    return qBound(kMinTunMtu, pathMtu - overhead, kMaxTunMtu);
+}
+
+XrayConfigBuilder::Outbound XrayConfigBuilder::buildMainOutbound(
     const ServerProfile& profile,
-    bool enableMux,
-    bool enableRealityFragDialer)
+    const TransportTuning& tuning,
+    bool enableRealityFragDialer,
+    const XrayCapabilities& core)
 {
     QJsonObject user {
         {QStringLiteral("id"), profile.userId},
@@ -493,56 +874,58 @@ QJsonObject XrayConfigBuilder::buildMainOutbound(
     if (profile.protocol == QStringLiteral("vless")) {
         user[QStringLiteral("encryption")] = profile.encryption.isEmpty()
             ? QStringLiteral("none")
-            : profile.encryption;
+            : profile.encryption.toString();
         if (!profile.flow.isEmpty()) {
-            user[QStringLiteral("flow")] = profile.flow;
+            user[QStringLiteral("flow")] = profile.flow.toString();
         }
     }
 
     if (profile.protocol == QStringLiteral("vmess")) {
         user[QStringLiteral("security")] = profile.encryption.isEmpty()
             ? QStringLiteral("auto")
-            : profile.encryption;
+            : profile.encryption.toString();
         user[QStringLiteral("alterId")] = 0;
     }
 
-    QJsonObject outbound {
-        {QStringLiteral("tag"), QStringLiteral("proxy")},
-        {QStringLiteral("protocol"), profile.protocol},
-        {QStringLiteral("settings"), QJsonObject {
-            {QStringLiteral("vnext"), QJsonArray {
-                QJsonObject {
-                    {QStringLiteral("address"), profile.address},
-                    {QStringLiteral("port"), static_cast<int>(profile.port)},
-                    {QStringLiteral("users"), QJsonArray {user}}
-                }
-            }}
-        }},
-        {QStringLiteral("streamSettings"), buildStreamSettings(profile)}
+    Outbound outbound;
+    outbound.tag = QStringLiteral("proxy");
+    outbound.protocol = profile.protocol.toString();
+    outbound.settings = QJsonObject {
+        {QStringLiteral("vnext"), QJsonArray {
+            QJsonObject {
+                {QStringLiteral("address"), profile.address},
+                {QStringLiteral("port"), static_cast<int>(profile.port)},
+                {QStringLiteral("users"), QJsonArray {user}}
+            }
+        }}
     };
+    outbound.streamSettings = buildStreamSettings(profile, core);
 
+    QJsonObject sockopt = buildSockopt(tuning, core);
     if (enableRealityFragDialer) {
-        QJsonObject streamSettings = outbound.value(QStringLiteral("streamSettings")).toObject();
-        streamSettings[QStringLiteral("sockopt")] = QJsonObject {
-            {QStringLiteral("dialerProxy"), QStringLiteral("frag-proxy")}
-        };
-        outbound[QStringLiteral("streamSettings")] = streamSettings;
+        sockopt.insert(QStringLiteral("dialerProxy"), QStringLiteral("frag-proxy"));
+    }
+    if (!sockopt.isEmpty()) {
+        outbound.streamSettings.insert(QStringLiteral("sockopt"), sockopt);
     }
 
-    if (enableMux) {
-        outbound[QStringLiteral("mux")] = QJsonObject {
+    if (tuning.mux.value_or(false)) {
+        outbound.mux = QJsonObject {
             {QStringLiteral("enabled"), true},
-            {QStringLiteral("concurrency"), 8}
+            {QStringLiteral("concurrency"), tuning.muxConcurrency.value_or(kDefaultMuxConcurrency)}
         };
+        if (tuning.xudpConcurrency && core.supportsOption(QStringLiteral("xudpConcurrency"))) {
+            outbound.mux.insert(QStringLiteral("xudpConcurrency"), *tuning.xudpConcurrency);
+        }
     }
 
     return outbound;
 }
 
-QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
+QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile, const XrayCapabilities& core)
 {
     QJsonObject stream {
-        {QStringLiteral("network"), profile.network.isEmpty() ? QStringLiteral("tcp") : profile.network}
+        {QStringLiteral("network"), profile.network.isEmpty() ? QStringLiteral("tcp") : profile.network.toString()}
     };
 
     if (profile.network == QStringLiteral("ws")) {
@@ -560,11 +943,22 @@ QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
 
     if (profile.network == QStringLiteral("grpc")) {
         stream[QStringLiteral("grpcSettings")] = QJsonObject {
-            {QStringLiteral("serviceName"), profile.serviceName}
+            {QStringLiteral("serviceName"), profile.serviceName()}
         };
     }
 
-    if (profile.network == QStringLiteral("xhttp")) {
+    // Cores older than the XHTTP rename only know the transport as SplitHTTP.
+    if (profile.network == QStringLiteral("xhttp")
+        && !core.supportsTransport(QStringLiteral("xhttp"))
+        && core.supportsTransport(QStringLiteral("splithttp"))) {
+        QJsonObject splitHttpSettings;
+        splitHttpSettings[QStringLiteral("path")] = normalizeTransportPath(profile.path);
+        if (!profile.hostHeader.isEmpty()) {
+            splitHttpSettings[QStringLiteral("host")] = profile.hostHeader;
+        }
+        stream[QStringLiteral("network")] = QStringLiteral("splithttp");
+        stream[QStringLiteral("splithttpSettings")] = splitHttpSettings;
+    } else if (profile.network == QStringLiteral("xhttp")) {
         QJsonObject xhttpSettings;
         xhttpSettings[QStringLiteral("path")] = normalizeTransportPath(profile.path);
 
@@ -574,8 +968,8 @@ QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
         xhttpSettings[QStringLiteral("mode")] = profile.xhttpMode.isEmpty()
             ? QStringLiteral("auto")
             : profile.xhttpMode;
-        if (!profile.xhttpExtra.isEmpty()) {
-            xhttpSettings[QStringLiteral("extra")] = profile.xhttpExtra;
+        if (!profile.xhttpExtra().isEmpty()) {
+            xhttpSettings[QStringLiteral("extra")] = profile.xhttpExtra();
         }
 
         stream[QStringLiteral("xhttpSettings")] = xhttpSettings;
@@ -584,7 +978,7 @@ QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
     if (profile.network == QStringLiteral("tcp")) {
         const QString headerType = profile.headerType.isEmpty()
             ? QStringLiteral("none")
-            : profile.headerType;
+            : profile.headerType.toString();
         stream[QStringLiteral("tcpSettings")] = QJsonObject {
             {QStringLiteral("header"), QJsonObject {
                 {QStringLiteral("type"), headerType}
@@ -594,7 +988,7 @@ QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
 
     const QString security = profile.security.isEmpty()
         ? QStringLiteral("none")
-        : profile.security;
+        : profile.security.toString();
     stream[QStringLiteral("security")] = security;
 
     if (security == QStringLiteral("tls")) {
@@ -608,17 +1002,17 @@ QJsonObject XrayConfigBuilder::buildStreamSettings(const ServerProfile& profile)
             realitySettings[QStringLiteral("serverName")] = profile.sni;
         }
         if (!profile.fingerprint.isEmpty()) {
-            realitySettings[QStringLiteral("fingerprint")] = profile.fingerprint;
+            realitySettings[QStringLiteral("fingerprint")] = profile.fingerprint.toString();
         }
-        if (!profile.publicKey.isEmpty()) {
-            realitySettings[QStringLiteral("publicKey")] = profile.publicKey;
+        if (!profile.publicKey().isEmpty()) {
+            realitySettings[QStringLiteral("publicKey")] = profile.publicKey();
         }
-        if (!profile.shortId.isEmpty()) {
-            realitySettings[QStringLiteral("shortId")] = profile.shortId;
+        if (!profile.shortId().isEmpty()) {
+            realitySettings[QStringLiteral("shortId")] = profile.shortId();
         }
-        realitySettings[QStringLiteral("spiderX")] = profile.spiderX.isEmpty()
+        realitySettings[QStringLiteral("spiderX")] = profile.spiderX().isEmpty()
             ? QStringLiteral("/")
-            : profile.spiderX;
+            : profile.spiderX();
 
         stream[QStringLiteral("realitySettings")] = realitySettings;
     }
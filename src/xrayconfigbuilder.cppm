@@ -7,6 +7,13 @@
  * `ServerProfile` into a complete Xray JSON runtime configuration,
  * including inbounds, outbounds, routing, and optional stats/process rules.
  *
+ * Configs are first composed as a typed `Config` (every mode-specific fixup
+ * is applied there) and then written in a single pass as compact JSON, so
+ * large routing lists are never copied through nested JSON temporaries.
+ * User domain/IP lists pass through `RoutingRuleCompiler` first, so only the
+ * minimal equivalent matcher set reaches xray; lists above
+ * `inlineRuleLimit` are referenced from generated rule assets instead.
+ *
  * @author      Kambiz Asadzadeh
  * @since       09 Feb 2026
  * @copyright   Copyright (c) 2026 Genyleap.
@@ -14,13 +21,20 @@
  */
 
 module;
+#include <QByteArray>
 #include <QJsonObject>
+#include <QList>
 #include <QStringList>
 #include <QtTypes>
 
+#include <optional>
+
 #ifndef Q_MOC_RUN
 export module genyconnect.backend.xrayconfigbuilder;
+import genyconnect.backend.routingrulecompiler;
+import genyconnect.backend.ruleassets;
 import genyconnect.backend.serverprofile;
+import genyconnect.backend.xraycapabilities;
 #endif
 
 /**
@@ -39,47 +53,148 @@ public:
         quint16 httpPort = 10809;               //!< Local http inbound port.
         quint16 apiPort = 10085;                //!< Xray API inbound port.
         QString logLevel = QStringLiteral("warning"); //!< Runtime log level.
-        bool enableMux = false;                 //!< Enable outbound mux.
+        bool enableMux = false;                 //!< Enable outbound mux unless the tuning decides.
+        TransportTuning transport;              //!< Global tuning defaults; the profile's own tuning wins.
         bool enableStatsApi = true;             //!< Enable stats API and policy.
         bool enableTun = false;                 //!< Enable system-level TUN inbound.
         bool tunAutoRoute = true;               //!< Auto-manage host routes for TUN.
         bool tunStrictRoute = true;             //!< Prevent route bypass leaks when possible.
         QString tunInterfaceName;               //!< Optional explicit interface name (macOS: utunN).
+        int tunMtu = 0;                         //!< TUN MTU; 0 keeps the platform default.
         QStringList dnsServers;                 //!< DNS servers used for built-in DNS / TUN DNS.
         bool whitelistMode = false;             //!< Enable whitelist-first routing mode.
         bool enableProcessRouting = false;      //!< Enable process-based rules.
-        QStringList proxyDomains;               //!< Domain rules to tunnel.
-        QStringList directDomains;              //!< Domain rules to bypass.
-        QStringList blockDomains;               //!< Domain rules to block.
+        QStringList proxyDomains;               //!< Domain/IP rules to tunnel.
+        QStringList directDomains;              //!< Domain/IP rules to bypass.
+        QStringList blockDomains;               //!< Domain/IP rules to block.
         QStringList proxyProcesses;             //!< Process names to tunnel.
         QStringList directProcesses;            //!< Process names to bypass.
         QStringList blockProcesses;             //!< Process names to block.
+        XrayCapabilities core;                  //!< Probed core features; unprobed leaves optional features out.
+        int inlineRuleLimit = 0;                //!< Matchers per list kept inline; larger lists move to rule assets (0 = never).
+        std::optional<RoutingRuleCompiler::Result> compiledRules; //!< Already compiled lists; replaces proxyDomains/directDomains/blockDomains.
     };
 
     /**
-     * @brief Build full Xray runtime JSON.
+     * @struct RoutingRule
+     * @brief One `field` routing rule; empty matchers are omitted.
+     */
+    struct RoutingRule {
+        QString outboundTag;                    //!< Target outbound.
+        QStringList inboundTags;                //!< Restrict to these inbounds.
+        QString network;                        //!< `tcp`, `udp` or `tcp,udp`.
+        QString port;                           //!< Port list/range expression.
+        QStringList ips;                        //!< CIDR/IP matchers.
+        QStringList domains;                    //!< Domain matchers (already prefixed).
+        QStringList processes;                  //!< Process-name matchers.
+    };
+
+    /**
+     * @struct Inbound
+     * @brief Inbound handler; protocol-specific parts stay as JSON leaves.
+     */
+    struct Inbound {
+        QString tag;                            //!< Inbound tag.
+        QString protocol;                       //!< Inbound protocol.
+        QString listen;                         //!< Listen address; empty omits it.
+        int port = 0;                           //!< Listen port; 0 omits it.
+        QJsonObject sniffing;                   //!< Sniffing settings; empty omits it.
+        QJsonObject settings;                   //!< Protocol settings.
+    };
+
+    /**
+     * @struct Outbound
+     * @brief Outbound handler; protocol-specific parts stay as JSON leaves.
+     */
+    struct Outbound {
+        QString tag;                            //!< Outbound tag.
+        QString protocol;                       //!< Outbound protocol.
+        QJsonObject settings;                   //!< Protocol settings.
+        QJsonObject streamSettings;             //!< Transport/security; empty omits it.
+        QJsonObject mux;                        //!< Mux settings; empty omits it.
+    };
+
+    /**
+     * @struct Config
+     * @brief Typed runtime configuration, serialized by serialize().
+     */
+    struct Config {
+        QString logLevel;                       //!< Runtime log level.
+        QList<Inbound> inbounds;                //!< Inbounds in declaration order.
+        QList<Outbound> outbounds;              //!< Outbounds; the first one is the default.
+        QString domainStrategy = QStringLiteral("AsIs"); //!< Routing domain strategy.
+        QList<RoutingRule> rules;               //!< Routing rules in match order.
+        QStringList dnsServers;                 //!< Built-in DNS servers; empty omits the section.
+        QString dnsQueryStrategy;               //!< Built-in DNS query strategy.
+        bool statsApi = false;                  //!< Emit the stats API service.
+        QJsonObject policyLevel;                //!< Policy level 0 (bufferSize, connIdle, ...); empty omits it.
+        QStringList ruleConflicts;              //!< Shadowed user rules dropped by the compiler (not serialized).
+        int ruleEntriesIn = 0;                  //!< User domain/IP entries before compilation.
+        int ruleEntriesOut = 0;                 //!< Matchers emitted after compilation.
+        QList<RuleAssets::Set> siteAssets;      //!< Domain lists referenced as `ext:` (store with RuleAssets).
+        QList<RuleAssets::Set> ipAssets;        //!< CIDR lists referenced as `ext:` (store with RuleAssets).
+    };
+
+    /**
+     * @brief Compose the typed runtime configuration.
+     * @param profile Selected server profile.
+     * @param options Build options.
+     * @return Complete configuration, including TUN DNS and noise-block rules.
+     */
+    static Config buildConfig(const ServerProfile& profile, const BuildOptions& options);
+
+    /**
+     * @brief Write a configuration as compact JSON in one pass.
+     * @param config Typed configuration.
+     * @return UTF-8 JSON document.
+     */
+    static QByteArray serialize(const Config& config);
+
+    /**
+     * @brief Build full Xray runtime JSON as a tree (for inspection; prefer serialize()).
      * @param profile Selected server profile.
      * @param options Build options.
      * @return Complete configuration object.
      */
     static QJsonObject build(const ServerProfile& profile, const BuildOptions& options);
 
+    /**
+     * @brief Whether the profile's transport carries packets in UDP datagrams (mKCP, QUIC).
+     * @param profile Server profile.
+     * @return True for datagram transports; false for TCP-based ones.
+     */
+    static bool usesDatagramTransport(const ServerProfile& profile);
+
+    /**
+     * @brief Derive a TUN MTU from the path MTU and the profile's outer transport overhead.
+     * @param profile Server profile whose protocol and transport add framing.
+     * @param pathMtu Measured path MTU towards the server, or 0 when unknown.
+     * @return The platform default (1500, 1400 on Windows) for stream transports
+     *         or without a measurement; otherwise the path MTU minus the datagram
+     *         overhead, clamped to 1280..1500.
+     */
+    static int recommendedTunMtu(const ServerProfile& profile, int pathMtu = 0);
+
 private:
     /**
-     * @brief Build primary proxy outbound object.
+     * @brief Build primary proxy outbound.
      * @param profile Server profile.
-     * @param enableMux Enable mux section.
-     * @return Outbound JSON object.
+     * @param tuning Effective transport tuning (profile over global defaults).
+     * @param enableRealityFragDialer Dial through the fragmenting `frag-proxy` outbound.
+     * @param core Probed core features.
+     * @return Outbound.
      */
-    static QJsonObject buildMainOutbound(
+    static Outbound buildMainOutbound(
         const ServerProfile& profile,
-        bool enableMux,
-        bool enableRealityFragDialer);
+        const TransportTuning& tuning,
+        bool enableRealityFragDialer,
+        const XrayCapabilities& core);
 
     /**
      * @brief Build stream settings based on profile transport/security.
      * @param profile Server profile.
+     * @param core Probed core features (selects legacy transport names on older cores).
      * @return Stream settings object.
      */
-    static QJsonObject buildStreamSettings(const ServerProfile& profile);
+    static QJsonObject buildStreamSettings(const ServerProfile& profile, const XrayCapabilities& core);
 };
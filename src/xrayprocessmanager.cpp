@@ -1,6 +1,7 @@
 module;
 #include <QFileInfo>
 #include <QProcess>
+#include <QProcessEnvironment>
 #include <QRegularExpression>
 #include <QTimer>
 
@@ -26,6 +27,11 @@ void XrayProcessManager::setWorkingDirectory(const QString& path)
     m_workingDirectory = path;
 }
 
+void XrayProcessManager::setAssetDirectory(const QString& path)
+{
+    m_assetDirectory = path;
+}
+
 QString XrayProcessManager::executablePath() const
 {
     return m_executablePath;
@@ -86,6 +92,12 @@ bool XrayProcessManager::start(const QString& configPath, QString *errorMessage)
         m_process.setWorkingDirectory(m_workingDirectory);
     }
 
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    if (!m_assetDirectory.trimmed().isEmpty()) {
+        environment.insert(QStringLiteral("XRAY_LOCATION_ASSET"), m_assetDirectory);
+    }
+    m_process.setProcessEnvironment(environment);
+
     m_process.start();
     Q_UNUSED(errorMessage)
     return true;
@@ -59,6 +59,12 @@ public:
      */
     void setWorkingDirectory(const QString& path);
 
+    /**
+     * @brief Set xray asset directory (`XRAY_LOCATION_ASSET`) for launched process.
+     * @param path Asset directory; empty keeps the core's default lookup.
+     */
+    void setAssetDirectory(const QString& path);
+
     /**
      * @brief Current executable path.
      * @return Executable path string.
@@ -159,6 +165,7 @@ private:
     QProcess m_process;          //!< Managed Xray child process.
     QString m_executablePath;    //!< Resolved executable path.
     QString m_workingDirectory;  //!< Working directory for process.
+    QString m_assetDirectory;    //!< Asset directory override; empty uses the default.
     QByteArray m_stdoutBuffer;   //!< Buffered stdout bytes for line splitting.
     QByteArray m_stderrBuffer;   //!< Buffered stderr bytes for line splitting.
 
@@ -95,6 +95,9 @@ ApplicationWindow {
     property int editProfileRow: -1
     property string editProfileName: ""
     property string editProfileGroup: ""
+    property var editProfileTuning: ({})
+    // Live speed-test figures; republished at most once per frame.
+    readonly property var speedTest: vpnController.speedTestSnapshot
     property real speedGaugeDisplayMbps: 0.0
     property string speedGaugeRangePreset: "Auto"
     property var downRateHistoryMbps: []
@@ -771,9 +774,48 @@ ApplicationWindow {
         editProfileRow = row
         editProfileName = (displayName || "").trim()
         editProfileGroup = normalizeImportGroupName(groupName || "General")
+        editProfileTuning = vpnController.profileTransportTuning(row)
         editProfilePopup.open()
     }
 
+    function tuningSwitchIndex(value) {
+        return value === undefined ? 0 : (value ? 1 : 2)
+    }
+
+    function tuningNumberText(value) {
+        return value === undefined ? "" : String(value)
+    }
+
+    function collectEditProfileTuning() {
+        const tuning = {}
+        const switches = [
+            ["mux", editTuningMuxBox], ["tcpFastOpen", editTuningFastOpenBox],
+            ["tcpNoDelay", editTuningNoDelayBox], ["tcpMptcp", editTuningMptcpBox],
+            ["fragment", editTuningFragmentBox]
+        ]
+        for (let i = 0; i < switches.length; ++i) {
+            const index = switches[i][1].currentIndex
+            if (index > 0) {
+                tuning[switches[i][0]] = index === 1
+            }
+        }
+        const numbers = [
+            ["muxConcurrency", editTuningMuxConcurrencyField], ["xudpConcurrency", editTuningXudpField],
+            ["tcpKeepAliveIdle", editTuningKeepAliveField], ["bufferSizeKb", editTuningBufferField],
+            ["connIdle", editTuningConnIdleField]
+        ]
+        for (let j = 0; j < numbers.length; ++j) {
+            const text = numbers[j][1].text.trim()
+            if (text.length > 0) {
+                tuning[numbers[j][0]] = parseInt(text)
+            }
+        }
+        if (editTuningCongestionBox.currentIndex > 0) {
+            tuning.tcpCongestion = editTuningCongestionBox.currentText
+        }
+        return tuning
+    }
+
     function sheetWidth(maxWidth) {
         return root.width
     }
@@ -902,10 +944,10 @@ ApplicationWindow {
 
         const observed = Math.max(
                     0.0,
-                    vpnController.speedTestCurrentMbps,
-                    vpnController.speedTestDownloadMbps,
-                    vpnController.speedTestUploadMbps,
-                    vpnController.speedTestAverageMbps,
+                    speedTest.currentMbps,
+                    speedTest.downloadMbps,
+                    speedTest.uploadMbps,
+                    speedTest.averageMbps,
                     speedGaugeDisplayMbps)
 
         if (observed <= 100.0)
@@ -923,14 +965,14 @@ ApplicationWindow {
     function speedGaugeTargetValue() {
         const maxMbps = speedGaugeMaxMbps()
         if (vpnController.speedTestRunning) {
-            const live = Math.min(Math.max(vpnController.speedTestCurrentMbps, 0.0), maxMbps)
+            const live = Math.min(Math.max(speedTest.currentMbps, 0.0), maxMbps)
             if (live > 0.05)
                 return live
             // Keep the needle from hard-snapping to zero during phase transitions.
             return Math.min(Math.max(speedGaugeDisplayMbps * 0.95, 0.0), maxMbps)
         }
-        if (vpnController.speedTestState === "Completed")
-            return Math.min(Math.max(vpnController.speedTestAverageMbps, 0.0), maxMbps)
+        if (speedTest.phase === SpeedTestPhase.Completed)
+            return Math.min(Math.max(speedTest.averageMbps, 0.0), maxMbps)
         return 0.0
     }
 
@@ -952,22 +994,22 @@ ApplicationWindow {
     }
 
     function speedPhaseProgress() {
-        if (vpnController.speedTestDurationSec <= 0)
+        if (speedTest.durationSec <= 0)
             return 0.0
-        return Math.max(0.0, Math.min(vpnController.speedTestElapsedSec / vpnController.speedTestDurationSec, 1.0))
+        return Math.max(0.0, Math.min(speedTest.elapsedSec / speedTest.durationSec, 1.0))
     }
 
     function speedTestStatusText() {
         if (vpnController.speedTestRunning) {
-            if (vpnController.speedTestPhase === "Latency")
+            if (speedTest.phase === SpeedTestPhase.Latency)
                 return "Measuring latency and jitter..."
-            if (vpnController.speedTestPhase === "Download")
+            if (speedTest.phase === SpeedTestPhase.Download)
                 return "Measuring live download throughput..."
-            if (vpnController.speedTestPhase === "Upload")
+            if (speedTest.phase === SpeedTestPhase.Upload)
                 return "Measuring live upload throughput..."
-            if (vpnController.speedTestState === "Analyzing")
+            if (speedTest.phase === SpeedTestPhase.Analyzing)
                 return "Analyzing connection quality..."
-            if (vpnController.speedTestState === "Preparing")
+            if (speedTest.phase === SpeedTestPhase.Preparing)
                 return "Preparing diagnostics..."
             return "Running..."
         }
@@ -981,78 +1023,86 @@ ApplicationWindow {
             return "Error: " + (vpnController.speedTestError === "Operation canceled"
                                  ? "Speed test timed out or endpoint did not respond."
                                  : vpnController.speedTestError)
-        if (vpnController.speedTestState === "Completed")
-            return vpnController.speedTestQualityScore >= 0
+        if (speedTest.phase === SpeedTestPhase.Completed) {
+            const completed = vpnController.speedTestQualityScore >= 0
                     ? ("Completed • Quality " + vpnController.speedTestQualityScore + "/100")
                     : "Completed"
-        if (vpnController.speedTestState === "Cancelled")
+            return vpnController.speedTestBufferbloatGrade.length > 0
+                    ? (completed + " • Bufferbloat " + vpnController.speedTestBufferbloatGrade)
+                    : completed
+        }
+        if (speedTest.phase === SpeedTestPhase.Cancelled)
             return "Cancelled"
         return "Ready"
     }
 
     function speedTestHeroTitle() {
         if (vpnController.speedTestRunning) {
-            if (vpnController.speedTestPhase === "Download")
+            if (speedTest.phase === SpeedTestPhase.Download)
                 return "Live download"
-            if (vpnController.speedTestPhase === "Upload")
+            if (speedTest.phase === SpeedTestPhase.Upload)
                 return "Live upload"
-            if (vpnController.speedTestPhase === "Latency")
+            if (speedTest.phase === SpeedTestPhase.Latency)
                 return "Latency probe"
             return "Running test"
         }
-        if (vpnController.speedTestState === "Completed")
+        if (speedTest.phase === SpeedTestPhase.Completed)
             return "Overall average"
         return "Speed estimate"
     }
 
     function speedTestHeroValueText() {
         if (vpnController.speedTestRunning)
-            return Math.max(vpnController.speedTestCurrentMbps, 0.0).toFixed(2)
-        if (vpnController.speedTestState === "Completed")
-            return Math.max(vpnController.speedTestAverageMbps, 0.0).toFixed(2)
+            return Math.max(speedTest.currentMbps, 0.0).toFixed(2)
+        if (speedTest.phase === SpeedTestPhase.Completed)
+            return Math.max(speedTest.averageMbps, 0.0).toFixed(2)
         return "0.00"
     }
 
     function speedTestHeroCaption() {
         if (vpnController.speedTestRunning) {
-            if (vpnController.speedTestPhase === "Download")
+            if (speedTest.phase === SpeedTestPhase.Download)
                 return "Current tunnel download rate"
-            if (vpnController.speedTestPhase === "Upload")
+            if (speedTest.phase === SpeedTestPhase.Upload)
                 return "Current tunnel upload rate"
-            if (vpnController.speedTestPhase === "Latency")
+            if (speedTest.phase === SpeedTestPhase.Latency)
                 return "Collecting response-time baseline"
             return "Collecting measurements"
         }
-        if (vpnController.speedTestState === "Completed")
+        if (speedTest.phase === SpeedTestPhase.Completed)
             return "Mean of final download and upload results"
         return "Run a diagnostics pass through the active VPN"
     }
 
     function speedTestProgressText() {
-        if (vpnController.speedTestState === "Completed")
+        if (speedTest.phase === SpeedTestPhase.Completed)
             return vpnController.speedTestQualityScore >= 0
                     ? ("Quality " + vpnController.speedTestQualityScore + "/100")
                     : "Completed"
-        if (vpnController.speedTestRunning)
-            return "Progress " + Math.round(Math.max(0, Math.min(vpnController.speedTestProgress, 1.0)) * 100) + "%"
+        if (vpnController.speedTestRunning) {
+            const progress = "Progress " + Math.round(Math.max(0, Math.min(speedTest.progress, 1.0)) * 100) + "%"
+            return speedTest.streamCount > 1
+                    ? (progress + " • " + speedTest.streamCount + " streams")
+                    : progress
+        }
         return "--"
     }
 
     function speedTestPhaseBadgeText() {
         if (vpnController.speedTestRunning)
-            return "Phase " + vpnController.speedTestPhase
-        return vpnController.speedTestState === "Idle" ? "Ready" : vpnController.speedTestState
+            return "Phase " + speedTest.phaseName
+        return speedTest.phase === SpeedTestPhase.Idle ? "Ready" : speedTest.state
     }
 
     function speedTestFooterText() {
-        const down = vpnController.speedTestDownloadMbps > 0 ? vpnController.speedTestDownloadMbps.toFixed(1) + " Mbps" : "--"
-        const up = vpnController.speedTestUploadMbps > 0 ? vpnController.speedTestUploadMbps.toFixed(1) + " Mbps" : "--"
+        const down = speedTest.downloadMbps > 0 ? speedTest.downloadMbps.toFixed(1) + " Mbps" : "--"
+        const up = speedTest.uploadMbps > 0 ? speedTest.uploadMbps.toFixed(1) + " Mbps" : "--"
         return "DL " + down + "  |  UL " + up
     }
 
     function speedOverallDisplayText() {
-        if (vpnController.speedTestState === "Completed")
-            return Math.max(vpnController.speedTestAverageMbps, 0.0).toFixed(2) + " Mbps"
+        if (speedTest.phase === SpeedTestPhase.Completed)
+            return Math.max(speedTest.averageMbps, 0.0).toFixed(2) + " Mbps"
         return "--"
     }
 
@@ -1071,19 +1121,19 @@ ApplicationWindow {
     function speedMetricValue(index) {
         switch (index) {
         case 0:
-            return vpnController.speedTestDownloadMbps > 0 ? (vpnController.speedTestDownloadMbps.toFixed(2) + " Mbps") : "--"
+            return speedTest.downloadMbps > 0 ? (speedTest.downloadMbps.toFixed(2) + " Mbps") : "--"
         case 1:
-            return vpnController.speedTestUploadMbps > 0 ? (vpnController.speedTestUploadMbps.toFixed(2) + " Mbps") : "--"
+            return speedTest.uploadMbps > 0 ? (speedTest.uploadMbps.toFixed(2) + " Mbps") : "--"
         case 2:
-            return vpnController.speedTestPingMs >= 0 ? (vpnController.speedTestPingMs + " ms") : "--"
+            return speedTest.pingMs >= 0 ? (speedTest.pingMs + " ms") : "--"
         case 3:
-            return vpnController.speedTestJitterMs >= 0 ? (vpnController.speedTestJitterMs + " ms") : "--"
+            return speedTest.jitterMs >= 0 ? (speedTest.jitterMs + " ms") : "--"
         case 4:
             return speedOverallDisplayText()
         case 5:
             return vpnController.speedTestQualityScore >= 0
                     ? (vpnController.speedTestQualityScore + "/100")
-                    : (Math.round(Math.max(0, Math.min(vpnController.speedTestProgress, 1.0)) * 100) + "%")
+                    : (Math.round(Math.max(0, Math.min(speedTest.progress, 1.0)) * 100) + "%")
         default:
             return "--"
         }
@@ -2655,7 +2705,7 @@ ApplicationWindow {
                         anchors.centerIn: parent
                         visible: listView.count === 0 || (listView.count > 0 && listView.contentHeight < 2)
                         text: listView.count === 0
-                              ? "No profiles. Import one first."
+                              ? (vpnController.startupLoading ? "Loading profiles..." : "No profiles. Import one first.")
                               : "No matching profile found."
                         color: root.themeColorToken("mainHex_8f9bad", "mainHex_9eb3cc")
                         font.family: FontSystem.contentFontFamily
@@ -2767,7 +2817,7 @@ ApplicationWindow {
         focus: true
         closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
         width: root.sheetWidth(420)
-        height: Math.min(root.height - 58, 294)
+        height: Math.min(root.height - 58, 610)
         x: (root.width - width) * 0.5
         y: root.drawerY(height)
         padding: 0
@@ -2849,6 +2899,151 @@ ApplicationWindow {
                 wrapMode: Text.WordWrap
             }
 
+            Text {
+                text: "Transport Tuning"
+                color: root.themeColorToken("mainHex_1f2530", "mainHex_d8e1f0")
+                font.family: FontSystem.getContentFontBold.name
+                font.pixelSize: 14
+                font.bold: true
+            }
+
+            GridLayout {
+                Layout.fillWidth: true
+                columns: 2
+                columnSpacing: 10
+                rowSpacing: 8
+
+                ComboBox {
+                    id: editTuningMuxBox
+                    Layout.fillWidth: true
+                    model: ["Mux: Default", "Mux: On", "Mux: Off"]
+                    currentIndex: root.tuningSwitchIndex(root.editProfileTuning.mux)
+                }
+
+                TextField {
+                    id: editTuningMuxConcurrencyField
+                    Layout.fillWidth: true
+                    text: root.tuningNumberText(root.editProfileTuning.muxConcurrency)
+                    placeholderText: "Mux concurrency (8)"
+                    validator: IntValidator { bottom: 1; top: 128 }
+                    selectByMouse: true
+                }
+
+                TextField {
+                    id: editTuningXudpField
+                    Layout.fillWidth: true
+                    text: root.tuningNumberText(root.editProfileTuning.xudpConcurrency)
+                    placeholderText: "XUDP concurrency"
+                    validator: IntValidator { bottom: 1; top: 1024 }
+                    selectByMouse: true
+                }
+
+                ComboBox {
+                    id: editTuningCongestionBox
+                    Layout.fillWidth: true
+                    model: ["Congestion: Default", "bbr", "cubic", "reno"]
+                    currentIndex: ["bbr", "cubic", "reno"].indexOf(root.editProfileTuning.tcpCongestion || "") + 1
+                }
+
+                ComboBox {
+                    id: editTuningFastOpenBox
+                    Layout.fillWidth: true
+                    model: ["TCP Fast Open: Default", "TCP Fast Open: On", "TCP Fast Open: Off"]
+                    currentIndex: root.tuningSwitchIndex(root.editProfileTuning.tcpFastOpen)
+                }
+
+                ComboBox {
+                    id: editTuningNoDelayBox
+                    Layout.fillWidth: true
+                    model: ["No Delay: Default", "No Delay: On", "No Delay: Off"]
+                    currentIndex: root.tuningSwitchIndex(root.editProfileTuning.tcpNoDelay)
+                }
+
+                ComboBox {
+                    id: editTuningMptcpBox
+                    Layout.fillWidth: true
+                    model: ["MPTCP: Default", "MPTCP: On", "MPTCP: Off"]
+                    currentIndex: root.tuningSwitchIndex(root.editProfileTuning.tcpMptcp)
+                }
+
+                ComboBox {
+                    id: editTuningFragmentBox
+                    Layout.fillWidth: true
+                    model: ["Reality Fragment: Default", "Reality Fragment: On", "Reality Fragment: Off"]
+                    currentIndex: root.tuningSwitchIndex(root.editProfileTuning.fragment)
+                }
+
+                TextField {
+                    id: editTuningKeepAliveField
+                    Layout.fillWidth: true
+                    text: root.tuningNumberText(root.editProfileTuning.tcpKeepAliveIdle)
+                    placeholderText: "Keep-alive idle (s)"
+                    validator: IntValidator { bottom: 1; top: 7200 }
+                    selectByMouse: true
+                }
+
+                TextField {
+                    id: editTuningBufferField
+                    Layout.fillWidth: true
+                    text: root.tuningNumberText(root.editProfileTuning.bufferSizeKb)
+                    placeholderText: "Buffer size (KB)"
+                    validator: IntValidator { bottom: 0; top: 65536 }
+                    selectByMouse: true
+                }
+
+                TextField {
+                    id: editTuningConnIdleField
+                    Layout.fillWidth: true
+                    text: root.tuningNumberText(root.editProfileTuning.connIdle)
+                    placeholderText: "Idle timeout (s)"
+                    validator: IntValidator { bottom: 1; top: 86400 }
+                    selectByMouse: true
+                }
+            }
+
+            Text {
+                Layout.fillWidth: true
+                text: "Empty fields use the global defaults. Options the installed core does not support are left out of the config."
+                color: root.themeColorToken("mainHex_7c8697", "mainHex_9bb0cb")
+                font.family: FontSystem.contentFontFamily
+                font.pixelSize: 12
+                wrapMode: Text.WordWrap
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                spacing: 10
+
+                Controls.Button {
+                    text: vpnController.transportTunerRunning ? "Stop Tuning" : "Auto-Tune"
+                    onClicked: {
+                        if (vpnController.transportTunerRunning) {
+                            vpnController.cancelTransportTuner()
+                        } else {
+                            vpnController.startTransportTuner(root.editProfileRow)
+                        }
+                    }
+                }
+
+                Text {
+                    Layout.fillWidth: true
+                    text: vpnController.transportTunerStatus
+                    color: root.themeColorToken("mainHex_7c8697", "mainHex_9bb0cb")
+                    font.family: FontSystem.contentFontFamily
+                    font.pixelSize: 12
+                    elide: Text.ElideRight
+                }
+            }
+
+            Connections {
+                target: vpnController
+                function onTransportTunerChanged() {
+                    if (!vpnController.transportTunerRunning && editProfilePopup.opened) {
+                        root.editProfileTuning = vpnController.profileTransportTuning(root.editProfileRow)
+                    }
+                }
+            }
+
             Item { Layout.fillHeight: true }
 
             RowLayout {
@@ -2868,7 +3063,10 @@ ApplicationWindow {
                         if (vpnController.updateProfileBasics(
                                     root.editProfileRow,
                                     editProfileNameField.text,
-                                    editProfileGroupField.text)) {
+                                    editProfileGroupField.text)
+                                && vpnController.updateProfileTransportTuning(
+                                    root.editProfileRow,
+                                    root.collectEditProfileTuning())) {
                             editProfilePopup.close()
                             root.syncSelectedProfileFromController()
                             Qt.callLater(root.positionProfilePopup)
@@ -3820,6 +4018,93 @@ ApplicationWindow {
                             onTextChanged: vpnController.blockDomainRules = text
                         }
 
+                        Text {
+                            visible: root.settingsSection === "routing"
+                            text: "Rule Sources"
+                            color: root.themeColorToken("mainHex_667081", "mainHex_9ab0ca")
+                            font.family: FontSystem.contentFontFamily
+                            font.pixelSize: 14
+                        }
+
+                        Text {
+                            Layout.fillWidth: true
+                            visible: root.settingsSection === "routing"
+                            text: "Large lists from a local file or URL (one entry per line, hosts files supported). URLs refresh in the background; big lists are compiled to rule assets instead of the runtime config."
+                            wrapMode: Text.Wrap
+                            color: root.themeColorToken("mainHex_8a95a8", "mainHex_9eb2cb")
+                            font.family: FontSystem.contentFontFamily
+                            font.pixelSize: 12
+                        }
+
+                        RowLayout {
+                            Layout.fillWidth: true
+                            visible: root.settingsSection === "routing"
+                            spacing: 8
+
+                            TextField {
+                                id: ruleSourceField
+                                Layout.fillWidth: true
+                                Layout.preferredHeight: 40
+                                placeholderText: "https://example.com/list.txt or /path/to/list.txt"
+                                selectByMouse: true
+                            }
+
+                            Controls.ComboBox {
+                                id: ruleSourceTargetCombo
+                                Layout.preferredWidth: 110
+                                Layout.preferredHeight: 40
+                                model: ["proxy", "direct", "block"]
+                            }
+
+                            Controls.Button {
+                                text: "Add"
+                                enabled: ruleSourceField.text.trim().length > 0
+                                onClicked: {
+                                    if (vpnController.addRuleSource(ruleSourceField.text, ruleSourceTargetCombo.currentText)) {
+                                        ruleSourceField.text = ""
+                                    }
+                                }
+                            }
+                        }
+
+                        Repeater {
+                            model: root.settingsSection === "routing" ? vpnController.ruleSourceItems : []
+
+                            delegate: RowLayout {
+                                required property var modelData
+                                required property int index
+                                Layout.fillWidth: true
+                                spacing: 8
+
+                                Text {
+                                    Layout.fillWidth: true
+                                    text: modelData.target + " · " + modelData.location
+                                          + " · " + modelData.entries + " entries"
+                                          + (modelData.updatedAt ? " · " + modelData.updatedAt : "")
+                                          + (modelData.error ? " · " + modelData.error : "")
+                                    elide: Text.ElideMiddle
+                                    color: modelData.error
+                                           ? root.themeColorToken("mainHex_d97706", "mainHex_f59e0b")
+                                           : root.themeColorToken("mainHex_334155", "mainHex_d7e4f6")
+                                    font.family: FontSystem.contentFontFamily
+                                    font.pixelSize: 12
+                                }
+
+                                Controls.Button {
+                                    text: "Remove"
+                                    onClicked: vpnController.removeRuleSource(index)
+                                }
+                            }
+                        }
+
+                        Controls.Button {
+                            visible: root.settingsSection === "routing" && vpnController.ruleSourceItems.length > 0
+                            Layout.fillWidth: true
+                            enabled: !vpnController.ruleSourcesBusy
+                            text: vpnController.ruleSourcesBusy ? "Refreshing Rule Sources..." : "Refresh Rule Sources"
+                            onClicked: vpnController.refreshRuleSources()
+                        }
+
                         Rectangle {
                             id: customDnsCard
                             Layout.fillWidth: true
@@ -5582,7 +5867,7 @@ ApplicationWindow {
                         Layout.preferredWidth: 1
                         Layout.preferredHeight: index < 2 ? 72 : 60
                         radius: 16
-                        color: (vpnController.speedTestState === "Completed" || vpnController.speedTestRunning)
+                        color: (speedTest.phase === SpeedTestPhase.Completed || vpnController.speedTestRunning)
                                ? root.themeColorToken("mainHex_f3f8ff", "mainHex_151c32")
                                : root.themeColorToken("mainHex_f9fbff", "mainHex_151c32")
                         border.width: 0
@@ -5615,7 +5900,7 @@ ApplicationWindow {
                 spacing: 8
 
                 Text {
-                    text: "Route stability " + ((vpnController.speedTestRunning || vpnController.speedTestState === "Completed")
+                    text: "Route stability " + ((vpnController.speedTestRunning || speedTest.phase === SpeedTestPhase.Completed)
                                                 ? (vpnController.speedTestRouteStabilityPct + "%")
                                                 : "--")
                     color: root.themeColorToken("mainHex_5d6d84", "mainHex_9db2cc")
@@ -5843,6 +6128,94 @@ ApplicationWindow {
                     }
                 }
             }
+
+            Rectangle {
+                Layout.fillWidth: true
+                Layout.preferredHeight: 132
+                Layout.minimumHeight: 132
+                radius: 16
+                color: root.themeColorToken("mainHex_f7f9fc", "mainHex_151c32")
+                border.width: 0
+
+                ColumnLayout {
+                    anchors.fill: parent
+                    anchors.margins: 12
+                    spacing: 8
+
+                    RowLayout {
+                        Layout.fillWidth: true
+                        spacing: 10
+
+                        Text {
+                            text: "Group Benchmark"
+                            color: root.themeColorToken("mainHex_3f4d63", "mainHex_d7e4f6")
+                            font.family: FontSystem.contentFontFamily
+                            font.pixelSize: 14
+                            font.bold: true
+                        }
+
+                        Text {
+                            Layout.fillWidth: true
+                            text: vpnController.batchSpeedTestStatus
+                            color: root.themeColorToken("mainHex_7c8697", "mainHex_9bb0cb")
+                            font.family: FontSystem.contentFontFamily
+                            font.pixelSize: 12
+                            elide: Text.ElideRight
+                        }
+
+                        Controls.Button {
+                            text: vpnController.batchSpeedTestRunning ? "Stop" : "Benchmark Group"
+                            enabled: vpnController.batchSpeedTestRunning || !vpnController.speedTestRunning
+                            onClicked: {
+                                if (vpnController.batchSpeedTestRunning) {
+                                    vpnController.cancelBatchSpeedTest()
+                                } else {
+                                    vpnController.startBatchSpeedTest()
+                                }
+                            }
+                        }
+                    }
+
+                    ListView {
+                        Layout.fillWidth: true
+                        Layout.fillHeight: true
+                        clip: true
+                        spacing: 2
+                        model: vpnController.batchSpeedTestResults
+                        boundsBehavior: Flickable.StopAtBounds
+
+                        delegate: Item {
+                            required property var modelData
+                            width: ListView.view.width
+                            height: 24
+
+                            Text {
+                                anchors.verticalCenter: parent.verticalCenter
+                                width: parent.width - 6
+                                text: modelData.ok
+                                      ? ("#" + modelData.rank + "  " + modelData.label + "  •  "
+                                         + modelData.throughputMbps.toFixed(2) + " Mbps  •  " + modelData.latencyMs + " ms")
+                                      : (modelData.label + "  •  " + (modelData.measured ? modelData.error : "pending"))
+                                elide: Text.ElideRight
+                                color: modelData.ok
+                                       ? root.themeColorToken("mainHex_586780", "mainHex_b0c3db")
+                                       : root.themeColorToken("mainHex_8a95a8", "mainHex_9eb2cb")
+                                font.family: FontSystem.contentFontFamily
+                                font.pixelSize: 13
+                            }
+
+                            MouseArea {
+                                anchors.fill: parent
+                                enabled: modelData.ok && modelData.row >= 0
+                                cursorShape: enabled ? Qt.PointingHandCursor : Qt.ArrowCursor
+                                onClicked: vpnController.currentProfileIndex = modelData.row
+                            }
+                        }
+
+                        ScrollBar.vertical: ScrollBar { }
+                    }
+                }
+            }
             }
         }
     }